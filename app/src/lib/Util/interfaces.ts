@@ -170,4 +170,13 @@ export interface PluginConfig {
 	version?: string;
 	description?: string;
 	main?: string;
+	limits?: PluginLimits;
+}
+
+// time limits for a plugin, overriding the game client's defaults (see plugin.c)
+export interface PluginLimits {
+	frame_budget_us?: number;
+	call_limit_us?: number;
+	max_violations?: number;
+	hook_instructions?: number;
 }
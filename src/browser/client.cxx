@@ -340,6 +340,25 @@ bool Browser::Client::IPCHandleMessage(int fd) {
 			this->IPCHandleClientListUpdate();
 			break;
 		}
+		case IPC_MSG_PLUGINPROFILE: {
+			std::vector<GameClient::PluginProfile> profiles(message.items);
+			for (GameClient::PluginProfile& profile: profiles) {
+				uint32_t id_length;
+				_bolt_ipc_receive(fd, &id_length, sizeof(id_length));
+				profile.id.resize(id_length);
+				_bolt_ipc_receive(fd, profile.id.data(), id_length);
+				_bolt_ipc_receive(fd, profile.callbacks, sizeof(profile.callbacks));
+			}
+			this->game_clients_lock.lock();
+			for (GameClient& g: this->game_clients) {
+				if (g.fd == fd) {
+					g.plugin_profiles = std::move(profiles);
+					break;
+				}
+			}
+			this->game_clients_lock.unlock();
+			break;
+		}
 		default: {
 			fmt::print("[I] got unknown message type {}\n", (int)message.message_type);
 			break;
@@ -362,6 +381,27 @@ CefRefPtr<CefResourceRequestHandler> Browser::Client::ListGameClients() {
 		if (g.identity) {
 			inner_dict->SetString("identity", g.identity);
 		}
+		if (!g.plugin_profiles.empty()) {
+			// callback names are in the same order as IPC_PROFILE_CALLBACK_TYPES
+			const char* const callback_names[IPC_PROFILE_CALLBACK_TYPES] = {"swapbuffers", "2d", "3d", "minimap", "mousemotion", "mousebutton", "scroll", "window"};
+			CefRefPtr<CefDictionaryValue> profiles_dict = CefDictionaryValue::Create();
+			for (const GameClient::PluginProfile& profile: g.plugin_profiles) {
+				CefRefPtr<CefDictionaryValue> profile_dict = CefDictionaryValue::Create();
+				for (size_t i = 0; i < IPC_PROFILE_CALLBACK_TYPES; i += 1) {
+					const BoltIPCPluginProfile& p = profile.callbacks[i];
+					if (!p.count) continue;
+					CefRefPtr<CefDictionaryValue> callback_dict = CefDictionaryValue::Create();
+					callback_dict->SetDouble("count", (double)p.count);
+					callback_dict->SetDouble("total_us", (double)p.total_us);
+					callback_dict->SetDouble("avg_us", (double)p.total_us / (double)p.count);
+					callback_dict->SetDouble("max_us", (double)p.max_us);
+					callback_dict->SetDouble("memory_delta", (double)p.memory_delta);
+					profile_dict->SetDictionary(callback_names[i], callback_dict);
+				}
+				profiles_dict->SetDictionary(profile.id, profile_dict);
+			}
+			inner_dict->SetDictionary("plugins", profiles_dict);
+		}
 		dict->SetDictionary(buf, inner_dict);
 	}
 	this->game_clients_lock.unlock();
@@ -371,11 +411,11 @@ CefRefPtr<CefResourceRequestHandler> Browser::Client::ListGameClients() {
 	return new ResourceHandler(std::move(str), 200, "application/json");
 }
 
-void Browser::Client::StartPlugin(uint64_t client_id, std::string id, std::string path, std::string main) {
+void Browser::Client::StartPlugin(uint64_t client_id, std::string id, std::string path, std::string main, const BoltIPCPluginLimits& limits) {
 	this->game_clients_lock.lock();
 	for (const GameClient& g: this->game_clients) {
 		if (g.uid == client_id) {
-			const size_t message_size = sizeof(BoltIPCMessageToClient) + (sizeof(uint32_t) * 3) + id.size() + path.size() + main.size();
+			const size_t message_size = sizeof(BoltIPCMessageToClient) + (sizeof(uint32_t) * 3) + id.size() + path.size() + main.size() + sizeof(limits);
 			uint8_t* message = new uint8_t[message_size];
 			*(BoltIPCMessageToClient*)message = {.message_type = IPC_MSG_STARTPLUGINS, .items = 1};
 			size_t pos = sizeof(BoltIPCMessageToClient);
@@ -390,6 +430,8 @@ void Browser::Client::StartPlugin(uint64_t client_id, std::string id, std::strin
 			memcpy(message + pos, path.data(), path.size());
 			pos += path.size();
 			memcpy(message + pos, main.data(), main.size());
+			pos += main.size();
+			memcpy(message + pos, &limits, sizeof(limits));
 			_bolt_ipc_send(g.fd, message, message_size);
 			delete[] message;
 			break;
@@ -398,6 +440,18 @@ void Browser::Client::StartPlugin(uint64_t client_id, std::string id, std::strin
 	this->game_clients_lock.unlock();
 }
 
+void Browser::Client::DumpTrace(uint64_t client_id) {
+	this->game_clients_lock.lock();
+	for (const GameClient& g: this->game_clients) {
+		if (g.uid == client_id) {
+			const BoltIPCMessageToClient message = {.message_type = IPC_MSG_DUMPTRACE, .items = 0};
+			_bolt_ipc_send(g.fd, &message, sizeof(message));
+			break;
+		}
+	}
+	this->game_clients_lock.unlock();
+}
+
 void Browser::Client::OnWindowCreated(CefRefPtr<CefWindow> window) {
 	// used only for dummy IPC window; real browsers have their own OnWindowCreated override
 	this->ipc_window = window;
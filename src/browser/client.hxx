@@ -15,6 +15,8 @@
 #endif
 
 #if defined(BOLT_PLUGINS)
+#include "../library/ipc.h"
+#include <string>
 #include <thread>
 #endif
 
@@ -87,8 +89,12 @@ namespace Browser {
 		/// Returns true on success, false on failure.
 		bool IPCHandleMessage(int fd);
 
-		/// Sends an IPC message to the named client to start a plugin.
-		void StartPlugin(uint64_t client_id, std::string id, std::string path, std::string main);
+		/// Sends an IPC message to the named client to start a plugin. Any limits which are 0 will use
+		/// the client's defaults.
+		void StartPlugin(uint64_t client_id, std::string id, std::string path, std::string main, const BoltIPCPluginLimits& limits);
+
+		/// Sends an IPC message to the named client to write its trace buffer to a file.
+		void DumpTrace(uint64_t client_id);
 
 		/* CefWindowDelegate overrides */
 		void OnWindowCreated(CefRefPtr<CefWindow>) override;
@@ -160,11 +166,17 @@ namespace Browser {
 #endif
 
 #if defined(BOLT_PLUGINS)
+			struct PluginProfile {
+				std::string id;
+				BoltIPCPluginProfile callbacks[IPC_PROFILE_CALLBACK_TYPES];
+			};
 			struct GameClient {
 				uint64_t uid;
 				int fd;
 				// identity may be null if game hasn't reported its identity yet or display name is unset
 				char* identity;
+				// most recent profiling data reported by this client, one entry per running plugin
+				std::vector<PluginProfile> plugin_profiles;
 			};
 			std::thread ipc_thread;
 			int ipc_fd;
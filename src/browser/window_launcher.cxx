@@ -353,6 +353,21 @@ CefRefPtr<CefResourceRequestHandler> Browser::Launcher::GetResourceRequestHandle
 				bool has_main  = false;
 				std::string_view client;
 				bool has_client  = false;
+				// optional, from the plugin's bolt.json; 0 means the client's default
+				BoltIPCPluginLimits limits = {};
+				bool bad_limit = false;
+				auto parse_limit = [&bad_limit](std::string_view val, uint32_t& out) {
+					uint64_t n = 0;
+					for (auto it = val.begin(); it != val.end(); it += 1) {
+						if (*it < '0' || *it > '9' || n > UINT32_MAX) {
+							bad_limit = true;
+							return;
+						}
+						n = (n * 10) + (*it - '0');
+					}
+					if (n > UINT32_MAX) bad_limit = true;
+					else out = (uint32_t)n;
+				};
 				size_t pos = 0;
 				while (true) {
 					size_t next_and = query.find('&', pos);
@@ -378,11 +393,19 @@ CefRefPtr<CefResourceRequestHandler> Browser::Launcher::GetResourceRequestHandle
 					} else if (key == "client") {
 						has_client = true;
 						client = val;
+					} else if (key == "frame_budget_us") {
+						parse_limit(val, limits.frame_budget_us);
+					} else if (key == "call_limit_us") {
+						parse_limit(val, limits.call_limit_us);
+					} else if (key == "max_violations") {
+						parse_limit(val, limits.max_violations);
+					} else if (key == "hook_instructions") {
+						parse_limit(val, limits.hook_instructions);
 					}
 					if (is_last) break;
 					pos = next_and + 1;
 				}
-				if (!has_id || !has_path || !has_main || !has_client) {
+				if (!has_id || !has_path || !has_main || !has_client || bad_limit) {
 					const char* data = "Bad request\n";
 					return new Browser::ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 400, "text/plain");
 				}
@@ -399,7 +422,8 @@ CefRefPtr<CefResourceRequestHandler> Browser::Launcher::GetResourceRequestHandle
 					client_id,
 					CefURIDecode(std::string(id), true, rule).ToString(),
 					CefURIDecode(std::string(path), true, rule).ToString(),
-					CefURIDecode(std::string(main), true, rule).ToString()
+					CefURIDecode(std::string(main), true, rule).ToString(),
+					limits
 				);
 				const char* data = "OK\n";
 				return new ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 200, "text/plain");
@@ -409,6 +433,30 @@ CefRefPtr<CefResourceRequestHandler> Browser::Launcher::GetResourceRequestHandle
 #endif
 		}
 
+		// request to send a message to a game client to write its trace buffer to a file
+		if (path == "/dump-trace") {
+#if defined(BOLT_PLUGINS)
+			if (!query.starts_with("client=") || query.size() == 7) {
+				const char* data = "Bad request\n";
+				return new Browser::ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 400, "text/plain");
+			}
+			uint64_t client_id = 0;
+			for (auto it = query.begin() + 7; it != query.end(); it += 1) {
+				if (*it < '0' || *it > '9') {
+					const char* data = "Bad request\n";
+					return new Browser::ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 400, "text/plain");
+				}
+				client_id = (client_id * 10) + (*it - '0');
+			}
+			this->client->DumpTrace(client_id);
+			const char* data = "OK\n";
+			return new ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 200, "text/plain");
+#else
+			const char* data = "Not supported\n";
+			return new Browser::ResourceHandler(reinterpret_cast<const unsigned char*>(data), strlen(data), 400, "text/plain");
+#endif
+		}
+
 		// instruction to try to open an external URL in the user's browser
 		if (path == "/open-external-url") {
 			CefRefPtr<CefPostData> post_data = request->GetPostData();
@@ -0,0 +1,72 @@
+#include "capture.h"
+
+#include "../rwlock/rwlock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define thread_local __declspec(thread)
+#else
+#define thread_local _Thread_local
+#endif
+
+// size of the stdio buffer for the capture file. payloads are often large, so a big buffer saves
+// a lot of write calls.
+#define CAPTURE_BUFFER_SIZE (4 * 1024 * 1024)
+
+uint8_t _bolt_capture_enabled = 0;
+
+// GL calls can come from any thread which has a context current, so everything below is protected
+// by `lock`, which also keeps each record contiguous in the file
+static RWLock lock;
+static FILE* file = NULL;
+static uint32_t next_thread_id = 1;
+static thread_local uint32_t thread_id = 0;
+
+void _bolt_capture_init() {
+    const char* path = getenv("BOLT_GL_CAPTURE");
+    if (!path || !*path) return;
+    file = fopen(path, "wb");
+    if (!file) {
+        printf("error: failed to open GL capture file %s\n", path);
+        return;
+    }
+    setvbuf(file, NULL, _IOFBF, CAPTURE_BUFFER_SIZE);
+    fwrite(CAPTURE_MAGIC, 1, strlen(CAPTURE_MAGIC), file);
+    _bolt_rwlock_init(&lock);
+    _bolt_capture_enabled = 1;
+    printf("capturing GL calls to %s\n", path);
+}
+
+void _bolt_capture_call(enum CaptureCall call, const uint64_t* args, uint32_t arg_count, const void* payload, size_t payload_size) {
+    if (!payload) payload_size = 0;
+    _bolt_rwlock_lock_write(&lock);
+    if (file) {
+        if (!thread_id) {
+            thread_id = next_thread_id;
+            next_thread_id += 1;
+        }
+        const struct CaptureRecord record = {.call = call, .thread = thread_id, .arg_count = arg_count, .payload_size = (uint32_t)payload_size};
+        fwrite(&record, sizeof(record), 1, file);
+        fwrite(args, sizeof(*args), arg_count, file);
+        if (payload_size) fwrite(payload, 1, payload_size, file);
+    }
+    _bolt_rwlock_unlock_write(&lock);
+}
+
+void _bolt_capture_flush() {
+    if (!_bolt_capture_enabled) return;
+    _bolt_rwlock_lock_write(&lock);
+    if (file) fflush(file);
+    _bolt_rwlock_unlock_write(&lock);
+}
+
+void _bolt_capture_close() {
+    if (!_bolt_capture_enabled) return;
+    _bolt_rwlock_lock_write(&lock);
+    if (file) fclose(file);
+    file = NULL;
+    _bolt_rwlock_unlock_write(&lock);
+}
@@ -0,0 +1,118 @@
+#ifndef _BOLT_LIBRARY_CAPTURE_H_
+#define _BOLT_LIBRARY_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// The hook functions in gl.c whose calls can be captured. These values are written to capture
+/// files, so new ones must only ever be added at the end.
+enum CaptureCall {
+    CAPTURE_SWAPBUFFERS,
+    CAPTURE_CREATECONTEXT,
+    CAPTURE_MAKECURRENT,
+    CAPTURE_DESTROYCONTEXT,
+    CAPTURE_GENTEXTURES,
+    CAPTURE_DRAWELEMENTS,
+    CAPTURE_DRAWARRAYS,
+    CAPTURE_BINDTEXTURE,
+    CAPTURE_TEXSUBIMAGE2D,
+    CAPTURE_DELETETEXTURES,
+    CAPTURE_CLEAR,
+    CAPTURE_VIEWPORT,
+    CAPTURE_CREATEPROGRAM,
+    CAPTURE_DELETEPROGRAM,
+    CAPTURE_BINDATTRIBLOCATION,
+    CAPTURE_LINKPROGRAM,
+    CAPTURE_USEPROGRAM,
+    CAPTURE_TEXSTORAGE2D,
+    CAPTURE_VERTEXATTRIBPOINTER,
+    CAPTURE_GENBUFFERS,
+    CAPTURE_BUFFERDATA,
+    CAPTURE_DELETEBUFFERS,
+    CAPTURE_BINDFRAMEBUFFER,
+    CAPTURE_COMPRESSEDTEXSUBIMAGE2D,
+    CAPTURE_COPYIMAGESUBDATA,
+    CAPTURE_ENABLEVERTEXATTRIBARRAY,
+    CAPTURE_DISABLEVERTEXATTRIBARRAY,
+    CAPTURE_MAPBUFFERRANGE,
+    CAPTURE_UNMAPBUFFER,
+    CAPTURE_BUFFERSTORAGE,
+    CAPTURE_FLUSHMAPPEDBUFFERRANGE,
+    CAPTURE_ACTIVETEXTURE,
+    CAPTURE_GENVERTEXARRAYS,
+    CAPTURE_DELETEVERTEXARRAYS,
+    CAPTURE_BINDVERTEXARRAY,
+    CAPTURE_BLITFRAMEBUFFER,
+    CAPTURE_BINDBUFFER,
+    CAPTURE_BINDBUFFERBASE,
+    CAPTURE_BINDBUFFERRANGE,
+    CAPTURE_UNIFORMBLOCKBINDING,
+    CAPTURE_UNIFORM1I,
+    CAPTURE_UNIFORM1IV,
+    CAPTURE_UNIFORM4F,
+    CAPTURE_UNIFORM4FV,
+    CAPTURE_UNIFORMMATRIX4FV,
+    CAPTURE_GENFRAMEBUFFERS,
+    CAPTURE_DELETEFRAMEBUFFERS,
+    CAPTURE_FRAMEBUFFERTEXTURE,
+    CAPTURE_FRAMEBUFFERTEXTURE2D,
+    CAPTURE_FRAMEBUFFERTEXTURELAYER,
+    CAPTURE_FRAMEBUFFERRENDERBUFFER,
+    CAPTURE_CALL_ENUM_SIZE, // last member of enum
+};
+
+/// A capture file starts with these 8 bytes, followed by one record per call. A record is a
+/// CaptureRecord, then `arg_count` uint64_t arguments, then `payload_size` bytes of payload (e.g.
+/// the contents of a buffer or texture upload). Arguments are in the same order as the parameters
+/// of the hook function. Pointers are stored as their numeric value, signed integers are sign-extended,
+/// and anything which can't be stored as an integer (floats, arrays, strings) is in the payload.
+/// Values returned or written out by GL, such as the names from glGen*, are recorded after the call.
+/// The payload of a glFlushMappedBufferRange record is the flushed range of the mapping, and the
+/// payload of a glUnmapBuffer record is the whole mapped range if the mapping was writable and not
+/// flushed explicitly, so a replay can copy these into its own mapping before making the call. This
+/// is done whether or not the mapping was intercepted by gl.c. A glLinkProgram record is made after
+/// the call, and its payload is described at CAPTURE_PROGRAM_NAMES.
+#define CAPTURE_MAGIC "BOLTCAP1"
+
+/// The uniforms and uniform block that gl.c looks up in every program it links. The payload of a
+/// glLinkProgram record is an int32_t for each of these, in this order: the location (or block
+/// index, for ViewTransforms) that GL returned, or -1 if the program doesn't have it. A replay needs
+/// these to make programs which gl.c will treat the same way, and to translate the locations in
+/// glUniform* records. New names must only ever be added at the end.
+#define CAPTURE_PROGRAM_NAMES "uDiffuseMap", "uProjectionMatrix", "uTextureAtlas", "uTextureAtlasSettings", "uAtlasMeta", \
+    "uModelMatrix", "uGridSize", "uVertexScale", "sSceneHDRTex", "sSourceTex", "ViewTransforms"
+
+struct CaptureRecord {
+    uint32_t call; // enum CaptureCall
+    uint32_t thread; // small number identifying the thread which made the call, starting from 1
+    uint32_t arg_count;
+    uint32_t payload_size;
+};
+
+/// Non-zero if capturing is enabled. This is set by _bolt_capture_init and never changes afterwards.
+extern uint8_t _bolt_capture_enabled;
+
+/// Enables capturing if the environment variable BOLT_GL_CAPTURE is set, in which case it's the path
+/// of the file to write to, which will be overwritten. Must be called once, before any hooks run.
+void _bolt_capture_init();
+
+/// Writes a record to the capture file. Use the CAPTURE macro instead of calling this directly.
+void _bolt_capture_call(enum CaptureCall, const uint64_t* args, uint32_t arg_count, const void* payload, size_t payload_size);
+
+/// Makes sure everything captured so far has been written to the file. Called once per frame.
+void _bolt_capture_flush();
+
+/// Flushes and closes the capture file, after which nothing else will be captured.
+void _bolt_capture_close();
+
+/// Captures a call if capturing is enabled. There must be at least one argument after PAYLOAD_SIZE,
+/// and each one must be implicitly convertible to uint64_t.
+#define CAPTURE(CALL, PAYLOAD, PAYLOAD_SIZE, ...) \
+    do { \
+        if (_bolt_capture_enabled) { \
+            const uint64_t capture_args[] = {__VA_ARGS__}; \
+            _bolt_capture_call(CALL, capture_args, sizeof(capture_args) / sizeof(*capture_args), PAYLOAD, PAYLOAD_SIZE); \
+        } \
+    } while (0)
+
+#endif
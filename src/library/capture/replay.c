@@ -0,0 +1,894 @@
+// Replays a GL capture (see capture.h) through the plugin library's _bolt_gl_* hooks, on the mock
+// backend (see ../mock/mock.h), then reports how long the hooks took for each type of call and how
+// much the buffer pools allocated. This is built from the plugin library's sources, minus the part
+// which hooks EGL and libGL, so the hooks are called directly instead of through LD_PRELOAD. Like
+// bolt-mock-test, it also stands in for the launcher, so a plugin can be run during the replay.
+// Usage: bolt-replay capture-file [plugin-dir/ [main.lua]]
+//
+// Each thread in the capture is replayed on a thread of its own, since GL contexts are current per
+// thread, but only one of them runs at a time, in the order the calls were captured. Object names
+// in the capture are mapped to the ones the mock hands out. Programs are recreated from the uniform
+// locations in their glLinkProgram records (see CAPTURE_PROGRAM_NAMES), which gives the mock enough
+// to make the hooks classify them the same way they did in the game. Uniform block offsets still
+// come from the mock, not the game, so 3D and minimap events will have the wrong camera.
+
+#include "capture.h"
+#include "../gl.h"
+#include "../mock/host.h"
+#include "../plugin/plugin.h"
+#include "../thread/thread.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// these are provided by the mock libEGL and libGL
+void* eglGetDisplay(void* native_display);
+unsigned int eglInitialize(void* display, void* major, void* minor);
+void* eglCreateContext(void* display, void* config, void* share_context, const void* attrib_list);
+unsigned int eglMakeCurrent(void* display, void* draw, void* read, void* context);
+unsigned int eglSwapBuffers(void* display, void* surface);
+unsigned int eglDestroyContext(void* display, void* context);
+unsigned int eglTerminate(void* display);
+void* eglGetProcAddress(const char* name);
+void glBindTexture(uint32_t target, unsigned int texture);
+void glClear(uint32_t mask);
+void glClearColor(float r, float g, float b, float a);
+void glDeleteTextures(unsigned int n, const unsigned int* textures);
+void glDrawArrays(uint32_t mode, int first, unsigned int count);
+void glDrawElements(uint32_t mode, unsigned int count, uint32_t type, const void* indices_offset);
+void glFlush();
+void glGenTextures(uint32_t n, unsigned int* textures);
+uint32_t glGetError();
+void glTexParameteri(uint32_t target, uint32_t pname, int param);
+void glTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, uint32_t type, const void* pixels);
+void glViewport(int x, int y, unsigned int width, unsigned int height);
+
+// most arguments any record has (glCopyImageSubData's 15), rounded up
+#define REPLAY_MAX_ARGS 16
+
+// most buffers one context can have mapped at once, and most buffer pools that will be reported on
+#define REPLAY_MAX_MAPPINGS 8
+#define REPLAY_MAX_POOLS 8
+
+static const char* program_names[] = {CAPTURE_PROGRAM_NAMES};
+#define PROGRAM_NAME_COUNT (sizeof(program_names) / sizeof(*program_names))
+// the last of the names is the uniform block, the rest are uniforms
+#define PROGRAM_VIEWTRANSFORMS (PROGRAM_NAME_COUNT - 1)
+
+// number of arguments each call is captured with. records may have more than this, in which case
+// the extra ones were added by a newer version and are ignored, but never fewer.
+static const uint8_t arg_counts[CAPTURE_CALL_ENUM_SIZE] = {
+    [CAPTURE_SWAPBUFFERS] = 2, [CAPTURE_CREATECONTEXT] = 2, [CAPTURE_MAKECURRENT] = 1, [CAPTURE_DESTROYCONTEXT] = 1,
+    [CAPTURE_GENTEXTURES] = 1, [CAPTURE_DRAWELEMENTS] = 4, [CAPTURE_DRAWARRAYS] = 3, [CAPTURE_BINDTEXTURE] = 2,
+    [CAPTURE_TEXSUBIMAGE2D] = 8, [CAPTURE_DELETETEXTURES] = 1, [CAPTURE_CLEAR] = 1, [CAPTURE_VIEWPORT] = 4,
+    [CAPTURE_CREATEPROGRAM] = 1, [CAPTURE_DELETEPROGRAM] = 1, [CAPTURE_BINDATTRIBLOCATION] = 2, [CAPTURE_LINKPROGRAM] = 1,
+    [CAPTURE_USEPROGRAM] = 1, [CAPTURE_TEXSTORAGE2D] = 5, [CAPTURE_VERTEXATTRIBPOINTER] = 6, [CAPTURE_GENBUFFERS] = 1,
+    [CAPTURE_BUFFERDATA] = 3, [CAPTURE_DELETEBUFFERS] = 1, [CAPTURE_BINDFRAMEBUFFER] = 2, [CAPTURE_COMPRESSEDTEXSUBIMAGE2D] = 8,
+    [CAPTURE_COPYIMAGESUBDATA] = 15, [CAPTURE_ENABLEVERTEXATTRIBARRAY] = 1, [CAPTURE_DISABLEVERTEXATTRIBARRAY] = 1,
+    [CAPTURE_MAPBUFFERRANGE] = 4, [CAPTURE_UNMAPBUFFER] = 1, [CAPTURE_BUFFERSTORAGE] = 3, [CAPTURE_FLUSHMAPPEDBUFFERRANGE] = 3,
+    [CAPTURE_ACTIVETEXTURE] = 1, [CAPTURE_GENVERTEXARRAYS] = 1, [CAPTURE_DELETEVERTEXARRAYS] = 1, [CAPTURE_BINDVERTEXARRAY] = 1,
+    [CAPTURE_BLITFRAMEBUFFER] = 10, [CAPTURE_BINDBUFFER] = 2, [CAPTURE_BINDBUFFERBASE] = 3, [CAPTURE_BINDBUFFERRANGE] = 5,
+    [CAPTURE_UNIFORMBLOCKBINDING] = 3, [CAPTURE_UNIFORM1I] = 2, [CAPTURE_UNIFORM1IV] = 2, [CAPTURE_UNIFORM4F] = 1,
+    [CAPTURE_UNIFORM4FV] = 2, [CAPTURE_UNIFORMMATRIX4FV] = 3, [CAPTURE_GENFRAMEBUFFERS] = 1, [CAPTURE_DELETEFRAMEBUFFERS] = 1,
+    [CAPTURE_FRAMEBUFFERTEXTURE] = 4, [CAPTURE_FRAMEBUFFERTEXTURE2D] = 5, [CAPTURE_FRAMEBUFFERTEXTURELAYER] = 5,
+    [CAPTURE_FRAMEBUFFERRENDERBUFFER] = 4,
+};
+
+static const char* call_names[CAPTURE_CALL_ENUM_SIZE] = {
+    [CAPTURE_SWAPBUFFERS] = "SwapBuffers", [CAPTURE_CREATECONTEXT] = "CreateContext", [CAPTURE_MAKECURRENT] = "MakeCurrent",
+    [CAPTURE_DESTROYCONTEXT] = "DestroyContext", [CAPTURE_GENTEXTURES] = "GenTextures", [CAPTURE_DRAWELEMENTS] = "DrawElements",
+    [CAPTURE_DRAWARRAYS] = "DrawArrays", [CAPTURE_BINDTEXTURE] = "BindTexture", [CAPTURE_TEXSUBIMAGE2D] = "TexSubImage2D",
+    [CAPTURE_DELETETEXTURES] = "DeleteTextures", [CAPTURE_CLEAR] = "Clear", [CAPTURE_VIEWPORT] = "Viewport",
+    [CAPTURE_CREATEPROGRAM] = "CreateProgram", [CAPTURE_DELETEPROGRAM] = "DeleteProgram", [CAPTURE_BINDATTRIBLOCATION] = "BindAttribLocation",
+    [CAPTURE_LINKPROGRAM] = "LinkProgram", [CAPTURE_USEPROGRAM] = "UseProgram", [CAPTURE_TEXSTORAGE2D] = "TexStorage2D",
+    [CAPTURE_VERTEXATTRIBPOINTER] = "VertexAttribPointer", [CAPTURE_GENBUFFERS] = "GenBuffers", [CAPTURE_BUFFERDATA] = "BufferData",
+    [CAPTURE_DELETEBUFFERS] = "DeleteBuffers", [CAPTURE_BINDFRAMEBUFFER] = "BindFramebuffer",
+    [CAPTURE_COMPRESSEDTEXSUBIMAGE2D] = "CompressedTexSubImage2D", [CAPTURE_COPYIMAGESUBDATA] = "CopyImageSubData",
+    [CAPTURE_ENABLEVERTEXATTRIBARRAY] = "EnableVertexAttribArray", [CAPTURE_DISABLEVERTEXATTRIBARRAY] = "DisableVertexAttribArray",
+    [CAPTURE_MAPBUFFERRANGE] = "MapBufferRange", [CAPTURE_UNMAPBUFFER] = "UnmapBuffer", [CAPTURE_BUFFERSTORAGE] = "BufferStorage",
+    [CAPTURE_FLUSHMAPPEDBUFFERRANGE] = "FlushMappedBufferRange", [CAPTURE_ACTIVETEXTURE] = "ActiveTexture",
+    [CAPTURE_GENVERTEXARRAYS] = "GenVertexArrays", [CAPTURE_DELETEVERTEXARRAYS] = "DeleteVertexArrays",
+    [CAPTURE_BINDVERTEXARRAY] = "BindVertexArray", [CAPTURE_BLITFRAMEBUFFER] = "BlitFramebuffer", [CAPTURE_BINDBUFFER] = "BindBuffer",
+    [CAPTURE_BINDBUFFERBASE] = "BindBufferBase", [CAPTURE_BINDBUFFERRANGE] = "BindBufferRange",
+    [CAPTURE_UNIFORMBLOCKBINDING] = "UniformBlockBinding", [CAPTURE_UNIFORM1I] = "Uniform1i", [CAPTURE_UNIFORM1IV] = "Uniform1iv",
+    [CAPTURE_UNIFORM4F] = "Uniform4f", [CAPTURE_UNIFORM4FV] = "Uniform4fv", [CAPTURE_UNIFORMMATRIX4FV] = "UniformMatrix4fv",
+    [CAPTURE_GENFRAMEBUFFERS] = "GenFramebuffers", [CAPTURE_DELETEFRAMEBUFFERS] = "DeleteFramebuffers",
+    [CAPTURE_FRAMEBUFFERTEXTURE] = "FramebufferTexture", [CAPTURE_FRAMEBUFFERTEXTURE2D] = "FramebufferTexture2D",
+    [CAPTURE_FRAMEBUFFERTEXTURELAYER] = "FramebufferTextureLayer", [CAPTURE_FRAMEBUFFERRENDERBUFFER] = "FramebufferRenderbuffer",
+};
+
+struct ReplayRecord {
+    struct CaptureRecord header;
+    uint64_t args[REPLAY_MAX_ARGS];
+    const uint8_t* payload; // not aligned
+};
+
+// a program made by the replay. `locations` are the ones from the capture, and `mock_locations`
+// are the ones the mock gave for the same names, or -1 where the capture had -1.
+struct ReplayProgram {
+    unsigned int name;
+    unsigned int shader;
+    int32_t locations[PROGRAM_NAME_COUNT];
+    int mock_locations[PROGRAM_NAME_COUNT];
+    struct ReplayProgram* next;
+};
+
+// maps from names in the capture to names from the mock, for the objects which are shared between
+// contexts. values are names cast to pointers, except for `programs`, which are ReplayPrograms.
+struct ReplayShareGroup {
+    struct IDMap textures;
+    struct IDMap buffers;
+    struct IDMap programs;
+    struct ReplayShareGroup* next;
+};
+
+struct ReplayMapping {
+    uint32_t target;
+    uint8_t* ptr;
+    uintptr_t length;
+};
+
+struct ReplayContext {
+    uint64_t id; // the context's handle in the capture, or 0 once it's been destroyed
+    void* egl; // the mock's handle
+    struct ReplayShareGroup* group;
+    struct IDMap vertex_arrays;
+    struct IDMap framebuffers;
+    struct ReplayProgram* program;
+    // pointers returned by the hook for glMapBufferRange, which glUnmapBuffer and
+    // glFlushMappedBufferRange payloads are copied into, like the game would've written them
+    struct ReplayMapping mappings[REPLAY_MAX_MAPPINGS];
+    struct ReplayContext* next;
+};
+
+struct ReplayStats {
+    uint64_t count[CAPTURE_CALL_ENUM_SIZE];
+    uint64_t ns[CAPTURE_CALL_ENUM_SIZE];
+    uint64_t skipped[CAPTURE_CALL_ENUM_SIZE];
+};
+
+struct ReplayThread {
+    uint32_t id; // thread number from the capture
+    Thread thread;
+    Signal start;
+    Signal done;
+    // records to replay when `start` is set, or NULL to make the thread exit
+    const uint8_t* run_begin;
+    const uint8_t* run_end;
+    struct ReplayContext* context;
+    // payloads are copied here, so they're aligned and strings are terminated
+    uint8_t* payload;
+    size_t payload_capacity;
+    unsigned int* names;
+    size_t names_capacity;
+    struct ReplayStats stats;
+};
+
+// counters from a buffer pool as of the last frame it was seen on
+struct ReplayPool {
+    const struct MemPool* pool;
+    uint64_t frames;
+    uint64_t allocations;
+    uint64_t bytes_allocated;
+    uint64_t reuses;
+    uint64_t bytes_reused;
+};
+
+// everything below is only ever used by one thread at a time, since only one replay thread runs at once
+static void* display = NULL;
+static struct GLLibFunctions libgl;
+static struct GLProcFunctions hooks;
+static struct GLProcFunctions mock;
+static struct ReplayContext* contexts = NULL;
+static struct ReplayShareGroup* groups = NULL;
+static struct ReplayProgram* programs = NULL;
+static struct ReplayPool pools[REPLAY_MAX_POOLS];
+static size_t pool_count = 0;
+
+static uint64_t now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000) + t.tv_nsec;
+}
+
+// reads the record at `*ptr` and advances `*ptr` past it. returns 0 on success, or 1 if the record
+// is malformed or doesn't fit before `end`, in which case `*ptr` isn't changed.
+static uint8_t _bolt_replay_read(const uint8_t** ptr, const uint8_t* end, struct ReplayRecord* record) {
+    struct CaptureRecord* header = &record->header;
+    if ((size_t)(end - *ptr) < sizeof(*header)) return 1;
+    memcpy(header, *ptr, sizeof(*header));
+    if (header->call >= CAPTURE_CALL_ENUM_SIZE || header->arg_count < arg_counts[header->call] || header->arg_count > REPLAY_MAX_ARGS) return 1;
+    const size_t args_size = header->arg_count * sizeof(uint64_t);
+    if ((size_t)(end - *ptr) - sizeof(*header) < args_size + header->payload_size) return 1;
+    memset(record->args, 0, sizeof(record->args));
+    memcpy(record->args, *ptr + sizeof(*header), args_size);
+    record->payload = *ptr + sizeof(*header) + args_size;
+    *ptr = record->payload + header->payload_size;
+    return 0;
+}
+
+static struct ReplayContext* _bolt_replay_find_context(uint64_t id) {
+    if (!id) return NULL;
+    for (struct ReplayContext* c = contexts; c; c = c->next) {
+        if (c->id == id) return c;
+    }
+    return NULL;
+}
+
+// returns the mock's name for a name from the capture, or the same name if it wasn't mapped
+static unsigned int _bolt_replay_name(const struct IDMap* map, uint64_t name) {
+    const void* value = name ? _bolt_idmap_get(map, (unsigned int)name) : NULL;
+    return value ? (unsigned int)(uintptr_t)value : (unsigned int)name;
+}
+
+static struct ReplayProgram* _bolt_replay_program(const struct ReplayContext* c, uint64_t name) {
+    return name ? _bolt_idmap_get(&c->group->programs, (unsigned int)name) : NULL;
+}
+
+static unsigned int _bolt_replay_program_name(const struct ReplayContext* c, uint64_t name) {
+    const struct ReplayProgram* p = _bolt_replay_program(c, name);
+    return p ? p->name : (unsigned int)name;
+}
+
+// translates a uniform location in the current program. locations which the capture doesn't say
+// anything about become -1, which GL ignores.
+static int _bolt_replay_location(const struct ReplayContext* c, uint64_t location) {
+    const struct ReplayProgram* p = c->program;
+    if (!p || (int)location == -1) return -1;
+    for (size_t i = 0; i < PROGRAM_VIEWTRANSFORMS; i += 1) {
+        if (p->locations[i] == (int32_t)location) return p->mock_locations[i];
+    }
+    return -1;
+}
+
+// returns a scratch array for `n` names, or NULL if it can't be allocated
+static unsigned int* _bolt_replay_names(struct ReplayThread* t, uint64_t n) {
+    if (n > t->names_capacity) {
+        unsigned int* names = realloc(t->names, n * sizeof(*names));
+        if (!names) return NULL;
+        t->names = names;
+        t->names_capacity = n;
+    }
+    return t->names;
+}
+
+// for glGen*: remembers which new names correspond to which captured ones
+static void _bolt_replay_map_names(struct IDMap* map, const unsigned int* captured, const unsigned int* names, uint64_t n) {
+    for (uint64_t i = 0; i < n; i += 1) {
+        if (captured[i] && names[i]) _bolt_idmap_set(map, captured[i], (void*)(uintptr_t)names[i]);
+    }
+}
+
+// for glDelete*: translates the captured names into `names` and forgets them
+static void _bolt_replay_unmap_names(struct IDMap* map, const unsigned int* captured, unsigned int* names, uint64_t n) {
+    for (uint64_t i = 0; i < n; i += 1) {
+        names[i] = _bolt_replay_name(map, captured[i]);
+        if (captured[i]) _bolt_idmap_remove(map, captured[i]);
+    }
+}
+
+static struct ReplayMapping* _bolt_replay_mapping(struct ReplayContext* c, uint32_t target, uint8_t add) {
+    struct ReplayMapping* empty = NULL;
+    for (size_t i = 0; i < REPLAY_MAX_MAPPINGS; i += 1) {
+        if (c->mappings[i].ptr && c->mappings[i].target == target) return &c->mappings[i];
+        if (!c->mappings[i].ptr && !empty) empty = &c->mappings[i];
+    }
+    return add ? empty : NULL;
+}
+
+static void _bolt_replay_create_program(struct ReplayContext* c, uint64_t captured) {
+    struct ReplayProgram* p = calloc(1, sizeof(*p));
+    p->name = hooks.CreateProgram();
+    for (size_t i = 0; i < PROGRAM_NAME_COUNT; i += 1) {
+        p->locations[i] = -1;
+        p->mock_locations[i] = -1;
+    }
+    p->next = programs;
+    programs = p;
+    if (captured) _bolt_idmap_set(&c->group->programs, (unsigned int)captured, p);
+}
+
+// gives the program a shader which mentions each of the names the capture had a location for, so
+// that the mock finds them when the hook looks them up, then links it. the mock searches for names
+// as substrings, so e.g. uTextureAtlas will always be found if uTextureAtlasSettings is. this has to
+// be done before the program is linked, and _bolt_replay_program_linked after.
+static void _bolt_replay_program_source(struct ReplayProgram* p, const int32_t* locations, size_t count) {
+    char source[512] = {0};
+    for (size_t i = 0; i < PROGRAM_NAME_COUNT; i += 1) {
+        p->locations[i] = (i < count) ? locations[i] : -1;
+        if (p->locations[i] == -1) continue;
+        strcat(source, program_names[i]);
+        strcat(source, " ");
+    }
+    if (p->locations[PROGRAM_VIEWTRANSFORMS] != -1) strcat(source, "uCameraPosition uViewProjMatrix");
+    if (!p->shader) {
+        p->shader = mock.CreateShader(GL_VERTEX_SHADER);
+        mock.AttachShader(p->name, p->shader);
+    }
+    const char* sources[] = {source};
+    mock.ShaderSource(p->shader, 1, sources, NULL);
+}
+
+static void _bolt_replay_program_linked(struct ReplayProgram* p) {
+    for (size_t i = 0; i < PROGRAM_NAME_COUNT; i += 1) {
+        if (p->locations[i] == -1) {
+            p->mock_locations[i] = -1;
+        } else if (i == PROGRAM_VIEWTRANSFORMS) {
+            p->mock_locations[i] = (int)mock.GetUniformBlockIndex(p->name, program_names[i]);
+        } else {
+            p->mock_locations[i] = mock.GetUniformLocation(p->name, program_names[i]);
+        }
+    }
+}
+
+// samples the current context's buffer pool, once per frame
+static void _bolt_replay_sample_pool() {
+    const struct MemPool* pool = _bolt_gl_buffer_pool();
+    if (!pool) return;
+    size_t i;
+    for (i = 0; i < pool_count; i += 1) {
+        if (pools[i].pool == pool) break;
+    }
+    if (i == pool_count) {
+        if (pool_count == REPLAY_MAX_POOLS) return;
+        memset(&pools[i], 0, sizeof(pools[i]));
+        pools[i].pool = pool;
+        pool_count += 1;
+    }
+    pools[i].frames += 1;
+    pools[i].allocations = pool->allocations;
+    pools[i].bytes_allocated = pool->bytes_allocated;
+    pools[i].reuses = pool->reuses;
+    pools[i].bytes_reused = pool->bytes_reused;
+}
+
+// calls the hook (and the mock, for functions the plugin library hooks in libGL rather than through
+// GetProcAddress) for one record. returns 0 if it was replayed, or 1 if it had to be skipped.
+static uint8_t _bolt_replay_call(struct ReplayThread* t, const struct ReplayRecord* r) {
+    const uint64_t* a = r->args;
+    const uint32_t payload_size = r->header.payload_size;
+    const void* payload = payload_size ? t->payload : NULL;
+    struct ReplayContext* c = t->context;
+
+    switch (r->header.call) {
+        case CAPTURE_CREATECONTEXT: {
+            struct ReplayContext* shared = _bolt_replay_find_context(a[1]);
+            struct ReplayContext* new_context = calloc(1, sizeof(*new_context));
+            new_context->id = a[0];
+            new_context->egl = eglCreateContext(display, NULL, shared ? shared->egl : NULL, NULL);
+            if (shared) {
+                new_context->group = shared->group;
+            } else {
+                new_context->group = calloc(1, sizeof(*new_context->group));
+                _bolt_idmap_init(&new_context->group->textures);
+                _bolt_idmap_init(&new_context->group->buffers);
+                _bolt_idmap_init(&new_context->group->programs);
+                new_context->group->next = groups;
+                groups = new_context->group;
+            }
+            _bolt_idmap_init(&new_context->vertex_arrays);
+            _bolt_idmap_init(&new_context->framebuffers);
+            new_context->next = contexts;
+            contexts = new_context;
+            _bolt_gl_onCreateContext(new_context->egl, shared ? shared->egl : NULL, &libgl, eglGetProcAddress);
+            return 0;
+        }
+        case CAPTURE_MAKECURRENT: {
+            struct ReplayContext* context = _bolt_replay_find_context(a[0]);
+            if (a[0] && !context) return 1;
+            eglMakeCurrent(display, NULL, NULL, context ? context->egl : NULL);
+            _bolt_gl_onMakeCurrent(context ? context->egl : NULL);
+            t->context = context;
+            return 0;
+        }
+        case CAPTURE_DESTROYCONTEXT: {
+            // the same as eglDestroyContext in so/main.c
+            struct ReplayContext* context = _bolt_replay_find_context(a[0]);
+            if (!context) return 1;
+            context->id = 0;
+            eglDestroyContext(display, context->egl);
+            void* main_context = _bolt_gl_onDestroyContext(context->egl);
+            if (main_context) {
+                eglMakeCurrent(display, NULL, NULL, main_context);
+                _bolt_gl_close();
+                eglMakeCurrent(display, NULL, NULL, NULL);
+                eglTerminate(display);
+            }
+            return 0;
+        }
+        default:
+            break;
+    }
+
+    // everything else is a GL call, which needs a context
+    if (!c) return 1;
+    switch (r->header.call) {
+        case CAPTURE_SWAPBUFFERS:
+            _bolt_gl_onSwapBuffers((uint32_t)a[0], (uint32_t)a[1]);
+            eglSwapBuffers(display, NULL);
+            _bolt_replay_sample_pool();
+            break;
+        case CAPTURE_GENTEXTURES:
+        case CAPTURE_GENBUFFERS:
+        case CAPTURE_GENVERTEXARRAYS:
+        case CAPTURE_GENFRAMEBUFFERS: {
+            unsigned int* names = _bolt_replay_names(t, a[0]);
+            if (!names || payload_size != a[0] * sizeof(*names)) return 1;
+            if (r->header.call == CAPTURE_GENTEXTURES) {
+                libgl.GenTextures((uint32_t)a[0], names);
+                _bolt_gl_onGenTextures((uint32_t)a[0], names);
+                _bolt_replay_map_names(&c->group->textures, payload, names, a[0]);
+            } else if (r->header.call == CAPTURE_GENBUFFERS) {
+                hooks.GenBuffers((uint32_t)a[0], names);
+                _bolt_replay_map_names(&c->group->buffers, payload, names, a[0]);
+            } else if (r->header.call == CAPTURE_GENVERTEXARRAYS) {
+                hooks.GenVertexArrays((uint32_t)a[0], names);
+                _bolt_replay_map_names(&c->vertex_arrays, payload, names, a[0]);
+            } else {
+                hooks.GenFramebuffers((uint32_t)a[0], names);
+                _bolt_replay_map_names(&c->framebuffers, payload, names, a[0]);
+            }
+            break;
+        }
+        case CAPTURE_DELETETEXTURES:
+        case CAPTURE_DELETEBUFFERS:
+        case CAPTURE_DELETEVERTEXARRAYS:
+        case CAPTURE_DELETEFRAMEBUFFERS: {
+            unsigned int* names = _bolt_replay_names(t, a[0]);
+            if (!names || payload_size != a[0] * sizeof(*names)) return 1;
+            if (r->header.call == CAPTURE_DELETETEXTURES) {
+                _bolt_replay_unmap_names(&c->group->textures, payload, names, a[0]);
+                libgl.DeleteTextures((unsigned int)a[0], names);
+                _bolt_gl_onDeleteTextures((unsigned int)a[0], names);
+            } else if (r->header.call == CAPTURE_DELETEBUFFERS) {
+                _bolt_replay_unmap_names(&c->group->buffers, payload, names, a[0]);
+                hooks.DeleteBuffers((unsigned int)a[0], names);
+            } else if (r->header.call == CAPTURE_DELETEVERTEXARRAYS) {
+                _bolt_replay_unmap_names(&c->vertex_arrays, payload, names, a[0]);
+                hooks.DeleteVertexArrays((uint32_t)a[0], names);
+            } else {
+                _bolt_replay_unmap_names(&c->framebuffers, payload, names, a[0]);
+                hooks.DeleteFramebuffers((uint32_t)a[0], names);
+            }
+            break;
+        }
+        case CAPTURE_DRAWELEMENTS:
+            libgl.DrawElements((uint32_t)a[0], (unsigned int)a[1], (uint32_t)a[2], (const void*)(uintptr_t)a[3]);
+            _bolt_gl_onDrawElements((uint32_t)a[0], (unsigned int)a[1], (uint32_t)a[2], (const void*)(uintptr_t)a[3]);
+            break;
+        case CAPTURE_DRAWARRAYS:
+            libgl.DrawArrays((uint32_t)a[0], (int)a[1], (unsigned int)a[2]);
+            _bolt_gl_onDrawArrays((uint32_t)a[0], (int)a[1], (unsigned int)a[2]);
+            break;
+        case CAPTURE_BINDTEXTURE: {
+            const unsigned int texture = _bolt_replay_name(&c->group->textures, a[1]);
+            libgl.BindTexture((uint32_t)a[0], texture);
+            _bolt_gl_onBindTexture((uint32_t)a[0], texture);
+            break;
+        }
+        case CAPTURE_TEXSUBIMAGE2D:
+            // only RGBA uploads have their pixels captured, since they're the only ones the hook reads
+            if ((uint32_t)a[6] == GL_RGBA && payload_size < a[4] * a[5] * 4) return 1;
+            libgl.TexSubImage2D((uint32_t)a[0], (int)a[1], (int)a[2], (int)a[3], (unsigned int)a[4], (unsigned int)a[5], (uint32_t)a[6], (uint32_t)a[7], payload);
+            _bolt_gl_onTexSubImage2D((uint32_t)a[0], (int)a[1], (int)a[2], (int)a[3], (unsigned int)a[4], (unsigned int)a[5], (uint32_t)a[6], (uint32_t)a[7], payload);
+            break;
+        case CAPTURE_CLEAR:
+            libgl.Clear((uint32_t)a[0]);
+            _bolt_gl_onClear((uint32_t)a[0]);
+            break;
+        case CAPTURE_VIEWPORT:
+            libgl.Viewport((int)a[0], (int)a[1], (unsigned int)a[2], (unsigned int)a[3]);
+            _bolt_gl_onViewport((int)a[0], (int)a[1], (unsigned int)a[2], (unsigned int)a[3]);
+            break;
+        case CAPTURE_CREATEPROGRAM:
+            _bolt_replay_create_program(c, a[0]);
+            break;
+        case CAPTURE_DELETEPROGRAM: {
+            // the ReplayProgram isn't freed until exit, in case another context is still using it
+            struct ReplayProgram* p = a[0] ? _bolt_idmap_remove(&c->group->programs, (unsigned int)a[0]) : NULL;
+            hooks.DeleteProgram(p ? p->name : (unsigned int)a[0]);
+            break;
+        }
+        case CAPTURE_BINDATTRIBLOCATION:
+            if (!payload) return 1;
+            hooks.BindAttribLocation(_bolt_replay_program_name(c, a[0]), (unsigned int)a[1], payload);
+            break;
+        case CAPTURE_LINKPROGRAM: {
+            struct ReplayProgram* p = _bolt_replay_program(c, a[0]);
+            if (!p) return 1;
+            _bolt_replay_program_source(p, payload, payload_size / sizeof(int32_t));
+            hooks.LinkProgram(p->name);
+            _bolt_replay_program_linked(p);
+            break;
+        }
+        case CAPTURE_USEPROGRAM: {
+            struct ReplayProgram* p = _bolt_replay_program(c, a[0]);
+            c->program = p;
+            hooks.UseProgram(p ? p->name : (unsigned int)a[0]);
+            break;
+        }
+        case CAPTURE_TEXSTORAGE2D:
+            hooks.TexStorage2D((uint32_t)a[0], (int)a[1], (uint32_t)a[2], (unsigned int)a[3], (unsigned int)a[4]);
+            break;
+        case CAPTURE_VERTEXATTRIBPOINTER:
+            hooks.VertexAttribPointer((unsigned int)a[0], (int)a[1], (uint32_t)a[2], (uint8_t)a[3], (unsigned int)a[4], (const void*)(uintptr_t)a[5]);
+            break;
+        case CAPTURE_BUFFERDATA:
+            hooks.BufferData((uint32_t)a[0], (uintptr_t)a[1], payload_size >= a[1] ? payload : NULL, (uint32_t)a[2]);
+            break;
+        case CAPTURE_BUFFERSTORAGE:
+            hooks.BufferStorage((unsigned int)a[0], (uintptr_t)a[1], payload_size >= a[1] ? payload : NULL, (uintptr_t)a[2]);
+            break;
+        case CAPTURE_BINDFRAMEBUFFER:
+            hooks.BindFramebuffer((uint32_t)a[0], _bolt_replay_name(&c->framebuffers, a[1]));
+            break;
+        case CAPTURE_COMPRESSEDTEXSUBIMAGE2D:
+            if (payload_size < a[7]) return 1;
+            hooks.CompressedTexSubImage2D((uint32_t)a[0], (int)a[1], (int)a[2], (int)a[3], (unsigned int)a[4], (unsigned int)a[5], (uint32_t)a[6], (unsigned int)a[7], payload);
+            break;
+        case CAPTURE_COPYIMAGESUBDATA:
+            hooks.CopyImageSubData(_bolt_replay_name(&c->group->textures, a[0]), (uint32_t)a[1], (int)a[2], (int)a[3], (int)a[4], (int)a[5],
+                _bolt_replay_name(&c->group->textures, a[6]), (uint32_t)a[7], (int)a[8], (int)a[9], (int)a[10], (int)a[11],
+                (unsigned int)a[12], (unsigned int)a[13], (unsigned int)a[14]);
+            break;
+        case CAPTURE_ENABLEVERTEXATTRIBARRAY:
+            hooks.EnableVertexAttribArray((unsigned int)a[0]);
+            break;
+        case CAPTURE_DISABLEVERTEXATTRIBARRAY:
+            hooks.DisableVertexAttribArray((unsigned int)a[0]);
+            break;
+        case CAPTURE_MAPBUFFERRANGE: {
+            uint8_t* ptr = hooks.MapBufferRange((uint32_t)a[0], (intptr_t)a[1], (uintptr_t)a[2], (uint32_t)a[3]);
+            struct ReplayMapping* mapping = _bolt_replay_mapping(c, (uint32_t)a[0], 1);
+            if (ptr && mapping) {
+                mapping->target = (uint32_t)a[0];
+                mapping->ptr = ptr;
+                mapping->length = (uintptr_t)a[2];
+            }
+            break;
+        }
+        case CAPTURE_UNMAPBUFFER: {
+            struct ReplayMapping* mapping = _bolt_replay_mapping(c, (uint32_t)a[0], 0);
+            if (mapping) {
+                if (payload) memcpy(mapping->ptr, payload, payload_size < mapping->length ? payload_size : mapping->length);
+                mapping->ptr = NULL;
+            }
+            hooks.UnmapBuffer((uint32_t)a[0]);
+            break;
+        }
+        case CAPTURE_FLUSHMAPPEDBUFFERRANGE: {
+            struct ReplayMapping* mapping = _bolt_replay_mapping(c, (uint32_t)a[0], 0);
+            if (mapping && payload && a[1] <= mapping->length && payload_size <= mapping->length - a[1]) {
+                memcpy(mapping->ptr + a[1], payload, payload_size);
+            }
+            hooks.FlushMappedBufferRange((uint32_t)a[0], (intptr_t)a[1], (uintptr_t)a[2]);
+            break;
+        }
+        case CAPTURE_ACTIVETEXTURE:
+            hooks.ActiveTexture((uint32_t)a[0]);
+            break;
+        case CAPTURE_BINDVERTEXARRAY:
+            hooks.BindVertexArray(_bolt_replay_name(&c->vertex_arrays, a[0]));
+            break;
+        case CAPTURE_BLITFRAMEBUFFER:
+            hooks.BlitFramebuffer((int)a[0], (int)a[1], (int)a[2], (int)a[3], (int)a[4], (int)a[5], (int)a[6], (int)a[7], (uint32_t)a[8], (uint32_t)a[9]);
+            break;
+        case CAPTURE_BINDBUFFER:
+            hooks.BindBuffer((uint32_t)a[0], _bolt_replay_name(&c->group->buffers, a[1]));
+            break;
+        case CAPTURE_BINDBUFFERBASE:
+            hooks.BindBufferBase((uint32_t)a[0], (unsigned int)a[1], _bolt_replay_name(&c->group->buffers, a[2]));
+            break;
+        case CAPTURE_BINDBUFFERRANGE:
+            hooks.BindBufferRange((uint32_t)a[0], (unsigned int)a[1], _bolt_replay_name(&c->group->buffers, a[2]), (intptr_t)a[3], (uintptr_t)a[4]);
+            break;
+        case CAPTURE_UNIFORMBLOCKBINDING: {
+            const struct ReplayProgram* p = _bolt_replay_program(c, a[0]);
+            const uint8_t known = p && p->locations[PROGRAM_VIEWTRANSFORMS] == (int32_t)a[1];
+            hooks.UniformBlockBinding(p ? p->name : (unsigned int)a[0], known ? (unsigned int)p->mock_locations[PROGRAM_VIEWTRANSFORMS] : 0xFFFFFFFFu, (unsigned int)a[2]);
+            break;
+        }
+        case CAPTURE_UNIFORM1I:
+            hooks.Uniform1i(_bolt_replay_location(c, a[0]), (int)a[1]);
+            break;
+        case CAPTURE_UNIFORM1IV:
+            if (payload_size < a[1] * sizeof(int)) return 1;
+            hooks.Uniform1iv(_bolt_replay_location(c, a[0]), (unsigned int)a[1], payload);
+            break;
+        case CAPTURE_UNIFORM4F: {
+            if (payload_size < 4 * sizeof(float)) return 1;
+            const float* v = payload;
+            hooks.Uniform4f(_bolt_replay_location(c, a[0]), v[0], v[1], v[2], v[3]);
+            break;
+        }
+        case CAPTURE_UNIFORM4FV:
+            if (payload_size < a[1] * 4 * sizeof(float)) return 1;
+            hooks.Uniform4fv(_bolt_replay_location(c, a[0]), (unsigned int)a[1], payload);
+            break;
+        case CAPTURE_UNIFORMMATRIX4FV:
+            if (payload_size < a[1] * 16 * sizeof(float)) return 1;
+            hooks.UniformMatrix4fv(_bolt_replay_location(c, a[0]), (unsigned int)a[1], (uint8_t)a[2], payload);
+            break;
+        case CAPTURE_FRAMEBUFFERTEXTURE:
+            hooks.FramebufferTexture((uint32_t)a[0], (uint32_t)a[1], _bolt_replay_name(&c->group->textures, a[2]), (int)a[3]);
+            break;
+        case CAPTURE_FRAMEBUFFERTEXTURE2D:
+            hooks.FramebufferTexture2D((uint32_t)a[0], (uint32_t)a[1], (uint32_t)a[2], _bolt_replay_name(&c->group->textures, a[3]), (int)a[4]);
+            break;
+        case CAPTURE_FRAMEBUFFERTEXTURELAYER:
+            hooks.FramebufferTextureLayer((uint32_t)a[0], (uint32_t)a[1], _bolt_replay_name(&c->group->textures, a[2]), (int)a[3], (int)a[4]);
+            break;
+        case CAPTURE_FRAMEBUFFERRENDERBUFFER:
+            // renderbuffers aren't captured, so their names are passed through as they are
+            hooks.FramebufferRenderbuffer((uint32_t)a[0], (uint32_t)a[1], (uint32_t)a[2], (unsigned int)a[3]);
+            break;
+        default:
+            return 1;
+    }
+    return 0;
+}
+
+static void _bolt_replay_thread(void* arg) {
+    struct ReplayThread* t = arg;
+    while (1) {
+        _bolt_signal_wait(&t->start);
+        if (!t->run_begin) break;
+        const uint8_t* ptr = t->run_begin;
+        struct ReplayRecord record;
+        while (ptr < t->run_end && !_bolt_replay_read(&ptr, t->run_end, &record)) {
+            const uint32_t call = record.header.call;
+            const size_t payload_size = record.header.payload_size;
+            if (payload_size + 1 > t->payload_capacity) {
+                // +1 so that strings can be terminated, and aligned for any payload type
+                free(t->payload);
+                t->payload_capacity = payload_size + 1;
+                t->payload = aligned_alloc(16, (t->payload_capacity + 15) & ~(size_t)15);
+            }
+            memcpy(t->payload, record.payload, payload_size);
+            t->payload[payload_size] = 0;
+
+            const uint64_t start = now_ns();
+            const uint8_t skipped = _bolt_replay_call(t, &record);
+            const uint64_t end = now_ns();
+            if (skipped) {
+                t->stats.skipped[call] += 1;
+            } else {
+                t->stats.count[call] += 1;
+                t->stats.ns[call] += end - start;
+            }
+        }
+        _bolt_signal_set(&t->done);
+    }
+}
+
+static struct ReplayThread* _bolt_replay_get_thread(struct ReplayThread*** threads, size_t* thread_count, uint32_t id) {
+    for (size_t i = 0; i < *thread_count; i += 1) {
+        if ((*threads)[i]->id == id) return (*threads)[i];
+    }
+    struct ReplayThread* t = calloc(1, sizeof(*t));
+    t->id = id;
+    _bolt_signal_init(&t->start);
+    _bolt_signal_init(&t->done);
+    if (_bolt_thread_start(&t->thread, _bolt_replay_thread, t)) {
+        printf("error: failed to start replay thread\n");
+        exit(1);
+    }
+    *threads = realloc(*threads, (*thread_count + 1) * sizeof(**threads));
+    (*threads)[*thread_count] = t;
+    *thread_count += 1;
+    return t;
+}
+
+static uint8_t _bolt_replay_load_functions() {
+    libgl.BindTexture = glBindTexture;
+    libgl.Clear = glClear;
+    libgl.ClearColor = glClearColor;
+    libgl.DeleteTextures = glDeleteTextures;
+    libgl.DrawArrays = glDrawArrays;
+    libgl.DrawElements = glDrawElements;
+    libgl.Flush = glFlush;
+    libgl.GenTextures = glGenTextures;
+    libgl.GetError = glGetError;
+    libgl.TexParameteri = glTexParameteri;
+    libgl.TexSubImage2D = glTexSubImage2D;
+    libgl.Viewport = glViewport;
+
+    uint8_t missing = 0;
+#define HOOK(NAME) hooks.NAME = _bolt_gl_GetProcAddress("gl" #NAME); if (!hooks.NAME) { printf("error: no hook for gl" #NAME "\n"); missing = 1; }
+    HOOK(ActiveTexture)
+    HOOK(BindAttribLocation)
+    HOOK(BindBuffer)
+    HOOK(BindBufferBase)
+    HOOK(BindBufferRange)
+    HOOK(BindFramebuffer)
+    HOOK(BindVertexArray)
+    HOOK(BlitFramebuffer)
+    HOOK(BufferData)
+    HOOK(BufferStorage)
+    HOOK(CompressedTexSubImage2D)
+    HOOK(CopyImageSubData)
+    HOOK(CreateProgram)
+    HOOK(DeleteBuffers)
+    HOOK(DeleteFramebuffers)
+    HOOK(DeleteProgram)
+    HOOK(DeleteVertexArrays)
+    HOOK(DisableVertexAttribArray)
+    HOOK(EnableVertexAttribArray)
+    HOOK(FlushMappedBufferRange)
+    HOOK(FramebufferRenderbuffer)
+    HOOK(FramebufferTexture)
+    HOOK(FramebufferTexture2D)
+    HOOK(FramebufferTextureLayer)
+    HOOK(GenBuffers)
+    HOOK(GenFramebuffers)
+    HOOK(GenVertexArrays)
+    HOOK(LinkProgram)
+    HOOK(MapBufferRange)
+    HOOK(TexStorage2D)
+    HOOK(Uniform1i)
+    HOOK(Uniform1iv)
+    HOOK(Uniform4f)
+    HOOK(Uniform4fv)
+    HOOK(UniformBlockBinding)
+    HOOK(UniformMatrix4fv)
+    HOOK(UnmapBuffer)
+    HOOK(UseProgram)
+    HOOK(VertexAttribPointer)
+#undef HOOK
+
+    // the shader functions aren't hooked, so these come straight from the mock
+    mock.AttachShader = eglGetProcAddress("glAttachShader");
+    mock.CreateShader = eglGetProcAddress("glCreateShader");
+    mock.GetUniformBlockIndex = eglGetProcAddress("glGetUniformBlockIndex");
+    mock.GetUniformLocation = eglGetProcAddress("glGetUniformLocation");
+    mock.ShaderSource = eglGetProcAddress("glShaderSource");
+    return missing;
+}
+
+static void _bolt_replay_report(struct ReplayThread** threads, size_t thread_count, uint64_t frames) {
+    struct ReplayStats total = {0};
+    for (size_t i = 0; i < thread_count; i += 1) {
+        for (size_t call = 0; call < CAPTURE_CALL_ENUM_SIZE; call += 1) {
+            total.count[call] += threads[i]->stats.count[call];
+            total.ns[call] += threads[i]->stats.ns[call];
+            total.skipped[call] += threads[i]->stats.skipped[call];
+        }
+    }
+
+    printf("%-26s %10s %10s %12s %10s\n", "call", "count", "skipped", "total ms", "ns/call");
+    for (size_t call = 0; call < CAPTURE_CALL_ENUM_SIZE; call += 1) {
+        if (!total.count[call] && !total.skipped[call]) continue;
+        printf("%-26s %10llu %10llu %12.3f %10llu\n", call_names[call], (unsigned long long)total.count[call], (unsigned long long)total.skipped[call],
+            total.ns[call] / 1000000.0, (unsigned long long)(total.count[call] ? total.ns[call] / total.count[call] : 0));
+    }
+
+    const uint64_t draws = total.count[CAPTURE_DRAWELEMENTS] + total.count[CAPTURE_DRAWARRAYS];
+    const uint64_t draw_ns = total.ns[CAPTURE_DRAWELEMENTS] + total.ns[CAPTURE_DRAWARRAYS];
+    printf("%llu frames, %llu draws, %llu ns per draw\n", (unsigned long long)frames, (unsigned long long)draws,
+        (unsigned long long)(draws ? draw_ns / draws : 0));
+
+    for (size_t i = 0; i < pool_count; i += 1) {
+        const struct ReplayPool* p = &pools[i];
+        printf("buffer pool %zu: %llu allocations (%llu bytes), %llu reuses (%llu bytes), %.1f allocations per frame over %llu frames\n",
+            i, (unsigned long long)p->allocations, (unsigned long long)p->bytes_allocated, (unsigned long long)p->reuses,
+            (unsigned long long)p->bytes_reused, (double)p->allocations / p->frames, (unsigned long long)p->frames);
+    }
+}
+
+static void _bolt_replay_free() {
+    while (contexts) {
+        struct ReplayContext* next = contexts->next;
+        _bolt_idmap_destroy(&contexts->vertex_arrays);
+        _bolt_idmap_destroy(&contexts->framebuffers);
+        free(contexts);
+        contexts = next;
+    }
+    while (groups) {
+        struct ReplayShareGroup* next = groups->next;
+        _bolt_idmap_destroy(&groups->textures);
+        _bolt_idmap_destroy(&groups->buffers);
+        _bolt_idmap_destroy(&groups->programs);
+        free(groups);
+        groups = next;
+    }
+    while (programs) {
+        struct ReplayProgram* next = programs->next;
+        free(programs);
+        programs = next;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s capture-file [plugin-dir/ [main.lua]]\n", argv[0]);
+        return 1;
+    }
+    const char* plugin_dir = (argc > 2) ? argv[2] : NULL;
+    const char* plugin_main = (argc > 3) ? argv[3] : "main.lua";
+
+    const int file = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (file == -1 || fstat(file, &st) == -1) {
+        printf("error: can't open %s\n", argv[1]);
+        return 1;
+    }
+    const size_t magic_size = strlen(CAPTURE_MAGIC);
+    const uint8_t* data = (st.st_size > 0) ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    if (data == MAP_FAILED || (size_t)st.st_size < magic_size || memcmp(data, CAPTURE_MAGIC, magic_size)) {
+        printf("error: %s isn't a capture file\n", argv[1]);
+        return 1;
+    }
+    const uint8_t* end = data + st.st_size;
+
+    // the library always connects to IPC when it starts, so this is done even without a plugin,
+    // otherwise it could connect to a real launcher. capturing is never enabled here.
+    _bolt_plugin_on_startup();
+    if (_bolt_mock_host_listen()) return 1;
+    if (_bolt_replay_load_functions()) return 1;
+    display = eglGetDisplay(NULL);
+    eglInitialize(display, NULL, NULL);
+
+    struct ReplayThread** threads = NULL;
+    size_t thread_count = 0;
+    uint8_t plugin_started = 0;
+    const uint8_t* ptr = data + magic_size;
+    while (ptr < end) {
+        // find the run of records made by the same thread, and let that thread replay them
+        const uint8_t* run_begin = ptr;
+        struct ReplayRecord record;
+        if (_bolt_replay_read(&ptr, end, &record)) {
+            printf("error: malformed record at offset %zu, stopping there\n", (size_t)(ptr - data));
+            break;
+        }
+        const uint32_t thread_id = record.header.thread;
+        while (ptr < end) {
+            const uint8_t* next = ptr;
+            if (_bolt_replay_read(&next, end, &record) || record.header.thread != thread_id) break;
+            ptr = next;
+        }
+        struct ReplayThread* t = _bolt_replay_get_thread(&threads, &thread_count, thread_id);
+        t->run_begin = run_begin;
+        t->run_end = ptr;
+        _bolt_signal_set(&t->start);
+        _bolt_signal_wait(&t->done);
+
+        // the library connects when the game's main context is first made current
+        if (plugin_dir && !plugin_started && _bolt_mock_host_accept(0)) {
+            if (_bolt_mock_host_start_plugin("replay", plugin_dir, plugin_main)) {
+                printf("error: IPC send failed\n");
+                return 1;
+            }
+            plugin_started = 1;
+        }
+    }
+    if (plugin_dir && !plugin_started) printf("error: plugin library never connected, so the plugin wasn't started\n");
+
+    for (size_t i = 0; i < thread_count; i += 1) {
+        threads[i]->run_begin = NULL;
+        _bolt_signal_set(&threads[i]->start);
+        _bolt_thread_join(&threads[i]->thread);
+    }
+    uint64_t frames = 0;
+    for (size_t i = 0; i < thread_count; i += 1) frames += threads[i]->stats.count[CAPTURE_SWAPBUFFERS];
+    _bolt_replay_report(threads, thread_count, frames);
+
+    for (size_t i = 0; i < thread_count; i += 1) {
+        _bolt_signal_destroy(&threads[i]->start);
+        _bolt_signal_destroy(&threads[i]->done);
+        free(threads[i]->payload);
+        free(threads[i]->names);
+        free(threads[i]);
+    }
+    free(threads);
+    _bolt_replay_free();
+    _bolt_mock_host_close();
+    munmap((void*)data, st.st_size);
+    return 0;
+}
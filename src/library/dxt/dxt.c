@@ -0,0 +1,363 @@
+#include "dxt.h"
+
+#include <string.h>
+
+// https://www.khronos.org/opengl/wiki/S3_Texture_Compression
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DXT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC doesn't need to be told which instruction sets a function is allowed to use
+#define DXT_TARGET(X)
+#define DXT_INLINE __forceinline
+#else
+#define DXT_TARGET(X) __attribute__((target(X)))
+// the SSE2 helpers are used by the AVX2 decoder too, where an out-of-line call would mix SSE and AVX
+// encodings and be much slower
+#define DXT_INLINE inline __attribute__((always_inline))
+#endif
+#endif
+
+typedef void (*DecodeBlocksFunc)(enum DXTFormat, const uint8_t*, size_t, uint8_t*, size_t);
+
+static void _bolt_dxt_decode_blocks_scalar(enum DXTFormat, const uint8_t*, size_t, uint8_t*, size_t);
+static DecodeBlocksFunc decode_blocks = _bolt_dxt_decode_blocks_scalar;
+
+static void _bolt_unpack_rgb565(uint16_t packed, uint8_t out[3]) {
+    out[0] = (packed >> 11) & 0b00011111;
+    out[0] = (out[0] << 3) | (out[0] >> 2);
+    out[1] = (packed >> 5) & 0b00111111;
+    out[1] = (out[1] << 2) | (out[1] >> 4);
+    out[2] = packed & 0b00011111;
+    out[2] = (out[2] << 3) | (out[2] >> 2);
+}
+
+// note: the game seems to be giving us RGBA data and telling us it's SRGB, so for now, sRGB formats
+// are decoded the same as regular ones. if this turns out to be wrong, it can be converted by using
+// a lookup table for each of the possible 5-bit and 6-bit values for consistency across platforms:
+// `lut5 = [round(pow(((x << 3) | (x >> 2)) / 255.0, 2.2) * 255.0) for x in range(32)]`
+// `lut6 = [round(pow(((x << 2) | (x >> 4)) / 255.0, 2.2) * 255.0) for x in range(64)]`
+//const uint8_t lut5[] = {0, 0, 1, 1, 3, 5, 7, 9, 13, 17, 21, 26, 32, 38, 44, 51, 60, 68, 77, 87, 98, 109, 120, 132, 146, 159, 173, 188, 205, 221, 238, 255};
+//const uint8_t lut6[] = {0, 0, 0, 0, 1, 1, 1, 2, 3, 3, 4, 5, 6, 8, 9, 11, 13, 14, 16, 18, 20, 23, 25, 28, 30, 33, 36, 39, 43, 46, 49, 53, 58, 62, 66, 70, 75, 79, 84, 89, 94, 99, 105, 110, 116, 121, 127, 133, 141, 148, 154, 161, 168, 175, 182, 190, 197, 205, 213, 221, 229, 238, 246, 255};
+
+// fills `out` with the four RGBA colours which a block's 2-bit colour codes refer to. for DXT3 and
+// DXT5 the alpha bytes are left as 0, since alpha comes from a separate part of the block.
+static void _bolt_dxt_colours(enum DXTFormat format, const uint8_t* block, uint8_t out[16]) {
+    const uint8_t* cptr = (format == DXT3 || format == DXT5) ? (block + 8) : block;
+    const uint16_t c0 = cptr[0] + (cptr[1] << 8);
+    const uint16_t c1 = cptr[2] + (cptr[3] << 8);
+    uint8_t c0_rgb[3];
+    uint8_t c1_rgb[3];
+    _bolt_unpack_rgb565(c0, c0_rgb);
+    _bolt_unpack_rgb565(c1, c1_rgb);
+    const uint8_t c0_greater = c0 > c1;
+
+    memcpy(out, c0_rgb, 3);
+    memcpy(out + 4, c1_rgb, 3);
+    for (size_t i = 0; i < 3; i += 1) {
+        if (c0_greater) {
+            out[8 + i] = (2 * c0_rgb[i] + c1_rgb[i]) / 3;
+            out[12 + i] = (2 * c1_rgb[i] + c0_rgb[i]) / 3;
+        } else {
+            out[8 + i] = (c0_rgb[i] + c1_rgb[i]) / 2;
+            out[12 + i] = 0;
+        }
+    }
+
+    switch (format) {
+        case DXT1_RGB:
+            // no alpha channel at all
+            out[3] = out[7] = out[11] = out[15] = 0xFF;
+            break;
+        case DXT1_RGBA:
+            // black means zero alpha
+            out[3] = out[7] = out[11] = 0xFF;
+            out[15] = c0_greater ? 0xFF : 0;
+            break;
+        default:
+            out[3] = out[7] = out[11] = out[15] = 0;
+            break;
+    }
+}
+
+// fills `out` with the eight alpha values which a DXT5 block's 3-bit alpha codes refer to
+static void _bolt_dxt5_alpha_palette(const uint8_t* block, uint8_t out[8]) {
+    const uint8_t alpha0 = block[0];
+    const uint8_t alpha1 = block[1];
+    const uint8_t a0_greater = alpha0 > alpha1;
+    out[0] = alpha0;
+    out[1] = alpha1;
+    for (uint8_t code = 2; code < 8; code += 1) {
+        if (a0_greater) out[code] = (((8 - code) * (uint16_t)alpha0) + ((code - 1) * (uint16_t)alpha1)) / 7;
+        else if (code == 6) out[code] = 0;
+        else if (code == 7) out[code] = 0xFF;
+        else out[code] = (((6 - code) * (uint16_t)alpha0) + ((code - 1) * (uint16_t)alpha1)) / 5;
+    }
+}
+
+// fills `out` with the alpha value of each of the 16 pixels in a DXT3 or DXT5 block
+static void _bolt_dxt_alphas(enum DXTFormat format, const uint8_t* block, uint8_t out[16]) {
+    if (format == DXT3) {
+        // 4-bit alpha value from the alpha chunk
+        for (size_t i = 0; i < 16; i += 1) {
+            out[i] = ((block[i / 2] >> ((i & 1) ? 4 : 0)) & 0b1111) * 17;
+        }
+    } else {
+        // 3-bit instruction value from atable
+        uint8_t palette[8];
+        _bolt_dxt5_alpha_palette(block, palette);
+        const uint64_t atable = block[2] + ((uint64_t)block[3] << 8) + ((uint64_t)block[4] << 16) + ((uint64_t)block[5] << 24) + ((uint64_t)block[6] << 32) + ((uint64_t)block[7] << 40);
+        for (size_t i = 0; i < 16; i += 1) {
+            out[i] = palette[(atable >> (i * 3)) & 0b111];
+        }
+    }
+}
+
+static uint32_t _bolt_dxt_colour_table(enum DXTFormat format, const uint8_t* block) {
+    const uint8_t* cptr = (format == DXT3 || format == DXT5) ? (block + 8) : block;
+    return cptr[4] + (cptr[5] << 8) + (cptr[6] << 16) + ((uint32_t)cptr[7] << 24);
+}
+
+static void _bolt_dxt_decode_blocks_scalar(enum DXTFormat format, const uint8_t* blocks, size_t count, uint8_t* out, size_t stride) {
+    const size_t block_size = _bolt_dxt_block_size(format);
+    const uint8_t has_alpha_chunk = format == DXT3 || format == DXT5;
+    for (size_t b = 0; b < count; b += 1) {
+        const uint8_t* block = blocks + (b * block_size);
+        uint8_t* out_ptr = out + (b * 16);
+        uint8_t colours[16];
+        uint8_t alphas[16];
+        _bolt_dxt_colours(format, block, colours);
+        if (has_alpha_chunk) _bolt_dxt_alphas(format, block, alphas);
+        const uint32_t ctable = _bolt_dxt_colour_table(format, block);
+        for (size_t j = 0; j < 4; j += 1) {
+            for (size_t i = 0; i < 4; i += 1) {
+                const size_t pixel_index = (4 * j) + i;
+                uint8_t* pixel_ptr = out_ptr + (stride * j) + (i * 4);
+                memcpy(pixel_ptr, colours + (((ctable >> (pixel_index * 2)) & 0b11) * 4), 4);
+                if (has_alpha_chunk) pixel_ptr[3] = alphas[pixel_index];
+            }
+        }
+    }
+}
+
+#if defined(DXT_X86)
+// masks for the low and high bits of each pixel's colour code, for one row of pixels per vector
+static const uint32_t sse2_code_bit0[16] = {
+    1u << 0, 1u << 2, 1u << 4, 1u << 6, 1u << 8, 1u << 10, 1u << 12, 1u << 14,
+    1u << 16, 1u << 18, 1u << 20, 1u << 22, 1u << 24, 1u << 26, 1u << 28, 1u << 30,
+};
+static const uint32_t sse2_code_bit1[16] = {
+    1u << 1, 1u << 3, 1u << 5, 1u << 7, 1u << 9, 1u << 11, 1u << 13, 1u << 15,
+    1u << 17, 1u << 19, 1u << 21, 1u << 23, 1u << 25, 1u << 27, 1u << 29, 1u << 31,
+};
+
+// returns the alpha values of a DXT3 block's 16 pixels, one per byte
+DXT_TARGET("sse2")
+static DXT_INLINE __m128i _bolt_dxt3_alphas_sse2(const uint8_t* block) {
+    const __m128i mask = _mm_set1_epi8(0b1111);
+    const __m128i packed = _mm_loadl_epi64((const __m128i*)block);
+    const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+    // n * 17, without the multiply
+    return _mm_or_si128(nibbles, _mm_slli_epi16(nibbles, 4));
+}
+
+// returns the 3-bit alpha codes of the 8 pixels in the low 24 bits of `bits`, one per 16-bit lane.
+// each code is moved to the top of its lane by a multiply and then shifted down to the bottom, since
+// SSE2 can't shift lanes by different amounts. the last three codes are taken from `bits >> 8` so
+// that none of them needs shifting up by more than 13.
+DXT_TARGET("sse2")
+static DXT_INLINE __m128i _bolt_dxt5_alpha_codes_sse2(uint32_t bits) {
+    const short lo = (short)(bits & 0xFFFF);
+    const short hi = (short)((bits >> 8) & 0xFFFF);
+    const __m128i window = _mm_setr_epi16(lo, lo, lo, lo, lo, hi, hi, hi);
+    const __m128i multipliers = _mm_setr_epi16(1 << 13, 1 << 10, 1 << 7, 1 << 4, 1 << 1, 1 << 6, 1 << 3, 1 << 0);
+    return _mm_srli_epi16(_mm_mullo_epi16(window, multipliers), 13);
+}
+
+// returns the alpha value for each of 8 alpha codes, one per 16-bit lane, computing the same values
+// as _bolt_dxt5_alpha_palette directly instead of looking them up. each code's value is alpha0 moved
+// `k` sevenths (or fifths) of the way towards alpha1, and the division is done with a multiply-high,
+// which is exact for numerators this small. there are no branches on the block's mode, since which
+// mode each block uses is unpredictable in practice.
+DXT_TARGET("sse2")
+static DXT_INLINE __m128i _bolt_dxt5_alpha_values_sse2(__m128i codes, __m128i alpha0, __m128i alpha1, uint8_t a0_greater) {
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i steps = _mm_set1_epi16(a0_greater ? 7 : 5);
+    const __m128i reciprocal = _mm_set1_epi16(a0_greater ? 9363 : 13108);
+    // code 0 is alpha0, code 1 is alpha1, and the rest step from one to the other
+    const __m128i k = _mm_or_si128(_mm_max_epi16(_mm_sub_epi16(codes, one), _mm_setzero_si128()), _mm_and_si128(_mm_cmpeq_epi16(codes, one), steps));
+    const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(steps, k), alpha0), _mm_mullo_epi16(k, alpha1));
+    const __m128i values = _mm_mulhi_epu16(sum, reciprocal);
+    // when stepping in fifths, codes 6 and 7 are fixed at 0 and 255 instead
+    const __m128i fixed = _mm_cmpgt_epi16(codes, steps);
+    const __m128i opaque = _mm_and_si128(_mm_and_si128(fixed, _mm_cmpeq_epi16(codes, _mm_set1_epi16(7))), _mm_set1_epi16(0xFF));
+    return _mm_or_si128(_mm_andnot_si128(fixed, values), opaque);
+}
+
+// returns the alpha values of a DXT5 block's 16 pixels, one per byte
+DXT_TARGET("sse2")
+static DXT_INLINE __m128i _bolt_dxt5_alphas_sse2(const uint8_t* block) {
+    const __m128i alpha0 = _mm_set1_epi16(block[0]);
+    const __m128i alpha1 = _mm_set1_epi16(block[1]);
+    const uint8_t a0_greater = block[0] > block[1];
+    const uint32_t bits_lo = block[2] + (block[3] << 8) + ((uint32_t)block[4] << 16);
+    const uint32_t bits_hi = block[5] + (block[6] << 8) + ((uint32_t)block[7] << 16);
+    const __m128i lo = _bolt_dxt5_alpha_values_sse2(_bolt_dxt5_alpha_codes_sse2(bits_lo), alpha0, alpha1, a0_greater);
+    const __m128i hi = _bolt_dxt5_alpha_values_sse2(_bolt_dxt5_alpha_codes_sse2(bits_hi), alpha0, alpha1, a0_greater);
+    return _mm_packus_epi16(lo, hi);
+}
+
+DXT_TARGET("sse2")
+static void _bolt_dxt_decode_blocks_sse2(enum DXTFormat format, const uint8_t* blocks, size_t count, uint8_t* out, size_t stride) {
+    const size_t block_size = _bolt_dxt_block_size(format);
+    const uint8_t has_alpha_chunk = format == DXT3 || format == DXT5;
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t b = 0; b < count; b += 1) {
+        const uint8_t* block = blocks + (b * block_size);
+        uint8_t* out_ptr = out + (b * 16);
+        uint8_t colours[16];
+        _bolt_dxt_colours(format, block, colours);
+        // each row's alpha values, in the top byte of each pixel's lane
+        __m128i row_alphas[4];
+        if (has_alpha_chunk) {
+            const __m128i alphas = (format == DXT3) ? _bolt_dxt3_alphas_sse2(block) : _bolt_dxt5_alphas_sse2(block);
+            const __m128i alphas_lo = _mm_unpacklo_epi8(zero, alphas);
+            const __m128i alphas_hi = _mm_unpackhi_epi8(zero, alphas);
+            row_alphas[0] = _mm_unpacklo_epi16(zero, alphas_lo);
+            row_alphas[1] = _mm_unpackhi_epi16(zero, alphas_lo);
+            row_alphas[2] = _mm_unpacklo_epi16(zero, alphas_hi);
+            row_alphas[3] = _mm_unpackhi_epi16(zero, alphas_hi);
+        }
+        uint32_t c[4];
+        memcpy(c, colours, sizeof(c));
+        const __m128i c0 = _mm_set1_epi32((int)c[0]);
+        const __m128i c1 = _mm_set1_epi32((int)c[1]);
+        const __m128i c2 = _mm_set1_epi32((int)c[2]);
+        const __m128i c3 = _mm_set1_epi32((int)c[3]);
+        const __m128i ctable = _mm_set1_epi32((int)_bolt_dxt_colour_table(format, block));
+        for (size_t j = 0; j < 4; j += 1) {
+            // all-ones in each lane where that pixel's code has the bit unset
+            const __m128i bit0_unset = _mm_cmpeq_epi32(_mm_and_si128(ctable, _mm_loadu_si128((const __m128i*)(sse2_code_bit0 + (j * 4)))), zero);
+            const __m128i bit1_unset = _mm_cmpeq_epi32(_mm_and_si128(ctable, _mm_loadu_si128((const __m128i*)(sse2_code_bit1 + (j * 4)))), zero);
+            const __m128i lo = _mm_or_si128(_mm_and_si128(bit0_unset, c0), _mm_andnot_si128(bit0_unset, c1));
+            const __m128i hi = _mm_or_si128(_mm_and_si128(bit0_unset, c2), _mm_andnot_si128(bit0_unset, c3));
+            __m128i row = _mm_or_si128(_mm_and_si128(bit1_unset, lo), _mm_andnot_si128(bit1_unset, hi));
+            if (has_alpha_chunk) row = _mm_or_si128(row, row_alphas[j]);
+            _mm_storeu_si128((__m128i*)(out_ptr + (stride * j)), row);
+        }
+    }
+}
+
+DXT_TARGET("avx2")
+static void _bolt_dxt_decode_blocks_avx2(enum DXTFormat format, const uint8_t* blocks, size_t count, uint8_t* out, size_t stride) {
+    const size_t block_size = _bolt_dxt_block_size(format);
+    const __m256i shifts2 = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i shifts4 = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i mask2 = _mm256_set1_epi32(0b11);
+    const __m256i mask4 = _mm256_set1_epi32(0b1111);
+    for (size_t b = 0; b < count; b += 1) {
+        const uint8_t* block = blocks + (b * block_size);
+        uint8_t* out_ptr = out + (b * 16);
+        uint8_t colours[16];
+        _bolt_dxt_colours(format, block, colours);
+        // same four colours in both halves, so that vpermd can look them up with indices 0-3
+        const __m256i palette = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)colours));
+        const uint32_t ctable = _bolt_dxt_colour_table(format, block);
+
+        const __m128i alphas = (format == DXT5) ? _bolt_dxt5_alphas_sse2(block) : _mm_setzero_si128();
+
+        // two rows of pixels at a time
+        for (size_t half = 0; half < 2; half += 1) {
+            const __m256i codes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)(ctable >> (half * 16))), shifts2), mask2);
+            __m256i rows = _mm256_permutevar8x32_epi32(palette, codes);
+            if (format == DXT3) {
+                uint32_t nibbles;
+                memcpy(&nibbles, block + (half * 4), sizeof(nibbles));
+                const __m256i a = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)nibbles), shifts4), mask4);
+                rows = _mm256_or_si256(rows, _mm256_slli_epi32(_mm256_or_si256(a, _mm256_slli_epi32(a, 4)), 24));
+            } else if (format == DXT5) {
+                const __m128i half_alphas = half ? _mm_unpackhi_epi64(alphas, alphas) : alphas;
+                rows = _mm256_or_si256(rows, _mm256_slli_epi32(_mm256_cvtepu8_epi32(half_alphas), 24));
+            }
+            _mm_storeu_si128((__m128i*)(out_ptr + (stride * half * 2)), _mm256_castsi256_si128(rows));
+            _mm_storeu_si128((__m128i*)(out_ptr + (stride * ((half * 2) + 1))), _mm256_extracti128_si256(rows, 1));
+        }
+    }
+}
+
+static uint8_t _bolt_dxt_cpu_has_sse2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2") != 0;
+#endif
+}
+
+static uint8_t _bolt_dxt_cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    // the OS also has to support saving the AVX registers, or using them will fault
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0b110) != 0b110) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+void _bolt_dxt_init() {
+#if defined(DXT_X86)
+    if (_bolt_dxt_cpu_has_avx2()) {
+        decode_blocks = _bolt_dxt_decode_blocks_avx2;
+    } else if (_bolt_dxt_cpu_has_sse2()) {
+        decode_blocks = _bolt_dxt_decode_blocks_sse2;
+    }
+#endif
+}
+
+uint8_t _bolt_dxt_set_decoder(enum DXTDecoder decoder) {
+    switch (decoder) {
+        case DXT_DECODER_SCALAR:
+            decode_blocks = _bolt_dxt_decode_blocks_scalar;
+            return 1;
+#if defined(DXT_X86)
+        case DXT_DECODER_SSE2:
+            if (!_bolt_dxt_cpu_has_sse2()) return 0;
+            decode_blocks = _bolt_dxt_decode_blocks_sse2;
+            return 1;
+        case DXT_DECODER_AVX2:
+            if (!_bolt_dxt_cpu_has_avx2()) return 0;
+            decode_blocks = _bolt_dxt_decode_blocks_avx2;
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+const char* _bolt_dxt_decoder_name(enum DXTDecoder decoder) {
+    switch (decoder) {
+        case DXT_DECODER_SCALAR: return "scalar";
+        case DXT_DECODER_SSE2: return "sse2";
+        case DXT_DECODER_AVX2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+size_t _bolt_dxt_block_size(enum DXTFormat format) {
+    return (format == DXT1_RGB || format == DXT1_RGBA) ? 8 : 16;
+}
+
+void _bolt_dxt_decode_blocks(enum DXTFormat format, const uint8_t* blocks, size_t count, uint8_t* out, size_t stride) {
+    decode_blocks(format, blocks, count, out, stride);
+}
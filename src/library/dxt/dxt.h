@@ -0,0 +1,47 @@
+#ifndef _BOLT_LIBRARY_DXT_H_
+#define _BOLT_LIBRARY_DXT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// The S3TC block formats that can be decoded. The sRGB variants of each GL format use the same
+/// value as their non-sRGB equivalents, since they're decoded identically.
+enum DXTFormat {
+    DXT1_RGB,
+    DXT1_RGBA,
+    DXT3,
+    DXT5,
+};
+
+/// The decoder implementations, from slowest to fastest. Only DXT_DECODER_SCALAR is available on
+/// every platform.
+enum DXTDecoder {
+    DXT_DECODER_SCALAR,
+    DXT_DECODER_SSE2,
+    DXT_DECODER_AVX2,
+    DXT_DECODER_ENUM_SIZE, // last member of enum
+};
+
+/// Picks the fastest decoder supported by the current CPU. Until this is called, the portable
+/// scalar decoder is used, so calling it is optional, but it should be called once at startup
+/// before any decoding happens on other threads.
+void _bolt_dxt_init();
+
+/// Makes _bolt_dxt_decode_blocks use a specific decoder instead of the one picked by _bolt_dxt_init.
+/// Returns 1 on success, or 0 if that decoder isn't supported by this build or CPU, in which case
+/// nothing is changed. Intended for the dxt-test and dxt-bench programs.
+uint8_t _bolt_dxt_set_decoder(enum DXTDecoder);
+
+/// Returns the name of a decoder, e.g. "sse2", for printing.
+const char* _bolt_dxt_decoder_name(enum DXTDecoder);
+
+/// Returns the size in bytes of one 4x4 block of the given format: 8 for DXT1, 16 otherwise.
+size_t _bolt_dxt_block_size(enum DXTFormat);
+
+/// Decodes `count` consecutive blocks, representing a horizontal strip of pixels four rows high,
+/// into RGBA pixels. `out` points to the top-left pixel of the first block, and `stride` is the
+/// distance in bytes between the start of each row of pixels. All 4x(count*4) pixels are written,
+/// so the caller must ensure there's room for them.
+void _bolt_dxt_decode_blocks(enum DXTFormat, const uint8_t* blocks, size_t count, uint8_t* out, size_t stride);
+
+#endif
@@ -0,0 +1,84 @@
+// Times every decoder supported by this CPU on a 2048x2048 texture of random blocks in each format.
+// Usage: dxt-bench [iterations]
+
+#include "dxt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define TEXTURE_SIZE 2048
+
+static uint64_t now_ns() {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, ticks;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&ticks);
+    return (uint64_t)((ticks.QuadPart * 1000000000.0) / frequency.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000) + t.tv_nsec;
+#endif
+}
+
+int main(int argc, char** argv) {
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if (iterations <= 0) {
+        printf("usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const size_t blocks_per_row = TEXTURE_SIZE / 4;
+    const size_t block_count = blocks_per_row * blocks_per_row;
+    const size_t stride = TEXTURE_SIZE * 4;
+    uint8_t* blocks = malloc(block_count * 16);
+    uint8_t* pixels = malloc(stride * TEXTURE_SIZE);
+    if (!blocks || !pixels) {
+        printf("out of memory\n");
+        return 2;
+    }
+    uint64_t state = 0x853C49E6748FEA9BULL;
+    for (size_t i = 0; i < block_count * 16; i += 8) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        const uint64_t r = state * 0x2545F4914F6CDD1DULL;
+        memcpy(blocks + i, &r, 8);
+    }
+
+    const struct { enum DXTFormat format; const char* name; } formats[] = {
+        {DXT1_RGBA, "dxt1"},
+        {DXT3, "dxt3"},
+        {DXT5, "dxt5"},
+    };
+    printf("%dx%d texture, best of %d iterations\n", TEXTURE_SIZE, TEXTURE_SIZE, iterations);
+    for (int d = DXT_DECODER_SCALAR; d < DXT_DECODER_ENUM_SIZE; d += 1) {
+        if (!_bolt_dxt_set_decoder((enum DXTDecoder)d)) {
+            printf("%-7s not supported\n", _bolt_dxt_decoder_name((enum DXTDecoder)d));
+            continue;
+        }
+        for (size_t f = 0; f < sizeof(formats) / sizeof(*formats); f += 1) {
+            const size_t block_size = _bolt_dxt_block_size(formats[f].format);
+            uint64_t best = UINT64_MAX;
+            for (int i = 0; i < iterations; i += 1) {
+                const uint64_t start = now_ns();
+                for (size_t row = 0; row < blocks_per_row; row += 1) {
+                    _bolt_dxt_decode_blocks(formats[f].format, blocks + (row * blocks_per_row * block_size), blocks_per_row, pixels + (row * stride * 4), stride);
+                }
+                const uint64_t elapsed = now_ns() - start;
+                if (elapsed < best) best = elapsed;
+            }
+            printf("%-7s %s: %8.3f ms, %6.2f ns/block\n", _bolt_dxt_decoder_name((enum DXTDecoder)d), formats[f].name, best / 1000000.0, (double)best / block_count);
+        }
+    }
+
+    free(blocks);
+    free(pixels);
+    return 0;
+}
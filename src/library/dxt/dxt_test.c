@@ -0,0 +1,116 @@
+// Checks that every decoder supported by this CPU gives exactly the same output as the scalar one,
+// on random DXT1, DXT3 and DXT5 blocks. Exits with a non-zero status if anything doesn't match.
+// Usage: dxt-test [seed]
+
+#include "dxt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// number of blocks decoded per strip, and number of strips per format and decoder
+#define STRIP_BLOCKS 61
+#define STRIP_COUNT 4096
+
+// padding after each row, so that writing past the end of a block's row would be caught
+#define ROW_PADDING 12
+
+static uint64_t rng_state;
+
+static uint64_t rng_next() {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// fills `blocks` with random data. random colour and alpha endpoints are almost never equal, and are
+// ordered either way round about half the time, so some blocks have them forced equal to make sure
+// the c0 == c1 and alpha0 == alpha1 cases are covered too.
+static void random_blocks(enum DXTFormat format, uint8_t* blocks, size_t count) {
+    const size_t block_size = _bolt_dxt_block_size(format);
+    for (size_t i = 0; i < count * block_size; i += 8) {
+        const uint64_t r = rng_next();
+        memcpy(blocks + i, &r, 8);
+    }
+    const size_t colour_offset = (format == DXT3 || format == DXT5) ? 8 : 0;
+    for (size_t b = 0; b < count; b += 1) {
+        uint8_t* block = blocks + (b * block_size);
+        const uint64_t r = rng_next();
+        if ((r & 0b11) == 0) memcpy(block + colour_offset + 2, block + colour_offset, 2);
+        if (format == DXT5 && ((r >> 2) & 0b11) == 0) block[1] = block[0];
+    }
+}
+
+static uint8_t check(enum DXTFormat format, const char* format_name, enum DXTDecoder decoder) {
+    const size_t block_size = _bolt_dxt_block_size(format);
+    const size_t stride = (STRIP_BLOCKS * 16) + ROW_PADDING;
+    uint8_t* blocks = malloc(STRIP_BLOCKS * block_size);
+    uint8_t* expected = malloc(stride * 4);
+    uint8_t* actual = malloc(stride * 4);
+    if (!blocks || !expected || !actual) {
+        printf("out of memory\n");
+        exit(2);
+    }
+
+    uint8_t ok = 1;
+    for (size_t strip = 0; strip < STRIP_COUNT && ok; strip += 1) {
+        random_blocks(format, blocks, STRIP_BLOCKS);
+        // the two outputs start off different, so a pixel that only one decoder writes can't match
+        memset(expected, 0xAA, stride * 4);
+        memset(actual, 0x55, stride * 4);
+        _bolt_dxt_set_decoder(DXT_DECODER_SCALAR);
+        _bolt_dxt_decode_blocks(format, blocks, STRIP_BLOCKS, expected, stride);
+        _bolt_dxt_set_decoder(decoder);
+        _bolt_dxt_decode_blocks(format, blocks, STRIP_BLOCKS, actual, stride);
+        for (size_t row = 0; row < 4 && ok; row += 1) {
+            const uint8_t* e = expected + (row * stride);
+            const uint8_t* a = actual + (row * stride);
+            for (size_t i = 0; i < STRIP_BLOCKS * 16; i += 1) {
+                if (e[i] == a[i]) continue;
+                const size_t b = i / 16;
+                printf("FAIL %s %s: strip %zu block %zu pixel (%zu, %zu) channel %zu: expected %u, got %u\n",
+                    format_name, _bolt_dxt_decoder_name(decoder), strip, b, (i % 16) / 4, row, i % 4, e[i], a[i]);
+                printf("  block:");
+                for (size_t j = 0; j < block_size; j += 1) printf(" %02x", blocks[(b * block_size) + j]);
+                printf("\n");
+                ok = 0;
+                break;
+            }
+        }
+    }
+
+    free(blocks);
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    rng_state = (argc > 1) ? strtoull(argv[1], NULL, 0) : 0x853C49E6748FEA9BULL;
+    if (!rng_state) rng_state = 1;
+    printf("seed %llu\n", (unsigned long long)rng_state);
+
+    const struct { enum DXTFormat format; const char* name; } formats[] = {
+        {DXT1_RGB, "dxt1-rgb"},
+        {DXT1_RGBA, "dxt1-rgba"},
+        {DXT3, "dxt3"},
+        {DXT5, "dxt5"},
+    };
+    int failures = 0;
+    for (int d = DXT_DECODER_SCALAR + 1; d < DXT_DECODER_ENUM_SIZE; d += 1) {
+        if (!_bolt_dxt_set_decoder((enum DXTDecoder)d)) {
+            printf("skip %s: not supported\n", _bolt_dxt_decoder_name((enum DXTDecoder)d));
+            continue;
+        }
+        for (size_t f = 0; f < sizeof(formats) / sizeof(*formats); f += 1) {
+            if (check(formats[f].format, formats[f].name, (enum DXTDecoder)d)) {
+                printf("ok %s %s\n", formats[f].name, _bolt_dxt_decoder_name((enum DXTDecoder)d));
+            } else {
+                failures += 1;
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -1,5 +1,8 @@
 #include "gl.h"
+#include "capture/capture.h"
+#include "dxt/dxt.h"
 #include "plugin/plugin.h"
+#include "trace/trace.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -17,9 +20,15 @@
 #endif
 
 #if defined(_MSC_VER)
+#include <intrin.h>
 #define thread_local __declspec(thread)
+// sequentially-consistent access to a 64-bit epoch counter, see RetiredObject
+static uint64_t load_epoch(const uint64_t* p) { return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)p, 0, 0); }
+static void store_epoch(uint64_t* p, uint64_t v) { _InterlockedExchange64((volatile __int64*)p, (__int64)v); }
 #else
 #define thread_local _Thread_local
+static uint64_t load_epoch(const uint64_t* p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+static void store_epoch(uint64_t* p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_SEQ_CST); }
 #endif
 
 static unsigned int gl_width;
@@ -31,54 +40,57 @@ static uint8_t egl_main_context_destroy_pending = 0;
 static uint8_t egl_main_context_makecurrent_pending = 0;
 
 static struct GLProcFunctions gl = {0};
+
+// held for writing by anything which changes or frees a texture's RGBA data or compressed blocks,
+// including decoding pending blocks, and for reading by plugin functions which read RGBA data that's
+// already there (see _bolt_texture_lock_region). the render thread is the only thing which touches
+// textures unless plugins are running in threaded mode, in which case the plugin worker thread can
+// read them at any time through texture_compare_by_id and texture_read_by_id.
+static RWLock texture_lock;
 static const struct GLLibFunctions* lgl = NULL;
-static unsigned int program_direct_screen;
-static int program_direct_screen_sampler;
-static int program_direct_screen_d_xywh;
-static int program_direct_screen_s_xywh;
-static int program_direct_screen_src_wh_dest_wh;
-static unsigned int program_direct_surface;
-static int program_direct_surface_sampler;
-static int program_direct_surface_d_xywh;
-static int program_direct_surface_s_xywh;
-static int program_direct_surface_src_wh_dest_wh;
-static unsigned int program_direct_vao;
-static unsigned int buffer_vertices_square;
-
-// "direct" program is basically a blit but with transparency.
-// there are different vertex shaders for targeting the screen vs targeting a surface.
-static const char* program_direct_screen_vs = "#version 330 core\n"
-"layout (location = 0) in vec2 aPos;"
-"out vec2 vPos;"
-"uniform ivec4 d_xywh;"
-"uniform ivec4 src_wh_dest_wh;"
-"void main() {"
-  "vPos = aPos;"
-  "gl_Position = vec4(((((aPos * d_xywh.pq) + d_xywh.st) * vec2(2.0, 2.0) / src_wh_dest_wh.pq) - vec2(1.0, 1.0)) * vec2(1.0, -1.0), 0.0, 1.0);"
-"}";
-static const char* program_direct_surface_vs = "#version 330 core\n"
+static unsigned int program_sprite;
+static int program_sprite_sampler;
+static unsigned int program_sprite_vao;
+static unsigned int buffer_sprite_vertices;
+
+// "sprite" program is basically a blit but with transparency. positions and texture coordinates
+// are calculated on the CPU when the blit is recorded, so that any number of blits with the same
+// source and target can be drawn with one draw call, regardless of their sizes and positions.
+// texture coordinates are clamped to the source surface's bounds, which has the same effect as
+// GL_CLAMP_TO_EDGE for surfaces that have been packed into an atlas.
+static const char* program_sprite_vs = "#version 330 core\n"
 "layout (location = 0) in vec2 aPos;"
-"out vec2 vPos;"
-"uniform ivec4 d_xywh;"
-"uniform ivec4 src_wh_dest_wh;"
+"layout (location = 1) in vec2 aTexCoord;"
+"layout (location = 2) in vec4 aTexBounds;"
+"out vec2 vTexCoord;"
+"flat out vec4 vTexBounds;"
 "void main() {"
-  "vPos = aPos;"
-  "gl_Position = vec4(((((aPos * d_xywh.pq) + d_xywh.st) * vec2(2.0, 2.0) / src_wh_dest_wh.pq) - vec2(1.0, 1.0)), 0.0, 1.0);"
+  "vTexCoord = aTexCoord;"
+  "vTexBounds = aTexBounds;"
+  "gl_Position = vec4(aPos, 0.0, 1.0);"
 "}";
-static const char* program_direct_fs = "#version 330 core\n"
-"in vec2 vPos;"
+static const char* program_sprite_fs = "#version 330 core\n"
+"in vec2 vTexCoord;"
+"flat in vec4 vTexBounds;"
 "layout (location = 0) out vec4 col;"
 "uniform sampler2D tex;"
-"uniform ivec4 s_xywh;"
-"uniform ivec4 src_wh_dest_wh;"
 "void main() {"
-  "col = texture(tex, ((vPos * s_xywh.pq) + s_xywh.st) / src_wh_dest_wh.st);"
+  "col = texture(tex, clamp(vTexCoord, vTexBounds.st, vTexBounds.pq));"
 "}";
 
 static struct GLProgram* _bolt_context_get_program(struct GLContext*, unsigned int);
 static struct GLArrayBuffer* _bolt_context_get_buffer(struct GLContext*, unsigned int);
 static struct GLTexture2D* _bolt_context_get_texture(struct GLContext*, unsigned int);
 static struct GLVertexArray* _bolt_context_get_vao(struct GLContext*, unsigned int);
+static struct GLFramebuffer* _bolt_context_get_framebuffer(struct GLContext*, unsigned int);
+static void* _bolt_buffer_data(struct GLContext*, struct GLArrayBuffer*);
+static uint8_t* _bolt_texture_data(struct GLTexture2D*);
+static void _bolt_texture_decode_region(struct GLTexture2D*, size_t, size_t, size_t, size_t);
+static void _bolt_texture_decode_span(struct GLTexture2D*, size_t, size_t, size_t);
+static uint8_t _bolt_texture_lock_region(struct GLTexture2D*, size_t, size_t, size_t, size_t);
+static uint8_t _bolt_texture_lock_span(struct GLTexture2D*, size_t, size_t, size_t);
+static void _bolt_texture_unlock(uint8_t);
+static void _bolt_texture_free_compressed(struct GLTexture2D*);
 static void _bolt_glcontext_init(struct GLContext*, void*, void*);
 static void _bolt_glcontext_free(struct GLContext*);
 
@@ -87,80 +99,319 @@ static void _bolt_gl_plugin_drawelements_vertex2d_atlas_xy(size_t index, void* u
 static void _bolt_gl_plugin_drawelements_vertex2d_atlas_wh(size_t index, void* userdata, int32_t* out);
 static void _bolt_gl_plugin_drawelements_vertex2d_uv(size_t index, void* userdata, double* out);
 static void _bolt_gl_plugin_drawelements_vertex2d_colour(size_t index, void* userdata, double* out);
+static void _bolt_gl_plugin_drawelements_vertex2d_decode(size_t count, void* userdata, struct Vertex2DArrays* out);
 static void _bolt_gl_plugin_drawelements_vertex3d_xyz(size_t index, void* userdata, int32_t* out);
 static size_t _bolt_gl_plugin_drawelements_vertex3d_atlas_meta(size_t index, void* userdata);
 static void _bolt_gl_plugin_drawelements_vertex3d_meta_xywh(size_t meta, void* userdata, int32_t* out);
 static void _bolt_gl_plugin_drawelements_vertex3d_uv(size_t index, void* userdata, double* out);
 static void _bolt_gl_plugin_drawelements_vertex3d_colour(size_t index, void* userdata, double* out);
+static void _bolt_gl_plugin_drawelements_vertex3d_decode(size_t count, void* userdata, struct Vertex3DArrays* out);
 static void _bolt_gl_plugin_matrix3d_toworldspace(int x, int y, int z, void* userdata, double* out);
 static void _bolt_gl_plugin_matrix3d_toscreenspace(int x, int y, int z, void* userdata, double* out);
 static void _bolt_gl_plugin_matrix3d_worldpos(void* userdata, double* out);
 static size_t _bolt_gl_plugin_texture_id(void* userdata);
 static void _bolt_gl_plugin_texture_size(void* userdata, size_t* out);
 static uint8_t _bolt_gl_plugin_texture_compare(void* userdata, size_t x, size_t y, size_t len, const unsigned char* data);
-static uint8_t* _bolt_gl_plugin_texture_data(void* userdata, size_t x, size_t y);
+static uint8_t* _bolt_gl_plugin_texture_data(void* userdata, size_t x, size_t y, size_t len);
+static uint8_t _bolt_gl_plugin_texture_compare_by_id(size_t id, size_t x, size_t y, size_t len, const unsigned char* data);
+static uint8_t _bolt_gl_plugin_texture_read_by_id(size_t id, size_t x, size_t y, size_t len, uint8_t* out);
 static void _bolt_gl_plugin_surface_init(struct SurfaceFunctions* out, unsigned int width, unsigned int height, const void* data);
 static void _bolt_gl_plugin_surface_destroy(void* userdata);
 static void _bolt_gl_plugin_surface_resize(void* userdata, unsigned int width, unsigned int height);
 static void _bolt_gl_plugin_surface_clear(void* userdata, double r, double g, double b, double a);
 static void _bolt_gl_plugin_surface_drawtoscreen(void* userdata, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh);
 static void _bolt_gl_plugin_surface_drawtosurface(void* userdata, void* target, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh);
+static void _bolt_gl_sprite_flush();
+static void _bolt_gl_sprite_buffer_create(size_t ring_size);
+static void _bolt_gl_sprite_buffer_destroy();
 
 #define MAX_TEXTURE_UNITS 4096 // would be nice if there was a way to query this at runtime, but it would be awkward to set up
-#define BUFFER_LIST_CAPACITY 256 * 256
-#define TEXTURE_LIST_CAPACITY 256
-#define PROGRAM_LIST_CAPACITY 256 * 8
-#define VAO_LIST_CAPACITY 256 * 256
-#define CONTEXTS_CAPACITY 64 // not growable so we just have to hard-code a number and hope it's enough forever
+#define MAX_UNIFORM_BUFFER_BINDINGS 128 // same as MAX_TEXTURE_UNITS, real limit is usually much lower than this
+#define CONTEXTS_CAPACITY 16 // initial capacity only, the map grows if more contexts than this are created
 #define GAME_MINIMAP_BIG_SIZE 2048
-static struct GLContext contexts[CONTEXTS_CAPACITY];
+
+// all live contexts, keyed by their EGL handle. GLContext structs are allocated individually so that
+// pointers to them (like current_context) stay valid when the map grows, and destroyed ones are kept
+// in a free list to be reused by the next context that gets created.
+static struct HashMap contexts = {0};
+static struct GLContext* contexts_free_list = NULL;
 thread_local struct GLContext* current_context = NULL;
 
+// shadow objects which can be shared between contexts (programs, buffers, textures and VAOs) are
+// looked up without locking, so when one is deleted, a thread using a different context could have
+// looked it up just before and still be using it. instead of being freed straight away, they're
+// retired: put in this list, tagged with a new value of `retire_epoch`, and freed by
+// _bolt_gl_collect_retired once every context has been seen at a point where it can't be using
+// anything it looked up beforehand. those points are MakeCurrent, SwapBuffers and the delete
+// functions, and each one records the current epoch in the context's `quiescent_epoch`. a context
+// which isn't current on any thread has a quiescent_epoch of UINT64_MAX, so it holds nothing up.
+// the list is only touched with `retired_lock` held, which is initialised along with `contexts`.
+struct RetiredObject {
+    void* object;
+    void (*free)(void* object, void* arg);
+    void* arg;
+    uint64_t epoch;
+    struct RetiredObject* next;
+};
+static struct RetiredObject* retired_objects = NULL;
+static uint64_t retire_epoch = 0;
+static RWLock retired_lock;
+
+// small surfaces which are created with initial pixel data (which is how plugins usually load icons)
+// are packed into shared atlas textures instead of getting a texture and framebuffer of their own.
+// this means blits from several of them can go in the same sprite batch, and it saves the driver's
+// overhead for each texture. a surface is moved out to its own texture the first time something
+// draws to it or clears it, since a texture can't be sampled while it's being rendered to.
+// space in an atlas is allocated with a skyline packer. when a surface is freed, its space is given
+// back to the skyline if nothing is above it, otherwise it goes in the atlas's list of free
+// rectangles, which are checked before the skyline when placing a new surface. that way, plugins
+// which keep creating and freeing short-lived surfaces don't use up the atlas.
+#define ATLAS_SIZE 1024
+#define ATLAS_MAX_SURFACE_SIZE 256 // surfaces bigger than this in either dimension get their own texture
+#define ATLAS_MAX_FREE_RECTS 256 // if there are more than this, the smallest ones are forgotten about
+
+struct AtlasRect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct SurfaceAtlas {
+    unsigned int texture;
+    size_t surface_count;
+    uint16_t skyline[ATLAS_SIZE]; // height of the allocated area in each column of pixels
+    struct AtlasRect free_rects[ATLAS_MAX_FREE_RECTS]; // unused space below the skyline
+    size_t free_rect_count;
+    struct SurfaceAtlas* next;
+};
+
+static struct SurfaceAtlas* atlases = NULL;
+
+/// `framebuffer` is 0 and `renderbuffer` is the atlas's texture if `atlas` is non-NULL, in which
+/// case `x` and `y` are the surface's position in the atlas.
 struct PluginSurfaceUserdata {
     unsigned int width;
     unsigned int height;
     unsigned int framebuffer;
     unsigned int renderbuffer;
+    struct SurfaceAtlas* atlas;
+    unsigned int x;
+    unsigned int y;
 };
 
+// surface blits aren't drawn immediately. they're recorded here and drawn by _bolt_gl_sprite_flush,
+// which is called after each batch of plugin callbacks, and before anything else touches a surface.
+// blits with the same source and target are grouped into one batch, which is drawn with one draw
+// call, so the cost of a flush depends on how many different surfaces are involved rather than how
+// many blits there are. all of this is only used from the render thread, so there's no locking.
+#define SPRITE_MAX_BATCHES 64
+#define SPRITE_VERTEX_FLOATS 8 // clip-space x,y, texture u,v, and the u,v bounds of the source rectangle
+#define SPRITE_QUAD_FLOATS (6 * SPRITE_VERTEX_FLOATS) // two triangles
+
+// `target` is NULL for blits to the screen, and is never a surface in an atlas
+struct SpriteBatch {
+    unsigned int source_texture;
+    struct PluginSurfaceUserdata* target;
+    unsigned int target_width;
+    unsigned int target_height;
+    size_t quad_count;
+    size_t first_quad; // only used during a flush
+};
+
+struct SpriteQuad {
+    size_t batch;
+    float vertices[SPRITE_QUAD_FLOATS];
+};
+
+static struct SpriteBatch sprite_batches[SPRITE_MAX_BATCHES];
+static size_t sprite_batch_count = 0;
+static struct SpriteQuad* sprite_quads = NULL;
+static float* sprite_vertices = NULL; // quads' vertices sorted by batch, same capacity as sprite_quads
+static size_t sprite_quad_count = 0;
+static size_t sprite_quad_capacity = 0;
+
+// if the driver supports persistent mapping and fences, flushed sprite vertices are written straight
+// into a persistently-mapped ring buffer instead of being uploaded with glBufferData, so that there's
+// no implicit synchronisation in the driver. the ring is split into sections, each with a fence which
+// is signalled when the GPU has finished the last draw that read from it. a section is only written
+// to again after waiting on its fence, which will normally have been signalled long before then.
+// if a single flush needs more space than the whole ring, the ring is replaced with a bigger one.
+#define SPRITE_RING_INITIAL_SIZE (1024 * 1024)
+#define SPRITE_RING_SECTIONS 4
+#define SPRITE_RING_WAIT_TIMEOUT 1000000000 // nanoseconds
+#define SPRITE_VERTEX_SIZE (SPRITE_VERTEX_FLOATS * sizeof(float))
+
+static uint8_t* sprite_ring = NULL; // mapping of buffer_sprite_vertices, or NULL if it's not persistent
+static size_t sprite_ring_size = 0;
+static size_t sprite_ring_offset = 0;
+static size_t sprite_ring_section = 0; // the section that sprite_ring_offset is in
+static void* sprite_ring_fences[SPRITE_RING_SECTIONS] = {0};
+
 struct GLContext* _bolt_context() {
     return current_context;
 }
 
+const struct MemPool* _bolt_gl_buffer_pool() {
+    return current_context ? current_context->buffer_pool : NULL;
+}
+
+static uint64_t _bolt_context_hash(const void* item, uint64_t seed0, uint64_t seed1) {
+    const uintptr_t* const* const id = item;
+    return hashmap_sip(*id, sizeof(uintptr_t), seed0, seed1);
+}
+
+static int _bolt_context_compare(const void* a, const void* b, void* udata) {
+    const uintptr_t id_a = **(uintptr_t**)a;
+    const uintptr_t id_b = **(uintptr_t**)b;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+static struct GLContext* _bolt_context_find(void* egl_context) {
+    if (!contexts.map) return NULL;
+    const uintptr_t id = (uintptr_t)egl_context;
+    const uintptr_t* id_ptr = &id;
+    _bolt_rwlock_lock_read(&contexts.rwlock);
+    struct GLContext** context = (struct GLContext**)hashmap_get(contexts.map, &id_ptr);
+    struct GLContext* ret = context ? *context : NULL;
+    _bolt_rwlock_unlock_read(&contexts.rwlock);
+    return ret;
+}
+
 size_t _bolt_context_count() {
-    size_t ret = 0;
-    for (size_t i = 0; i < CONTEXTS_CAPACITY; i += 1) {
-        if (contexts[i].id != 0) {
-            ret += 1;
-        }
-    }
+    if (!contexts.map) return 0;
+    _bolt_rwlock_lock_read(&contexts.rwlock);
+    const size_t ret = hashmap_count(contexts.map);
+    _bolt_rwlock_unlock_read(&contexts.rwlock);
     return ret;
 }
 
 void _bolt_create_context(void* egl_context, void* shared) {
-    for (size_t i = 0; i < CONTEXTS_CAPACITY; i += 1) {
-        struct GLContext* ptr = &contexts[i];
-        if (ptr->id == 0) {
-            _bolt_glcontext_init(ptr, egl_context, shared);
-            ptr->is_attached = 1;
-            return;
-        }
+    if (!contexts.map) {
+        _bolt_rwlock_init(&contexts.rwlock);
+        _bolt_rwlock_init(&retired_lock);
+        contexts.map = hashmap_new(sizeof(struct GLContext*), CONTEXTS_CAPACITY, 0, 0, _bolt_context_hash, _bolt_context_compare, NULL, NULL);
     }
+    struct GLContext* ptr;
+    _bolt_rwlock_lock_write(&contexts.rwlock);
+    if (contexts_free_list) {
+        ptr = contexts_free_list;
+        contexts_free_list = ptr->next_free;
+    } else {
+        ptr = malloc(sizeof(struct GLContext));
+    }
+    _bolt_rwlock_unlock_write(&contexts.rwlock);
+    _bolt_glcontext_init(ptr, egl_context, shared);
+    ptr->is_attached = 1;
+    _bolt_rwlock_lock_write(&contexts.rwlock);
+    hashmap_set(contexts.map, &ptr);
+    _bolt_rwlock_unlock_write(&contexts.rwlock);
 }
 
 void _bolt_destroy_context(void* egl_context) {
-    for (size_t i = 0; i < CONTEXTS_CAPACITY; i += 1) {
-        struct GLContext* ptr = &contexts[i];
-        if (ptr->id == (uintptr_t)egl_context) {
-            if (ptr->is_attached) {
-                ptr->deferred_destroy = 1;
-            } else {
-                _bolt_glcontext_free(ptr);
-                ptr->id = 0;
-            }
-            break;
+    struct GLContext* ptr = _bolt_context_find(egl_context);
+    if (!ptr) return;
+    if (ptr->is_attached) {
+        ptr->deferred_destroy = 1;
+        return;
+    }
+    _bolt_rwlock_lock_write(&contexts.rwlock);
+    hashmap_delete(contexts.map, &ptr);
+    _bolt_rwlock_unlock_write(&contexts.rwlock);
+    _bolt_glcontext_free(ptr);
+    ptr->id = 0;
+    _bolt_rwlock_lock_write(&contexts.rwlock);
+    ptr->next_free = contexts_free_list;
+    contexts_free_list = ptr;
+    _bolt_rwlock_unlock_write(&contexts.rwlock);
+}
+
+// records that the context's thread isn't using any shadow objects it looked up before now
+static void _bolt_context_quiescent(struct GLContext* c) {
+    if (c) store_epoch(&c->quiescent_epoch, load_epoch(&retire_epoch));
+}
+
+// hands a shadow object which has just been removed from its IDMap to _bolt_gl_collect_retired, to
+// be freed later by calling free(object, arg). if there's no memory for that, it's leaked instead,
+// since freeing it now might not be safe.
+static void _bolt_gl_retire(void* object, void (*free_fn)(void*, void*), void* arg) {
+    if (!object) return;
+    struct RetiredObject* retired = malloc(sizeof(struct RetiredObject));
+    if (!retired) return;
+    retired->object = object;
+    retired->free = free_fn;
+    retired->arg = arg;
+    _bolt_rwlock_lock_write(&retired_lock);
+    retired->epoch = load_epoch(&retire_epoch) + 1;
+    store_epoch(&retire_epoch, retired->epoch);
+    retired->next = retired_objects;
+    retired_objects = retired;
+    _bolt_rwlock_unlock_write(&retired_lock);
+}
+
+// frees every retired object which `free_all` is true for or which no context can still be using
+static void _bolt_gl_free_retired(uint8_t (*free_all)(const struct RetiredObject*, void*), void* userdata, uint64_t safe_epoch) {
+    struct RetiredObject* freeable = NULL;
+    _bolt_rwlock_lock_write(&retired_lock);
+    struct RetiredObject** prev = &retired_objects;
+    while (*prev) {
+        struct RetiredObject* retired = *prev;
+        if (retired->epoch <= safe_epoch || (free_all && free_all(retired, userdata))) {
+            *prev = retired->next;
+            retired->next = freeable;
+            freeable = retired;
+        } else {
+            prev = &retired->next;
         }
     }
+    _bolt_rwlock_unlock_write(&retired_lock);
+    while (freeable) {
+        struct RetiredObject* next = freeable->next;
+        freeable->free(freeable->object, freeable->arg);
+        free(freeable);
+        freeable = next;
+    }
+}
+
+// frees the retired objects which every context has passed a quiescent point since retiring
+static void _bolt_gl_collect_retired() {
+    if (!contexts.map) return;
+    _bolt_rwlock_lock_read(&retired_lock);
+    const uint8_t any = retired_objects != NULL;
+    _bolt_rwlock_unlock_read(&retired_lock);
+    if (!any) return;
+    uint64_t safe_epoch = load_epoch(&retire_epoch);
+    size_t iter = 0;
+    void* item;
+    _bolt_rwlock_lock_read(&contexts.rwlock);
+    while (hashmap_iter(contexts.map, &iter, &item)) {
+        const uint64_t epoch = load_epoch(&(*(struct GLContext**)item)->quiescent_epoch);
+        if (epoch < safe_epoch) safe_epoch = epoch;
+    }
+    _bolt_rwlock_unlock_read(&contexts.rwlock);
+    _bolt_gl_free_retired(NULL, NULL, safe_epoch);
+}
+
+static uint8_t _bolt_retired_arg_is(const struct RetiredObject* retired, void* arg) {
+    return retired->arg == arg;
+}
+
+static void _bolt_free_retired_object(void* object, void* arg) {
+    free(object);
+}
+
+static void _bolt_free_retired_buffer(void* object, void* pool) {
+    struct GLArrayBuffer* buffer = object;
+    _bolt_mempool_free(pool, buffer->data);
+    _bolt_mempool_free(pool, buffer->mapping);
+    free(buffer);
+}
+
+static void _bolt_free_retired_texture(void* object, void* arg) {
+    struct GLTexture2D* texture = object;
+    _bolt_texture_free_compressed(texture);
+    free(texture->data);
+    free(texture);
 }
 
 void _bolt_set_attr_binding(struct GLContext* c, struct GLAttrBinding* binding, unsigned int buffer, int size, const void* offset, unsigned int stride, uint32_t type, uint8_t normalise) {
@@ -182,12 +433,17 @@ float _bolt_f16_to_f32(uint16_t bits) {
     return u.f;
 }
 
-uint8_t _bolt_get_attr_binding(struct GLContext* c, const struct GLAttrBinding* binding, size_t index, size_t num_out, float* out) {
+// returns a pointer to the first vertex's value of an attribute, or NULL if it has no buffer or the
+// buffer's contents can't be read. vertex n's value is at `stride * n` bytes after this.
+static const uint8_t* _bolt_attr_binding_base(struct GLContext* c, const struct GLAttrBinding* binding) {
     struct GLArrayBuffer* buffer = binding->buffer;
-    if (!buffer || !buffer->data) return 0;
-    uintptr_t buf_offset = binding->offset + (binding->stride * index);
+    if (!buffer) return NULL;
+    const uint8_t* data = _bolt_buffer_data(c, buffer);
+    return data ? data + binding->offset : NULL;
+}
 
-    const uint8_t* ptr = (uint8_t*)buffer->data + buf_offset;
+// converts one vertex's value of an attribute, starting at `ptr`, to floats
+static void _bolt_attr_binding_read(const struct GLAttrBinding* binding, const uint8_t* ptr, size_t num_out, float* out) {
     if (!binding->normalise) {
         switch (binding->type) {
             case GL_FLOAT:
@@ -242,15 +498,11 @@ uint8_t _bolt_get_attr_binding(struct GLContext* c, const struct GLAttrBinding*
                 break;
         }
     }
-    return 1;
 }
 
-uint8_t _bolt_get_attr_binding_int(struct GLContext* c, const struct GLAttrBinding* binding, size_t index, size_t num_out, int32_t* out) {
-    struct GLArrayBuffer* buffer = binding->buffer;
-    if (!buffer || !buffer->data) return 0;
-    uintptr_t buf_offset = binding->offset + (binding->stride * index);
-
-    const uint8_t* ptr = (uint8_t*)buffer->data + buf_offset;
+// converts one vertex's value of an attribute, starting at `ptr`, to ints. returns 0 without
+// writing anything if the attribute isn't a non-normalised integer type.
+static uint8_t _bolt_attr_binding_read_int(const struct GLAttrBinding* binding, const uint8_t* ptr, size_t num_out, int32_t* out) {
     if (!binding->normalise) {
         switch (binding->type) {
             case GL_UNSIGNED_BYTE:
@@ -280,71 +532,84 @@ uint8_t _bolt_get_attr_binding_int(struct GLContext* c, const struct GLAttrBindi
     return 1;
 }
 
-static int _bolt_hashmap_compare(const void* a, const void* b, void* udata) {
-    return (**(unsigned int**)a) - (**(unsigned int**)b);
-}
-
-static uint64_t _bolt_hashmap_hash(const void* item, uint64_t seed0, uint64_t seed1) {
-    const unsigned int* const* const id = item;
-    return hashmap_sip(*id, sizeof(unsigned int), seed0, seed1);
-}
-
-static void _bolt_hashmap_init(struct HashMap* map, size_t cap) {
-    _bolt_rwlock_init(&map->rwlock);
-    map->map = hashmap_new(sizeof(void*), cap, 0, 0, _bolt_hashmap_hash, _bolt_hashmap_compare, NULL, NULL);
+uint8_t _bolt_get_attr_binding(struct GLContext* c, const struct GLAttrBinding* binding, size_t index, size_t num_out, float* out) {
+    const uint8_t* base = _bolt_attr_binding_base(c, binding);
+    if (!base) return 0;
+    _bolt_attr_binding_read(binding, base + (binding->stride * index), num_out, out);
+    return 1;
 }
 
-static void _bolt_hashmap_destroy(struct HashMap* map) {
-    _bolt_rwlock_destroy(&map->rwlock);
-    hashmap_free(map->map);
+uint8_t _bolt_get_attr_binding_int(struct GLContext* c, const struct GLAttrBinding* binding, size_t index, size_t num_out, int32_t* out) {
+    const uint8_t* base = _bolt_attr_binding_base(c, binding);
+    if (!base) return 0;
+    return _bolt_attr_binding_read_int(binding, base + (binding->stride * index), num_out, out);
 }
 
 static void _bolt_glcontext_init(struct GLContext* context, void* egl_context, void* egl_shared) {
-    struct GLContext* shared = NULL;
-    if (egl_shared) {
-        for (size_t i = 0; i < CONTEXTS_CAPACITY; i += 1) {
-            struct GLContext* ptr = &contexts[i];
-            if (ptr->id == (uintptr_t)egl_shared) {
-                shared = ptr;
-                break;
-            }
-        }
-    }
+    struct GLContext* shared = egl_shared ? _bolt_context_find(egl_shared) : NULL;
     memset(context, 0, sizeof(*context));
     context->id = (uintptr_t)egl_context;
-    context->texture_units = calloc(MAX_TEXTURE_UNITS, sizeof(unsigned int));
+    context->quiescent_epoch = UINT64_MAX;
+    context->texture_units = calloc(MAX_TEXTURE_UNITS, sizeof(struct GLTexture2D*));
+    context->uniform_buffer_bindings = calloc(MAX_UNIFORM_BUFFER_BINDINGS, sizeof(unsigned int));
     context->game_view_tex = -1;
     context->target_3d_tex = -1;
     context->game_view_framebuffer = -1;
     context->need_3d_tex = 0;
+    // framebuffers are container objects, so they're never shared between contexts
+    context->framebuffers = malloc(sizeof(struct IDMap));
+    _bolt_idmap_init(context->framebuffers);
     if (shared) {
         context->programs = shared->programs;
         context->buffers = shared->buffers;
+        context->buffer_pool = shared->buffer_pool;
         context->textures = shared->textures;
         context->vaos = shared->vaos;
     } else {
         context->is_shared_owner = 1;
-        context->programs = malloc(sizeof(struct HashMap));
-        _bolt_hashmap_init(context->programs, PROGRAM_LIST_CAPACITY);
-        context->buffers = malloc(sizeof(struct HashMap));
-        _bolt_hashmap_init(context->buffers, BUFFER_LIST_CAPACITY);
-        context->textures = malloc(sizeof(struct HashMap));
-        _bolt_hashmap_init(context->textures, TEXTURE_LIST_CAPACITY);
-        context->vaos = malloc(sizeof(struct HashMap));
-        _bolt_hashmap_init(context->vaos, VAO_LIST_CAPACITY);
+        context->programs = malloc(sizeof(struct IDMap));
+        _bolt_idmap_init(context->programs);
+        context->buffers = malloc(sizeof(struct IDMap));
+        _bolt_idmap_init(context->buffers);
+        context->buffer_pool = malloc(sizeof(struct MemPool));
+        _bolt_mempool_init(context->buffer_pool);
+        context->textures = malloc(sizeof(struct IDMap));
+        _bolt_idmap_init(context->textures);
+        context->vaos = malloc(sizeof(struct IDMap));
+        _bolt_idmap_init(context->vaos);
     }
 }
 
 static void _bolt_glcontext_free(struct GLContext* context) {
     free(context->texture_units);
+    free(context->uniform_buffer_bindings);
+    size_t iter = 0;
+    void* item;
+    while (_bolt_idmap_iter(context->framebuffers, &iter, &item)) {
+        free(item);
+    }
+    _bolt_idmap_destroy(context->framebuffers);
+    free(context->framebuffers);
     if (context->is_shared_owner) {
-        _bolt_hashmap_destroy(context->programs);
+        _bolt_idmap_destroy(context->programs);
         free(context->programs);
-        _bolt_hashmap_destroy(context->buffers);
+        iter = 0;
+        while (_bolt_idmap_iter(context->buffers, &iter, &item)) {
+            struct GLArrayBuffer* buffer = item;
+            _bolt_mempool_free(context->buffer_pool, buffer->data);
+            _bolt_mempool_free(context->buffer_pool, buffer->mapping);
+            free(buffer);
+        }
+        _bolt_idmap_destroy(context->buffers);
         free(context->buffers);
-        _bolt_hashmap_destroy(context->textures);
+        // nothing can be using this share group's objects any more, but retired buffers still need the pool
+        _bolt_gl_free_retired(_bolt_retired_arg_is, context->buffer_pool, 0);
+        LOG("buffer pool: %llu bytes allocated, %llu bytes reused\n", (unsigned long long)context->buffer_pool->bytes_allocated, (unsigned long long)context->buffer_pool->bytes_reused);
+        _bolt_mempool_destroy(context->buffer_pool);
+        free(context->buffer_pool);
+        _bolt_idmap_destroy(context->textures);
         free(context->textures);
-        _bolt_hashmap_destroy(context->vaos);
+        _bolt_idmap_destroy(context->vaos);
         free(context->vaos);
     }
 }
@@ -364,65 +629,270 @@ uint32_t _bolt_binding_for_buffer(uint32_t target) {
 }
 
 static struct GLProgram* _bolt_context_get_program(struct GLContext* c, unsigned int index) {
-    struct HashMap* map = c->programs;
-    const unsigned int* index_ptr = &index;
-    _bolt_rwlock_lock_read(&map->rwlock);
-    struct GLProgram** program = (struct GLProgram**)hashmap_get(map->map, &index_ptr);
-    struct GLProgram* ret = program ? *program : NULL;
-    _bolt_rwlock_unlock_read(&map->rwlock);
-    return ret;
+    return _bolt_idmap_get(c->programs, index);
 }
 
 static struct GLArrayBuffer* _bolt_context_get_buffer(struct GLContext* c, unsigned int index) {
-    struct HashMap* map = c->buffers;
-    const unsigned int* index_ptr = &index;
-    _bolt_rwlock_lock_read(&map->rwlock);
-    struct GLArrayBuffer** buffer = (struct GLArrayBuffer**)hashmap_get(map->map, &index_ptr);
-    struct GLArrayBuffer* ret = buffer ? *buffer : NULL;
-    _bolt_rwlock_unlock_read(&map->rwlock);
-    return ret;
+    return _bolt_idmap_get(c->buffers, index);
 }
 
 static struct GLTexture2D* _bolt_context_get_texture(struct GLContext* c, unsigned int index) {
-    struct HashMap* map = c->textures;
-    const unsigned int* index_ptr = &index;
-    _bolt_rwlock_lock_read(&map->rwlock);
-    struct GLTexture2D** tex = (struct GLTexture2D**)hashmap_get(map->map, &index_ptr);
-    struct GLTexture2D* ret = tex ? *tex : NULL;
-    _bolt_rwlock_unlock_read(&map->rwlock);
-    return ret;
+    return _bolt_idmap_get(c->textures, index);
 }
 
 static struct GLVertexArray* _bolt_context_get_vao(struct GLContext* c, unsigned int index) {
-    struct HashMap* map = c->vaos;
-    const unsigned int* index_ptr = &index;
-    _bolt_rwlock_lock_read(&map->rwlock);
-    struct GLVertexArray** vao = (struct GLVertexArray**)hashmap_get(map->map, &index_ptr);
-    struct GLVertexArray* ret = vao ? *vao : NULL;
-    _bolt_rwlock_unlock_read(&map->rwlock);
+    return _bolt_idmap_get(c->vaos, index);
+}
+
+// returns the CPU-side copy of a buffer's contents. buffers aren't copied until the first time
+// this is called for them, so if there's no copy yet, the contents are read back from the driver
+// and the buffer is marked so that future uploads to it will be copied as they happen.
+// the readback is only valid because the buffer can't be mapped for real at this point: GL doesn't
+// allow drawing from a buffer with an active non-persistent mapping, and buffers with persistent
+// storage are already shadowed by _bolt_glBufferStorage. after this, all maps of it are intercepted.
+static void* _bolt_buffer_data(struct GLContext* c, struct GLArrayBuffer* buffer) {
+    if (buffer->shadowed) return buffer->data;
+    buffer->shadowed = 1;
+    if (buffer->size == 0) return NULL;
+    buffer->data = _bolt_mempool_alloc(c->buffer_pool, buffer->size);
+    if (buffer->data) {
+        int old_binding;
+        gl.GetIntegerv(GL_COPY_READ_BUFFER_BINDING, &old_binding);
+        gl.BindBuffer(GL_COPY_READ_BUFFER, buffer->id);
+        gl.GetBufferSubData(GL_COPY_READ_BUFFER, 0, buffer->size, buffer->data);
+        gl.BindBuffer(GL_COPY_READ_BUFFER, old_binding);
+    }
+    return buffer->data;
+}
+
+// gets a texture's RGBA copy, allocating it if nothing has needed it yet. textures only ever given
+// compressed uploads usually never need it at all. returns NULL if it can't be allocated.
+// texture_lock must be held for writing.
+static uint8_t* _bolt_texture_data(struct GLTexture2D* tex) {
+    if (!tex->data && tex->width && tex->height) tex->data = malloc((size_t)tex->width * tex->height * 4);
+    return tex->data;
+}
+
+// decodes any compressed blocks overlapping the given rectangle of pixels which haven't been decoded
+// into tex->data since they were uploaded, or if `decode` is 0, just returns 1 if there are any.
+// the rectangle is clamped to the texture's bounds.
+static uint8_t _bolt_texture_pending_region(struct GLTexture2D* tex, size_t x, size_t y, size_t w, size_t h, uint8_t decode) {
+    if (!tex || !tex->pending_count || x >= tex->width || y >= tex->height) return 0;
+    if (decode && !_bolt_texture_data(tex)) return 0;
+    if (x + w > tex->width) w = tex->width - x;
+    if (y + h > tex->height) h = tex->height - y;
+    if (w == 0 || h == 0) return 0;
+    const enum DXTFormat format = (enum DXTFormat)tex->compressed_format;
+    const size_t block_size = _bolt_dxt_block_size(format);
+    const size_t tex_blocks_x = (tex->width + 3) / 4;
+    uint8_t any = 0;
+    for (size_t by = y / 4; by <= (y + h - 1) / 4; by += 1) {
+        for (size_t bx = x / 4; bx <= (x + w - 1) / 4; bx += 1) {
+            const size_t block = (by * tex_blocks_x) + bx;
+            if (!tex->block_pending[block]) continue;
+            if (!decode) return 1;
+            any = 1;
+            tex->block_pending[block] = 0;
+            tex->pending_count -= 1;
+            const uint8_t* src = tex->compressed + (block * block_size);
+            if ((bx + 1) * 4 <= tex->width && (by + 1) * 4 <= tex->height) {
+                _bolt_dxt_decode_blocks(format, src, 1, tex->data + ((((by * 4) * tex->width) + (bx * 4)) * 4), tex->width * 4);
+                continue;
+            }
+            // block hangs off the right or bottom edge of the texture
+            uint8_t pixels[4 * 4 * 4];
+            _bolt_dxt_decode_blocks(format, src, 1, pixels, 4 * 4);
+            for (size_t j = 0; j < 4 && (by * 4) + j < tex->height; j += 1) {
+                for (size_t i = 0; i < 4 && (bx * 4) + i < tex->width; i += 1) {
+                    memcpy(tex->data + (((((by * 4) + j) * tex->width) + (bx * 4) + i) * 4), pixels + (j * 16) + (i * 4), 4);
+                }
+            }
+        }
+    }
+    return any;
+}
+
+static void _bolt_texture_decode_region(struct GLTexture2D* tex, size_t x, size_t y, size_t w, size_t h) {
+    _bolt_texture_pending_region(tex, x, y, w, h, 1);
+}
+
+// gets the rectangle covering `len` bytes of RGBA data starting at x,y, which may run on to
+// subsequent rows, as {x, y, w, h}
+static void _bolt_texture_span_region(const struct GLTexture2D* tex, size_t x, size_t y, size_t len, size_t* out) {
+    const size_t pixels = (len + 3) / 4;
+    if (x + pixels <= tex->width || tex->width == 0) {
+        out[0] = x;
+        out[1] = y;
+        out[2] = pixels;
+        out[3] = 1;
+    } else {
+        out[0] = 0;
+        out[1] = y;
+        out[2] = tex->width;
+        out[3] = ((x + pixels - 1) / tex->width) + 1;
+    }
+}
+
+// same as _bolt_texture_decode_region, but for a span of bytes, see _bolt_texture_span_region
+static void _bolt_texture_decode_span(struct GLTexture2D* tex, size_t x, size_t y, size_t len) {
+    if (!tex || !tex->pending_count || len == 0) return;
+    size_t region[4];
+    _bolt_texture_span_region(tex, x, y, len, region);
+    _bolt_texture_decode_region(tex, region[0], region[1], region[2], region[3]);
+}
+
+// locks texture_lock so that the given rectangle of a texture's RGBA data can be read. usually it's
+// already been allocated and decoded, so only a read lock is needed, but if not, this takes the write
+// lock and does that first. tex->data is still NULL afterwards if it couldn't be allocated. returns
+// what to pass to _bolt_texture_unlock afterwards.
+static uint8_t _bolt_texture_lock_region(struct GLTexture2D* tex, size_t x, size_t y, size_t w, size_t h) {
+    _bolt_rwlock_lock_read(&texture_lock);
+    if (tex->data && !_bolt_texture_pending_region(tex, x, y, w, h, 0)) return 0;
+    _bolt_rwlock_unlock_read(&texture_lock);
+    _bolt_rwlock_lock_write(&texture_lock);
+    _bolt_texture_data(tex);
+    _bolt_texture_decode_region(tex, x, y, w, h);
+    return 1;
+}
+
+// same as _bolt_texture_lock_region, but for a span of bytes, see _bolt_texture_span_region
+static uint8_t _bolt_texture_lock_span(struct GLTexture2D* tex, size_t x, size_t y, size_t len) {
+    size_t region[4];
+    _bolt_texture_span_region(tex, x, y, len, region);
+    return _bolt_texture_lock_region(tex, region[0], region[1], region[2], region[3]);
+}
+
+// same as _bolt_texture_lock_span, but looks the texture up by ID, and returns NULL if there's no
+// such texture or the span is out of its bounds. the lookup has to be done again if the read lock is
+// swapped for the write lock, since the texture could be deleted in between. texture_lock is held
+// afterwards either way, and `write` is set to what to pass to _bolt_texture_unlock.
+static struct GLTexture2D* _bolt_texture_lock_span_by_id(struct GLContext* c, size_t id, size_t x, size_t y, size_t len, uint8_t* write) {
+    *write = 0;
+    _bolt_rwlock_lock_read(&texture_lock);
+    struct GLTexture2D* tex = _bolt_context_get_texture(c, id);
+    if (!tex || (tex->width * y * 4) + (x * 4) + len > tex->width * tex->height * 4) return NULL;
+    size_t region[4];
+    _bolt_texture_span_region(tex, x, y, len, region);
+    if (tex->data && !_bolt_texture_pending_region(tex, region[0], region[1], region[2], region[3], 0)) return tex;
+    _bolt_rwlock_unlock_read(&texture_lock);
+    _bolt_rwlock_lock_write(&texture_lock);
+    *write = 1;
+    tex = _bolt_context_get_texture(c, id);
+    if (!tex || (tex->width * y * 4) + (x * 4) + len > tex->width * tex->height * 4) return NULL;
+    _bolt_texture_data(tex);
+    _bolt_texture_decode_span(tex, x, y, len);
+    return tex;
+}
+
+static void _bolt_texture_unlock(uint8_t write) {
+    if (write) {
+        _bolt_rwlock_unlock_write(&texture_lock);
+    } else {
+        _bolt_rwlock_unlock_read(&texture_lock);
+    }
+}
+
+static void _bolt_texture_free_compressed(struct GLTexture2D* tex) {
+    free(tex->compressed);
+    free(tex->block_pending);
+    tex->compressed = NULL;
+    tex->block_pending = NULL;
+    tex->pending_count = 0;
+}
+
+static struct GLFramebuffer* _bolt_context_get_framebuffer(struct GLContext* c, unsigned int index) {
+    return _bolt_idmap_get(c->framebuffers, index);
+}
+
+// gets the ID of the buffer bound to `target` from our copy of the binding state, only asking the
+// driver if we don't know it. target must be one that _bolt_binding_for_buffer doesn't return -1 for.
+static unsigned int _bolt_context_bound_buffer(struct GLContext* c, uint32_t target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return c->array_binding;
+        case GL_UNIFORM_BUFFER:
+            return c->uniform_binding;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            // element array binding is VAO state, and we don't keep a GLVertexArray for VAO 0
+            if (c->bound_vao) return c->bound_vao->element_binding;
+            break;
+    }
+    int buffer_id;
+    gl.GetIntegerv(_bolt_binding_for_buffer(target), &buffer_id);
+    return buffer_id;
+}
+
+// gets the name of the object attached to GL_COLOR_ATTACHMENT0 of the framebuffer currently bound
+// to `target`, which should be either GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+static int _bolt_context_framebuffer_tex(struct GLContext* c, uint32_t target) {
+    const unsigned int id = target == GL_READ_FRAMEBUFFER ? c->current_read_framebuffer : c->current_draw_framebuffer;
+    const struct GLFramebuffer* fb = _bolt_context_get_framebuffer(c, id);
+    if (fb) return fb->colour_attachment;
+    int tex;
+    gl.GetFramebufferAttachmentParameteriv(target, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &tex);
+    return tex;
+}
+
+// gets the buffer currently bound to the ViewTransforms uniform block of the given program
+static struct GLArrayBuffer* _bolt_context_view_transforms_buffer(struct GLContext* c, const struct GLProgram* p) {
+    const int binding = p->binding_ViewTransforms;
+    if (binding >= 0 && binding < MAX_UNIFORM_BUFFER_BINDINGS) {
+        return _bolt_context_get_buffer(c, c->uniform_buffer_bindings[binding]);
+    }
+    int ubo_binding, ubo_index;
+    gl.GetActiveUniformBlockiv(p->id, p->block_index_ViewTransforms, GL_UNIFORM_BLOCK_BINDING, &ubo_binding);
+    gl.GetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, ubo_binding, &ubo_index);
+    return _bolt_context_get_buffer(c, ubo_index);
+}
+
+// returns a pointer to a draw's indices, or NULL if there's no element buffer bound or its contents
+// couldn't be read, e.g. because it's empty or out of memory
+static const unsigned short* _bolt_element_indices(struct GLContext* c, struct GLArrayBuffer* element_buffer, uintptr_t indices_offset) {
+    if (!element_buffer) return NULL;
+    const uint8_t* data = _bolt_buffer_data(c, element_buffer);
+    return data ? (const unsigned short*)(data + indices_offset) : NULL;
+}
+
+// these return 0 for every vertex if the indices can't be read, so that plugins get vertex 0's
+// attributes rather than a crash
+static unsigned short _bolt_vertex2d_index(struct GLPluginDrawElementsVertex2DUserData* data, size_t index) {
+    if (!data->indices) data->indices = _bolt_element_indices(data->c, data->element_buffer, data->indices_offset);
+    return data->indices ? data->indices[index] : 0;
+}
+
+static unsigned short _bolt_vertex3d_index(struct GLPluginDrawElementsVertex3DUserData* data, size_t index) {
+    if (!data->indices) data->indices = _bolt_element_indices(data->c, data->element_buffer, data->indices_offset);
+    return data->indices ? data->indices[index] : 0;
+}
+
+static int _bolt_program_uniform_int(const struct GLProgram* p, const struct GLUniformShadow* u, int location) {
+    if (u->known) return u->value.i;
+    int ret;
+    gl.GetUniformiv(p->id, location, &ret);
     return ret;
 }
 
-static void _bolt_unpack_rgb565(uint16_t packed, uint8_t out[3]) {
-    out[0] = (packed >> 11) & 0b00011111;
-    out[0] = (out[0] << 3) | (out[0] >> 2);
-    out[1] = (packed >> 5) & 0b00111111;
-    out[1] = (out[1] << 2) | (out[1] >> 4);
-    out[2] = packed & 0b00011111;
-    out[2] = (out[2] << 3) | (out[2] >> 2);
+static void _bolt_program_uniform_floats(const struct GLProgram* p, const struct GLUniformShadow* u, int location, size_t count, float* out) {
+    if (u->known) {
+        memcpy(out, u->value.f, count * sizeof(float));
+    } else {
+        gl.GetUniformfv(p->id, location, out);
+    }
 }
 
-// use a lookup table for each of the possible 5-bit and 6-bit values for consistency across platforms
-// `lut5 = [round(pow(((x << 3) | (x >> 2)) / 255.0, 2.2) * 255.0) for x in range(32)]`
-// `lut6 = [round(pow(((x << 2) | (x >> 4)) / 255.0, 2.2) * 255.0) for x in range(64)]`
-//const uint8_t lut5[] = {0, 0, 1, 1, 3, 5, 7, 9, 13, 17, 21, 26, 32, 38, 44, 51, 60, 68, 77, 87, 98, 109, 120, 132, 146, 159, 173, 188, 205, 221, 238, 255};
-//const uint8_t lut6[] = {0, 0, 0, 0, 1, 1, 1, 2, 3, 3, 4, 5, 6, 8, 9, 11, 13, 14, 16, 18, 20, 23, 25, 28, 30, 33, 36, 39, 43, 46, 49, 53, 58, 62, 66, 70, 75, 79, 84, 89, 94, 99, 105, 110, 116, 121, 127, 133, 141, 148, 154, 161, 168, 175, 182, 190, 197, 205, 213, 221, 229, 238, 246, 255};
-static void _bolt_unpack_srgb565(uint16_t packed, uint8_t out[3]) {
-    // game seems to be giving us RGBA and telling us it's SRGB, so for now, just don't convert it
-    _bolt_unpack_rgb565(packed, out);
-    //out[0] = lut5[(packed >> 11) & 0b00011111];
-    //out[1] = lut6[(packed >> 5) & 0b00111111];
-    //out[2] = lut5[packed & 0b00011111];
+// copies a uniform value that the game is setting into our shadow copy, if it's one we care about
+static void _bolt_program_set_uniform(struct GLProgram* p, int location, const void* data, size_t size) {
+    if (!p || location == -1) return;
+#define SHADOW_UNIFORM(NAME) if (location == p->loc_##NAME) { memcpy(&p->NAME.value, data, size); p->NAME.known = 1; }
+    SHADOW_UNIFORM(uProjectionMatrix)
+    SHADOW_UNIFORM(uDiffuseMap)
+    SHADOW_UNIFORM(uTextureAtlas)
+    SHADOW_UNIFORM(uTextureAtlasSettings)
+    SHADOW_UNIFORM(uAtlasMeta)
+    SHADOW_UNIFORM(uModelMatrix)
+    SHADOW_UNIFORM(sSceneHDRTex)
+    SHADOW_UNIFORM(sSourceTex)
+#undef SHADOW_UNIFORM
 }
 
 // note this function binds GL_DRAW_FRAMEBUFFER and GL_TEXTURE_2D (for the current active texture unit)
@@ -446,17 +916,22 @@ static void _bolt_gl_surface_destroy_buffers(struct PluginSurfaceUserdata* userd
 }
 
 void _bolt_gl_load(void* (*GetProcAddress)(const char*)) {
+    _bolt_dxt_init();
+    _bolt_rwlock_init(&texture_lock);
 #define INIT_GL_FUNC(NAME) gl.NAME = GetProcAddress("gl"#NAME);
     INIT_GL_FUNC(ActiveTexture)
     INIT_GL_FUNC(AttachShader)
     INIT_GL_FUNC(BindAttribLocation)
     INIT_GL_FUNC(BindBuffer)
+    INIT_GL_FUNC(BindBufferBase)
+    INIT_GL_FUNC(BindBufferRange)
     INIT_GL_FUNC(BindFramebuffer)
     INIT_GL_FUNC(BindVertexArray)
     INIT_GL_FUNC(BlitFramebuffer)
     INIT_GL_FUNC(BufferData)
     INIT_GL_FUNC(BufferStorage)
     INIT_GL_FUNC(BufferSubData)
+    INIT_GL_FUNC(ClientWaitSync)
     INIT_GL_FUNC(CompileShader)
     INIT_GL_FUNC(CompressedTexSubImage2D)
     INIT_GL_FUNC(CopyImageSubData)
@@ -466,17 +941,22 @@ void _bolt_gl_load(void* (*GetProcAddress)(const char*)) {
     INIT_GL_FUNC(DeleteFramebuffers)
     INIT_GL_FUNC(DeleteProgram)
     INIT_GL_FUNC(DeleteShader)
+    INIT_GL_FUNC(DeleteSync)
     INIT_GL_FUNC(DeleteVertexArrays)
     INIT_GL_FUNC(DisableVertexAttribArray)
     INIT_GL_FUNC(DrawElements)
     INIT_GL_FUNC(EnableVertexAttribArray)
+    INIT_GL_FUNC(FenceSync)
     INIT_GL_FUNC(FlushMappedBufferRange)
+    INIT_GL_FUNC(FramebufferRenderbuffer)
     INIT_GL_FUNC(FramebufferTexture)
+    INIT_GL_FUNC(FramebufferTexture2D)
     INIT_GL_FUNC(FramebufferTextureLayer)
     INIT_GL_FUNC(GenBuffers)
     INIT_GL_FUNC(GenFramebuffers)
     INIT_GL_FUNC(GenVertexArrays)
     INIT_GL_FUNC(GetActiveUniformBlockiv)
+    INIT_GL_FUNC(GetBufferSubData)
     INIT_GL_FUNC(GetActiveUniformsiv)
     INIT_GL_FUNC(GetFramebufferAttachmentParameteriv)
     INIT_GL_FUNC(GetIntegeri_v)
@@ -492,7 +972,11 @@ void _bolt_gl_load(void* (*GetProcAddress)(const char*)) {
     INIT_GL_FUNC(ShaderSource)
     INIT_GL_FUNC(TexStorage2D)
     INIT_GL_FUNC(Uniform1i)
+    INIT_GL_FUNC(Uniform1iv)
+    INIT_GL_FUNC(Uniform4f)
+    INIT_GL_FUNC(Uniform4fv)
     INIT_GL_FUNC(Uniform4i)
+    INIT_GL_FUNC(UniformBlockBinding)
     INIT_GL_FUNC(UniformMatrix4fv)
     INIT_GL_FUNC(UnmapBuffer)
     INIT_GL_FUNC(UseProgram)
@@ -501,62 +985,55 @@ void _bolt_gl_load(void* (*GetProcAddress)(const char*)) {
 }
 
 void _bolt_gl_init() {
-    unsigned int direct_screen_vs = gl.CreateShader(GL_VERTEX_SHADER);
-    gl.ShaderSource(direct_screen_vs, 1, &program_direct_screen_vs, NULL);
-    gl.CompileShader(direct_screen_vs);
-
-    unsigned int direct_surface_vs = gl.CreateShader(GL_VERTEX_SHADER);
-    gl.ShaderSource(direct_surface_vs, 1, &program_direct_surface_vs, NULL);
-    gl.CompileShader(direct_surface_vs);
-
-    unsigned int direct_fs = gl.CreateShader(GL_FRAGMENT_SHADER);
-    gl.ShaderSource(direct_fs, 1, &program_direct_fs, NULL);
-    gl.CompileShader(direct_fs);
-
-    program_direct_screen = gl.CreateProgram();
-    gl.AttachShader(program_direct_screen, direct_screen_vs);
-    gl.AttachShader(program_direct_screen, direct_fs);
-    gl.LinkProgram(program_direct_screen);
-    program_direct_screen_sampler = gl.GetUniformLocation(program_direct_screen, "tex");
-    program_direct_screen_d_xywh = gl.GetUniformLocation(program_direct_screen, "d_xywh");
-    program_direct_screen_s_xywh = gl.GetUniformLocation(program_direct_screen, "s_xywh");
-    program_direct_screen_src_wh_dest_wh = gl.GetUniformLocation(program_direct_screen, "src_wh_dest_wh");
-
-    program_direct_surface = gl.CreateProgram();
-    gl.AttachShader(program_direct_surface, direct_surface_vs);
-    gl.AttachShader(program_direct_surface, direct_fs);
-    gl.LinkProgram(program_direct_surface);
-    program_direct_surface_sampler = gl.GetUniformLocation(program_direct_surface, "tex");
-    program_direct_surface_d_xywh = gl.GetUniformLocation(program_direct_surface, "d_xywh");
-    program_direct_surface_s_xywh = gl.GetUniformLocation(program_direct_surface, "s_xywh");
-    program_direct_surface_src_wh_dest_wh = gl.GetUniformLocation(program_direct_surface, "src_wh_dest_wh");
-
-    gl.DeleteShader(direct_screen_vs);
-    gl.DeleteShader(direct_surface_vs);
-    gl.DeleteShader(direct_fs);
-
-    gl.GenVertexArrays(1, &program_direct_vao);
-    gl.BindVertexArray(program_direct_vao);
-    gl.GenBuffers(1, &buffer_vertices_square);
-    gl.BindBuffer(GL_ARRAY_BUFFER, buffer_vertices_square);
-    const float square[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
-    gl.BufferData(GL_ARRAY_BUFFER, sizeof(float) * 8, square, GL_STATIC_DRAW);
-    gl.EnableVertexAttribArray(0);
-    gl.VertexAttribPointer(0, 2, GL_FLOAT, 0, 2 * sizeof(float), NULL);
+    unsigned int sprite_vs = gl.CreateShader(GL_VERTEX_SHADER);
+    gl.ShaderSource(sprite_vs, 1, &program_sprite_vs, NULL);
+    gl.CompileShader(sprite_vs);
+
+    unsigned int sprite_fs = gl.CreateShader(GL_FRAGMENT_SHADER);
+    gl.ShaderSource(sprite_fs, 1, &program_sprite_fs, NULL);
+    gl.CompileShader(sprite_fs);
+
+    program_sprite = gl.CreateProgram();
+    gl.AttachShader(program_sprite, sprite_vs);
+    gl.AttachShader(program_sprite, sprite_fs);
+    gl.LinkProgram(program_sprite);
+    program_sprite_sampler = gl.GetUniformLocation(program_sprite, "tex");
+
+    gl.DeleteShader(sprite_vs);
+    gl.DeleteShader(sprite_fs);
+
+    gl.GenVertexArrays(1, &program_sprite_vao);
+    _bolt_gl_sprite_buffer_create(SPRITE_RING_INITIAL_SIZE);
     gl.BindVertexArray(0);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void _bolt_gl_close() {
-    gl.DeleteBuffers(1, &buffer_vertices_square);
-    gl.DeleteProgram(program_direct_screen);
-    gl.DeleteProgram(program_direct_surface);
-    gl.DeleteVertexArrays(1, &program_direct_vao);
+    // anything still pending at this point is for surfaces that are about to be destroyed anyway
+    sprite_batch_count = 0;
+    sprite_quad_count = 0;
+    free(sprite_quads);
+    free(sprite_vertices);
+    sprite_quads = NULL;
+    sprite_vertices = NULL;
+    sprite_quad_capacity = 0;
+    while (atlases) {
+        struct SurfaceAtlas* next = atlases->next;
+        lgl->DeleteTextures(1, &atlases->texture);
+        free(atlases);
+        atlases = next;
+    }
+    _bolt_gl_sprite_buffer_destroy();
+    gl.DeleteProgram(program_sprite);
+    gl.DeleteVertexArrays(1, &program_sprite_vao);
     _bolt_destroy_context((void*)egl_main_context);
+    _bolt_capture_close();
 }
 
 unsigned int _bolt_glCreateProgram() {
     LOG("glCreateProgram\n");
     unsigned int id = gl.CreateProgram();
+    CAPTURE(CAPTURE_CREATEPROGRAM, NULL, 0, id);
     struct GLContext* c = _bolt_context();
     struct GLProgram* program = malloc(sizeof(struct GLProgram));
     program->id = id;
@@ -576,33 +1053,41 @@ unsigned int _bolt_glCreateProgram() {
     program->loc_uGridSize = -1;
     program->loc_uVertexScale = -1;
     program->loc_sSceneHDRTex = -1;
+    program->loc_sSourceTex = -1;
     program->block_index_ViewTransforms = -1;
+    program->binding_ViewTransforms = -1;
     program->offset_uCameraPosition = -1;
     program->offset_uViewProjMatrix = -1;
+    program->uProjectionMatrix.known = 0;
+    program->uDiffuseMap.known = 0;
+    program->uTextureAtlas.known = 0;
+    program->uTextureAtlasSettings.known = 0;
+    program->uAtlasMeta.known = 0;
+    program->uModelMatrix.known = 0;
+    program->sSceneHDRTex.known = 0;
+    program->sSourceTex.known = 0;
     program->is_2d = 0;
     program->is_3d = 0;
     program->is_minimap = 0;
-    _bolt_rwlock_lock_write(&c->programs->rwlock);
-    hashmap_set(c->programs->map, &program);
-    _bolt_rwlock_unlock_write(&c->programs->rwlock);
+    _bolt_idmap_set(c->programs, id, program);
     LOG("glCreateProgram end\n");
     return id;
 }
 
 void _bolt_glDeleteProgram(unsigned int program) {
     LOG("glDeleteProgram\n");
+    CAPTURE(CAPTURE_DELETEPROGRAM, NULL, 0, program);
     gl.DeleteProgram(program);
     struct GLContext* c = _bolt_context();
-    unsigned int* ptr = &program;
-    _bolt_rwlock_lock_write(&c->programs->rwlock);
-    struct GLProgram* const* p = hashmap_delete(c->programs->map, &ptr);
-    free(*p);
-    _bolt_rwlock_unlock_write(&c->programs->rwlock);
+    _bolt_context_quiescent(c);
+    _bolt_gl_retire(_bolt_idmap_remove(c->programs, program), _bolt_free_retired_object, NULL);
+    _bolt_gl_collect_retired();
     LOG("glDeleteProgram end\n");
 }
 
 void _bolt_glBindAttribLocation(unsigned int program, unsigned int index, const char* name) {
     LOG("glBindAttribLocation\n");
+    CAPTURE(CAPTURE_BINDATTRIBLOCATION, name, strlen(name) + 1, program, index);
     gl.BindAttribLocation(program, index, name);
     struct GLContext* c = _bolt_context();
     struct GLProgram* p = _bolt_context_get_program(c, program);
@@ -639,15 +1124,30 @@ void _bolt_glLinkProgram(unsigned int program) {
     unsigned int ubo_indices[2];
     int view_offsets[2];
     int viewport_offset;
+    int view_binding = -1;
     if (block_index_ViewTransforms != -1) {
         gl.GetUniformIndices(program, 2, view_var_names, ubo_indices);
         gl.GetActiveUniformsiv(program, 2, ubo_indices, GL_UNIFORM_OFFSET, view_offsets);
+        gl.GetActiveUniformBlockiv(program, block_index_ViewTransforms, GL_UNIFORM_BLOCK_BINDING, &view_binding);
+    }
+
+    // linking resets all uniforms to their defaults, so anything we had shadowed is now stale
+    if (p) {
+        p->uProjectionMatrix.known = 0;
+        p->uDiffuseMap.known = 0;
+        p->uTextureAtlas.known = 0;
+        p->uTextureAtlasSettings.known = 0;
+        p->uAtlasMeta.known = 0;
+        p->uModelMatrix.known = 0;
+        p->sSceneHDRTex.known = 0;
+        p->sSourceTex.known = 0;
     }
 
     if (loc_uModelMatrix != -1 && loc_uGridSize != -1 && block_index_ViewTransforms != -1) {
         p->loc_uModelMatrix = loc_uModelMatrix;
         p->loc_uGridSize = loc_uGridSize;
         p->block_index_ViewTransforms = block_index_ViewTransforms;
+        p->binding_ViewTransforms = view_binding;
         p->offset_uCameraPosition = view_offsets[0];
         p->offset_uViewProjMatrix = view_offsets[1];
         p->is_minimap = 1;
@@ -664,15 +1164,21 @@ void _bolt_glLinkProgram(unsigned int program) {
         p->loc_uModelMatrix = loc_uModelMatrix;
         p->loc_uVertexScale = loc_uVertexScale;
         p->block_index_ViewTransforms = block_index_ViewTransforms;
+        p->binding_ViewTransforms = view_binding;
         p->offset_uCameraPosition = view_offsets[0];
         p->offset_uViewProjMatrix = view_offsets[1];
         p->is_3d = 1;
     }
+    // in the order of CAPTURE_PROGRAM_NAMES
+    const int32_t capture_locations[] = {uDiffuseMap, uProjectionMatrix, uTextureAtlas, uTextureAtlasSettings, uAtlasMeta, loc_uModelMatrix,
+        loc_uGridSize, loc_uVertexScale, p->loc_sSceneHDRTex, p->loc_sSourceTex, block_index_ViewTransforms};
+    CAPTURE(CAPTURE_LINKPROGRAM, capture_locations, sizeof(capture_locations), program);
     LOG("glLinkProgram end\n");
 }
 
 void _bolt_glUseProgram(unsigned int program) {
     LOG("glUseProgram\n");
+    CAPTURE(CAPTURE_USEPROGRAM, NULL, 0, program);
     gl.UseProgram(program);
     struct GLContext* c = _bolt_context();
     c->bound_program = _bolt_context_get_program(c, program);
@@ -681,77 +1187,90 @@ void _bolt_glUseProgram(unsigned int program) {
 
 void _bolt_glTexStorage2D(uint32_t target, int levels, uint32_t internalformat, unsigned int width, unsigned int height) {
     LOG("glTexStorage2D\n");
+    CAPTURE(CAPTURE_TEXSTORAGE2D, NULL, 0, target, levels, internalformat, width, height);
     gl.TexStorage2D(target, levels, internalformat, width, height);
     struct GLContext* c = _bolt_context();
     if (target == GL_TEXTURE_2D) {
         struct GLTexture2D* tex = c->texture_units[c->active_texture];
+        _bolt_rwlock_lock_write(&texture_lock);
+        _bolt_texture_free_compressed(tex);
         free(tex->data);
-        tex->data = malloc(width * height * 4);
+        tex->data = NULL; // see _bolt_texture_data
         tex->width = width;
         tex->height = height;
+        _bolt_rwlock_unlock_write(&texture_lock);
     }
     LOG("glTexStorage2D end\n");
 }
 
 void _bolt_glVertexAttribPointer(unsigned int index, int size, uint32_t type, uint8_t normalised, unsigned int stride, const void* pointer) {
     LOG("glVertexAttribPointer\n");
+    CAPTURE(CAPTURE_VERTEXATTRIBPOINTER, NULL, 0, index, size, type, normalised, stride, (uintptr_t)pointer);
     gl.VertexAttribPointer(index, size, type, normalised, stride, pointer);
     struct GLContext* c = _bolt_context();
-    int array_binding;
-    gl.GetIntegerv(GL_ARRAY_BUFFER_BINDING, &array_binding);
-    _bolt_set_attr_binding(c, &c->bound_vao->attributes[index], array_binding, size, pointer, stride, type, normalised);
+    _bolt_set_attr_binding(c, &c->bound_vao->attributes[index], c->array_binding, size, pointer, stride, type, normalised);
     LOG("glVertexAttribPointer end\n");
 }
 
 void _bolt_glGenBuffers(uint32_t n, unsigned int* buffers) {
     LOG("glGenBuffers\n");
     gl.GenBuffers(n, buffers);
+    CAPTURE(CAPTURE_GENBUFFERS, buffers, n * sizeof(*buffers), n);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->buffers->rwlock);
     for (size_t i = 0; i < n; i += 1) {
         struct GLArrayBuffer* buffer = calloc(1, sizeof(struct GLArrayBuffer));
         buffer->id = buffers[i];
-        hashmap_set(c->buffers->map, &buffer);
+        _bolt_idmap_set(c->buffers, buffer->id, buffer);
     }
-    _bolt_rwlock_unlock_write(&c->buffers->rwlock);
     LOG("glGenBuffers end\n");
 }
 
 void _bolt_glBufferData(uint32_t target, uintptr_t size, const void* data, uint32_t usage) {
     LOG("glBufferData\n");
+    CAPTURE(CAPTURE_BUFFERDATA, data, size, target, size, usage);
     gl.BufferData(target, size, data, usage);
     struct GLContext* c = _bolt_context();
     uint32_t binding_type = _bolt_binding_for_buffer(target);
     if (binding_type != -1) {
-        int buffer_id;
-        gl.GetIntegerv(binding_type, &buffer_id);
-        void* buffer_content = malloc(size);
-        if (data) memcpy(buffer_content, data, size);
+        const unsigned int buffer_id = _bolt_context_bound_buffer(c, target);
         struct GLArrayBuffer* buffer = _bolt_context_get_buffer(c, buffer_id);
-        free(buffer->data);
-        buffer->data = buffer_content;
+        _bolt_mempool_free(c->buffer_pool, buffer->data);
+        buffer->data = NULL;
+        buffer->size = size;
+        // respecifying a buffer's storage unmaps it
+        buffer->driver_mapping = NULL;
+        if (buffer->shadowed) {
+            buffer->data = _bolt_mempool_alloc(c->buffer_pool, size);
+            if (data && buffer->data) memcpy(buffer->data, data, size);
+        }
     }
     LOG("glBufferData end\n");
 }
 
 void _bolt_glDeleteBuffers(unsigned int n, const unsigned int* buffers) {
     LOG("glDeleteBuffers\n");
+    CAPTURE(CAPTURE_DELETEBUFFERS, buffers, n * sizeof(*buffers), n);
     gl.DeleteBuffers(n, buffers);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->buffers->rwlock);
+    _bolt_context_quiescent(c);
     for (unsigned int i = 0; i < n; i += 1) {
-        const unsigned int* ptr = &buffers[i];
-        struct GLArrayBuffer* const* buffer = hashmap_delete(c->buffers->map, &ptr);
-        free((*buffer)->data);
-        free((*buffer)->mapping);
-        free(*buffer);
+        _bolt_gl_retire(_bolt_idmap_remove(c->buffers, buffers[i]), _bolt_free_retired_buffer, c->buffer_pool);
+
+        // deleting a buffer unbinds it from everywhere it's bound in this context
+        if (c->array_binding == buffers[i]) c->array_binding = 0;
+        if (c->uniform_binding == buffers[i]) c->uniform_binding = 0;
+        if (c->bound_vao && c->bound_vao->element_binding == buffers[i]) c->bound_vao->element_binding = 0;
+        for (size_t j = 0; j < MAX_UNIFORM_BUFFER_BINDINGS; j += 1) {
+            if (c->uniform_buffer_bindings[j] == buffers[i]) c->uniform_buffer_bindings[j] = 0;
+        }
     }
-    _bolt_rwlock_unlock_write(&c->buffers->rwlock);
+    _bolt_gl_collect_retired();
     LOG("glDeleteBuffers end\n");
 }
 
 void _bolt_glBindFramebuffer(uint32_t target, unsigned int framebuffer) {
     LOG("glBindFramebuffer\n", (uintptr_t)gl.BindFramebuffer);
+    CAPTURE(CAPTURE_BINDFRAMEBUFFER, NULL, 0, target, framebuffer);
     gl.BindFramebuffer(target, framebuffer);
     struct GLContext* c = _bolt_context();
     switch (target) {
@@ -769,129 +1288,108 @@ void _bolt_glBindFramebuffer(uint32_t target, unsigned int framebuffer) {
     LOG("glBindFramebuffer end\n");
 }
 
-// https://www.khronos.org/opengl/wiki/S3_Texture_Compression
 void _bolt_glCompressedTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, unsigned int imageSize, const void* data) {
     LOG("glCompressedTexSubImage2D\n");
+    CAPTURE(CAPTURE_COMPRESSEDTEXSUBIMAGE2D, data, imageSize, target, level, xoffset, yoffset, width, height, format, imageSize);
     gl.CompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
     if (target != GL_TEXTURE_2D || level != 0) return;
-    const uint8_t is_dxt1 = (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT);
-    const uint8_t is_srgb = (format == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT);
-    const size_t input_stride = is_dxt1 ? 8 : 16;
-    void (*const unpack565)(uint16_t, uint8_t*) = is_srgb ? _bolt_unpack_srgb565 : _bolt_unpack_rgb565;
+    enum DXTFormat dxt_format;
+    switch (format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            dxt_format = DXT1_RGB;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            dxt_format = DXT1_RGBA;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+            dxt_format = DXT3;
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            dxt_format = DXT5;
+            break;
+        default:
+            return;
+    }
     struct GLContext* c = _bolt_context();
     struct GLTexture2D* tex = c->texture_units[c->active_texture];
-    int out_xoffset = xoffset;
-    int out_yoffset = yoffset;
-    for (size_t ii = 0; ii < (width * height); ii += input_stride) {
-        const uint8_t* ptr = (uint8_t*)data + ii;
-        const uint8_t* cptr = is_dxt1 ? ptr : (ptr + 8);
-        uint8_t* out_ptr = tex->data + (out_yoffset * tex->width * 4) + (out_xoffset * 4);
-        uint16_t c0 = cptr[0] + (cptr[1] << 8);
-        uint16_t c1 = cptr[2] + (cptr[3] << 8);
-        uint8_t c0_rgb[3];
-        uint8_t c1_rgb[3];
-        unpack565(c0, c0_rgb);
-        unpack565(c1, c1_rgb);
-        const uint8_t c0_greater = c0 > c1;
-        const uint32_t ctable = cptr[4] + (cptr[5] << 8) + (cptr[6] << 16) + (cptr[7] << 24);
-        const uint8_t alpha0 = ptr[0];
-        const uint8_t alpha1 = ptr[1];
-        const uint8_t a0_greater = alpha0 > alpha1;
-        const uint64_t atable = ptr[2] + ((uint64_t)ptr[3] << 8) + ((uint64_t)ptr[4] << 16) + ((uint64_t)ptr[5] << 24) + ((uint64_t)ptr[6] << 32) + ((uint64_t)ptr[7] << 40);
-
-        for (size_t j = 0; j < 4; j += 1) {
-            for (size_t i = 0; i < 4; i += 1) {
-                if (out_xoffset + i >= 0 && out_yoffset + j >= 0 && out_xoffset + i < tex->width && out_yoffset + j < tex->height) {
-                    uint8_t* pixel_ptr = out_ptr + (tex->width * j * 4) + (i * 4);
-                    uint8_t pixel_index = (4 * j) + i;
-                    const uint8_t code = (ctable >> (pixel_index * 2)) & 0b11;
-
-                    // parse colour table and set R, G and B bytes for this pixel
-                    switch(code) {
-                        case 0:
-                            memcpy(pixel_ptr, c0_rgb, 3);
-                            break;
-                        case 1:
-                            memcpy(pixel_ptr, c1_rgb, 3);
-                            break;
-                        case 2:
-                            if (c0_greater) {
-                                pixel_ptr[0] = (2*c0_rgb[0]+c1_rgb[0])/3;
-                                pixel_ptr[1] = (2*c0_rgb[1]+c1_rgb[1])/3;
-                                pixel_ptr[2] = (2*c0_rgb[2]+c1_rgb[2])/3;
-                            } else {
-                                pixel_ptr[0] = (c0_rgb[0]+c1_rgb[0])/2;
-                                pixel_ptr[1] = (c0_rgb[1]+c1_rgb[1])/2;
-                                pixel_ptr[2] = (c0_rgb[2]+c1_rgb[2])/2;
-                            }
-                            break;
-                        case 3:
-                            if (c0_greater) {
-                                pixel_ptr[0] = (2*c1_rgb[0]+c0_rgb[0])/3;
-                                pixel_ptr[1] = (2*c1_rgb[1]+c0_rgb[1])/3;
-                                pixel_ptr[2] = (2*c1_rgb[2]+c0_rgb[2])/3;
-                            } else {
-                                memset(pixel_ptr, 0, 3);
-                            }
-                            break;
-                    }
-
-                    // parse alpha table (if any) and set alpha byte for this pixel
-                    switch (format) {
-                        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
-                        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: {
-                            // no alpha channel at all
-                            pixel_ptr[3] = 0xFF;
-                            break;
-                        }
-                        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
-                        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: {
-                            // black means zero alpha
-                            pixel_ptr[3] = (code == 3 && !c0_greater) ? 0 : 0xFF;
-                            break;
-                        }
-                        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
-                        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: {
-                            // 4-bit alpha value from the alpha chunk
-                            pixel_ptr[3] = ((ptr[pixel_index / 2] >> ((i & 1) ? 4 : 0)) & 0b1111) * 17;
-                            break;
-                        }
-                        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-                        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: {
-                            // 3-bit instruction value from atable
-                            const uint8_t code = (atable >> (pixel_index * 3)) & 0b111;
-                            switch (code) {
-                                case 0:
-                                    pixel_ptr[3] = alpha0;
-                                    break;
-                                case 1:
-                                    pixel_ptr[3] = alpha1;
-                                    break;
-                                case 6:
-                                case 7:
-                                    if (!a0_greater) {
-                                        pixel_ptr[3] = code == 6 ? 0 : 0xFF;
-                                        break;
-                                    }
-                                    // fall through is intentional
-                                default:
-                                    if (a0_greater) pixel_ptr[3] = (((8 - code) * (uint16_t)alpha0) + ((code - 1) * (uint16_t)alpha1)) / 7;
-                                    else pixel_ptr[3] = (((6 - code) * (uint16_t)alpha0) + ((code - 1) * (uint16_t)alpha1)) / 5;
-                                    break;
-                            }
-                            break;
-                        }
-                    }
+    if (!tex) return;
+    const size_t block_size = _bolt_dxt_block_size(dxt_format);
+    const unsigned int blocks_x = (width + 3) / 4;
+    const unsigned int blocks_y = (height + 3) / 4;
+    if ((size_t)blocks_x * blocks_y * block_size > imageSize) return;
+
+    // usual case: the upload is block-aligned, so just keep the blocks and decode them later if
+    // anything actually reads those pixels. most compressed textures are never read by plugins.
+    const size_t tex_blocks_x = (tex->width + 3) / 4;
+    const size_t tex_blocks_y = (tex->height + 3) / 4;
+    const uint8_t aligned = xoffset >= 0 && yoffset >= 0 && (xoffset % 4) == 0 && (yoffset % 4) == 0;
+    _bolt_rwlock_lock_write(&texture_lock);
+    if (aligned && tex->compressed && tex->compressed_format != (int)dxt_format) {
+        // texture is being re-uploaded in a different format - bring the RGBA copy up to date with
+        // the old blocks before throwing them away
+        _bolt_texture_decode_region(tex, 0, 0, tex->width, tex->height);
+        _bolt_texture_free_compressed(tex);
+    }
+    if (aligned && !tex->compressed) {
+        tex->compressed = malloc(tex_blocks_x * tex_blocks_y * block_size);
+        tex->block_pending = calloc(tex_blocks_x * tex_blocks_y, 1);
+        tex->pending_count = 0;
+        tex->compressed_format = (int)dxt_format;
+        if (!tex->compressed || !tex->block_pending) _bolt_texture_free_compressed(tex);
+    }
+    if (aligned && tex->compressed) {
+        const size_t first_bx = xoffset / 4;
+        const size_t first_by = yoffset / 4;
+        for (size_t by = 0; by < blocks_y && first_by + by < tex_blocks_y; by += 1) {
+            const size_t copy_x = (first_bx + blocks_x > tex_blocks_x) ? (first_bx < tex_blocks_x ? tex_blocks_x - first_bx : 0) : blocks_x;
+            const size_t tex_block = ((first_by + by) * tex_blocks_x) + first_bx;
+            memcpy(tex->compressed + (tex_block * block_size), (uint8_t*)data + (by * blocks_x * block_size), copy_x * block_size);
+            for (size_t bx = 0; bx < copy_x; bx += 1) {
+                if (!tex->block_pending[tex_block + bx]) {
+                    tex->block_pending[tex_block + bx] = 1;
+                    tex->pending_count += 1;
                 }
             }
         }
+        _bolt_rwlock_unlock_write(&texture_lock);
+        LOG("glCompressedTexSubImage2D end\n");
+        return;
+    }
 
-        out_xoffset += 4;
-        if (out_xoffset >= xoffset + width) {
-            out_xoffset = xoffset;
-            out_yoffset += 4;
+    // unaligned uploads can't be kept as blocks, so decode them immediately, after making sure no
+    // stale pending blocks get decoded over the top of them later
+    if (!_bolt_texture_data(tex)) {
+        _bolt_rwlock_unlock_write(&texture_lock);
+        LOG("glCompressedTexSubImage2D end\n");
+        return;
+    }
+    _bolt_texture_decode_region(tex, xoffset < 0 ? 0 : xoffset, yoffset < 0 ? 0 : yoffset, blocks_x * 4, blocks_y * 4);
+    for (unsigned int by = 0; by < blocks_y; by += 1) {
+        const uint8_t* row = (uint8_t*)data + (by * blocks_x * block_size);
+        const int out_y = yoffset + (by * 4);
+        if (xoffset >= 0 && out_y >= 0 && xoffset + (blocks_x * 4) <= tex->width && out_y + 4 <= tex->height) {
+            // fast path: this whole row of blocks is inside the texture, so decode straight into it
+            _bolt_dxt_decode_blocks(dxt_format, row, blocks_x, tex->data + (((out_y * tex->width) + xoffset) * 4), tex->width * 4);
+            continue;
+        }
+        for (unsigned int bx = 0; bx < blocks_x; bx += 1) {
+            uint8_t pixels[4 * 4 * 4];
+            const int out_x = xoffset + (bx * 4);
+            _bolt_dxt_decode_blocks(dxt_format, row + (bx * block_size), 1, pixels, 4 * 4);
+            for (size_t j = 0; j < 4; j += 1) {
+                for (size_t i = 0; i < 4; i += 1) {
+                    if (out_x + i >= 0 && out_y + j >= 0 && out_x + i < tex->width && out_y + j < tex->height) {
+                        memcpy(tex->data + ((((out_y + j) * tex->width) + out_x + i) * 4), pixels + (j * 16) + (i * 4), 4);
+                    }
+                }
+            }
         }
     }
+    _bolt_rwlock_unlock_write(&texture_lock);
     LOG("glCompressedTexSubImage2D end\n");
 }
 
@@ -899,20 +1397,28 @@ void _bolt_glCopyImageSubData(unsigned int srcName, uint32_t srcTarget, int srcL
                               unsigned int dstName, uint32_t dstTarget, int dstLevel, int dstX, int dstY, int dstZ,
                               unsigned int srcWidth, unsigned int srcHeight, unsigned int srcDepth) {
     LOG("glCopyImageSubData\n");
+    CAPTURE(CAPTURE_COPYIMAGESUBDATA, NULL, 0, srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
     gl.CopyImageSubData(srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
     struct GLContext* c = _bolt_context();
     if (srcTarget == GL_TEXTURE_2D && dstTarget == GL_TEXTURE_2D && srcLevel == 0 && dstLevel == 0) {
         struct GLTexture2D* src = _bolt_context_get_texture(c, srcName);
         struct GLTexture2D* dst = _bolt_context_get_texture(c, dstName);
-        for (size_t i = 0; i < srcHeight; i += 1) {
-            memcpy(dst->data + (dstY * dst->width * 4) + (dstX * 4), src->data + (srcY * src->width * 4) + (srcX * 4), srcWidth * 4);
+        _bolt_rwlock_lock_write(&texture_lock);
+        if (src && dst && _bolt_texture_data(src) && _bolt_texture_data(dst)) {
+            _bolt_texture_decode_region(src, srcX, srcY, srcWidth, srcHeight);
+            _bolt_texture_decode_region(dst, dstX, dstY, srcWidth, srcHeight);
+            for (size_t i = 0; i < srcHeight; i += 1) {
+                memcpy(dst->data + (dstY * dst->width * 4) + (dstX * 4), src->data + (srcY * src->width * 4) + (srcX * 4), srcWidth * 4);
+            }
         }
+        _bolt_rwlock_unlock_write(&texture_lock);
     }
     LOG("glCopyImageSubData end\n");
 }
 
 void _bolt_glEnableVertexAttribArray(unsigned int index) {
     LOG("glEnableVertexAttribArray\n");
+    CAPTURE(CAPTURE_ENABLEVERTEXATTRIBARRAY, NULL, 0, index);
     gl.EnableVertexAttribArray(index);
     struct GLContext* c = _bolt_context();
     c->bound_vao->attributes[index].enabled = 1;
@@ -921,6 +1427,7 @@ void _bolt_glEnableVertexAttribArray(unsigned int index) {
 
 void _bolt_glDisableVertexAttribArray(unsigned int index) {
     LOG("glDisableVertexAttribArray\n");
+    CAPTURE(CAPTURE_DISABLEVERTEXATTRIBARRAY, NULL, 0, index);
     gl.EnableVertexAttribArray(index);
     struct GLContext* c = _bolt_context();
     c->bound_vao->attributes[index].enabled = 0;
@@ -929,13 +1436,23 @@ void _bolt_glDisableVertexAttribArray(unsigned int index) {
 
 void* _bolt_glMapBufferRange(uint32_t target, intptr_t offset, uintptr_t length, uint32_t access) {
     LOG("glMapBufferRange\n");
+    CAPTURE(CAPTURE_MAPBUFFERRANGE, NULL, 0, target, offset, length, access);
     struct GLContext* c = _bolt_context();
     uint32_t binding_type = _bolt_binding_for_buffer(target);
     if (binding_type != -1) {
-        int buffer_id;
-        gl.GetIntegerv(binding_type, &buffer_id);
+        const unsigned int buffer_id = _bolt_context_bound_buffer(c, target);
         struct GLArrayBuffer* buffer = _bolt_context_get_buffer(c, buffer_id);
-        buffer->mapping = malloc(length);
+        if (!buffer->shadowed) {
+            // nothing's interested in this buffer's contents, so let the driver map it for real
+            void* ret = gl.MapBufferRange(target, offset, length, access);
+            buffer->driver_mapping = ret;
+            buffer->mapping_offset = offset;
+            buffer->mapping_len = length;
+            buffer->mapping_access_type = access;
+            LOG("glMapBufferRange end (not shadowed)\n");
+            return ret;
+        }
+        buffer->mapping = _bolt_mempool_alloc(c->buffer_pool, length);
         buffer->mapping_offset = offset;
         buffer->mapping_len = length;
         buffer->mapping_access_type = access;
@@ -953,14 +1470,26 @@ uint8_t _bolt_glUnmapBuffer(uint32_t target) {
     struct GLContext* c = _bolt_context();
     uint32_t binding_type = _bolt_binding_for_buffer(target);
     if (binding_type != -1) {
-        int buffer_id;
-        gl.GetIntegerv(binding_type, &buffer_id);
+        const unsigned int buffer_id = _bolt_context_bound_buffer(c, target);
         struct GLArrayBuffer* buffer = _bolt_context_get_buffer(c, buffer_id);
-        free(buffer->mapping);
+        if (!buffer->mapping) {
+            // this was a real mapping, see _bolt_glMapBufferRange. if it wasn't flushed explicitly,
+            // the whole range is written back by the unmap, so that's what goes in the capture.
+            // reading from a write-only mapping is slow, but only capturing needs to do it.
+            const uint8_t write_back = buffer->driver_mapping && (buffer->mapping_access_type & GL_MAP_WRITE_BIT) && !(buffer->mapping_access_type & GL_MAP_FLUSH_EXPLICIT_BIT);
+            CAPTURE(CAPTURE_UNMAPBUFFER, write_back ? buffer->driver_mapping : NULL, write_back ? buffer->mapping_len : 0, target);
+            buffer->driver_mapping = NULL;
+            uint8_t ret = gl.UnmapBuffer(target);
+            LOG("glUnmapBuffer end (not shadowed)\n");
+            return ret;
+        }
+        CAPTURE(CAPTURE_UNMAPBUFFER, NULL, 0, target);
+        _bolt_mempool_free(c->buffer_pool, buffer->mapping);
         buffer->mapping = NULL;
         LOG("glUnmapBuffer end (intercepted)\n");
         return 1;
     } else {
+        CAPTURE(CAPTURE_UNMAPBUFFER, NULL, 0, target);
         uint8_t ret = gl.UnmapBuffer(target);
         LOG("glUnmapBuffer end (not intercepted)\n");
         return ret;
@@ -969,17 +1498,24 @@ uint8_t _bolt_glUnmapBuffer(uint32_t target) {
 
 void _bolt_glBufferStorage(uint32_t target, uintptr_t size, const void* data, uintptr_t flags) {
     LOG("glBufferStorage\n");
+    CAPTURE(CAPTURE_BUFFERSTORAGE, data, size, target, size, flags);
     gl.BufferStorage(target, size, data, flags);
     struct GLContext* c = _bolt_context();
     uint32_t binding_type = _bolt_binding_for_buffer(target);
     if (binding_type != -1) {
-        int buffer_id;
-        gl.GetIntegerv(binding_type, &buffer_id);
-        void* buffer_content = malloc(size);
-        if (data) memcpy(buffer_content, data, size);
+        const unsigned int buffer_id = _bolt_context_bound_buffer(c, target);
         struct GLArrayBuffer* buffer = _bolt_context_get_buffer(c, buffer_id);
-        free(buffer->data);
-        buffer->data = buffer_content;
+        _bolt_mempool_free(c->buffer_pool, buffer->data);
+        buffer->data = NULL;
+        buffer->size = size;
+        // a persistent mapping can stay active while the buffer is drawn from, and writes through it
+        // would never reach a copy read back later, so these are shadowed from the start and every
+        // map of them is intercepted, rather than waiting for _bolt_buffer_data to do it lazily
+        if (flags & GL_MAP_PERSISTENT_BIT) buffer->shadowed = 1;
+        if (buffer->shadowed) {
+            buffer->data = _bolt_mempool_alloc(c->buffer_pool, size);
+            if (data && buffer->data) memcpy(buffer->data, data, size);
+        }
     }
     LOG("glBufferStorage end (%s)\n", binding_type == -1 ? "not intercepted" : "intercepted");
 }
@@ -989,12 +1525,19 @@ void _bolt_glFlushMappedBufferRange(uint32_t target, intptr_t offset, uintptr_t
     struct GLContext* c = _bolt_context();
     uint32_t binding_type = _bolt_binding_for_buffer(target);
     if (binding_type != -1) {
-        int buffer_id;
-        gl.GetIntegerv(binding_type, &buffer_id);
+        const unsigned int buffer_id = _bolt_context_bound_buffer(c, target);
         struct GLArrayBuffer* buffer = _bolt_context_get_buffer(c, buffer_id);
-        gl.BufferSubData(target, buffer->mapping_offset + offset, length, buffer->mapping + offset);
-        memcpy((uint8_t*)buffer->data + buffer->mapping_offset + offset, buffer->mapping + offset, length);
+        if (buffer->mapping) {
+            CAPTURE(CAPTURE_FLUSHMAPPEDBUFFERRANGE, buffer->mapping + offset, length, target, offset, length);
+            gl.BufferSubData(target, buffer->mapping_offset + offset, length, buffer->mapping + offset);
+            if (buffer->data) memcpy((uint8_t*)buffer->data + buffer->mapping_offset + offset, buffer->mapping + offset, length);
+        } else {
+            // a real mapping, so the data is read from the driver's pointer, see _bolt_glUnmapBuffer
+            CAPTURE(CAPTURE_FLUSHMAPPEDBUFFERRANGE, buffer->driver_mapping ? buffer->driver_mapping + offset : NULL, length, target, offset, length);
+            gl.FlushMappedBufferRange(target, offset, length);
+        }
     } else {
+        CAPTURE(CAPTURE_FLUSHMAPPEDBUFFERRANGE, NULL, 0, target, offset, length);
         gl.FlushMappedBufferRange(target, offset, length);
     }
     LOG("glFlushMappedBufferRange end (%s)\n", binding_type == -1 ? "not intercepted" : "intercepted");
@@ -1002,6 +1545,7 @@ void _bolt_glFlushMappedBufferRange(uint32_t target, intptr_t offset, uintptr_t
 
 void _bolt_glActiveTexture(uint32_t texture) {
     LOG("glActiveTexture\n");
+    CAPTURE(CAPTURE_ACTIVETEXTURE, NULL, 0, texture);
     gl.ActiveTexture(texture);
     struct GLContext* c = _bolt_context();
     c->active_texture = texture - GL_TEXTURE0;
@@ -1010,6 +1554,7 @@ void _bolt_glActiveTexture(uint32_t texture) {
 
 void _bolt_glMultiDrawElements(uint32_t mode, uint32_t* count, uint32_t type, const void** indices, size_t drawcount) {
     LOG("glMultiDrawElements\n");
+    // not captured, since each draw is captured by _bolt_gl_onDrawElements
     gl.MultiDrawElements(mode, count, type, indices, drawcount);
     for (size_t i = 0; i < drawcount; i += 1) {
         _bolt_gl_onDrawElements(mode, count[i], type, indices[i]);
@@ -1020,33 +1565,32 @@ void _bolt_glMultiDrawElements(uint32_t mode, uint32_t* count, uint32_t type, co
 void _bolt_glGenVertexArrays(uint32_t n, unsigned int* arrays) {
     LOG("glGenVertexArrays\n");
     gl.GenVertexArrays(n, arrays);
+    CAPTURE(CAPTURE_GENVERTEXARRAYS, arrays, n * sizeof(*arrays), n);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->vaos->rwlock);
     for (size_t i = 0; i < n; i += 1) {
         struct GLVertexArray* array = calloc(1, sizeof(struct GLVertexArray));
         array->id = arrays[i];
-        hashmap_set(c->vaos->map, &array);
+        _bolt_idmap_set(c->vaos, array->id, array);
     }
-    _bolt_rwlock_unlock_write(&c->vaos->rwlock);
     LOG("glGenVertexArrays end\n");
 }
 
 void _bolt_glDeleteVertexArrays(uint32_t n, const unsigned int* arrays) {
     LOG("glDeleteVertexArrays\n");
+    CAPTURE(CAPTURE_DELETEVERTEXARRAYS, arrays, n * sizeof(*arrays), n);
     gl.DeleteVertexArrays(n, arrays);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->vaos->rwlock);
+    _bolt_context_quiescent(c);
     for (size_t i = 0; i < n; i += 1) {
-        const unsigned int* ptr = &arrays[i];
-        struct GLVertexArray* const* vao = hashmap_delete(c->vaos->map, &ptr);
-        free(*vao);
+        _bolt_gl_retire(_bolt_idmap_remove(c->vaos, arrays[i]), _bolt_free_retired_object, NULL);
     }
-    _bolt_rwlock_unlock_write(&c->vaos->rwlock);
+    _bolt_gl_collect_retired();
     LOG("glDeleteVertexArrays end\n");
 }
 
 void _bolt_glBindVertexArray(uint32_t array) {
     LOG("glBindVertexArray\n");
+    CAPTURE(CAPTURE_BINDVERTEXARRAY, NULL, 0, array);
     gl.BindVertexArray(array);
     struct GLContext* c = _bolt_context();
     c->bound_vao = _bolt_context_get_vao(c, array);
@@ -1055,6 +1599,7 @@ void _bolt_glBindVertexArray(uint32_t array) {
 
 void _bolt_glBlitFramebuffer(int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0, int dstX1, int dstY1, uint32_t mask, uint32_t filter) {
     LOG("glBlitFramebuffer\n");
+    CAPTURE(CAPTURE_BLITFRAMEBUFFER, NULL, 0, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
     gl.BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
     struct GLContext* c = _bolt_context();
     if (c->current_draw_framebuffer == 0 && c->game_view_framebuffer != c->current_read_framebuffer) {
@@ -1064,19 +1609,197 @@ void _bolt_glBlitFramebuffer(int srcX0, int srcY0, int srcX1, int srcY1, int dst
         c->need_3d_tex = 1;
         printf("new game_view_framebuffer %u...\n", c->current_read_framebuffer);
     } else if (c->need_3d_tex) {
-        int draw_tex;
-        gl.GetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &draw_tex);
+        const int draw_tex = _bolt_context_framebuffer_tex(c, GL_DRAW_FRAMEBUFFER);
         if (draw_tex == c->game_view_tex) {
             c->need_3d_tex = 0;
             c->game_view_w = dstX1 - dstX0;
             c->game_view_h = dstY1 - dstY0;
-            gl.GetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &c->target_3d_tex);
+            c->target_3d_tex = _bolt_context_framebuffer_tex(c, GL_READ_FRAMEBUFFER);
             printf("new target_3d_tex %i\n", c->target_3d_tex);
         }
     }
     LOG("glBlitFramebuffer end\n");
 }
 
+void _bolt_glBindBuffer(uint32_t target, unsigned int buffer) {
+    LOG("glBindBuffer\n");
+    CAPTURE(CAPTURE_BINDBUFFER, NULL, 0, target, buffer);
+    gl.BindBuffer(target, buffer);
+    struct GLContext* c = _bolt_context();
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            c->array_binding = buffer;
+            break;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            if (c->bound_vao) c->bound_vao->element_binding = buffer;
+            break;
+        case GL_UNIFORM_BUFFER:
+            c->uniform_binding = buffer;
+            break;
+    }
+    LOG("glBindBuffer end\n");
+}
+
+void _bolt_glBindBufferBase(uint32_t target, unsigned int index, unsigned int buffer) {
+    LOG("glBindBufferBase\n");
+    CAPTURE(CAPTURE_BINDBUFFERBASE, NULL, 0, target, index, buffer);
+    gl.BindBufferBase(target, index, buffer);
+    struct GLContext* c = _bolt_context();
+    if (target == GL_UNIFORM_BUFFER) {
+        // binding to an indexed target also binds to the generic one
+        c->uniform_binding = buffer;
+        if (index < MAX_UNIFORM_BUFFER_BINDINGS) c->uniform_buffer_bindings[index] = buffer;
+    }
+    LOG("glBindBufferBase end\n");
+}
+
+void _bolt_glBindBufferRange(uint32_t target, unsigned int index, unsigned int buffer, intptr_t offset, uintptr_t size) {
+    LOG("glBindBufferRange\n");
+    CAPTURE(CAPTURE_BINDBUFFERRANGE, NULL, 0, target, index, buffer, offset, size);
+    gl.BindBufferRange(target, index, buffer, offset, size);
+    struct GLContext* c = _bolt_context();
+    if (target == GL_UNIFORM_BUFFER) {
+        c->uniform_binding = buffer;
+        if (index < MAX_UNIFORM_BUFFER_BINDINGS) c->uniform_buffer_bindings[index] = buffer;
+    }
+    LOG("glBindBufferRange end\n");
+}
+
+void _bolt_glUniformBlockBinding(unsigned int program, unsigned int uniformBlockIndex, unsigned int uniformBlockBinding) {
+    LOG("glUniformBlockBinding\n");
+    CAPTURE(CAPTURE_UNIFORMBLOCKBINDING, NULL, 0, program, uniformBlockIndex, uniformBlockBinding);
+    gl.UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+    struct GLContext* c = _bolt_context();
+    struct GLProgram* p = _bolt_context_get_program(c, program);
+    if (p && p->block_index_ViewTransforms != -1 && uniformBlockIndex == p->block_index_ViewTransforms) {
+        p->binding_ViewTransforms = uniformBlockBinding;
+    }
+    LOG("glUniformBlockBinding end\n");
+}
+
+void _bolt_glUniform1i(int location, int v0) {
+    LOG("glUniform1i\n");
+    CAPTURE(CAPTURE_UNIFORM1I, NULL, 0, location, v0);
+    gl.Uniform1i(location, v0);
+    struct GLContext* c = _bolt_context();
+    _bolt_program_set_uniform(c->bound_program, location, &v0, sizeof(v0));
+    LOG("glUniform1i end\n");
+}
+
+void _bolt_glUniform1iv(int location, unsigned int count, const int* value) {
+    LOG("glUniform1iv\n");
+    CAPTURE(CAPTURE_UNIFORM1IV, value, count * sizeof(*value), location, count);
+    gl.Uniform1iv(location, count, value);
+    struct GLContext* c = _bolt_context();
+    if (count > 0) _bolt_program_set_uniform(c->bound_program, location, value, sizeof(*value));
+    LOG("glUniform1iv end\n");
+}
+
+void _bolt_glUniform4f(int location, float v0, float v1, float v2, float v3) {
+    LOG("glUniform4f\n");
+    const float values[] = {v0, v1, v2, v3};
+    CAPTURE(CAPTURE_UNIFORM4F, values, sizeof(values), location);
+    gl.Uniform4f(location, v0, v1, v2, v3);
+    struct GLContext* c = _bolt_context();
+    _bolt_program_set_uniform(c->bound_program, location, values, sizeof(values));
+    LOG("glUniform4f end\n");
+}
+
+void _bolt_glUniform4fv(int location, unsigned int count, const float* value) {
+    LOG("glUniform4fv\n");
+    CAPTURE(CAPTURE_UNIFORM4FV, value, count * 4 * sizeof(*value), location, count);
+    gl.Uniform4fv(location, count, value);
+    struct GLContext* c = _bolt_context();
+    if (count > 0) _bolt_program_set_uniform(c->bound_program, location, value, 4 * sizeof(*value));
+    LOG("glUniform4fv end\n");
+}
+
+void _bolt_glUniformMatrix4fv(int location, unsigned int count, uint8_t transpose, const float* value) {
+    LOG("glUniformMatrix4fv\n");
+    CAPTURE(CAPTURE_UNIFORMMATRIX4FV, value, count * 16 * sizeof(*value), location, count, transpose);
+    gl.UniformMatrix4fv(location, count, transpose, value);
+    struct GLContext* c = _bolt_context();
+    if (count > 0) {
+        if (transpose) {
+            // store it the way glGetUniformfv would give it back to us, i.e. column-major
+            float matrix[16];
+            for (size_t i = 0; i < 16; i += 1) matrix[i] = value[((i % 4) * 4) + (i / 4)];
+            _bolt_program_set_uniform(c->bound_program, location, matrix, sizeof(matrix));
+        } else {
+            _bolt_program_set_uniform(c->bound_program, location, value, 16 * sizeof(*value));
+        }
+    }
+    LOG("glUniformMatrix4fv end\n");
+}
+
+void _bolt_glGenFramebuffers(uint32_t n, unsigned int* framebuffers) {
+    LOG("glGenFramebuffers\n");
+    gl.GenFramebuffers(n, framebuffers);
+    CAPTURE(CAPTURE_GENFRAMEBUFFERS, framebuffers, n * sizeof(*framebuffers), n);
+    struct GLContext* c = _bolt_context();
+    for (size_t i = 0; i < n; i += 1) {
+        struct GLFramebuffer* fb = calloc(1, sizeof(struct GLFramebuffer));
+        fb->id = framebuffers[i];
+        _bolt_idmap_set(c->framebuffers, fb->id, fb);
+    }
+    LOG("glGenFramebuffers end\n");
+}
+
+void _bolt_glDeleteFramebuffers(uint32_t n, unsigned int* framebuffers) {
+    LOG("glDeleteFramebuffers\n");
+    CAPTURE(CAPTURE_DELETEFRAMEBUFFERS, framebuffers, n * sizeof(*framebuffers), n);
+    gl.DeleteFramebuffers(n, framebuffers);
+    struct GLContext* c = _bolt_context();
+    for (uint32_t i = 0; i < n; i += 1) {
+        if (framebuffers[i] == 0) continue;
+        free(_bolt_idmap_remove(c->framebuffers, framebuffers[i]));
+        if (c->current_draw_framebuffer == framebuffers[i]) c->current_draw_framebuffer = 0;
+        if (c->current_read_framebuffer == framebuffers[i]) c->current_read_framebuffer = 0;
+    }
+    LOG("glDeleteFramebuffers end\n");
+}
+
+// records the new colour attachment of the framebuffer bound to `target`, if it's the one we care about
+static void _bolt_set_framebuffer_attachment(uint32_t target, uint32_t attachment, unsigned int name) {
+    if (attachment != GL_COLOR_ATTACHMENT0) return;
+    struct GLContext* c = _bolt_context();
+    const unsigned int id = target == GL_READ_FRAMEBUFFER ? c->current_read_framebuffer : c->current_draw_framebuffer;
+    struct GLFramebuffer* fb = _bolt_context_get_framebuffer(c, id);
+    if (fb) fb->colour_attachment = name;
+}
+
+void _bolt_glFramebufferTexture(uint32_t target, uint32_t attachment, unsigned int texture, int level) {
+    LOG("glFramebufferTexture\n");
+    CAPTURE(CAPTURE_FRAMEBUFFERTEXTURE, NULL, 0, target, attachment, texture, level);
+    gl.FramebufferTexture(target, attachment, texture, level);
+    _bolt_set_framebuffer_attachment(target, attachment, texture);
+    LOG("glFramebufferTexture end\n");
+}
+
+void _bolt_glFramebufferTexture2D(uint32_t target, uint32_t attachment, uint32_t textarget, unsigned int texture, int level) {
+    LOG("glFramebufferTexture2D\n");
+    CAPTURE(CAPTURE_FRAMEBUFFERTEXTURE2D, NULL, 0, target, attachment, textarget, texture, level);
+    gl.FramebufferTexture2D(target, attachment, textarget, texture, level);
+    _bolt_set_framebuffer_attachment(target, attachment, texture);
+    LOG("glFramebufferTexture2D end\n");
+}
+
+void _bolt_glFramebufferTextureLayer(uint32_t target, uint32_t attachment, unsigned int texture, int level, int layer) {
+    LOG("glFramebufferTextureLayer\n");
+    CAPTURE(CAPTURE_FRAMEBUFFERTEXTURELAYER, NULL, 0, target, attachment, texture, level, layer);
+    gl.FramebufferTextureLayer(target, attachment, texture, level, layer);
+    _bolt_set_framebuffer_attachment(target, attachment, texture);
+    LOG("glFramebufferTextureLayer end\n");
+}
+
+void _bolt_glFramebufferRenderbuffer(uint32_t target, uint32_t attachment, uint32_t renderbuffertarget, unsigned int renderbuffer) {
+    LOG("glFramebufferRenderbuffer\n");
+    CAPTURE(CAPTURE_FRAMEBUFFERRENDERBUFFER, NULL, 0, target, attachment, renderbuffertarget, renderbuffer);
+    gl.FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+    _bolt_set_framebuffer_attachment(target, attachment, renderbuffer);
+    LOG("glFramebufferRenderbuffer end\n");
+}
+
 void* _bolt_gl_GetProcAddress(const char* name) {
 #define PROC_ADDRESS_MAP(FUNC) if (!strcmp(name, "gl"#FUNC)) { return gl.FUNC ? _bolt_gl##FUNC : NULL; }
     PROC_ADDRESS_MAP(CreateProgram)
@@ -1104,17 +1827,38 @@ void* _bolt_gl_GetProcAddress(const char* name) {
     PROC_ADDRESS_MAP(DeleteVertexArrays)
     PROC_ADDRESS_MAP(BindVertexArray)
     PROC_ADDRESS_MAP(BlitFramebuffer)
+    PROC_ADDRESS_MAP(BindBuffer)
+    PROC_ADDRESS_MAP(BindBufferBase)
+    PROC_ADDRESS_MAP(BindBufferRange)
+    PROC_ADDRESS_MAP(UniformBlockBinding)
+    PROC_ADDRESS_MAP(Uniform1i)
+    PROC_ADDRESS_MAP(Uniform1iv)
+    PROC_ADDRESS_MAP(Uniform4f)
+    PROC_ADDRESS_MAP(Uniform4fv)
+    PROC_ADDRESS_MAP(UniformMatrix4fv)
+    PROC_ADDRESS_MAP(GenFramebuffers)
+    PROC_ADDRESS_MAP(DeleteFramebuffers)
+    PROC_ADDRESS_MAP(FramebufferTexture)
+    PROC_ADDRESS_MAP(FramebufferTexture2D)
+    PROC_ADDRESS_MAP(FramebufferTextureLayer)
+    PROC_ADDRESS_MAP(FramebufferRenderbuffer)
 #undef PROC_ADDRESS_MAP
     return NULL;
 }
 
 void _bolt_gl_onSwapBuffers(uint32_t window_width, uint32_t window_height) {
+    CAPTURE(CAPTURE_SWAPBUFFERS, NULL, 0, window_width, window_height);
     gl_width = window_width;
     gl_height = window_height;
+    _bolt_context_quiescent(current_context);
+    _bolt_gl_collect_retired();
     if (_bolt_plugin_is_inited()) _bolt_plugin_process_windows(window_width, window_height);
+    _bolt_gl_sprite_flush();
+    _bolt_capture_flush();
 }
 
 void _bolt_gl_onCreateContext(void* context, void* shared_context, const struct GLLibFunctions* libgl, void* (*GetProcAddress)(const char*)) {
+    CAPTURE(CAPTURE_CREATECONTEXT, NULL, 0, (uintptr_t)context, (uintptr_t)shared_context);
     if (!shared_context) {
         lgl = libgl;
         if (egl_init_count == 0) {
@@ -1129,21 +1873,18 @@ void _bolt_gl_onCreateContext(void* context, void* shared_context, const struct
 }
 
 void _bolt_gl_onMakeCurrent(void* context) {
+    CAPTURE(CAPTURE_MAKECURRENT, NULL, 0, (uintptr_t)context);
     if (current_context) {
+        store_epoch(&current_context->quiescent_epoch, UINT64_MAX);
         current_context->is_attached = 0;
-        if (current_context->deferred_destroy) _bolt_destroy_context(current_context);
+        if (current_context->deferred_destroy) _bolt_destroy_context((void*)current_context->id);
     }
     if (!context) {
         current_context = 0;
         return;
     }
-    for (size_t i = 0; i < CONTEXTS_CAPACITY; i += 1) {
-        struct GLContext* ptr = &contexts[i];
-        if (ptr->id == (uintptr_t)context) {
-            current_context = ptr;
-            break;
-        }
-    }
+    current_context = _bolt_context_find(context);
+    _bolt_context_quiescent(current_context);
     if (egl_main_context_makecurrent_pending && (uintptr_t)context == egl_main_context) {
         egl_main_context_makecurrent_pending = 0;
         _bolt_gl_init();
@@ -1151,12 +1892,15 @@ void _bolt_gl_onMakeCurrent(void* context) {
             .surface_init = _bolt_gl_plugin_surface_init,
             .surface_destroy = _bolt_gl_plugin_surface_destroy,
             .surface_resize_and_clear = _bolt_gl_plugin_surface_resize,
+            .texture_compare = _bolt_gl_plugin_texture_compare_by_id,
+            .texture_read = _bolt_gl_plugin_texture_read_by_id,
         };
         _bolt_plugin_init(&functions);
     }
 }
 
 void* _bolt_gl_onDestroyContext(void* context) {
+    CAPTURE(CAPTURE_DESTROYCONTEXT, NULL, 0, (uintptr_t)context);
     uint8_t do_destroy_main = 0;
     if ((uintptr_t)context != egl_main_context) {
         _bolt_destroy_context(context);
@@ -1171,38 +1915,42 @@ void* _bolt_gl_onDestroyContext(void* context) {
 }
 
 void _bolt_gl_onGenTextures(uint32_t n, unsigned int* textures) {
+    CAPTURE(CAPTURE_GENTEXTURES, textures, n * sizeof(*textures), n);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->textures->rwlock);
     for (size_t i = 0; i < n; i += 1) {
         struct GLTexture2D* tex = calloc(1, sizeof(struct GLTexture2D));
         tex->id = textures[i];
         tex->is_minimap_tex_big = 0;
         tex->is_minimap_tex_small = 0;
-        hashmap_set(c->textures->map, &tex);
+        _bolt_idmap_set(c->textures, tex->id, tex);
     }
-    _bolt_rwlock_unlock_write(&c->textures->rwlock);
 }
 
 void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, const void* indices_offset) {
+    CAPTURE(CAPTURE_DRAWELEMENTS, NULL, 0, mode, count, type, (uintptr_t)indices_offset);
+    // everything below this is only for building events for plugins, so don't bother if no plugin wants them
+    const uint8_t want_2d = _bolt_plugin_has_subscribers(PLUGIN_EVENT_BATCH2D);
+    const uint8_t want_minimap = _bolt_plugin_has_subscribers(PLUGIN_EVENT_MINIMAP);
+    const uint8_t want_3d = _bolt_plugin_has_subscribers(PLUGIN_EVENT_RENDER3D);
+    if (!want_2d && !want_minimap && !want_3d) return;
+    const uint64_t trace_start = _bolt_trace_begin();
     struct GLContext* c = _bolt_context();
     struct GLAttrBinding* attributes = c->bound_vao->attributes;
-    int element_binding;
-    gl.GetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_binding);
+    const unsigned int element_binding = _bolt_context_bound_buffer(c, GL_ELEMENT_ARRAY_BUFFER);
     struct GLArrayBuffer* element_buffer = _bolt_context_get_buffer(c, element_binding);
-    const unsigned short* indices = (unsigned short*)((uint8_t*)element_buffer->data + (uintptr_t)indices_offset);
     if (type == GL_UNSIGNED_SHORT && mode == GL_TRIANGLES && count > 0 && c->bound_program->is_2d && !c->bound_program->is_minimap) {
-        int diffuse_map;
-        gl.GetUniformiv(c->bound_program->id, c->bound_program->loc_uDiffuseMap, &diffuse_map);
+        const struct GLProgram* p = c->bound_program;
+        const int diffuse_map = _bolt_program_uniform_int(p, &p->uDiffuseMap, p->loc_uDiffuseMap);
         float projection_matrix[16];
-        gl.GetUniformfv(c->bound_program->id, c->bound_program->loc_uProjectionMatrix, projection_matrix);
-        int draw_tex;
-        gl.GetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &draw_tex);
+        _bolt_program_uniform_floats(p, &p->uProjectionMatrix, p->loc_uProjectionMatrix, 16, projection_matrix);
+        const int draw_tex = _bolt_context_framebuffer_tex(c, GL_DRAW_FRAMEBUFFER);
         struct GLTexture2D* tex = c->texture_units[diffuse_map];
         struct GLTexture2D* tex_target = _bolt_context_get_texture(c, draw_tex);
 
         if (tex->is_minimap_tex_big) {
             tex_target->is_minimap_tex_small = 1;
-            if (count == 6) {
+            const unsigned short* indices = (count == 6 && want_minimap) ? _bolt_element_indices(c, element_buffer, (uintptr_t)indices_offset) : NULL;
+            if (indices) {
                 // get XY and UV of first two vertices
                 const struct GLAttrBinding* tex_uv = &attributes[c->bound_program->loc_aTextureUV];
                 const struct GLAttrBinding* position_2d = &attributes[c->bound_program->loc_aVertexPosition2D];
@@ -1263,12 +2011,15 @@ void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, c
                     render.x = tex->minimap_center_x + (64.0 * (cx - (double)(tex->width >> 1)));
                     render.y = tex->minimap_center_y + (64.0 * (cy - (double)(tex->height >> 1)));
                     _bolt_plugin_handle_minimap(&render);
+                    _bolt_gl_sprite_flush();
                 }
             }
-        } else {
+        } else if (want_2d) {
             struct GLPluginDrawElementsVertex2DUserData vertex_userdata;
             vertex_userdata.c = c;
-            vertex_userdata.indices = (unsigned short*)((uint8_t*)element_buffer->data + (uintptr_t)indices_offset);
+            vertex_userdata.indices = NULL;
+            vertex_userdata.element_buffer = element_buffer;
+            vertex_userdata.indices_offset = (uintptr_t)indices_offset;
             vertex_userdata.atlas = c->texture_units[diffuse_map];
             vertex_userdata.position = &attributes[c->bound_program->loc_aVertexPosition2D];
             vertex_userdata.atlas_min = &attributes[c->bound_program->loc_aTextureUVAtlasMin];
@@ -1291,6 +2042,7 @@ void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, c
             batch.vertex_functions.atlas_wh = _bolt_gl_plugin_drawelements_vertex2d_atlas_wh;
             batch.vertex_functions.uv = _bolt_gl_plugin_drawelements_vertex2d_uv;
             batch.vertex_functions.colour = _bolt_gl_plugin_drawelements_vertex2d_colour;
+            batch.vertex_functions.decode = _bolt_gl_plugin_drawelements_vertex2d_decode;
             batch.texture_functions.userdata = &tex_userdata;
             batch.texture_functions.id = _bolt_gl_plugin_texture_id;
             batch.texture_functions.size = _bolt_gl_plugin_texture_size;
@@ -1298,26 +2050,26 @@ void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, c
             batch.texture_functions.data = _bolt_gl_plugin_texture_data;
 
             _bolt_plugin_handle_2d(&batch);
+            _bolt_gl_sprite_flush();
         }
     }
-    if (type == GL_UNSIGNED_SHORT && mode == GL_TRIANGLES && c->bound_program->is_3d) {
-        int draw_tex;
-        gl.GetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &draw_tex);
+    if (want_3d && type == GL_UNSIGNED_SHORT && mode == GL_TRIANGLES && c->bound_program->is_3d) {
+        const int draw_tex = _bolt_context_framebuffer_tex(c, GL_DRAW_FRAMEBUFFER);
         if (draw_tex == c->target_3d_tex) {
-            int atlas, settings_atlas, ubo_binding, ubo_view_index, ubo_viewport_index;
+            const struct GLProgram* p = c->bound_program;
             float atlas_meta[4];
-            gl.GetUniformiv(c->bound_program->id, c->bound_program->loc_uTextureAtlas, &atlas);
-            gl.GetUniformiv(c->bound_program->id, c->bound_program->loc_uTextureAtlasSettings, &settings_atlas);
-            gl.GetUniformfv(c->bound_program->id, c->bound_program->loc_uAtlasMeta, atlas_meta);
+            const int atlas = _bolt_program_uniform_int(p, &p->uTextureAtlas, p->loc_uTextureAtlas);
+            const int settings_atlas = _bolt_program_uniform_int(p, &p->uTextureAtlasSettings, p->loc_uTextureAtlasSettings);
+            _bolt_program_uniform_floats(p, &p->uAtlasMeta, p->loc_uAtlasMeta, 4, atlas_meta);
             struct GLTexture2D* tex = c->texture_units[atlas];
             struct GLTexture2D* tex_settings = c->texture_units[settings_atlas];
-            gl.GetActiveUniformBlockiv(c->bound_program->id, c->bound_program->block_index_ViewTransforms, GL_UNIFORM_BLOCK_BINDING, &ubo_binding);
-            gl.GetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, ubo_binding, &ubo_view_index);
-            const float* view_proj_matrix = (float*)((uint8_t*)(_bolt_context_get_buffer(c, ubo_view_index)->data) + c->bound_program->offset_uViewProjMatrix);
+            const float* view_proj_matrix = (float*)((uint8_t*)_bolt_buffer_data(c, _bolt_context_view_transforms_buffer(c, p)) + p->offset_uViewProjMatrix);
 
             struct GLPluginDrawElementsVertex3DUserData vertex_userdata;
             vertex_userdata.c = c;
-            vertex_userdata.indices = (unsigned short*)((uint8_t*)element_buffer->data + (uintptr_t)indices_offset);
+            vertex_userdata.indices = NULL;
+            vertex_userdata.element_buffer = element_buffer;
+            vertex_userdata.indices_offset = (uintptr_t)indices_offset;
             vertex_userdata.atlas_scale = roundf(atlas_meta[1]);
             vertex_userdata.atlas = tex;
             vertex_userdata.settings_atlas = tex_settings;
@@ -1330,8 +2082,12 @@ void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, c
             tex_userdata.tex = tex;
 
             struct GLPlugin3DMatrixUserData matrix_userdata;
-            gl.GetUniformfv(c->bound_program->id, c->bound_program->loc_uModelMatrix, matrix_userdata.model_matrix);
+            _bolt_program_uniform_floats(p, &p->uModelMatrix, p->loc_uModelMatrix, 16, matrix_userdata.model_matrix);
             memcpy(matrix_userdata.viewproj_matrix, view_proj_matrix, 16 * sizeof(float));
+            matrix_userdata.game_view_x = c->game_view_x;
+            matrix_userdata.game_view_y = c->game_view_y;
+            matrix_userdata.game_view_w = c->game_view_w;
+            matrix_userdata.game_view_h = c->game_view_h;
 
             struct Render3D render;
             render.vertex_count = count;
@@ -1341,38 +2097,40 @@ void _bolt_gl_onDrawElements(uint32_t mode, unsigned int count, uint32_t type, c
             render.vertex_functions.atlas_xywh = _bolt_gl_plugin_drawelements_vertex3d_meta_xywh;
             render.vertex_functions.uv = _bolt_gl_plugin_drawelements_vertex3d_uv;
             render.vertex_functions.colour = _bolt_gl_plugin_drawelements_vertex3d_colour;
+            render.vertex_functions.decode = _bolt_gl_plugin_drawelements_vertex3d_decode;
             render.texture_functions.userdata = &tex_userdata;
             render.texture_functions.id = _bolt_gl_plugin_texture_id;
             render.texture_functions.size = _bolt_gl_plugin_texture_size;
             render.texture_functions.compare = _bolt_gl_plugin_texture_compare;
             render.texture_functions.data = _bolt_gl_plugin_texture_data;
             render.matrix_functions.userdata = &matrix_userdata;
+            render.matrix_functions.userdata_size = sizeof(matrix_userdata);
             render.matrix_functions.to_world_space = _bolt_gl_plugin_matrix3d_toworldspace;
             render.matrix_functions.to_screen_space = _bolt_gl_plugin_matrix3d_toscreenspace;
             render.matrix_functions.world_pos = _bolt_gl_plugin_matrix3d_worldpos;
 
             _bolt_plugin_handle_3d(&render);
+            _bolt_gl_sprite_flush();
         }
     }
+    _bolt_trace_end("gl drawelements", trace_start);
 }
 
 void _bolt_gl_onDrawArrays(uint32_t mode, int first, unsigned int count) {
+    CAPTURE(CAPTURE_DRAWARRAYS, NULL, 0, mode, first, count);
+    const uint64_t trace_start = _bolt_trace_begin();
     struct GLContext* c = _bolt_context();
-    int draw_tex;
-    gl.GetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &draw_tex);
+    struct GLProgram* p = c->bound_program;
+    const int draw_tex = _bolt_context_framebuffer_tex(c, GL_DRAW_FRAMEBUFFER);
     struct GLTexture2D* tex = _bolt_context_get_texture(c, draw_tex);
-    if (c->bound_program->is_minimap && tex->width == GAME_MINIMAP_BIG_SIZE && tex->height == GAME_MINIMAP_BIG_SIZE) {
-        int ubo_binding, ubo_view_index;
-        gl.GetActiveUniformBlockiv(c->bound_program->id, c->bound_program->block_index_ViewTransforms, GL_UNIFORM_BLOCK_BINDING, &ubo_binding);
-        gl.GetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, ubo_binding, &ubo_view_index);
-        const float* camera_position = (float*)((uint8_t*)(_bolt_context_get_buffer(c, ubo_view_index)->data) + c->bound_program->offset_uCameraPosition);
+    if (p->is_minimap && tex->width == GAME_MINIMAP_BIG_SIZE && tex->height == GAME_MINIMAP_BIG_SIZE) {
+        const float* camera_position = (float*)((uint8_t*)_bolt_buffer_data(c, _bolt_context_view_transforms_buffer(c, p)) + p->offset_uCameraPosition);
         tex->is_minimap_tex_big = 1;
         tex->minimap_center_x = camera_position[0];
         tex->minimap_center_y = camera_position[2];
     } else if (mode == GL_TRIANGLE_STRIP && count == 4) {
-        if (c->bound_program->loc_sSceneHDRTex != -1) {
-            int game_view_tex;
-            gl.GetUniformiv(c->bound_program->id, c->bound_program->loc_sSceneHDRTex, &game_view_tex);
+        if (p->loc_sSceneHDRTex != -1) {
+            const int game_view_tex = _bolt_program_uniform_int(p, &p->sSceneHDRTex, p->loc_sSceneHDRTex);
             if (c->current_draw_framebuffer == 0 && c->game_view_tex_front != c->texture_units[game_view_tex]->id) {
                 c->game_view_tex = c->texture_units[game_view_tex]->id;
                 c->game_view_tex_front = c->game_view_tex;
@@ -1386,10 +2144,9 @@ void _bolt_gl_onDrawArrays(uint32_t mode, int first, unsigned int count) {
                 c->game_view_tex_front = c->game_view_tex;
                 printf("new game_view_tex %u...\n", c->game_view_tex);
             }
-        } else if (c->bound_program->loc_sSourceTex != -1) {
+        } else if (p->loc_sSourceTex != -1) {
             if (c->need_3d_tex == 1 && draw_tex == c->game_view_tex) {
-                int game_view_tex;
-                gl.GetUniformiv(c->bound_program->id, c->bound_program->loc_sSourceTex, &game_view_tex);
+                const int game_view_tex = _bolt_program_uniform_int(p, &p->sSourceTex, p->loc_sSourceTex);
                 c->game_view_tex = c->texture_units[game_view_tex]->id;
                 printf("updated direct game_view_tex to %u...\n", c->game_view_tex);
                 c->need_3d_tex += 1;
@@ -1397,9 +2154,11 @@ void _bolt_gl_onDrawArrays(uint32_t mode, int first, unsigned int count) {
 
         }
     }
+    _bolt_trace_end("gl drawarrays", trace_start);
 }
 
 void _bolt_gl_onBindTexture(uint32_t target, unsigned int texture) {
+    CAPTURE(CAPTURE_BINDTEXTURE, NULL, 0, target, texture);
     if (target == GL_TEXTURE_2D) {
         struct GLContext* c = _bolt_context();
         c->texture_units[c->active_texture] = _bolt_context_get_texture(c, texture);
@@ -1407,36 +2166,42 @@ void _bolt_gl_onBindTexture(uint32_t target, unsigned int texture) {
 }
 
 void _bolt_gl_onTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, uint32_t type, const void* pixels) {
+    CAPTURE(CAPTURE_TEXSUBIMAGE2D, pixels, format == GL_RGBA ? width * height * 4 : 0, target, level, xoffset, yoffset, width, height, format, type);
     struct GLContext* c = _bolt_context();
     if (target == GL_TEXTURE_2D && level == 0 && format == GL_RGBA) {
         struct GLTexture2D* tex = c->texture_units[c->active_texture];
         if (tex && !(xoffset < 0 || yoffset < 0 || xoffset + width > tex->width || yoffset + height > tex->height)) {
-            for (unsigned int y = 0; y < height; y += 1) {
-                unsigned char* dest_ptr = tex->data + ((tex->width * (y + yoffset)) + xoffset) * 4;
-                const uint8_t* src_ptr = (uint8_t*)pixels + (width * y * 4);
-                memcpy(dest_ptr, src_ptr, width * 4);
+            _bolt_rwlock_lock_write(&texture_lock);
+            if (_bolt_texture_data(tex)) {
+                _bolt_texture_decode_region(tex, xoffset, yoffset, width, height);
+                for (unsigned int y = 0; y < height; y += 1) {
+                    unsigned char* dest_ptr = tex->data + ((tex->width * (y + yoffset)) + xoffset) * 4;
+                    const uint8_t* src_ptr = (uint8_t*)pixels + (width * y * 4);
+                    memcpy(dest_ptr, src_ptr, width * 4);
+                }
             }
+            _bolt_rwlock_unlock_write(&texture_lock);
         }
     }
 }
 
 void _bolt_gl_onDeleteTextures(unsigned int n, const unsigned int* textures) {
+    CAPTURE(CAPTURE_DELETETEXTURES, textures, n * sizeof(*textures), n);
     struct GLContext* c = _bolt_context();
-    _bolt_rwlock_lock_write(&c->textures->rwlock);
+    _bolt_context_quiescent(c);
+    _bolt_rwlock_lock_write(&texture_lock);
     for (unsigned int i = 0; i < n; i += 1) {
-        const unsigned int* ptr = &textures[i];
-        struct GLTexture2D* const* texture = hashmap_delete(c->textures->map, &ptr);
-        free((*texture)->data);
-        free(*texture);
+        _bolt_gl_retire(_bolt_idmap_remove(c->textures, textures[i]), _bolt_free_retired_texture, NULL);
     }
-    _bolt_rwlock_unlock_write(&c->textures->rwlock);
+    _bolt_rwlock_unlock_write(&texture_lock);
+    _bolt_gl_collect_retired();
 }
 
 void _bolt_gl_onClear(uint32_t mask) {
+    CAPTURE(CAPTURE_CLEAR, NULL, 0, mask);
     struct GLContext* c = _bolt_context();
     if (mask & GL_COLOR_BUFFER_BIT) {
-        int draw_tex;
-        gl.GetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &draw_tex);
+        const int draw_tex = _bolt_context_framebuffer_tex(c, GL_DRAW_FRAMEBUFFER);
         struct GLTexture2D* tex = _bolt_context_get_texture(c, draw_tex);
         if (tex) {
             tex->is_minimap_tex_big = 0;
@@ -1445,6 +2210,7 @@ void _bolt_gl_onClear(uint32_t mask) {
 }
 
 void _bolt_gl_onViewport(int x, int y, unsigned int width, unsigned int height) {
+    CAPTURE(CAPTURE_VIEWPORT, NULL, 0, x, y, width, height);
     struct GLContext* c = _bolt_context();
     c->viewport_x = x;
     c->viewport_y = y;
@@ -1454,9 +2220,9 @@ void _bolt_gl_onViewport(int x, int y, unsigned int width, unsigned int height)
 
 static void _bolt_gl_plugin_drawelements_vertex2d_xy(size_t index, void* userdata, int32_t* out) {
     struct GLPluginDrawElementsVertex2DUserData* data = userdata;
-    if (!_bolt_get_attr_binding_int(data->c, data->position, data->indices[index], 2, out)) {
+    if (!_bolt_get_attr_binding_int(data->c, data->position, _bolt_vertex2d_index(data, index), 2, out)) {
         float pos[2];
-        _bolt_get_attr_binding(data->c, data->position, data->indices[index], 2, pos);
+        _bolt_get_attr_binding(data->c, data->position, _bolt_vertex2d_index(data, index), 2, pos);
         out[0] = (int32_t)roundf(pos[0]);
         out[1] = (int32_t)roundf(pos[1]);
     }
@@ -1465,7 +2231,7 @@ static void _bolt_gl_plugin_drawelements_vertex2d_xy(size_t index, void* userdat
 static void _bolt_gl_plugin_drawelements_vertex2d_atlas_xy(size_t index, void* userdata, int32_t* out) {
     struct GLPluginDrawElementsVertex2DUserData* data = userdata;
     float xy[2];
-    _bolt_get_attr_binding(data->c, data->atlas_min, data->indices[index], 2, xy);
+    _bolt_get_attr_binding(data->c, data->atlas_min, _bolt_vertex2d_index(data, index), 2, xy);
     out[0] = (int32_t)roundf(xy[0] * data->atlas->width);
     out[1] = (int32_t)roundf(xy[1] * data->atlas->height);
 }
@@ -1473,7 +2239,7 @@ static void _bolt_gl_plugin_drawelements_vertex2d_atlas_xy(size_t index, void* u
 static void _bolt_gl_plugin_drawelements_vertex2d_atlas_wh(size_t index, void* userdata, int32_t* out) {
     struct GLPluginDrawElementsVertex2DUserData* data = userdata;
     float wh[2];
-    _bolt_get_attr_binding(data->c, data->atlas_size, data->indices[index], 2, wh);
+    _bolt_get_attr_binding(data->c, data->atlas_size, _bolt_vertex2d_index(data, index), 2, wh);
     // these are negative for some reason
     out[0] = -(int32_t)roundf(wh[0] * data->atlas->width);
     out[1] = -(int32_t)roundf(wh[1] * data->atlas->height);
@@ -1482,7 +2248,7 @@ static void _bolt_gl_plugin_drawelements_vertex2d_atlas_wh(size_t index, void* u
 static void _bolt_gl_plugin_drawelements_vertex2d_uv(size_t index, void* userdata, double* out) {
     struct GLPluginDrawElementsVertex2DUserData* data = userdata;
     float uv[2];
-    _bolt_get_attr_binding(data->c, data->tex_uv, data->indices[index], 2, uv);
+    _bolt_get_attr_binding(data->c, data->tex_uv, _bolt_vertex2d_index(data, index), 2, uv);
     out[0] = (double)uv[0];
     out[1] = (double)uv[1];
 }
@@ -1490,7 +2256,7 @@ static void _bolt_gl_plugin_drawelements_vertex2d_uv(size_t index, void* userdat
 static void _bolt_gl_plugin_drawelements_vertex2d_colour(size_t index, void* userdata, double* out) {
     struct GLPluginDrawElementsVertex2DUserData* data = userdata;
     float colour[4];
-    _bolt_get_attr_binding(data->c, data->colour, data->indices[index], 4, colour);
+    _bolt_get_attr_binding(data->c, data->colour, _bolt_vertex2d_index(data, index), 4, colour);
     // these are ABGR for some reason
     out[0] = (double)colour[3];
     out[1] = (double)colour[2];
@@ -1498,11 +2264,58 @@ static void _bolt_gl_plugin_drawelements_vertex2d_colour(size_t index, void* use
     out[3] = (double)colour[0];
 }
 
+// same results as calling each of the functions above for every vertex, but the index buffer and
+// each attribute's buffer are only looked up once, rather than once per vertex per attribute.
+// attributes whose buffers can't be read come out as zeroes.
+static void _bolt_gl_plugin_drawelements_vertex2d_decode(size_t count, void* userdata, struct Vertex2DArrays* out) {
+    struct GLPluginDrawElementsVertex2DUserData* data = userdata;
+    if (!data->indices) data->indices = _bolt_element_indices(data->c, data->element_buffer, data->indices_offset);
+    const unsigned short* indices = data->indices;
+    const uint8_t* position = _bolt_attr_binding_base(data->c, data->position);
+    const uint8_t* atlas_min = _bolt_attr_binding_base(data->c, data->atlas_min);
+    const uint8_t* atlas_size = _bolt_attr_binding_base(data->c, data->atlas_size);
+    const uint8_t* tex_uv = _bolt_attr_binding_base(data->c, data->tex_uv);
+    const uint8_t* colour = _bolt_attr_binding_base(data->c, data->colour);
+    const float atlas_w = (float)data->atlas->width;
+    const float atlas_h = (float)data->atlas->height;
+    for (size_t i = 0; i < count; i += 1) {
+        const size_t index = indices ? indices[i] : 0;
+        float f[4] = {0.0, 0.0, 0.0, 0.0};
+        int32_t* xy = out->xy + (i * 2);
+        if (!position) {
+            xy[0] = xy[1] = 0;
+        } else if (!_bolt_attr_binding_read_int(data->position, position + (data->position->stride * index), 2, xy)) {
+            _bolt_attr_binding_read(data->position, position + (data->position->stride * index), 2, f);
+            xy[0] = (int32_t)roundf(f[0]);
+            xy[1] = (int32_t)roundf(f[1]);
+        }
+        f[0] = f[1] = 0.0;
+        if (atlas_min) _bolt_attr_binding_read(data->atlas_min, atlas_min + (data->atlas_min->stride * index), 2, f);
+        out->atlas_xy[i * 2] = (int32_t)roundf(f[0] * atlas_w);
+        out->atlas_xy[(i * 2) + 1] = (int32_t)roundf(f[1] * atlas_h);
+        f[0] = f[1] = 0.0;
+        if (atlas_size) _bolt_attr_binding_read(data->atlas_size, atlas_size + (data->atlas_size->stride * index), 2, f);
+        out->atlas_wh[i * 2] = -(int32_t)roundf(f[0] * atlas_w);
+        out->atlas_wh[(i * 2) + 1] = -(int32_t)roundf(f[1] * atlas_h);
+        f[0] = f[1] = 0.0;
+        if (tex_uv) _bolt_attr_binding_read(data->tex_uv, tex_uv + (data->tex_uv->stride * index), 2, f);
+        out->uv[i * 2] = (double)f[0];
+        out->uv[(i * 2) + 1] = (double)f[1];
+        f[0] = f[1] = 0.0;
+        if (colour) _bolt_attr_binding_read(data->colour, colour + (data->colour->stride * index), 4, f);
+        // ABGR, see _bolt_gl_plugin_drawelements_vertex2d_colour
+        out->colour[i * 4] = (double)f[3];
+        out->colour[(i * 4) + 1] = (double)f[2];
+        out->colour[(i * 4) + 2] = (double)f[1];
+        out->colour[(i * 4) + 3] = (double)f[0];
+    }
+}
+
 static void _bolt_gl_plugin_drawelements_vertex3d_xyz(size_t index, void* userdata, int32_t* out) {
     struct GLPluginDrawElementsVertex3DUserData* data = userdata;
-    if (!_bolt_get_attr_binding_int(data->c, data->xyz_bone, data->indices[index], 3, out)) {
+    if (!_bolt_get_attr_binding_int(data->c, data->xyz_bone, _bolt_vertex3d_index(data, index), 3, out)) {
         float pos[3];
-        _bolt_get_attr_binding(data->c, data->xyz_bone, data->indices[index], 3, pos);
+        _bolt_get_attr_binding(data->c, data->xyz_bone, _bolt_vertex3d_index(data, index), 3, pos);
         out[0] = (int32_t)roundf(pos[0]);
         out[1] = (int32_t)roundf(pos[1]);
         out[2] = (int32_t)roundf(pos[2]);
@@ -1512,27 +2325,35 @@ static void _bolt_gl_plugin_drawelements_vertex3d_xyz(size_t index, void* userda
 static size_t _bolt_gl_plugin_drawelements_vertex3d_atlas_meta(size_t index, void* userdata) {
     struct GLPluginDrawElementsVertex3DUserData* data = userdata;
     int material_xy[2];
-    _bolt_get_attr_binding_int(data->c, data->xy_xz, data->indices[index], 2, material_xy);
+    _bolt_get_attr_binding_int(data->c, data->xy_xz, _bolt_vertex3d_index(data, index), 2, material_xy);
     return ((size_t)material_xy[1] << 16) | (size_t)material_xy[0];
 }
 
 static void _bolt_gl_plugin_drawelements_vertex3d_meta_xywh(size_t meta, void* userdata, int32_t* out) {
     struct GLPluginDrawElementsVertex3DUserData* data = userdata;
+    struct GLTexture2D* settings_atlas = data->settings_atlas;
     size_t slot_x = meta & 0xFF;
     size_t slot_y = meta >> 16;
     // this is pretty wild
-    const uint8_t* settings_ptr = data->settings_atlas->data + (slot_y * data->settings_atlas->width * 4 * 4) + (slot_x * 3 * 4);
-    const uint8_t bitmask = *(settings_ptr + (data->settings_atlas->width * 2 * 4) + 7);
+    const uint8_t locked_write = _bolt_texture_lock_region(settings_atlas, slot_x * 3, slot_y * 4, 3, 3);
+    if (!settings_atlas->data) {
+        _bolt_texture_unlock(locked_write);
+        memset(out, 0, 4 * sizeof(*out));
+        return;
+    }
+    const uint8_t* settings_ptr = settings_atlas->data + (slot_y * settings_atlas->width * 4 * 4) + (slot_x * 3 * 4);
+    const uint8_t bitmask = *(settings_ptr + (settings_atlas->width * 2 * 4) + 7);
     out[0] = ((int32_t)(*settings_ptr) + (bitmask & 1 ? 256 : 0)) * data->atlas_scale;
     out[1] = ((int32_t)*(settings_ptr + 1) + (bitmask & 2 ? 256 : 0)) * data->atlas_scale;
     out[2] = (int32_t)*(settings_ptr + 8) * data->atlas_scale;
     out[3] = out[2];
+    _bolt_texture_unlock(locked_write);
 }
 
 static void _bolt_gl_plugin_drawelements_vertex3d_uv(size_t index, void* userdata, double* out) {
     struct GLPluginDrawElementsVertex3DUserData* data = userdata;
     float uv[2];
-    _bolt_get_attr_binding(data->c, data->tex_uv, data->indices[index], 2, uv);
+    _bolt_get_attr_binding(data->c, data->tex_uv, _bolt_vertex3d_index(data, index), 2, uv);
     out[0] = (double)uv[0];
     out[1] = (double)uv[1];
 }
@@ -1540,7 +2361,7 @@ static void _bolt_gl_plugin_drawelements_vertex3d_uv(size_t index, void* userdat
 static void _bolt_gl_plugin_drawelements_vertex3d_colour(size_t index, void* userdata, double* out) {
     struct GLPluginDrawElementsVertex3DUserData* data = userdata;
     float colour[4];
-    _bolt_get_attr_binding(data->c, data->colour, data->indices[index], 4, colour);
+    _bolt_get_attr_binding(data->c, data->colour, _bolt_vertex3d_index(data, index), 4, colour);
     // these are ABGR for some reason
     out[0] = (double)colour[3];
     out[1] = (double)colour[2];
@@ -1548,6 +2369,15 @@ static void _bolt_gl_plugin_drawelements_vertex3d_colour(size_t index, void* use
     out[3] = (double)colour[0];
 }
 
+static void _bolt_gl_plugin_drawelements_vertex3d_decode(size_t count, void* userdata, struct Vertex3DArrays* out) {
+    for (size_t i = 0; i < count; i += 1) {
+        _bolt_gl_plugin_drawelements_vertex3d_xyz(i, userdata, out->xyz + (i * 3));
+        out->atlas_meta[i] = (uint32_t)_bolt_gl_plugin_drawelements_vertex3d_atlas_meta(i, userdata);
+        _bolt_gl_plugin_drawelements_vertex3d_uv(i, userdata, out->uv + (i * 2));
+        _bolt_gl_plugin_drawelements_vertex3d_colour(i, userdata, out->colour + (i * 4));
+    }
+}
+
 static void _bolt_gl_plugin_matrix3d_toworldspace(int x, int y, int z, void* userdata, double* out) {
     const struct GLPlugin3DMatrixUserData* data = userdata;
     const double dx = (double)x;
@@ -1564,7 +2394,6 @@ static void _bolt_gl_plugin_matrix3d_toworldspace(int x, int y, int z, void* use
 }
 
 static void _bolt_gl_plugin_matrix3d_toscreenspace(int x, int y, int z, void* userdata, double* out) {
-    const struct GLContext* c = _bolt_context();
     struct GLPlugin3DMatrixUserData* data = userdata;
     const double dx = (double)x;
     const double dy = (double)y;
@@ -1578,8 +2407,8 @@ static void _bolt_gl_plugin_matrix3d_toscreenspace(int x, int y, int z, void* us
     const double outx = (mx * (double)vpmx[0]) + (my * (double)vpmx[4]) + (mz * (double)vpmx[8]) + (mh * (double)vpmx[12]);
     const double outy = (mx * (double)vpmx[1]) + (my * (double)vpmx[5]) + (mz * (double)vpmx[9]) + (mh * (double)vpmx[13]);
     const double homogenous = (mx * (double)vpmx[3]) + (my * (double)vpmx[7]) + (mz * (double)vpmx[11]) + (mh * (double)vpmx[15]);
-    out[0] = (((outx  / homogenous) + 1.0) * c->game_view_w / 2.0) + (double)c->game_view_x;
-    out[1] = (((-outy / homogenous) + 1.0) * c->game_view_h / 2.0) + (double)c->game_view_y;
+    out[0] = (((outx  / homogenous) + 1.0) * data->game_view_w / 2.0) + (double)data->game_view_x;
+    out[1] = (((-outy / homogenous) + 1.0) * data->game_view_h / 2.0) + (double)data->game_view_y;
 }
 
 static void _bolt_gl_plugin_matrix3d_worldpos(void* userdata, double* out) {
@@ -1603,7 +2432,7 @@ static void _bolt_gl_plugin_texture_size(void* userdata, size_t* out) {
 
 static uint8_t _bolt_gl_plugin_texture_compare(void* userdata, size_t x, size_t y, size_t len, const unsigned char* data) {
     const struct GLPluginTextureUserData* data_ = userdata;
-    const struct GLTexture2D* tex = data_->tex;
+    struct GLTexture2D* tex = data_->tex;
     const size_t start_offset = (tex->width * y * 4) + (x * 4);
     if (start_offset + len > tex->width * tex->height * 4) {
         printf(
@@ -1612,13 +2441,475 @@ static uint8_t _bolt_gl_plugin_texture_compare(void* userdata, size_t x, size_t
         );
         return 0;
     }
-    return !memcmp(tex->data + start_offset, data, len);
+    const uint8_t locked_write = _bolt_texture_lock_span(tex, x, y, len);
+    const uint8_t ret = tex->data && !memcmp(tex->data + start_offset, data, len);
+    _bolt_texture_unlock(locked_write);
+    return ret;
 }
 
-static uint8_t* _bolt_gl_plugin_texture_data(void* userdata, size_t x, size_t y) {
+static uint8_t* _bolt_gl_plugin_texture_data(void* userdata, size_t x, size_t y, size_t len) {
     const struct GLPluginTextureUserData* data = userdata;
-    const struct GLTexture2D* tex = data->tex;
-    return tex->data + (tex->width * y * 4) + (x * 4);
+    struct GLTexture2D* tex = data->tex;
+    _bolt_texture_unlock(_bolt_texture_lock_span(tex, x, y, len));
+    return tex->data ? tex->data + (tex->width * y * 4) + (x * 4) : NULL;
+}
+
+static uint8_t _bolt_gl_plugin_texture_compare_by_id(size_t id, size_t x, size_t y, size_t len, const unsigned char* data) {
+    struct GLContext* c = _bolt_context_find((void*)egl_main_context);
+    if (!c) return 0;
+    uint8_t locked_write;
+    struct GLTexture2D* tex = _bolt_texture_lock_span_by_id(c, id, x, y, len, &locked_write);
+    const uint8_t ret = tex && tex->data && !memcmp(tex->data + (tex->width * y * 4) + (x * 4), data, len);
+    _bolt_texture_unlock(locked_write);
+    return ret;
+}
+
+static uint8_t _bolt_gl_plugin_texture_read_by_id(size_t id, size_t x, size_t y, size_t len, uint8_t* out) {
+    struct GLContext* c = _bolt_context_find((void*)egl_main_context);
+    if (!c) {
+        memset(out, 0, len);
+        return 0;
+    }
+    uint8_t locked_write;
+    struct GLTexture2D* tex = _bolt_texture_lock_span_by_id(c, id, x, y, len, &locked_write);
+    uint8_t ret = 0;
+    if (tex && tex->data) {
+        memcpy(out, tex->data + (tex->width * y * 4) + (x * 4), len);
+        ret = 1;
+    } else {
+        memset(out, 0, len);
+    }
+    _bolt_texture_unlock(locked_write);
+    return ret;
+}
+
+// removes any free rectangles that share a whole edge with `rect` from an atlas's free list, and
+// returns `rect` grown to cover them, so that freed space doesn't stay split up into small pieces
+static struct AtlasRect _bolt_atlas_free_rect_merge(struct SurfaceAtlas* atlas, struct AtlasRect rect) {
+    size_t i = 0;
+    while (i < atlas->free_rect_count) {
+        const struct AtlasRect r = atlas->free_rects[i];
+        if (r.x == rect.x && r.width == rect.width && (r.y + r.height == rect.y || rect.y + rect.height == r.y)) {
+            rect.y = (r.y < rect.y) ? r.y : rect.y;
+            rect.height += r.height;
+        } else if (r.y == rect.y && r.height == rect.height && (r.x + r.width == rect.x || rect.x + rect.width == r.x)) {
+            rect.x = (r.x < rect.x) ? r.x : rect.x;
+            rect.width += r.width;
+        } else {
+            i += 1;
+            continue;
+        }
+        atlas->free_rect_count -= 1;
+        atlas->free_rects[i] = atlas->free_rects[atlas->free_rect_count];
+        // the bigger rectangle might line up with ones that didn't before
+        i = 0;
+    }
+    return rect;
+}
+
+// adds a rectangle to an atlas's free list, merged with its neighbours. if the list is full, the
+// smallest rectangle is dropped, which could be the new one; its space can't be used again until
+// the atlas is emptied.
+static void _bolt_atlas_free_rect_add(struct SurfaceAtlas* atlas, struct AtlasRect rect) {
+    if (!rect.width || !rect.height) return;
+    rect = _bolt_atlas_free_rect_merge(atlas, rect);
+    if (atlas->free_rect_count < ATLAS_MAX_FREE_RECTS) {
+        atlas->free_rects[atlas->free_rect_count] = rect;
+        atlas->free_rect_count += 1;
+        return;
+    }
+    size_t smallest = 0;
+    for (size_t i = 1; i < ATLAS_MAX_FREE_RECTS; i += 1) {
+        const struct AtlasRect* r = &atlas->free_rects[i];
+        const struct AtlasRect* s = &atlas->free_rects[smallest];
+        if ((size_t)r->width * r->height < (size_t)s->width * s->height) smallest = i;
+    }
+    const struct AtlasRect* s = &atlas->free_rects[smallest];
+    if ((size_t)rect.width * rect.height > (size_t)s->width * s->height) atlas->free_rects[smallest] = rect;
+}
+
+static void _bolt_atlas_free_rect_remove(struct SurfaceAtlas* atlas, size_t index) {
+    atlas->free_rect_count -= 1;
+    atlas->free_rects[index] = atlas->free_rects[atlas->free_rect_count];
+}
+
+// returns 1 if nothing has been allocated above `rect`, i.e. the skyline is at its top edge
+static uint8_t _bolt_atlas_rect_on_skyline(const struct SurfaceAtlas* atlas, const struct AtlasRect* rect) {
+    for (size_t i = rect->x; i < (size_t)rect->x + rect->width; i += 1) {
+        if (atlas->skyline[i] != rect->y + rect->height) return 0;
+    }
+    return 1;
+}
+
+// gives a freed rectangle back to the atlas: to the skyline if nothing is above it, along with any
+// free rectangles that end up with nothing above them as a result, or otherwise to the free list.
+static void _bolt_atlas_release_rect(struct SurfaceAtlas* atlas, struct AtlasRect rect) {
+    rect = _bolt_atlas_free_rect_merge(atlas, rect);
+    if (!_bolt_atlas_rect_on_skyline(atlas, &rect)) {
+        _bolt_atlas_free_rect_add(atlas, rect);
+        return;
+    }
+    uint8_t lowered = 1;
+    while (lowered) {
+        for (size_t i = rect.x; i < (size_t)rect.x + rect.width; i += 1) atlas->skyline[i] = rect.y;
+        lowered = 0;
+        for (size_t i = 0; i < atlas->free_rect_count; i += 1) {
+            if (_bolt_atlas_rect_on_skyline(atlas, &atlas->free_rects[i])) {
+                rect = atlas->free_rects[i];
+                _bolt_atlas_free_rect_remove(atlas, i);
+                lowered = 1;
+                break;
+            }
+        }
+    }
+}
+
+// looks for space for a `width` by `height` rectangle in an atlas, preferring the free rectangle
+// that fits it with the least area left over, then the lowest point on the skyline. returns 0 if
+// there's no room, otherwise allocates the space and puts its position in `x` and `y`.
+static uint8_t _bolt_atlas_alloc(struct SurfaceAtlas* atlas, unsigned int width, unsigned int height, unsigned int* x, unsigned int* y) {
+    size_t best_rect = atlas->free_rect_count;
+    size_t best_area = SIZE_MAX;
+    for (size_t i = 0; i < atlas->free_rect_count; i += 1) {
+        const struct AtlasRect* r = &atlas->free_rects[i];
+        const size_t area = (size_t)r->width * r->height;
+        if (r->width >= width && r->height >= height && area < best_area) {
+            best_rect = i;
+            best_area = area;
+        }
+    }
+    if (best_rect < atlas->free_rect_count) {
+        // guillotine split: the leftover space to the right of the new surface and below it
+        const struct AtlasRect r = atlas->free_rects[best_rect];
+        _bolt_atlas_free_rect_remove(atlas, best_rect);
+        _bolt_atlas_free_rect_add(atlas, (struct AtlasRect){.x = r.x + width, .y = r.y, .width = r.width - width, .height = height});
+        _bolt_atlas_free_rect_add(atlas, (struct AtlasRect){.x = r.x, .y = r.y + height, .width = r.width, .height = r.height - height});
+        *x = r.x;
+        *y = r.y;
+        return 1;
+    }
+
+    size_t best_x = 0;
+    size_t best_y = ATLAS_SIZE;
+    // skyline bottom-left: try each place where the skyline changes height, and take the lowest
+    for (size_t sx = 0; sx + width <= ATLAS_SIZE; sx += 1) {
+        if (sx > 0 && atlas->skyline[sx] == atlas->skyline[sx - 1]) continue;
+        size_t sy = 0;
+        for (size_t i = sx; i < sx + width; i += 1) {
+            if (atlas->skyline[i] > sy) sy = atlas->skyline[i];
+        }
+        if (sy + height <= ATLAS_SIZE && sy < best_y) {
+            best_x = sx;
+            best_y = sy;
+        }
+    }
+    if (best_y == ATLAS_SIZE) return 0;
+    for (size_t i = best_x; i < best_x + width; i += 1) {
+        // the gap between the skyline and the new surface's bottom edge can't be reached by the
+        // skyline again, so it goes in the free list, one column-run at a time
+        if (atlas->skyline[i] < best_y) {
+            size_t end = i + 1;
+            while (end < best_x + width && atlas->skyline[end] == atlas->skyline[i]) end += 1;
+            _bolt_atlas_free_rect_add(atlas, (struct AtlasRect){.x = i, .y = atlas->skyline[i], .width = end - i, .height = best_y - atlas->skyline[i]});
+            for (size_t j = i; j < end; j += 1) atlas->skyline[j] = best_y + height;
+            i = end - 1;
+        } else {
+            atlas->skyline[i] = best_y + height;
+        }
+    }
+    *x = best_x;
+    *y = best_y;
+    return 1;
+}
+
+// finds space for a surface in an atlas, creating a new atlas if none of them have room, and sets
+// the surface's atlas, x, y and renderbuffer. binds GL_TEXTURE_2D to the atlas texture. returns 0,
+// having changed nothing, if a new atlas was needed but couldn't be allocated.
+static uint8_t _bolt_gl_surface_enter_atlas(struct PluginSurfaceUserdata* userdata) {
+    struct SurfaceAtlas* atlas = atlases;
+    unsigned int x = 0;
+    unsigned int y = 0;
+    while (atlas && !_bolt_atlas_alloc(atlas, userdata->width, userdata->height, &x, &y)) atlas = atlas->next;
+    if (!atlas) {
+        atlas = calloc(1, sizeof(struct SurfaceAtlas));
+        if (!atlas) return 0;
+        lgl->GenTextures(1, &atlas->texture);
+        lgl->BindTexture(GL_TEXTURE_2D, atlas->texture);
+        gl.TexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE);
+        lgl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        lgl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        lgl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        lgl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        atlas->next = atlases;
+        atlases = atlas;
+        _bolt_atlas_alloc(atlas, userdata->width, userdata->height, &x, &y);
+    } else {
+        lgl->BindTexture(GL_TEXTURE_2D, atlas->texture);
+    }
+    atlas->surface_count += 1;
+    userdata->atlas = atlas;
+    userdata->x = x;
+    userdata->y = y;
+    userdata->framebuffer = 0;
+    userdata->renderbuffer = atlas->texture;
+    return 1;
+}
+
+// releases a surface's space in its atlas, and deletes the atlas if it's now empty, unless it's the
+// only one, in which case it's kept for the next surface to use. doesn't touch any GL bindings.
+static void _bolt_gl_surface_release_atlas(struct PluginSurfaceUserdata* userdata) {
+    struct SurfaceAtlas* atlas = userdata->atlas;
+    const struct AtlasRect rect = {.x = userdata->x, .y = userdata->y, .width = userdata->width, .height = userdata->height};
+    userdata->atlas = NULL;
+    userdata->x = 0;
+    userdata->y = 0;
+    atlas->surface_count -= 1;
+    if (atlas->surface_count) {
+        _bolt_atlas_release_rect(atlas, rect);
+        return;
+    }
+    if (atlas == atlases && !atlas->next) {
+        memset(atlas->skyline, 0, sizeof(atlas->skyline));
+        atlas->free_rect_count = 0;
+        return;
+    }
+    struct SurfaceAtlas** prev = &atlases;
+    while (*prev != atlas) prev = &(*prev)->next;
+    *prev = atlas->next;
+    lgl->DeleteTextures(1, &atlas->texture);
+    free(atlas);
+}
+
+// moves a surface out of its atlas into its own texture and framebuffer, so that it can be drawn to,
+// optionally copying its contents. flushes any pending sprites first, since they may refer to the
+// surface's old position. leaves the GL state as it was.
+static void _bolt_gl_surface_leave_atlas(struct PluginSurfaceUserdata* userdata, uint8_t copy) {
+    struct GLContext* c = _bolt_context();
+    _bolt_gl_sprite_flush();
+    const unsigned int atlas_texture = userdata->renderbuffer;
+    const unsigned int x = userdata->x;
+    const unsigned int y = userdata->y;
+    _bolt_gl_surface_release_atlas(userdata);
+    _bolt_gl_surface_init_buffers(userdata);
+    if (copy) {
+        gl.CopyImageSubData(atlas_texture, GL_TEXTURE_2D, 0, x, y, 0, userdata->renderbuffer, GL_TEXTURE_2D, 0, 0, 0, 0, userdata->width, userdata->height, 1);
+    }
+    const struct GLTexture2D* original_tex = c->texture_units[c->active_texture];
+    lgl->BindTexture(GL_TEXTURE_2D, original_tex ? original_tex->id : 0);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, c->current_draw_framebuffer);
+}
+
+static void _bolt_gl_sprite_add(struct PluginSurfaceUserdata* source, struct PluginSurfaceUserdata* target, unsigned int target_width, unsigned int target_height, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh) {
+    if (target && target->atlas) _bolt_gl_surface_leave_atlas(target, 1);
+    if (sprite_quad_count == sprite_quad_capacity) {
+        // if there isn't memory to queue any more quads, draw the ones already queued to make room
+        // for this one, or drop it if there aren't any
+        const size_t capacity = sprite_quad_capacity ? sprite_quad_capacity * 2 : 64;
+        struct SpriteQuad* quads = realloc(sprite_quads, capacity * sizeof(*sprite_quads));
+        if (quads) sprite_quads = quads;
+        float* vertices = quads ? realloc(sprite_vertices, capacity * sizeof(sprite_quads->vertices)) : NULL;
+        if (vertices) {
+            sprite_vertices = vertices;
+            sprite_quad_capacity = capacity;
+        } else if (sprite_quad_count) {
+            _bolt_gl_sprite_flush();
+        } else {
+            return;
+        }
+    }
+
+    // look backwards for a batch this blit can be added to. it can only be moved ahead of a later
+    // batch if that can't change the result, i.e. the later batch doesn't draw to the same target
+    // (which would change the blending order), draw to our source, or read from our target.
+    size_t batch_index = sprite_batch_count;
+    for (size_t i = sprite_batch_count; i > 0; i -= 1) {
+        const struct SpriteBatch* batch = &sprite_batches[i - 1];
+        if (batch->source_texture == source->renderbuffer && batch->target == target && batch->target_width == target_width && batch->target_height == target_height) {
+            batch_index = i - 1;
+            break;
+        }
+        if (batch->target == target) break;
+        if (batch->target && batch->target->renderbuffer == source->renderbuffer) break;
+        if (target && batch->source_texture == target->renderbuffer) break;
+    }
+    if (batch_index == sprite_batch_count) {
+        if (sprite_batch_count == SPRITE_MAX_BATCHES) _bolt_gl_sprite_flush();
+        batch_index = sprite_batch_count;
+        sprite_batches[batch_index] = (struct SpriteBatch){
+            .source_texture = source->renderbuffer, .target = target, .target_width = target_width, .target_height = target_height, .quad_count = 0,
+        };
+        sprite_batch_count += 1;
+    }
+    float x0 = ((float)dx * 2.0f / target_width) - 1.0f;
+    float x1 = ((float)(dx + dw) * 2.0f / target_width) - 1.0f;
+    float y0 = ((float)dy * 2.0f / target_height) - 1.0f;
+    float y1 = ((float)(dy + dh) * 2.0f / target_height) - 1.0f;
+    if (!target) {
+        // the screen's origin is at the bottom-left, whereas surfaces are drawn to with it at the top-left
+        y0 = -y0;
+        y1 = -y1;
+    }
+    const float texture_width = source->atlas ? ATLAS_SIZE : source->width;
+    const float texture_height = source->atlas ? ATLAS_SIZE : source->height;
+    const float u0 = (float)(source->x + sx) / texture_width;
+    const float u1 = (float)(source->x + sx + sw) / texture_width;
+    const float v0 = (float)(source->y + sy) / texture_height;
+    const float v1 = (float)(source->y + sy + sh) / texture_height;
+    // bounds are the centres of the surface's edge pixels
+    const float bu0 = ((float)source->x + 0.5f) / texture_width;
+    const float bu1 = ((float)(source->x + source->width) - 0.5f) / texture_width;
+    const float bv0 = ((float)source->y + 0.5f) / texture_height;
+    const float bv1 = ((float)(source->y + source->height) - 0.5f) / texture_height;
+    // same vertex order as a triangle strip of the four corners, so that the winding is the same
+    const float vertices[SPRITE_QUAD_FLOATS] = {
+        x0, y0, u0, v0, bu0, bv0, bu1, bv1,  x1, y0, u1, v0, bu0, bv0, bu1, bv1,  x0, y1, u0, v1, bu0, bv0, bu1, bv1,
+        x0, y1, u0, v1, bu0, bv0, bu1, bv1,  x1, y0, u1, v0, bu0, bv0, bu1, bv1,  x1, y1, u1, v1, bu0, bv0, bu1, bv1,
+    };
+    struct SpriteQuad* quad = &sprite_quads[sprite_quad_count];
+    quad->batch = batch_index;
+    memcpy(quad->vertices, vertices, sizeof(vertices));
+    sprite_batches[batch_index].quad_count += 1;
+    sprite_quad_count += 1;
+}
+
+// creates buffer_sprite_vertices and points the sprite VAO's attributes at it. if persistent mapping is
+// available, the buffer is a persistently-mapped ring of `ring_size` bytes, which must be a multiple of
+// SPRITE_RING_SECTIONS * SPRITE_VERTEX_SIZE. binds the sprite VAO and GL_ARRAY_BUFFER.
+static void _bolt_gl_sprite_buffer_create(size_t ring_size) {
+    gl.BindVertexArray(program_sprite_vao);
+    gl.GenBuffers(1, &buffer_sprite_vertices);
+    gl.BindBuffer(GL_ARRAY_BUFFER, buffer_sprite_vertices);
+    if (gl.BufferStorage && gl.FenceSync && gl.ClientWaitSync && gl.DeleteSync) {
+        const uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl.BufferStorage(GL_ARRAY_BUFFER, ring_size, NULL, flags);
+        sprite_ring = gl.MapBufferRange(GL_ARRAY_BUFFER, 0, ring_size, flags);
+        if (sprite_ring) {
+            sprite_ring_size = ring_size;
+            sprite_ring_offset = 0;
+            sprite_ring_section = 0;
+        } else {
+            // immutable storage can't be re-specified with glBufferData, so start again with a new buffer
+            gl.DeleteBuffers(1, &buffer_sprite_vertices);
+            gl.GenBuffers(1, &buffer_sprite_vertices);
+            gl.BindBuffer(GL_ARRAY_BUFFER, buffer_sprite_vertices);
+        }
+    }
+    gl.EnableVertexAttribArray(0);
+    gl.VertexAttribPointer(0, 2, GL_FLOAT, 0, SPRITE_VERTEX_SIZE, NULL);
+    gl.EnableVertexAttribArray(1);
+    gl.VertexAttribPointer(1, 2, GL_FLOAT, 0, SPRITE_VERTEX_SIZE, (const void*)(2 * sizeof(float)));
+    gl.EnableVertexAttribArray(2);
+    gl.VertexAttribPointer(2, 4, GL_FLOAT, 0, SPRITE_VERTEX_SIZE, (const void*)(4 * sizeof(float)));
+}
+
+// deleting the buffer also unmaps it, and GL keeps it alive until any draws using it have finished
+static void _bolt_gl_sprite_buffer_destroy() {
+    for (size_t i = 0; i < SPRITE_RING_SECTIONS; i += 1) {
+        if (sprite_ring_fences[i]) gl.DeleteSync(sprite_ring_fences[i]);
+        sprite_ring_fences[i] = NULL;
+    }
+    gl.DeleteBuffers(1, &buffer_sprite_vertices);
+    sprite_ring = NULL;
+    sprite_ring_size = 0;
+}
+
+// reserves `size` bytes in the ring, waiting for the GPU to finish with any sections it overlaps
+// that were last used on the previous trip around the ring. returns the offset of the reserved space.
+static size_t _bolt_gl_sprite_ring_reserve(size_t size) {
+    const size_t section_size = sprite_ring_size / SPRITE_RING_SECTIONS;
+    size_t start = ((sprite_ring_offset + SPRITE_VERTEX_SIZE - 1) / SPRITE_VERTEX_SIZE) * SPRITE_VERTEX_SIZE;
+    uint8_t wrapped = 0;
+    if (start + size > sprite_ring_size) {
+        start = 0;
+        wrapped = 1;
+    }
+    const size_t first = start / section_size;
+    const size_t last = (start + size - 1) / section_size;
+    for (size_t i = first; i <= last; i += 1) {
+        // the current section was already waited on when we first moved into it
+        if (i == sprite_ring_section && !wrapped) continue;
+        if (sprite_ring_fences[i]) {
+            gl.ClientWaitSync(sprite_ring_fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, SPRITE_RING_WAIT_TIMEOUT);
+            gl.DeleteSync(sprite_ring_fences[i]);
+            sprite_ring_fences[i] = NULL;
+        }
+    }
+    sprite_ring_offset = start + size;
+    sprite_ring_section = last;
+    return start;
+}
+
+// fences every section overlapped by a range of the ring, after the draws that read from it
+static void _bolt_gl_sprite_ring_fence(size_t start, size_t size) {
+    const size_t section_size = sprite_ring_size / SPRITE_RING_SECTIONS;
+    for (size_t i = start / section_size; i <= (start + size - 1) / section_size; i += 1) {
+        if (sprite_ring_fences[i]) gl.DeleteSync(sprite_ring_fences[i]);
+        sprite_ring_fences[i] = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+static void _bolt_gl_sprite_flush() {
+    if (!sprite_quad_count) return;
+    const uint64_t trace_start = _bolt_trace_begin();
+    struct GLContext* c = _bolt_context();
+
+    const size_t bytes = sprite_quad_count * sizeof(sprite_quads->vertices);
+    if (sprite_ring && bytes > sprite_ring_size) {
+        size_t ring_size = sprite_ring_size;
+        while (ring_size < bytes) ring_size *= 2;
+        _bolt_gl_sprite_buffer_destroy();
+        _bolt_gl_sprite_buffer_create(ring_size);
+    }
+    float* vertices = sprite_vertices;
+    size_t ring_start = 0;
+    if (sprite_ring) {
+        ring_start = _bolt_gl_sprite_ring_reserve(bytes);
+        vertices = (float*)(sprite_ring + ring_start);
+    }
+
+    // sort the quads by batch, keeping them in the order they were added within each batch
+    size_t offset = 0;
+    for (size_t i = 0; i < sprite_batch_count; i += 1) {
+        sprite_batches[i].first_quad = offset;
+        offset += sprite_batches[i].quad_count;
+        sprite_batches[i].quad_count = 0;
+    }
+    for (size_t i = 0; i < sprite_quad_count; i += 1) {
+        struct SpriteBatch* batch = &sprite_batches[sprite_quads[i].batch];
+        memcpy(vertices + ((batch->first_quad + batch->quad_count) * SPRITE_QUAD_FLOATS), sprite_quads[i].vertices, sizeof(sprite_quads[i].vertices));
+        batch->quad_count += 1;
+    }
+
+    gl.UseProgram(program_sprite);
+    gl.BindVertexArray(program_sprite_vao);
+    gl.BindBuffer(GL_ARRAY_BUFFER, buffer_sprite_vertices);
+    if (!sprite_ring) gl.BufferData(GL_ARRAY_BUFFER, bytes, sprite_vertices, GL_STREAM_DRAW);
+    const size_t first_vertex = ring_start / SPRITE_VERTEX_SIZE;
+    gl.Uniform1i(program_sprite_sampler, c->active_texture);
+    for (size_t i = 0; i < sprite_batch_count; i += 1) {
+        const struct SpriteBatch* batch = &sprite_batches[i];
+        const struct SpriteBatch* previous = i ? &sprite_batches[i - 1] : NULL;
+        lgl->BindTexture(GL_TEXTURE_2D, batch->source_texture);
+        if (!previous || previous->target != batch->target) {
+            gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, batch->target ? batch->target->framebuffer : 0);
+        }
+        if (!previous || previous->target_width != batch->target_width || previous->target_height != batch->target_height) {
+            lgl->Viewport(0, 0, batch->target_width, batch->target_height);
+        }
+        lgl->DrawArrays(GL_TRIANGLES, first_vertex + (batch->first_quad * 6), batch->quad_count * 6);
+    }
+    if (sprite_ring) _bolt_gl_sprite_ring_fence(ring_start, bytes);
+    sprite_batch_count = 0;
+    sprite_quad_count = 0;
+
+    lgl->Viewport(c->viewport_x, c->viewport_y, c->viewport_w, c->viewport_h);
+    const struct GLTexture2D* original_tex = c->texture_units[c->active_texture];
+    lgl->BindTexture(GL_TEXTURE_2D, original_tex ? original_tex->id : 0);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, c->current_draw_framebuffer);
+    gl.BindBuffer(GL_ARRAY_BUFFER, c->array_binding);
+    gl.BindVertexArray(c->bound_vao->id);
+    gl.UseProgram(c->bound_program ? c->bound_program->id : 0);
+    _bolt_trace_end("sprite flush", trace_start);
 }
 
 static void _bolt_gl_plugin_surface_init(struct SurfaceFunctions* functions, unsigned int width, unsigned int height, const void* data) {
@@ -1626,10 +2917,16 @@ static void _bolt_gl_plugin_surface_init(struct SurfaceFunctions* functions, uns
     struct GLContext* c = _bolt_context();
     userdata->width = width;
     userdata->height = height;
-    _bolt_gl_surface_init_buffers(userdata);
-    if (data) {
+    userdata->atlas = NULL;
+    userdata->x = 0;
+    userdata->y = 0;
+    if (data && width > 0 && height > 0 && width <= ATLAS_MAX_SURFACE_SIZE && height <= ATLAS_MAX_SURFACE_SIZE && _bolt_gl_surface_enter_atlas(userdata)) {
+        lgl->TexSubImage2D(GL_TEXTURE_2D, 0, userdata->x, userdata->y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    } else if (data) {
+        _bolt_gl_surface_init_buffers(userdata);
         lgl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
     } else {
+        _bolt_gl_surface_init_buffers(userdata);
         lgl->ClearColor(0.0, 0.0, 0.0, 0.0);
         lgl->Clear(GL_COLOR_BUFFER_BIT);
     }
@@ -1645,13 +2942,23 @@ static void _bolt_gl_plugin_surface_init(struct SurfaceFunctions* functions, uns
 
 static void _bolt_gl_plugin_surface_destroy(void* _userdata) {
     struct PluginSurfaceUserdata* userdata = _userdata;
-    _bolt_gl_surface_destroy_buffers(userdata);
+    _bolt_gl_sprite_flush();
+    if (userdata->atlas) {
+        _bolt_gl_surface_release_atlas(userdata);
+    } else {
+        _bolt_gl_surface_destroy_buffers(userdata);
+    }
     free(userdata);
 }
 
 static void _bolt_gl_plugin_surface_resize(void* _userdata, unsigned int width, unsigned int height) {
     struct PluginSurfaceUserdata* userdata = _userdata;
-    _bolt_gl_surface_destroy_buffers(userdata);
+    _bolt_gl_sprite_flush();
+    if (userdata->atlas) {
+        _bolt_gl_surface_release_atlas(userdata);
+    } else {
+        _bolt_gl_surface_destroy_buffers(userdata);
+    }
     userdata->width = width;
     userdata->height = height;
     _bolt_gl_surface_init_buffers(userdata);
@@ -1662,6 +2969,8 @@ static void _bolt_gl_plugin_surface_resize(void* _userdata, unsigned int width,
 static void _bolt_gl_plugin_surface_clear(void* _userdata, double r, double g, double b, double a) {
     struct PluginSurfaceUserdata* userdata = _userdata;
     struct GLContext* c = _bolt_context();
+    if (userdata->atlas) _bolt_gl_surface_leave_atlas(userdata, 0);
+    _bolt_gl_sprite_flush();
     gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, userdata->framebuffer);
     lgl->ClearColor(r, g, b, a);
     lgl->Clear(GL_COLOR_BUFFER_BIT);
@@ -1669,48 +2978,10 @@ static void _bolt_gl_plugin_surface_clear(void* _userdata, double r, double g, d
 }
 
 static void _bolt_gl_plugin_surface_drawtoscreen(void* _userdata, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh) {
-    struct PluginSurfaceUserdata* userdata = _userdata;
-    struct GLContext* c = _bolt_context();
-
-    gl.UseProgram(program_direct_screen);
-    lgl->BindTexture(GL_TEXTURE_2D, userdata->renderbuffer);
-    gl.BindVertexArray(program_direct_vao);
-    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    gl.Uniform1i(program_direct_screen_sampler, c->active_texture);
-    gl.Uniform4i(program_direct_screen_d_xywh, dx, dy, dw, dh);
-    gl.Uniform4i(program_direct_screen_s_xywh, sx, sy, sw, sh);
-    gl.Uniform4i(program_direct_screen_src_wh_dest_wh, userdata->width, userdata->height, gl_width, gl_height);
-    lgl->Viewport(0, 0, gl_width, gl_height);
-    lgl->DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-    lgl->Viewport(c->viewport_x, c->viewport_y, c->viewport_w, c->viewport_h);
-    const struct GLTexture2D* original_tex = c->texture_units[c->active_texture];
-    lgl->BindTexture(GL_TEXTURE_2D, original_tex ? original_tex->id : 0);
-    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, c->current_draw_framebuffer);
-    gl.BindVertexArray(c->bound_vao->id);
-    gl.UseProgram(c->bound_program ? c->bound_program->id : 0);
+    _bolt_gl_sprite_add(_userdata, NULL, gl_width, gl_height, sx, sy, sw, sh, dx, dy, dw, dh);
 }
 
 static void _bolt_gl_plugin_surface_drawtosurface(void* _userdata, void* _target, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh) {
-    struct PluginSurfaceUserdata* userdata = _userdata;
     struct PluginSurfaceUserdata* target = _target;
-    struct GLContext* c = _bolt_context();
-
-    gl.UseProgram(program_direct_surface);
-    lgl->BindTexture(GL_TEXTURE_2D, userdata->renderbuffer);
-    gl.BindVertexArray(program_direct_vao);
-    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, target->framebuffer);
-    gl.Uniform1i(program_direct_surface_sampler, c->active_texture);
-    gl.Uniform4i(program_direct_surface_d_xywh, dx, dy, dw, dh);
-    gl.Uniform4i(program_direct_surface_s_xywh, sx, sy, sw, sh);
-    gl.Uniform4i(program_direct_surface_src_wh_dest_wh, userdata->width, userdata->height, target->width, target->height);
-    lgl->Viewport(0, 0, target->width, target->height);
-    lgl->DrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-    lgl->Viewport(c->viewport_x, c->viewport_y, c->viewport_w, c->viewport_h);
-    const struct GLTexture2D* original_tex = c->texture_units[c->active_texture];
-    lgl->BindTexture(GL_TEXTURE_2D, original_tex ? original_tex->id : 0);
-    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, c->current_draw_framebuffer);
-    gl.BindVertexArray(c->bound_vao->id);
-    gl.UseProgram(c->bound_program ? c->bound_program->id : 0);
+    _bolt_gl_sprite_add(_userdata, target, target->width, target->height, sx, sy, sw, sh, dx, dy, dw, dh);
 }
@@ -5,6 +5,8 @@
 
 #include "../../modules/hashmap/hashmap.h"
 #include "rwlock/rwlock.h"
+#include "mempool/mempool.h"
+#include "idmap/idmap.h"
 struct hashmap;
 struct SurfaceFunctions;
 
@@ -14,12 +16,15 @@ struct GLProcFunctions {
     void (*AttachShader)(unsigned int, unsigned int);
     void (*BindAttribLocation)(unsigned int, unsigned int, const char*);
     void (*BindBuffer)(uint32_t, unsigned int);
+    void (*BindBufferBase)(uint32_t, unsigned int, unsigned int);
+    void (*BindBufferRange)(uint32_t, unsigned int, unsigned int, intptr_t, uintptr_t);
     void (*BindFramebuffer)(uint32_t, unsigned int);
     void (*BindVertexArray)(uint32_t);
     void (*BlitFramebuffer)(int, int, int, int, int, int, int, int, uint32_t, uint32_t);
     void (*BufferData)(uint32_t, uintptr_t, const void*, uint32_t);
     void (*BufferStorage)(unsigned int, uintptr_t, const void*, uintptr_t);
     void (*BufferSubData)(uint32_t, intptr_t, uintptr_t, const void*);
+    uint32_t (*ClientWaitSync)(void*, uint32_t, uint64_t);
     void (*CompileShader)(unsigned int);
     void (*CompressedTexSubImage2D)(uint32_t, int, int, int, unsigned int, unsigned int, uint32_t, unsigned int, const void*);
     void (*CopyImageSubData)(unsigned int, uint32_t, int, int, int, int, unsigned int, uint32_t, int, int, int, int, unsigned int, unsigned int, unsigned int);
@@ -29,17 +34,22 @@ struct GLProcFunctions {
     void (*DeleteFramebuffers)(uint32_t, unsigned int*);
     void (*DeleteProgram)(unsigned int);
     void (*DeleteShader)(unsigned int);
+    void (*DeleteSync)(void*);
     void (*DeleteVertexArrays)(uint32_t, const unsigned int*);
     void (*DisableVertexAttribArray)(unsigned int);
     void (*DrawElements)(uint32_t, unsigned int, uint32_t, const void*);
     void (*EnableVertexAttribArray)(unsigned int);
+    void* (*FenceSync)(uint32_t, uint32_t);
     void (*FlushMappedBufferRange)(uint32_t, intptr_t, uintptr_t);
+    void (*FramebufferRenderbuffer)(uint32_t, uint32_t, uint32_t, unsigned int);
     void (*FramebufferTexture)(uint32_t, uint32_t, unsigned int, int);
+    void (*FramebufferTexture2D)(uint32_t, uint32_t, uint32_t, unsigned int, int);
     void (*FramebufferTextureLayer)(uint32_t, uint32_t, unsigned int, int, int);
     void (*GenBuffers)(uint32_t, unsigned int*);
     void (*GenFramebuffers)(uint32_t, unsigned int*);
     void (*GenVertexArrays)(uint32_t, unsigned int*);
     void (*GetActiveUniformBlockiv)(unsigned int, unsigned int, uint32_t, int*);
+    void (*GetBufferSubData)(uint32_t, intptr_t, uintptr_t, void*);
     void (*GetActiveUniformsiv)(unsigned int, uint32_t, const unsigned int*, uint32_t, int*);
     void (*GetFramebufferAttachmentParameteriv)(uint32_t, uint32_t, uint32_t, int*);
     void (*GetIntegeri_v)(uint32_t, unsigned int, int*);
@@ -55,7 +65,11 @@ struct GLProcFunctions {
     void (*ShaderSource)(unsigned int, uint32_t, const char**, const int*);
     void (*TexStorage2D)(uint32_t, int, uint32_t, unsigned int, unsigned int);
     void (*Uniform1i)(int, int);
+    void (*Uniform1iv)(int, unsigned int, const int*);
+    void (*Uniform4f)(int, float, float, float, float);
+    void (*Uniform4fv)(int, unsigned int, const float*);
     void (*Uniform4i)(int, int, int, int, int);
+    void (*UniformBlockBinding)(unsigned int, unsigned int, unsigned int);
     void (*UniformMatrix4fv)(int, unsigned int, uint8_t, const float*);
     uint8_t (*UnmapBuffer)(uint32_t);
     void (*UseProgram)(unsigned int);
@@ -95,6 +109,10 @@ struct GLLibFunctions {
 #define GL_MAP_READ_BIT 1
 #define GL_MAP_WRITE_BIT 2
 #define GL_MAP_FLUSH_EXPLICIT_BIT 16
+#define GL_MAP_PERSISTENT_BIT 64
+#define GL_MAP_COHERENT_BIT 128
+#define GL_SYNC_FLUSH_COMMANDS_BIT 1
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 37143
 #define GL_TEXTURE_MAG_FILTER 10240
 #define GL_TEXTURE_MIN_FILTER 10241
 #define GL_TEXTURE_WRAP_S 10242
@@ -109,6 +127,7 @@ struct GLLibFunctions {
 #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 35918
 #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 35919
 #define GL_ACTIVE_TEXTURE 34016
+#define GL_STREAM_DRAW 35040
 #define GL_STATIC_DRAW 35044
 #define GL_FRAGMENT_SHADER 35632
 #define GL_VERTEX_SHADER 35633
@@ -122,6 +141,8 @@ struct GLLibFunctions {
 #define GL_ARRAY_BUFFER_BINDING 34964
 #define GL_ELEMENT_ARRAY_BUFFER_BINDING 34965
 #define GL_UNIFORM_BUFFER_BINDING 35368
+#define GL_COPY_READ_BUFFER 36662
+#define GL_COPY_READ_BUFFER_BINDING 36662
 #define GL_UNIFORM_OFFSET 35387
 #define GL_UNIFORM_BLOCK_BINDING 35391
 #define GL_TEXTURE0 33984
@@ -134,26 +155,54 @@ struct GLLibFunctions {
 
 /* bolt re-implementation of some gl objects, storing only the things we need */
 
+/// `data` is a CPU-side copy of the buffer's contents, but it's only kept for buffers that have been
+/// read by us at least once, as indicated by `shadowed`. For other buffers it will be NULL, and
+/// mappings of them are passed through to the driver, so use _bolt_buffer_data to access it.
+/// `mapping` is set while an intercepted mapping is active, and `driver_mapping` is set while a
+/// mapping that was passed through to the driver is active. The offset, length and access type
+/// fields apply to whichever of the two is set.
 struct GLArrayBuffer {
     unsigned int id;
+    uint8_t shadowed;
+    uintptr_t size;
     void* data;
     uint8_t* mapping;
+    uint8_t* driver_mapping;
     int32_t mapping_offset;
     uint32_t mapping_len;
     uint32_t mapping_access_type;
 };
 
+/// `data` is the RGBA copy of the texture's contents. Compressed uploads aren't decoded into it
+/// straight away: the blocks are kept in `compressed` (laid out as a grid of blocks covering the
+/// whole texture) and each one is only decoded into `data` once something reads the pixels it
+/// covers. `block_pending` has one entry per block, set while that block's RGBA pixels are stale.
 struct GLTexture2D {
     unsigned int id;
     unsigned char* data;
     unsigned int width;
     unsigned int height;
+    uint8_t* compressed;
+    uint8_t* block_pending;
+    size_t pending_count;
+    int compressed_format;
     double minimap_center_x;
     double minimap_center_y;
     uint8_t is_minimap_tex_big;
     uint8_t is_minimap_tex_small;
 };
 
+/// Client-side copy of a uniform value which gets read during draw calls. `known` is only set when
+/// the value was written by a glUniform* call that went through our hooks since the last link, so
+/// if it's unset, the real value has to be fetched from the driver instead.
+struct GLUniformShadow {
+    union {
+        int i;
+        float f[16];
+    } value;
+    uint8_t known;
+};
+
 struct GLProgram {
     unsigned int id;
     unsigned int loc_aVertexPosition2D;
@@ -174,8 +223,17 @@ struct GLProgram {
     int loc_sSceneHDRTex;
     int loc_sSourceTex;
     int block_index_ViewTransforms;
+    int binding_ViewTransforms;
     int offset_uCameraPosition;
     int offset_uViewProjMatrix;
+    struct GLUniformShadow uProjectionMatrix;
+    struct GLUniformShadow uDiffuseMap;
+    struct GLUniformShadow uTextureAtlas;
+    struct GLUniformShadow uTextureAtlasSettings;
+    struct GLUniformShadow uAtlasMeta;
+    struct GLUniformShadow uModelMatrix;
+    struct GLUniformShadow sSceneHDRTex;
+    struct GLUniformShadow sSourceTex;
     uint8_t is_minimap;
     uint8_t is_2d;
     uint8_t is_3d;
@@ -193,9 +251,15 @@ struct GLAttrBinding {
 
 struct GLVertexArray {
     unsigned int id;
+    unsigned int element_binding;
     struct GLAttrBinding attributes[16];
 };
 
+struct GLFramebuffer {
+    unsigned int id;
+    unsigned int colour_attachment;
+};
+
 struct HashMap {
     struct hashmap* map;
     RWLock rwlock;
@@ -207,14 +271,19 @@ struct HashMap {
 /// are actually safe assumptions in valid OpenGL usage.
 struct GLContext {
     uintptr_t id;
-    struct HashMap* programs;
-    struct HashMap* buffers;
-    struct HashMap* textures;
-    struct HashMap* vaos;
+    struct IDMap* programs;
+    struct IDMap* buffers;
+    struct IDMap* textures;
+    struct IDMap* vaos;
+    struct IDMap* framebuffers;
+    struct MemPool* buffer_pool; // for buffer contents and mappings, shared in the same way as `buffers`
     struct GLTexture2D** texture_units;
+    unsigned int* uniform_buffer_bindings;
     struct GLProgram* bound_program;
     struct GLVertexArray* bound_vao;
     unsigned int active_texture;
+    unsigned int array_binding;
+    unsigned int uniform_binding;
     unsigned int current_draw_framebuffer;
     unsigned int current_read_framebuffer;
     unsigned int game_view_framebuffer;
@@ -234,6 +303,8 @@ struct GLContext {
     int viewport_y;
     unsigned int viewport_w;
     unsigned int viewport_h;
+    uint64_t quiescent_epoch; // see RetiredObject in gl.c
+    struct GLContext* next_free; // only used while this struct is sitting in the contexts free list
 };
 
 void _bolt_gl_close();
@@ -288,11 +359,17 @@ void _bolt_gl_onClear(uint32_t);
 /// Call this in response to glViewport, which needs to be hooked from libgl.
 void _bolt_gl_onViewport(int, int, unsigned int, unsigned int);
 
+/// Returns the pool that the current context's buffer contents and mappings are allocated from, or
+/// NULL if no context is current. This is only for reporting on, e.g. by bolt-replay.
+const struct MemPool* _bolt_gl_buffer_pool();
+
 /* plugin library interop stuff */
 
 struct GLPluginDrawElementsVertex2DUserData {
     struct GLContext* c;
-    unsigned short* indices;
+    const unsigned short* indices; // NULL until first used, see _bolt_vertex2d_index
+    struct GLArrayBuffer* element_buffer;
+    uintptr_t indices_offset;
     struct GLTexture2D* atlas;
     struct GLAttrBinding* position;
     struct GLAttrBinding* atlas_min;
@@ -303,7 +380,9 @@ struct GLPluginDrawElementsVertex2DUserData {
 
 struct GLPluginDrawElementsVertex3DUserData {
     struct GLContext* c;
-    unsigned short* indices;
+    const unsigned short* indices; // NULL until first used, see _bolt_vertex3d_index
+    struct GLArrayBuffer* element_buffer;
+    uintptr_t indices_offset;
     int atlas_scale;
     struct GLTexture2D* atlas;
     struct GLTexture2D* settings_atlas;
@@ -316,6 +395,10 @@ struct GLPluginDrawElementsVertex3DUserData {
 struct GLPlugin3DMatrixUserData {
     float model_matrix[16];
     float viewproj_matrix[16];
+    int game_view_x;
+    int game_view_y;
+    int game_view_w;
+    int game_view_h;
 };
 
 struct GLPluginTextureUserData {
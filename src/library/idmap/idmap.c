@@ -0,0 +1,244 @@
+#include "idmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+// on x86 and x64, MSVC gives volatile loads acquire semantics and volatile stores release semantics;
+// the barrier stops the compiler itself from reordering anything around them
+static unsigned int load_id(const unsigned int* p) { const unsigned int v = *(const volatile unsigned int*)p; _ReadWriteBarrier(); return v; }
+static void* load_ptr(void* const* p) { void* const v = *(void* const volatile*)p; _ReadWriteBarrier(); return v; }
+static void store_id(unsigned int* p, unsigned int v) { _ReadWriteBarrier(); *(volatile unsigned int*)p = v; }
+static void store_ptr(void** p, void* v) { _ReadWriteBarrier(); *(void* volatile*)p = v; }
+#else
+static unsigned int load_id(const unsigned int* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void* load_ptr(void* const* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void store_id(unsigned int* p, unsigned int v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static void store_ptr(void** p, void* v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#endif
+
+// a slot with id 0 has never been used. a slot with a non-zero id and a NULL value used to hold that
+// id but it's since been removed - these are left in place so that lookups for other ids which
+// probed past this slot when they were inserted can still find them, and get reused by inserts.
+struct IDMapSlot {
+    unsigned int id;
+    void* value;
+};
+
+struct IDMapTable {
+    struct IDMapTable* next_retired;
+    size_t mask; // capacity - 1, capacity is always a power of two
+    size_t used; // slots with a non-zero id, whether or not they still have a value
+    struct IDMapSlot slots[];
+};
+
+#define DIRECT_LIMIT ((size_t)IDMAP_PAGE_SIZE * IDMAP_PAGE_COUNT)
+
+static size_t _bolt_idmap_slot_for(unsigned int id, size_t mask) {
+    // GL names are mostly small and sequential, so a multiplicative hash is plenty
+    return ((size_t)id * 0x9E3779B1u) & mask;
+}
+
+static struct IDMapTable* _bolt_idmap_table_new(size_t capacity) {
+    size_t cap = 16;
+    while (cap < capacity) cap <<= 1;
+    struct IDMapTable* table = calloc(1, sizeof(struct IDMapTable) + (cap * sizeof(struct IDMapSlot)));
+    if (table) table->mask = cap - 1;
+    return table;
+}
+
+// replaces the map's table with one big enough for its current contents, without any of the old
+// table's removed slots. must be called with the write lock held. if the new table can't be allocated,
+// the old one is left in place and 0 is returned, otherwise returns 1.
+static uint8_t _bolt_idmap_rebuild(struct IDMap* map) {
+    struct IDMapTable* old = map->table;
+    size_t live = 0;
+    for (size_t i = 0; i <= old->mask; i += 1) {
+        if (old->slots[i].id && old->slots[i].value) live += 1;
+    }
+    struct IDMapTable* table = _bolt_idmap_table_new(live * 2);
+    if (!table) return 0;
+    for (size_t i = 0; i <= old->mask; i += 1) {
+        const struct IDMapSlot* slot = &old->slots[i];
+        if (!slot->id || !slot->value) continue;
+        size_t index = _bolt_idmap_slot_for(slot->id, table->mask);
+        while (table->slots[index].id) index = (index + 1) & table->mask;
+        table->slots[index] = *slot;
+        table->used += 1;
+    }
+    store_ptr((void**)&map->table, table);
+    old->next_retired = map->retired;
+    map->retired = old;
+    return 1;
+}
+
+void _bolt_idmap_init(struct IDMap* map) {
+    memset(map, 0, sizeof(*map));
+    _bolt_rwlock_init(&map->lock);
+    // the hash table is only for outliers, so it can start small
+    map->table = _bolt_idmap_table_new(16);
+}
+
+void* _bolt_idmap_get(const struct IDMap* map, unsigned int id) {
+    if (id < DIRECT_LIMIT) {
+        void* const* page = load_ptr((void* const*)&map->pages[id / IDMAP_PAGE_SIZE]);
+        return page ? load_ptr(&page[id % IDMAP_PAGE_SIZE]) : NULL;
+    }
+    const struct IDMapTable* table = load_ptr((void* const*)&map->table);
+    if (!table) return NULL;
+    size_t index = _bolt_idmap_slot_for(id, table->mask);
+    while (1) {
+        const struct IDMapSlot* slot = &table->slots[index];
+        const unsigned int slot_id = load_id(&slot->id);
+        if (slot_id == 0) return NULL;
+        if (slot_id == id) {
+            void* value = load_ptr(&slot->value);
+            // if the slot got reused for a different id while we were reading it, then `id` was
+            // removed concurrently, so whichever answer we give is as good as the other
+            if (load_id(&slot->id) == id) return value;
+        }
+        index = (index + 1) & table->mask;
+    }
+}
+
+void _bolt_idmap_set(struct IDMap* map, unsigned int id, void* value) {
+    if (id == 0 || !value) return;
+    _bolt_rwlock_lock_write(&map->lock);
+    if (id < DIRECT_LIMIT) {
+        void** page = map->pages[id / IDMAP_PAGE_SIZE];
+        if (!page) {
+            page = calloc(IDMAP_PAGE_SIZE, sizeof(void*));
+            if (!page) {
+                _bolt_rwlock_unlock_write(&map->lock);
+                return;
+            }
+            store_ptr((void**)&map->pages[id / IDMAP_PAGE_SIZE], page);
+        }
+        if (!page[id % IDMAP_PAGE_SIZE]) map->count += 1;
+        store_ptr(&page[id % IDMAP_PAGE_SIZE], value);
+        _bolt_rwlock_unlock_write(&map->lock);
+        return;
+    }
+    if (!map->table) {
+        // the initial allocation in _bolt_idmap_init failed, so try again now
+        struct IDMapTable* table = _bolt_idmap_table_new(16);
+        if (!table) {
+            _bolt_rwlock_unlock_write(&map->lock);
+            return;
+        }
+        store_ptr((void**)&map->table, table);
+    }
+    struct IDMapTable* table = map->table;
+    struct IDMapSlot* reusable = NULL;
+    size_t index = _bolt_idmap_slot_for(id, table->mask);
+    while (1) {
+        struct IDMapSlot* slot = &table->slots[index];
+        if (slot->id == id) {
+            if (!slot->value) map->count += 1;
+            store_ptr(&slot->value, value);
+            _bolt_rwlock_unlock_write(&map->lock);
+            return;
+        }
+        if (slot->id == 0) break;
+        if (!slot->value && !reusable) reusable = slot;
+        index = (index + 1) & table->mask;
+    }
+
+    if (reusable) {
+        // value is already NULL, so readers will see this as "not present" until the value is set
+        store_id(&reusable->id, id);
+        store_ptr(&reusable->value, value);
+    } else {
+        // lookups stop at the first empty slot, so the last one must never be filled. this can only
+        // happen if every rebuild since the table passed 75% has failed to allocate.
+        if (table->used == table->mask) {
+            _bolt_rwlock_unlock_write(&map->lock);
+            return;
+        }
+        struct IDMapSlot* slot = &table->slots[index];
+        store_ptr(&slot->value, value);
+        store_id(&slot->id, id);
+        table->used += 1;
+        // keep the load factor below 75%, counting removed slots, or lookups for missing ids get slow
+        if (table->used * 4 > (table->mask + 1) * 3) _bolt_idmap_rebuild(map);
+    }
+    map->count += 1;
+    _bolt_rwlock_unlock_write(&map->lock);
+}
+
+void* _bolt_idmap_remove(struct IDMap* map, unsigned int id) {
+    if (id == 0) return NULL;
+    _bolt_rwlock_lock_write(&map->lock);
+    void* ret = NULL;
+    if (id < DIRECT_LIMIT) {
+        void** page = map->pages[id / IDMAP_PAGE_SIZE];
+        if (page && page[id % IDMAP_PAGE_SIZE]) {
+            ret = page[id % IDMAP_PAGE_SIZE];
+            store_ptr(&page[id % IDMAP_PAGE_SIZE], NULL);
+            map->count -= 1;
+        }
+        _bolt_rwlock_unlock_write(&map->lock);
+        return ret;
+    }
+    struct IDMapTable* table = map->table;
+    if (!table) {
+        _bolt_rwlock_unlock_write(&map->lock);
+        return NULL;
+    }
+    size_t index = _bolt_idmap_slot_for(id, table->mask);
+    while (table->slots[index].id) {
+        struct IDMapSlot* slot = &table->slots[index];
+        if (slot->id == id) {
+            ret = slot->value;
+            if (ret) {
+                store_ptr(&slot->value, NULL);
+                map->count -= 1;
+            }
+            break;
+        }
+        index = (index + 1) & table->mask;
+    }
+    _bolt_rwlock_unlock_write(&map->lock);
+    return ret;
+}
+
+uint8_t _bolt_idmap_iter(const struct IDMap* map, size_t* iter, void** value) {
+    // iter counts through every name that could be in the pages, then every slot in the hash table
+    while (*iter < DIRECT_LIMIT) {
+        void* const* page = map->pages[*iter / IDMAP_PAGE_SIZE];
+        if (!page) {
+            *iter = ((*iter / IDMAP_PAGE_SIZE) + 1) * IDMAP_PAGE_SIZE;
+            continue;
+        }
+        void* ptr = page[*iter % IDMAP_PAGE_SIZE];
+        *iter += 1;
+        if (ptr) {
+            *value = ptr;
+            return 1;
+        }
+    }
+    const struct IDMapTable* table = map->table;
+    if (!table) return 0;
+    while (*iter - DIRECT_LIMIT <= table->mask) {
+        const struct IDMapSlot* slot = &table->slots[*iter - DIRECT_LIMIT];
+        *iter += 1;
+        if (slot->id && slot->value) {
+            *value = slot->value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void _bolt_idmap_destroy(struct IDMap* map) {
+    _bolt_rwlock_destroy(&map->lock);
+    for (size_t i = 0; i < IDMAP_PAGE_COUNT; i += 1) free(map->pages[i]);
+    free(map->table);
+    while (map->retired) {
+        struct IDMapTable* next = map->retired->next_retired;
+        free(map->retired);
+        map->retired = next;
+    }
+    map->table = NULL;
+}
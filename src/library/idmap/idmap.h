@@ -0,0 +1,66 @@
+#ifndef _BOLT_LIBRARY_IDMAP_H_
+#define _BOLT_LIBRARY_IDMAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../rwlock/rwlock.h"
+
+/// Number of values in each page of an IDMap's direct table.
+#define IDMAP_PAGE_SIZE 1024
+
+/// Number of pages in an IDMap's direct table. Names below IDMAP_PAGE_SIZE * IDMAP_PAGE_COUNT are
+/// looked up by indexing straight into a page; anything above that goes in the hash table.
+#define IDMAP_PAGE_COUNT 256
+
+struct IDMapTable;
+
+/// A map from GL object names to pointers, used for the shadow copies of GL objects which may be
+/// shared between contexts (programs, buffers, textures and so on).
+///
+/// GL hands out names as small, densely packed integers, so most values are kept in `pages`, which
+/// is indexed directly by name. Pages are allocated the first time a name in their range is set and
+/// aren't freed until the map is destroyed. Names too big for the pages go in a hash table instead.
+///
+/// Lookups don't take any locks, so they never wait on another thread, which matters because
+/// they're done many times per draw call on the render thread. Inserts and removes are serialised
+/// against each other by `lock`, which _bolt_idmap_set and _bolt_idmap_remove take internally.
+///
+/// When the hash table fills up, a new one is built and published in its place. The old table may still
+/// be in use by a concurrent lookup, so it goes in the `retired` list and isn't freed until
+/// _bolt_idmap_destroy. Slots of removed names get reused by later inserts, so this rarely happens
+/// other than when the number of live objects grows.
+///
+/// Name 0 is reserved and can't be inserted, which is fine since GL never generates it. Values
+/// must be non-NULL.
+struct IDMap {
+    void** pages[IDMAP_PAGE_COUNT];
+    struct IDMapTable* table;
+    struct IDMapTable* retired;
+    size_t count;
+    RWLock lock;
+};
+
+/// Initialises an empty map.
+void _bolt_idmap_init(struct IDMap*);
+
+/// Returns the value for `id`, or NULL if there isn't one. Safe to call from any thread at any
+/// time, including while another thread is inserting or removing.
+void* _bolt_idmap_get(const struct IDMap*, unsigned int id);
+
+/// Inserts or replaces the value for `id`. If memory for it can't be allocated, the map is left unchanged.
+void _bolt_idmap_set(struct IDMap*, unsigned int id, void* value);
+
+/// Removes the value for `id` and returns it, or returns NULL if there wasn't one. It's up to the
+/// caller to make sure nothing is still using the value before freeing it.
+void* _bolt_idmap_remove(struct IDMap*, unsigned int id);
+
+/// Iterates the map's values. `iter` should point to 0 for the first call. Returns 0 when there
+/// are no more values, otherwise sets `value` and returns 1. Must not be used concurrently with
+/// _bolt_idmap_set or _bolt_idmap_remove.
+uint8_t _bolt_idmap_iter(const struct IDMap*, size_t* iter, void** value);
+
+/// Frees the map's tables and destroys its lock. Doesn't free any of the values.
+void _bolt_idmap_destroy(struct IDMap*);
+
+#endif
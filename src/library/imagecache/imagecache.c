@@ -0,0 +1,161 @@
+#include "imagecache.h"
+
+#include "../../../modules/hashmap/hashmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void _bolt_imagecache_unlink(struct ImageCache* cache, struct CachedImage* image) {
+    if (image->prev) image->prev->next = image->next;
+    else cache->head = image->next;
+    if (image->next) image->next->prev = image->prev;
+    else cache->tail = image->prev;
+    image->prev = NULL;
+    image->next = NULL;
+}
+
+static void _bolt_imagecache_push_front(struct ImageCache* cache, struct CachedImage* image) {
+    image->prev = NULL;
+    image->next = cache->head;
+    if (cache->head) cache->head->prev = image;
+    else cache->tail = image;
+    cache->head = image;
+}
+
+static void _bolt_imagecache_free_image(struct CachedImage* image) {
+    free(image->file);
+    free(image->rgba);
+    free(image);
+}
+
+static size_t _bolt_imagecache_image_bytes(const struct CachedImage* image) {
+    return image->rgba_size + image->file_size;
+}
+
+static int _bolt_imagecache_map_compare(const void* a, const void* b, void* udata) {
+    const struct CachedImage* i1 = *(const struct CachedImage* const*)a;
+    const struct CachedImage* i2 = *(const struct CachedImage* const*)b;
+    if (i1->file_size != i2->file_size) return 1;
+    return memcmp(i1->file, i2->file, i1->file_size);
+}
+
+static uint64_t _bolt_imagecache_map_hash(const void* item, uint64_t seed0, uint64_t seed1) {
+    // already a sip hash of the file, from _bolt_imagecache_hash
+    return (*(const struct CachedImage* const*)item)->hash;
+}
+
+// frees unreferenced images, least recently used first, until the cache is back under max_bytes.
+// must be called with the lock held. the freed images are put in a list to be freed after
+// unlocking, which is returned.
+static struct CachedImage* _bolt_imagecache_evict(struct ImageCache* cache) {
+    struct CachedImage* evicted = NULL;
+    struct CachedImage* image = cache->tail;
+    while (image && cache->bytes_cached > cache->max_bytes) {
+        struct CachedImage* prev = image->prev;
+        if (!image->refcount) {
+            _bolt_imagecache_unlink(cache, image);
+            hashmap_delete(cache->map, &image);
+            cache->bytes_cached -= _bolt_imagecache_image_bytes(image);
+            image->next = evicted;
+            evicted = image;
+        }
+        image = prev;
+    }
+    return evicted;
+}
+
+static void _bolt_imagecache_free_list(struct CachedImage* image) {
+    while (image) {
+        struct CachedImage* next = image->next;
+        _bolt_imagecache_free_image(image);
+        image = next;
+    }
+}
+
+// must be called with the lock held
+static struct CachedImage* _bolt_imagecache_find(struct ImageCache* cache, uint64_t hash, const void* file, size_t file_size) {
+    const struct CachedImage key = {.hash = hash, .file = (uint8_t*)file, .file_size = file_size};
+    const struct CachedImage* key_ptr = &key;
+    struct CachedImage* const* found = hashmap_get(cache->map, &key_ptr);
+    if (!found) return NULL;
+    struct CachedImage* image = *found;
+    image->refcount += 1;
+    if (image != cache->head) {
+        _bolt_imagecache_unlink(cache, image);
+        _bolt_imagecache_push_front(cache, image);
+    }
+    return image;
+}
+
+void _bolt_imagecache_init(struct ImageCache* cache, size_t max_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->max_bytes = max_bytes;
+    cache->map = hashmap_new(sizeof(struct CachedImage*), 8, 0, 0, _bolt_imagecache_map_hash, _bolt_imagecache_map_compare, NULL, NULL);
+    _bolt_rwlock_init(&cache->lock);
+}
+
+uint64_t _bolt_imagecache_hash(const void* file, size_t file_size) {
+    return hashmap_sip(file, file_size, 0, 0);
+}
+
+struct CachedImage* _bolt_imagecache_acquire(struct ImageCache* cache, uint64_t hash, const void* file, size_t file_size) {
+    _bolt_rwlock_lock_write(&cache->lock);
+    struct CachedImage* image = _bolt_imagecache_find(cache, hash, file, file_size);
+    _bolt_rwlock_unlock_write(&cache->lock);
+    return image;
+}
+
+struct CachedImage* _bolt_imagecache_insert(struct ImageCache* cache, uint64_t hash, uint8_t* file, size_t file_size, uint32_t width, uint32_t height, uint8_t* rgba, size_t rgba_size) {
+    struct CachedImage* new_image = malloc(sizeof(struct CachedImage));
+    if (!new_image) {
+        free(file);
+        free(rgba);
+        return NULL;
+    }
+    new_image->hash = hash;
+    new_image->file = file;
+    new_image->file_size = file_size;
+    new_image->width = width;
+    new_image->height = height;
+    new_image->rgba = rgba;
+    new_image->rgba_size = rgba_size;
+    new_image->refcount = 1;
+
+    _bolt_rwlock_lock_write(&cache->lock);
+    struct CachedImage* image = _bolt_imagecache_find(cache, hash, file, file_size);
+    struct CachedImage* evicted = NULL;
+    if (!image) {
+        hashmap_set(cache->map, &new_image);
+        if (!hashmap_oom(cache->map)) {
+            image = new_image;
+            new_image = NULL;
+            _bolt_imagecache_push_front(cache, image);
+            cache->bytes_cached += _bolt_imagecache_image_bytes(image);
+            evicted = _bolt_imagecache_evict(cache);
+        }
+    }
+    _bolt_rwlock_unlock_write(&cache->lock);
+
+    if (new_image) _bolt_imagecache_free_image(new_image);
+    _bolt_imagecache_free_list(evicted);
+    return image;
+}
+
+void _bolt_imagecache_release(struct ImageCache* cache, struct CachedImage* image) {
+    if (!image) return;
+    _bolt_rwlock_lock_write(&cache->lock);
+    image->refcount -= 1;
+    struct CachedImage* evicted = image->refcount ? NULL : _bolt_imagecache_evict(cache);
+    _bolt_rwlock_unlock_write(&cache->lock);
+    _bolt_imagecache_free_list(evicted);
+}
+
+void _bolt_imagecache_destroy(struct ImageCache* cache) {
+    _bolt_imagecache_free_list(cache->head);
+    hashmap_free(cache->map);
+    cache->map = NULL;
+    cache->head = NULL;
+    cache->tail = NULL;
+    cache->bytes_cached = 0;
+    _bolt_rwlock_destroy(&cache->lock);
+}
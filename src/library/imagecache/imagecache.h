@@ -0,0 +1,69 @@
+#ifndef _BOLT_LIBRARY_IMAGECACHE_H_
+#define _BOLT_LIBRARY_IMAGECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../rwlock/rwlock.h"
+
+struct hashmap;
+
+/// Default value for ImageCache.max_bytes.
+#define IMAGECACHE_DEFAULT_MAX_BYTES (64 * 1024 * 1024)
+
+/// A decoded image in an ImageCache. Everything in here is read-only once it's been added.
+/// `file` is the encoded file it was decoded from, which is kept so that a lookup can check it's
+/// really the same file and not just one with the same hash.
+struct CachedImage {
+    uint64_t hash;
+    uint8_t* file;
+    size_t file_size;
+    uint32_t width;
+    uint32_t height;
+    uint8_t* rgba;
+    size_t rgba_size;
+
+    // private to imagecache.c, protected by the cache's lock
+    uint32_t refcount;
+    struct CachedImage* prev;
+    struct CachedImage* next;
+};
+
+/// A thread-safe cache of decoded RGBA images, keyed by the encoded file's contents, so that loading
+/// the same file more than once only decodes it once. Images are reference-counted, and an image
+/// with no references is kept until the total size of all cached images and their files goes over
+/// `max_bytes`, at which point the least recently used ones are freed. Images which are in use are
+/// never freed, even if that means going over `max_bytes`.
+struct ImageCache {
+    RWLock lock;
+    struct hashmap* map; // of CachedImage*, by file contents
+    struct CachedImage* head; // most recently used
+    struct CachedImage* tail; // least recently used
+    size_t bytes_cached;
+    size_t max_bytes;
+};
+
+/// Initialises an empty cache. A `max_bytes` of 0 means images are freed as soon as they're released.
+void _bolt_imagecache_init(struct ImageCache*, size_t max_bytes);
+
+/// Hashes an encoded image file for use as a key into the cache.
+uint64_t _bolt_imagecache_hash(const void* file, size_t file_size);
+
+/// Looks for an image decoded from a file with exactly these contents, where `hash` is the file's
+/// _bolt_imagecache_hash. If there is one, adds a reference to it and returns it, otherwise returns
+/// NULL.
+struct CachedImage* _bolt_imagecache_acquire(struct ImageCache*, uint64_t hash, const void* file, size_t file_size);
+
+/// Adds a decoded image to the cache, taking ownership of `file` and `rgba`, which must both have
+/// been allocated with malloc, and returns it with one reference. If an image from the same file
+/// was added in the meantime, `file` and `rgba` are freed and that image is returned instead.
+/// Returns NULL if out of memory, in which case `file` and `rgba` are still freed.
+struct CachedImage* _bolt_imagecache_insert(struct ImageCache*, uint64_t hash, uint8_t* file, size_t file_size, uint32_t width, uint32_t height, uint8_t* rgba, size_t rgba_size);
+
+/// Removes a reference from an image. Passing NULL does nothing.
+void _bolt_imagecache_release(struct ImageCache*, struct CachedImage*);
+
+/// Frees every image in the cache and destroys its lock. There must be no references left.
+void _bolt_imagecache_destroy(struct ImageCache*);
+
+#endif
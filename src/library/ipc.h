@@ -6,10 +6,12 @@
 enum BoltMessageTypeToHost {
     IPC_MSG_DUPLICATEPROCESS,
     IPC_MSG_IDENTIFY,
+    IPC_MSG_PLUGINPROFILE,
 };
 
 enum BoltMessageTypeToClient {
     IPC_MSG_STARTPLUGINS,
+    IPC_MSG_DUMPTRACE,
 };
 
 /// A generic message. The host process will always assume incoming data is an instance of this
@@ -34,6 +36,36 @@ struct BoltIPCMessageToClient {
     uint32_t items;
 };
 
+/// Number of callback types which are profiled separately in an IPC_MSG_PLUGINPROFILE message. The
+/// first seven are in the same order as enum PluginEventType (see plugin/plugin.h), and the last
+/// one counts all window events together.
+#define IPC_PROFILE_CALLBACK_TYPES 8
+
+/// Profiling data for one type of callback on one plugin, totalled since the previous message.
+///
+/// IPC_MSG_PLUGINPROFILE is sent by each client roughly once per second while it has plugins running.
+/// `items` is the number of plugins. Each plugin is sent as a uint32_t ID length, followed by the
+/// ID itself (not null-terminated), followed by IPC_PROFILE_CALLBACK_TYPES of this struct.
+struct BoltIPCPluginProfile {
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+    int64_t memory_delta; // change in bytes of memory used by the plugin's Lua state
+};
+
+/// Time limits for one plugin, from the "limits" object in its bolt.json. Any which are 0 weren't
+/// configured, and the client uses its own default for them (see plugin.c).
+///
+/// IPC_MSG_STARTPLUGINS has `items` plugins. Each plugin is sent as three uint32_t lengths, of its
+/// ID, its directory path and its main file, followed by those three strings (not null-terminated),
+/// followed by this struct.
+struct BoltIPCPluginLimits {
+    uint32_t frame_budget_us;
+    uint32_t call_limit_us;
+    uint32_t max_violations;
+    uint32_t hook_instructions;
+};
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
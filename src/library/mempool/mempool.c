@@ -0,0 +1,145 @@
+#include "mempool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// every block starts with one of these, so that a block can be put back in the right list when
+// it's freed. padded to 16 bytes so that the memory after it is suitably aligned for anything.
+union BlockHeader {
+    struct {
+        size_t size; // not including the header
+        union BlockHeader* next;
+    } h;
+    uint8_t padding[16];
+};
+
+// returns the size class for a small allocation of `size` bytes, and puts the size of that class's
+// blocks in `block_size`. must only be called with sizes up to MEMPOOL_LARGE_SIZE.
+static uint32_t _bolt_mempool_class_for(size_t size, size_t* block_size) {
+    if (size <= MEMPOOL_MIN_SIZE) {
+        *block_size = MEMPOOL_MIN_SIZE;
+        return 0;
+    }
+    // find the power of two below `size`, then which quarter of the way to the next one it's in
+    uint32_t doublings = 0;
+    size_t base = MEMPOOL_MIN_SIZE;
+    while ((base << 1) < size) {
+        base <<= 1;
+        doublings += 1;
+    }
+    const size_t step = base / 4;
+    const size_t steps = (size - base + step - 1) / step;
+    *block_size = base + (steps * step);
+    return 1 + (doublings * 4) + (uint32_t)(steps - 1);
+}
+
+// removes and returns the best-fitting block in the large free list for an allocation of `size`
+// bytes, or returns NULL if none is big enough without wasting too much. must hold the lock.
+static union BlockHeader* _bolt_mempool_take_large(struct MemPool* pool, size_t size) {
+    union BlockHeader** best = NULL;
+    for (union BlockHeader** prev = (union BlockHeader**)&pool->large_free_list; *prev; prev = &(*prev)->h.next) {
+        const size_t block_size = (*prev)->h.size;
+        if (block_size < size || block_size - size > size / 8) continue;
+        if (!best || block_size < (*best)->h.size) best = prev;
+    }
+    if (!best) return NULL;
+    union BlockHeader* block = *best;
+    *best = block->h.next;
+    pool->large_cached_count -= 1;
+    return block;
+}
+
+void _bolt_mempool_init(struct MemPool* pool) {
+    memset(pool, 0, sizeof(*pool));
+    _bolt_rwlock_init(&pool->lock);
+}
+
+void* _bolt_mempool_alloc(struct MemPool* pool, size_t size) {
+    if (size == 0) return NULL;
+    const uint8_t large = size > MEMPOOL_LARGE_SIZE;
+    size_t block_size = size;
+    const uint32_t size_class = large ? 0 : _bolt_mempool_class_for(size, &block_size);
+    union BlockHeader* block = NULL;
+
+    _bolt_rwlock_lock_write(&pool->lock);
+    if (large) {
+        block = _bolt_mempool_take_large(pool, size);
+    } else if (pool->free_lists[size_class]) {
+        block = pool->free_lists[size_class];
+        pool->free_lists[size_class] = block->h.next;
+    }
+    if (block) {
+        pool->bytes_cached -= block->h.size;
+        pool->bytes_reused += block->h.size;
+        pool->reuses += 1;
+    } else {
+        pool->bytes_allocated += sizeof(union BlockHeader) + block_size;
+        pool->allocations += 1;
+    }
+    _bolt_rwlock_unlock_write(&pool->lock);
+
+    if (!block) {
+        block = malloc(sizeof(union BlockHeader) + block_size);
+        if (!block) {
+            _bolt_rwlock_lock_write(&pool->lock);
+            pool->bytes_allocated -= sizeof(union BlockHeader) + block_size;
+            pool->allocations -= 1;
+            _bolt_rwlock_unlock_write(&pool->lock);
+            return NULL;
+        }
+        block->h.size = block_size;
+    }
+    return block + 1;
+}
+
+void _bolt_mempool_free(struct MemPool* pool, void* ptr) {
+    if (!ptr) return;
+    union BlockHeader* block = (union BlockHeader*)ptr - 1;
+    union BlockHeader* evicted = NULL;
+    const size_t block_size = block->h.size;
+    _bolt_rwlock_lock_write(&pool->lock);
+    if (block_size > MEMPOOL_LARGE_SIZE && pool->large_cached_count == MEMPOOL_MAX_LARGE_CACHED) {
+        union BlockHeader** last = (union BlockHeader**)&pool->large_free_list;
+        while ((*last)->h.next) last = &(*last)->h.next;
+        evicted = *last;
+        *last = NULL;
+        pool->large_cached_count -= 1;
+        pool->bytes_cached -= evicted->h.size;
+    }
+    if (pool->bytes_cached + block_size <= MEMPOOL_MAX_CACHED) {
+        void** list = &pool->large_free_list;
+        if (block_size <= MEMPOOL_LARGE_SIZE) {
+            size_t class_size;
+            list = &pool->free_lists[_bolt_mempool_class_for(block_size, &class_size)];
+        } else {
+            pool->large_cached_count += 1;
+        }
+        block->h.next = *list;
+        *list = block;
+        pool->bytes_cached += block_size;
+        block = NULL;
+    }
+    _bolt_rwlock_unlock_write(&pool->lock);
+    free(evicted);
+    free(block);
+}
+
+static void _bolt_mempool_free_list(void** list) {
+    union BlockHeader* block = *list;
+    while (block) {
+        union BlockHeader* next = block->h.next;
+        free(block);
+        block = next;
+    }
+    *list = NULL;
+}
+
+void _bolt_mempool_destroy(struct MemPool* pool) {
+    for (size_t i = 0; i < MEMPOOL_CLASS_COUNT; i += 1) {
+        _bolt_mempool_free_list(&pool->free_lists[i]);
+    }
+    _bolt_mempool_free_list(&pool->large_free_list);
+    pool->large_cached_count = 0;
+    pool->bytes_cached = 0;
+    _bolt_rwlock_destroy(&pool->lock);
+}
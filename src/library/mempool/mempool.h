@@ -0,0 +1,67 @@
+#ifndef _BOLT_LIBRARY_MEMPOOL_H_
+#define _BOLT_LIBRARY_MEMPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../rwlock/rwlock.h"
+
+/// Smallest block size. Allocations up to this size all get a block of this size.
+#define MEMPOOL_MIN_SIZE 64
+
+/// Allocations bigger than this aren't rounded up to a size class, see MemPool.
+#define MEMPOOL_LARGE_SIZE (64 * 1024)
+
+/// Number of size classes for small allocations: one for MEMPOOL_MIN_SIZE, then four for each
+/// doubling up to MEMPOOL_LARGE_SIZE.
+#define MEMPOOL_CLASS_COUNT 41
+
+/// Maximum number of bytes a pool will keep in its free lists. Blocks freed beyond this limit are
+/// returned to the system instead.
+#define MEMPOOL_MAX_CACHED (128 * 1024 * 1024)
+
+/// Maximum number of large blocks a pool will keep. When another is freed, the one that's been in
+/// the list the longest is returned to the system, since it's the least likely to fit anything.
+#define MEMPOOL_MAX_LARGE_CACHED 32
+
+/// A thread-safe allocator which keeps freed blocks for reuse, so that memory which is allocated
+/// and freed repeatedly (e.g. a buffer that gets re-uploaded every frame) doesn't have to go
+/// through malloc again.
+///
+/// Small allocations are rounded up to a size class, with four classes per power of two so that
+/// no more than a quarter of a block is wasted, and freed blocks go in a free list for their class.
+/// Large allocations are given exactly the size asked for, and freed ones go in a single list, from
+/// which a block is only reused for an allocation it fits with no more than an eighth to spare.
+struct MemPool {
+    RWLock lock;
+    void* free_lists[MEMPOOL_CLASS_COUNT];
+    void* large_free_list; // most recently freed first
+    size_t large_cached_count;
+    size_t bytes_cached;
+
+    /// Total bytes requested from malloc by this pool, including block headers.
+    uint64_t bytes_allocated;
+
+    /// Total bytes handed out from the free lists instead of being requested from malloc.
+    uint64_t bytes_reused;
+
+    /// Number of blocks requested from malloc, and number handed out from the free lists instead.
+    uint64_t allocations;
+    uint64_t reuses;
+};
+
+/// Initialises an empty pool.
+void _bolt_mempool_init(struct MemPool*);
+
+/// Allocates at least `size` bytes, aligned to 16 bytes. The returned pointer must be freed with
+/// _bolt_mempool_free on the same pool. Returns NULL for a size of 0 or if allocation fails.
+void* _bolt_mempool_alloc(struct MemPool*, size_t size);
+
+/// Returns a block to the pool. Passing NULL does nothing.
+void _bolt_mempool_free(struct MemPool*, void* ptr);
+
+/// Frees all memory cached by the pool and destroys its lock. Blocks which are still in use are not
+/// freed by this, and must not be passed to _bolt_mempool_free afterwards.
+void _bolt_mempool_destroy(struct MemPool*);
+
+#endif
@@ -0,0 +1,83 @@
+#include "mock.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// EGL_TRUE and EGL_FALSE
+#define MOCK_TRUE 1
+#define MOCK_FALSE 0
+
+// every display and context handle returned is a pointer to one of these. the mock only has one
+// display, and contexts don't own any state because the mock libGL's state is global.
+struct MockHandle {
+    uint32_t magic;
+    uint8_t destroyed; // destroyed while current, so it'll be freed when it's released
+};
+
+#define MOCK_DISPLAY_MAGIC 0x424F4C44
+#define MOCK_CONTEXT_MAGIC 0x424F4C43
+
+static struct MockHandle display = {.magic = MOCK_DISPLAY_MAGIC};
+
+static _Thread_local void* current_context = NULL;
+
+void* eglGetDisplay(void* native_display) {
+    return &display;
+}
+
+unsigned int eglInitialize(void* dpy, int* major, int* minor) {
+    if (dpy != &display) return MOCK_FALSE;
+    if (major) *major = 1;
+    if (minor) *minor = 5;
+    return MOCK_TRUE;
+}
+
+unsigned int eglTerminate(void* dpy) {
+    return dpy == &display ? MOCK_TRUE : MOCK_FALSE;
+}
+
+void* eglGetProcAddress(const char* name) {
+    return _bolt_mock_gl_get_proc_address(name);
+}
+
+void* eglCreateContext(void* dpy, void* config, void* share_context, const void* attrib_list) {
+    if (dpy != &display) return NULL;
+    struct MockHandle* context = malloc(sizeof(*context));
+    context->magic = MOCK_CONTEXT_MAGIC;
+    context->destroyed = 0;
+    return context;
+}
+
+unsigned int eglMakeCurrent(void* dpy, void* draw, void* read, void* context) {
+    if (dpy != &display) return MOCK_FALSE;
+    if (context && ((struct MockHandle*)context)->magic != MOCK_CONTEXT_MAGIC) return MOCK_FALSE;
+    struct MockHandle* old_context = current_context;
+    current_context = context;
+    if (old_context && old_context != context && old_context->destroyed) {
+        old_context->magic = 0;
+        free(old_context);
+    }
+    return MOCK_TRUE;
+}
+
+void* eglGetCurrentContext() {
+    return current_context;
+}
+
+unsigned int eglDestroyContext(void* dpy, void* context) {
+    if (dpy != &display || !context || ((struct MockHandle*)context)->magic != MOCK_CONTEXT_MAGIC) return MOCK_FALSE;
+    // like real EGL, a context that's current on this thread isn't freed until it's released. the
+    // plugin library relies on this: it makes the main context current again after destroying it,
+    // to clean up its own GL objects.
+    if (context == current_context) {
+        ((struct MockHandle*)context)->destroyed = 1;
+        return MOCK_TRUE;
+    }
+    ((struct MockHandle*)context)->magic = 0;
+    free(context);
+    return MOCK_TRUE;
+}
+
+unsigned int eglSwapBuffers(void* dpy, void* surface) {
+    return (dpy == &display && current_context) ? MOCK_TRUE : MOCK_FALSE;
+}
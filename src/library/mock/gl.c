@@ -0,0 +1,800 @@
+#include "mock.h"
+#include "../gl.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the rest of the constants we need, which aren't in gl.h because the plugin library never uses them
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+#define GL_NONE 0
+#define GL_DRAW_FRAMEBUFFER_BINDING 36006
+#define GL_READ_FRAMEBUFFER_BINDING 36010
+#define GL_CURRENT_PROGRAM 35725
+#define GL_ALREADY_SIGNALED 37146
+
+// maximum number of attached shaders, and number of indexed uniform buffer binding points
+#define MOCK_MAX_SHADERS 4
+#define MOCK_UNIFORM_BINDINGS 64
+
+// a uniform or uniform block which has been looked up in a program. its index in the program's
+// list is used as its location, its block index, and its uniform index.
+struct MockUniform {
+    char* name;
+    int ivalues[4];
+    float fvalues[16];
+    uint8_t ivalue_count; // how many values the uniform has, which depends on which glUniform
+    uint8_t fvalue_count; // function last set it, since there's no shader compiler to tell us
+    unsigned int block_binding;
+};
+
+enum MockObjectType {
+    MOCK_NONE,
+    MOCK_TEXTURE,
+    MOCK_BUFFER,
+    MOCK_SHADER,
+    MOCK_PROGRAM,
+    MOCK_FRAMEBUFFER,
+    MOCK_VERTEXARRAY,
+};
+
+// all GL objects share one namespace here, since it makes no difference to the caller whether two
+// objects of different types can have the same name, and it means we only need one lookup table.
+struct MockObject {
+    enum MockObjectType type;
+
+    // buffers
+    uint8_t* data;
+    uintptr_t size;
+
+    // shaders, and programs after linking
+    char* source;
+
+    // programs
+    unsigned int shaders[MOCK_MAX_SHADERS];
+    struct MockUniform* uniforms;
+    unsigned int uniform_count;
+
+    // framebuffers
+    unsigned int colour_attachment;
+
+    // vertex arrays
+    unsigned int element_buffer;
+};
+
+// the mock doesn't distinguish between contexts, so all state is global and protected by `lock`
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct MockObject* objects = NULL;
+static unsigned int object_capacity = 0;
+static unsigned int next_name = 1;
+
+static unsigned int active_texture = GL_TEXTURE0;
+static unsigned int current_program = 0;
+static unsigned int vertex_array = 0;
+static unsigned int draw_framebuffer = 0;
+static unsigned int read_framebuffer = 0;
+static unsigned int array_buffer = 0;
+static unsigned int element_buffer = 0;
+static unsigned int uniform_buffer = 0;
+static unsigned int copy_read_buffer = 0;
+static unsigned int other_buffer = 0;
+static unsigned int uniform_bindings[MOCK_UNIFORM_BINDINGS] = {0};
+
+// allocates n new object names of the given type. must be called with the lock held.
+static void _bolt_mock_gen(enum MockObjectType type, uint32_t n, unsigned int* names) {
+    if (next_name + n > object_capacity) {
+        unsigned int new_capacity = object_capacity ? object_capacity : 256;
+        while (next_name + n > new_capacity) new_capacity *= 2;
+        objects = realloc(objects, new_capacity * sizeof(*objects));
+        memset(objects + object_capacity, 0, (new_capacity - object_capacity) * sizeof(*objects));
+        object_capacity = new_capacity;
+    }
+    for (uint32_t i = 0; i < n; i += 1) {
+        objects[next_name].type = type;
+        if (names) names[i] = next_name;
+        next_name += 1;
+    }
+}
+
+// returns the object with this name if it exists and is of this type, otherwise NULL. must be
+// called with the lock held.
+static struct MockObject* _bolt_mock_get(unsigned int name, enum MockObjectType type) {
+    if (name == 0 || name >= next_name || objects[name].type != type) return NULL;
+    return &objects[name];
+}
+
+// must be called with the lock held
+static void _bolt_mock_delete(unsigned int name) {
+    if (name == 0 || name >= next_name) return;
+    struct MockObject* object = &objects[name];
+    for (unsigned int i = 0; i < object->uniform_count; i += 1) free(object->uniforms[i].name);
+    free(object->uniforms);
+    free(object->data);
+    free(object->source);
+    memset(object, 0, sizeof(*object));
+}
+
+// returns the binding point for a buffer target. element array bindings are part of the vertex
+// array's state, like in real GL. must be called with the lock held.
+static unsigned int* _bolt_mock_buffer_binding(uint32_t target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return &array_buffer;
+        case GL_ELEMENT_ARRAY_BUFFER: {
+            struct MockObject* vao = _bolt_mock_get(vertex_array, MOCK_VERTEXARRAY);
+            return vao ? &vao->element_buffer : &element_buffer;
+        }
+        case GL_UNIFORM_BUFFER:
+            return &uniform_buffer;
+        case GL_COPY_READ_BUFFER:
+            return &copy_read_buffer;
+        default:
+            return &other_buffer;
+    }
+}
+
+// must be called with the lock held
+static struct MockObject* _bolt_mock_bound_buffer(uint32_t target) {
+    return _bolt_mock_get(*_bolt_mock_buffer_binding(target), MOCK_BUFFER);
+}
+
+// returns the uniform with this name in a linked program, adding it to the program's list if it
+// hasn't been looked up before, or NULL if it doesn't appear in the program's shader source. must
+// be called with the lock held.
+static struct MockUniform* _bolt_mock_uniform(struct MockObject* program, const char* name, unsigned int* index) {
+    if (!program || !program->source || !strstr(program->source, name)) return NULL;
+    for (unsigned int i = 0; i < program->uniform_count; i += 1) {
+        if (!strcmp(program->uniforms[i].name, name)) {
+            *index = i;
+            return &program->uniforms[i];
+        }
+    }
+    program->uniforms = realloc(program->uniforms, (program->uniform_count + 1) * sizeof(*program->uniforms));
+    struct MockUniform* uniform = &program->uniforms[program->uniform_count];
+    memset(uniform, 0, sizeof(*uniform));
+    uniform->name = strdup(name);
+    *index = program->uniform_count;
+    program->uniform_count += 1;
+    return uniform;
+}
+
+// returns the uniform at this location in the current program, or NULL. must be called with the
+// lock held.
+static struct MockUniform* _bolt_mock_uniform_at(int location) {
+    struct MockObject* program = _bolt_mock_get(current_program, MOCK_PROGRAM);
+    if (!program || location < 0 || (unsigned int)location >= program->uniform_count) return NULL;
+    return &program->uniforms[location];
+}
+
+// must be called with the lock held
+static void _bolt_mock_buffer_store(struct MockObject* buffer, uintptr_t size, const void* data) {
+    if (!buffer) return;
+    free(buffer->data);
+    buffer->data = calloc(size ? size : 1, 1);
+    buffer->size = size;
+    if (data) memcpy(buffer->data, data, size);
+}
+
+static void _bolt_mock_glActiveTexture(uint32_t texture) {
+    pthread_mutex_lock(&lock);
+    active_texture = texture;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glAttachShader(unsigned int program, unsigned int shader) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    if (p) {
+        for (size_t i = 0; i < MOCK_MAX_SHADERS; i += 1) {
+            if (!p->shaders[i]) {
+                p->shaders[i] = shader;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBindAttribLocation(unsigned int program, unsigned int index, const char* name) {}
+
+static void _bolt_mock_glBindBuffer(uint32_t target, unsigned int buffer) {
+    pthread_mutex_lock(&lock);
+    *_bolt_mock_buffer_binding(target) = buffer;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBindBufferBase(uint32_t target, unsigned int index, unsigned int buffer) {
+    pthread_mutex_lock(&lock);
+    *_bolt_mock_buffer_binding(target) = buffer;
+    if (target == GL_UNIFORM_BUFFER && index < MOCK_UNIFORM_BINDINGS) uniform_bindings[index] = buffer;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBindBufferRange(uint32_t target, unsigned int index, unsigned int buffer, intptr_t offset, uintptr_t size) {
+    _bolt_mock_glBindBufferBase(target, index, buffer);
+}
+
+static void _bolt_mock_glBindFramebuffer(uint32_t target, unsigned int framebuffer) {
+    pthread_mutex_lock(&lock);
+    if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) draw_framebuffer = framebuffer;
+    if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER) read_framebuffer = framebuffer;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBindTexture(uint32_t target, unsigned int texture) {}
+
+static void _bolt_mock_glBindVertexArray(uint32_t array) {
+    pthread_mutex_lock(&lock);
+    vertex_array = array;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBlitFramebuffer(int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0, int dstX1, int dstY1, uint32_t mask, uint32_t filter) {}
+
+static void _bolt_mock_glBufferData(uint32_t target, uintptr_t size, const void* data, uint32_t usage) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_buffer_store(_bolt_mock_bound_buffer(target), size, data);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBufferStorage(unsigned int target, uintptr_t size, const void* data, uintptr_t flags) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_buffer_store(_bolt_mock_bound_buffer(target), size, data);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glBufferSubData(uint32_t target, intptr_t offset, uintptr_t size, const void* data) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* buffer = _bolt_mock_bound_buffer(target);
+    if (buffer && offset >= 0 && offset + size <= buffer->size) memcpy(buffer->data + offset, data, size);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glClear(uint32_t mask) {}
+
+// nothing is ever in flight, so fences are always signalled. the pointer only needs to be non-NULL.
+static uint32_t _bolt_mock_glClientWaitSync(void* sync, uint32_t flags, uint64_t timeout) {
+    return GL_ALREADY_SIGNALED;
+}
+
+static void _bolt_mock_glClearColor(float r, float g, float b, float a) {}
+
+static void _bolt_mock_glCompileShader(unsigned int shader) {}
+
+static void _bolt_mock_glCompressedTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, unsigned int imageSize, const void* data) {}
+
+static void _bolt_mock_glCopyImageSubData(unsigned int srcName, uint32_t srcTarget, int srcLevel, int srcX, int srcY, int srcZ,
+                                          unsigned int dstName, uint32_t dstTarget, int dstLevel, int dstX, int dstY, int dstZ,
+                                          unsigned int srcWidth, unsigned int srcHeight, unsigned int srcDepth) {}
+
+static unsigned int _bolt_mock_glCreateProgram() {
+    unsigned int name;
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_PROGRAM, 1, &name);
+    pthread_mutex_unlock(&lock);
+    return name;
+}
+
+static unsigned int _bolt_mock_glCreateShader(uint32_t type) {
+    unsigned int name;
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_SHADER, 1, &name);
+    pthread_mutex_unlock(&lock);
+    return name;
+}
+
+static void _bolt_mock_glDeleteBuffers(unsigned int n, const unsigned int* buffers) {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < n; i += 1) {
+        if (_bolt_mock_get(buffers[i], MOCK_BUFFER)) _bolt_mock_delete(buffers[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDeleteFramebuffers(uint32_t n, unsigned int* framebuffers) {
+    pthread_mutex_lock(&lock);
+    for (uint32_t i = 0; i < n; i += 1) {
+        if (_bolt_mock_get(framebuffers[i], MOCK_FRAMEBUFFER)) _bolt_mock_delete(framebuffers[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDeleteProgram(unsigned int program) {
+    pthread_mutex_lock(&lock);
+    if (_bolt_mock_get(program, MOCK_PROGRAM)) _bolt_mock_delete(program);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDeleteShader(unsigned int shader) {
+    pthread_mutex_lock(&lock);
+    if (_bolt_mock_get(shader, MOCK_SHADER)) _bolt_mock_delete(shader);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDeleteSync(void* sync) {}
+
+static void _bolt_mock_glDeleteTextures(unsigned int n, const unsigned int* textures) {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < n; i += 1) {
+        if (_bolt_mock_get(textures[i], MOCK_TEXTURE)) _bolt_mock_delete(textures[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDeleteVertexArrays(uint32_t n, const unsigned int* arrays) {
+    pthread_mutex_lock(&lock);
+    for (uint32_t i = 0; i < n; i += 1) {
+        if (_bolt_mock_get(arrays[i], MOCK_VERTEXARRAY)) _bolt_mock_delete(arrays[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glDisableVertexAttribArray(unsigned int index) {}
+
+static void _bolt_mock_glDrawArrays(uint32_t mode, int first, unsigned int count) {}
+
+static void _bolt_mock_glDrawElements(uint32_t mode, unsigned int count, uint32_t type, const void* indices_offset) {}
+
+static void _bolt_mock_glEnableVertexAttribArray(unsigned int index) {}
+
+static void* _bolt_mock_glFenceSync(uint32_t condition, uint32_t flags) {
+    return &lock;
+}
+
+static void _bolt_mock_glFlush() {}
+
+static void _bolt_mock_glFlushMappedBufferRange(uint32_t target, intptr_t offset, uintptr_t length) {}
+
+static void _bolt_mock_glFramebufferRenderbuffer(uint32_t target, uint32_t attachment, uint32_t renderbuffertarget, unsigned int renderbuffer) {}
+
+static void _bolt_mock_glFramebufferTexture(uint32_t target, uint32_t attachment, unsigned int texture, int level) {
+    if (attachment != GL_COLOR_ATTACHMENT0) return;
+    pthread_mutex_lock(&lock);
+    struct MockObject* fb = _bolt_mock_get(target == GL_READ_FRAMEBUFFER ? read_framebuffer : draw_framebuffer, MOCK_FRAMEBUFFER);
+    if (fb) fb->colour_attachment = texture;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glFramebufferTexture2D(uint32_t target, uint32_t attachment, uint32_t textarget, unsigned int texture, int level) {
+    _bolt_mock_glFramebufferTexture(target, attachment, texture, level);
+}
+
+static void _bolt_mock_glFramebufferTextureLayer(uint32_t target, uint32_t attachment, unsigned int texture, int level, int layer) {
+    _bolt_mock_glFramebufferTexture(target, attachment, texture, level);
+}
+
+static void _bolt_mock_glGenBuffers(uint32_t n, unsigned int* buffers) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_BUFFER, n, buffers);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGenFramebuffers(uint32_t n, unsigned int* framebuffers) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_FRAMEBUFFER, n, framebuffers);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGenTextures(uint32_t n, unsigned int* textures) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_TEXTURE, n, textures);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGenVertexArrays(uint32_t n, unsigned int* arrays) {
+    pthread_mutex_lock(&lock);
+    _bolt_mock_gen(MOCK_VERTEXARRAY, n, arrays);
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetActiveUniformBlockiv(unsigned int program, unsigned int uniformBlockIndex, uint32_t pname, int* params) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    *params = 0;
+    if (p && pname == GL_UNIFORM_BLOCK_BINDING && uniformBlockIndex < p->uniform_count) {
+        *params = p->uniforms[uniformBlockIndex].block_binding;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetActiveUniformsiv(unsigned int program, uint32_t uniformCount, const unsigned int* uniformIndices, uint32_t pname, int* params) {
+    // there's no real block layout, so each uniform gets enough space for a 4x4 float matrix
+    for (uint32_t i = 0; i < uniformCount; i += 1) {
+        params[i] = (pname == GL_UNIFORM_OFFSET) ? (int)(i * 16 * sizeof(float)) : 0;
+    }
+}
+
+static void _bolt_mock_glGetBufferSubData(uint32_t target, intptr_t offset, uintptr_t size, void* data) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* buffer = _bolt_mock_bound_buffer(target);
+    if (buffer && offset >= 0 && offset + size <= buffer->size) memcpy(data, buffer->data + offset, size);
+    pthread_mutex_unlock(&lock);
+}
+
+static uint32_t _bolt_mock_glGetError() {
+    return 0;
+}
+
+static void _bolt_mock_glGetFramebufferAttachmentParameteriv(uint32_t target, uint32_t attachment, uint32_t pname, int* params) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* fb = _bolt_mock_get(target == GL_READ_FRAMEBUFFER ? read_framebuffer : draw_framebuffer, MOCK_FRAMEBUFFER);
+    const unsigned int texture = (fb && attachment == GL_COLOR_ATTACHMENT0) ? fb->colour_attachment : 0;
+    switch (pname) {
+        case GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME:
+            *params = texture;
+            break;
+        case GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE:
+            *params = texture ? GL_TEXTURE : GL_NONE;
+            break;
+        default:
+            *params = 0;
+            break;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetIntegeri_v(uint32_t target, unsigned int index, int* data) {
+    pthread_mutex_lock(&lock);
+    *data = (target == GL_UNIFORM_BUFFER_BINDING && index < MOCK_UNIFORM_BINDINGS) ? uniform_bindings[index] : 0;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetIntegerv(uint32_t pname, int* data) {
+    pthread_mutex_lock(&lock);
+    switch (pname) {
+        case GL_ACTIVE_TEXTURE:
+            *data = active_texture;
+            break;
+        case GL_CURRENT_PROGRAM:
+            *data = current_program;
+            break;
+        case GL_VERTEX_ARRAY_BINDING:
+            *data = vertex_array;
+            break;
+        case GL_DRAW_FRAMEBUFFER_BINDING:
+            *data = draw_framebuffer;
+            break;
+        case GL_READ_FRAMEBUFFER_BINDING:
+            *data = read_framebuffer;
+            break;
+        case GL_ARRAY_BUFFER_BINDING:
+            *data = *_bolt_mock_buffer_binding(GL_ARRAY_BUFFER);
+            break;
+        case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+            *data = *_bolt_mock_buffer_binding(GL_ELEMENT_ARRAY_BUFFER);
+            break;
+        case GL_UNIFORM_BUFFER_BINDING:
+            *data = *_bolt_mock_buffer_binding(GL_UNIFORM_BUFFER);
+            break;
+        case GL_COPY_READ_BUFFER_BINDING:
+            *data = *_bolt_mock_buffer_binding(GL_COPY_READ_BUFFER);
+            break;
+        default:
+            *data = 0;
+            break;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static unsigned int _bolt_mock_glGetUniformBlockIndex(uint32_t program, const char* uniformBlockName) {
+    unsigned int index = GL_INVALID_INDEX;
+    pthread_mutex_lock(&lock);
+    _bolt_mock_uniform(_bolt_mock_get(program, MOCK_PROGRAM), uniformBlockName, &index);
+    pthread_mutex_unlock(&lock);
+    return index;
+}
+
+static void _bolt_mock_glGetUniformfv(unsigned int program, int location, float* params) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    if (p && location >= 0 && (unsigned int)location < p->uniform_count) {
+        memcpy(params, p->uniforms[location].fvalues, p->uniforms[location].fvalue_count * sizeof(*params));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetUniformIndices(uint32_t program, uint32_t uniformCount, const char** uniformNames, unsigned int* uniformIndices) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    for (uint32_t i = 0; i < uniformCount; i += 1) {
+        uniformIndices[i] = GL_INVALID_INDEX;
+        _bolt_mock_uniform(p, uniformNames[i], &uniformIndices[i]);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glGetUniformiv(unsigned int program, int location, int* params) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    if (p && location >= 0 && (unsigned int)location < p->uniform_count) {
+        memcpy(params, p->uniforms[location].ivalues, p->uniforms[location].ivalue_count * sizeof(*params));
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static int _bolt_mock_glGetUniformLocation(unsigned int program, const char* name) {
+    unsigned int index = GL_INVALID_INDEX;
+    pthread_mutex_lock(&lock);
+    _bolt_mock_uniform(_bolt_mock_get(program, MOCK_PROGRAM), name, &index);
+    pthread_mutex_unlock(&lock);
+    return index == GL_INVALID_INDEX ? -1 : (int)index;
+}
+
+static void _bolt_mock_glLinkProgram(unsigned int program) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    if (p) {
+        // the program's source is the concatenation of its shaders' sources, which is what
+        // uniforms are looked up in
+        size_t length = 0;
+        for (size_t i = 0; i < MOCK_MAX_SHADERS; i += 1) {
+            struct MockObject* shader = _bolt_mock_get(p->shaders[i], MOCK_SHADER);
+            if (shader && shader->source) length += strlen(shader->source);
+        }
+        free(p->source);
+        p->source = calloc(length + 1, 1);
+        for (size_t i = 0; i < MOCK_MAX_SHADERS; i += 1) {
+            struct MockObject* shader = _bolt_mock_get(p->shaders[i], MOCK_SHADER);
+            if (shader && shader->source) strcat(p->source, shader->source);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void* _bolt_mock_glMapBufferRange(uint32_t target, intptr_t offset, uintptr_t length, uint32_t access) {
+    void* ret = NULL;
+    pthread_mutex_lock(&lock);
+    struct MockObject* buffer = _bolt_mock_bound_buffer(target);
+    if (buffer && offset >= 0 && offset + length <= buffer->size) ret = buffer->data + offset;
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+static void _bolt_mock_glMultiDrawElements(uint32_t mode, uint32_t* count, uint32_t type, const void** indices, uint32_t drawcount) {}
+
+static void _bolt_mock_glShaderSource(unsigned int shader, uint32_t count, const char** string, const int* length) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* s = _bolt_mock_get(shader, MOCK_SHADER);
+    if (s) {
+        size_t total = 0;
+        for (uint32_t i = 0; i < count; i += 1) total += (length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+        free(s->source);
+        s->source = malloc(total + 1);
+        size_t offset = 0;
+        for (uint32_t i = 0; i < count; i += 1) {
+            const size_t len = (length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+            memcpy(s->source + offset, string[i], len);
+            offset += len;
+        }
+        s->source[total] = '\0';
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glTexParameteri(uint32_t target, uint32_t pname, int param) {}
+
+static void _bolt_mock_glTexStorage2D(uint32_t target, int levels, uint32_t internalformat, unsigned int width, unsigned int height) {}
+
+static void _bolt_mock_glTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, uint32_t type, const void* pixels) {}
+
+static void _bolt_mock_glUniform1i(int location, int v0) {
+    pthread_mutex_lock(&lock);
+    struct MockUniform* uniform = _bolt_mock_uniform_at(location);
+    if (uniform) {
+        uniform->ivalues[0] = v0;
+        uniform->ivalue_count = 1;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniform1iv(int location, unsigned int count, const int* value) {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < count; i += 1) {
+        struct MockUniform* uniform = _bolt_mock_uniform_at(location + i);
+        if (uniform) {
+            uniform->ivalues[0] = value[i];
+            uniform->ivalue_count = 1;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniform4f(int location, float v0, float v1, float v2, float v3) {
+    pthread_mutex_lock(&lock);
+    struct MockUniform* uniform = _bolt_mock_uniform_at(location);
+    if (uniform) {
+        uniform->fvalues[0] = v0;
+        uniform->fvalues[1] = v1;
+        uniform->fvalues[2] = v2;
+        uniform->fvalues[3] = v3;
+        uniform->fvalue_count = 4;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniform4fv(int location, unsigned int count, const float* value) {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < count; i += 1) {
+        struct MockUniform* uniform = _bolt_mock_uniform_at(location + i);
+        if (uniform) {
+            memcpy(uniform->fvalues, value + (i * 4), 4 * sizeof(*value));
+            uniform->fvalue_count = 4;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniform4i(int location, int v0, int v1, int v2, int v3) {
+    pthread_mutex_lock(&lock);
+    struct MockUniform* uniform = _bolt_mock_uniform_at(location);
+    if (uniform) {
+        uniform->ivalues[0] = v0;
+        uniform->ivalues[1] = v1;
+        uniform->ivalues[2] = v2;
+        uniform->ivalues[3] = v3;
+        uniform->ivalue_count = 4;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniformBlockBinding(unsigned int program, unsigned int uniformBlockIndex, unsigned int uniformBlockBinding) {
+    pthread_mutex_lock(&lock);
+    struct MockObject* p = _bolt_mock_get(program, MOCK_PROGRAM);
+    if (p && uniformBlockIndex < p->uniform_count) p->uniforms[uniformBlockIndex].block_binding = uniformBlockBinding;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glUniformMatrix4fv(int location, unsigned int count, uint8_t transpose, const float* value) {
+    pthread_mutex_lock(&lock);
+    for (unsigned int i = 0; i < count; i += 1) {
+        struct MockUniform* uniform = _bolt_mock_uniform_at(location + i);
+        if (uniform) {
+            memcpy(uniform->fvalues, value + (i * 16), 16 * sizeof(*value));
+            uniform->fvalue_count = 16;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static uint8_t _bolt_mock_glUnmapBuffer(uint32_t target) {
+    return 1;
+}
+
+static void _bolt_mock_glUseProgram(unsigned int program) {
+    pthread_mutex_lock(&lock);
+    current_program = program;
+    pthread_mutex_unlock(&lock);
+}
+
+static void _bolt_mock_glVertexAttribPointer(unsigned int index, int size, uint32_t type, uint8_t normalised, unsigned int stride, const void* pointer) {}
+
+static void _bolt_mock_glViewport(int x, int y, unsigned int width, unsigned int height) {}
+
+void* _bolt_mock_gl_get_proc_address(const char* name) {
+#define MOCK_GL_FUNC(NAME) if (!strcmp(name, "gl"#NAME)) return _bolt_mock_gl##NAME;
+    MOCK_GL_FUNC(ActiveTexture)
+    MOCK_GL_FUNC(AttachShader)
+    MOCK_GL_FUNC(BindAttribLocation)
+    MOCK_GL_FUNC(BindBuffer)
+    MOCK_GL_FUNC(BindBufferBase)
+    MOCK_GL_FUNC(BindBufferRange)
+    MOCK_GL_FUNC(BindFramebuffer)
+    MOCK_GL_FUNC(BindTexture)
+    MOCK_GL_FUNC(BindVertexArray)
+    MOCK_GL_FUNC(BlitFramebuffer)
+    MOCK_GL_FUNC(BufferData)
+    MOCK_GL_FUNC(BufferStorage)
+    MOCK_GL_FUNC(BufferSubData)
+    MOCK_GL_FUNC(Clear)
+    MOCK_GL_FUNC(ClearColor)
+    MOCK_GL_FUNC(ClientWaitSync)
+    MOCK_GL_FUNC(CompileShader)
+    MOCK_GL_FUNC(CompressedTexSubImage2D)
+    MOCK_GL_FUNC(CopyImageSubData)
+    MOCK_GL_FUNC(CreateProgram)
+    MOCK_GL_FUNC(CreateShader)
+    MOCK_GL_FUNC(DeleteBuffers)
+    MOCK_GL_FUNC(DeleteFramebuffers)
+    MOCK_GL_FUNC(DeleteProgram)
+    MOCK_GL_FUNC(DeleteShader)
+    MOCK_GL_FUNC(DeleteSync)
+    MOCK_GL_FUNC(DeleteTextures)
+    MOCK_GL_FUNC(DeleteVertexArrays)
+    MOCK_GL_FUNC(DisableVertexAttribArray)
+    MOCK_GL_FUNC(DrawArrays)
+    MOCK_GL_FUNC(DrawElements)
+    MOCK_GL_FUNC(EnableVertexAttribArray)
+    MOCK_GL_FUNC(FenceSync)
+    MOCK_GL_FUNC(Flush)
+    MOCK_GL_FUNC(FlushMappedBufferRange)
+    MOCK_GL_FUNC(FramebufferRenderbuffer)
+    MOCK_GL_FUNC(FramebufferTexture)
+    MOCK_GL_FUNC(FramebufferTexture2D)
+    MOCK_GL_FUNC(FramebufferTextureLayer)
+    MOCK_GL_FUNC(GenBuffers)
+    MOCK_GL_FUNC(GenFramebuffers)
+    MOCK_GL_FUNC(GenTextures)
+    MOCK_GL_FUNC(GenVertexArrays)
+    MOCK_GL_FUNC(GetActiveUniformBlockiv)
+    MOCK_GL_FUNC(GetActiveUniformsiv)
+    MOCK_GL_FUNC(GetBufferSubData)
+    MOCK_GL_FUNC(GetError)
+    MOCK_GL_FUNC(GetFramebufferAttachmentParameteriv)
+    MOCK_GL_FUNC(GetIntegeri_v)
+    MOCK_GL_FUNC(GetIntegerv)
+    MOCK_GL_FUNC(GetUniformBlockIndex)
+    MOCK_GL_FUNC(GetUniformfv)
+    MOCK_GL_FUNC(GetUniformIndices)
+    MOCK_GL_FUNC(GetUniformiv)
+    MOCK_GL_FUNC(GetUniformLocation)
+    MOCK_GL_FUNC(LinkProgram)
+    MOCK_GL_FUNC(MapBufferRange)
+    MOCK_GL_FUNC(MultiDrawElements)
+    MOCK_GL_FUNC(ShaderSource)
+    MOCK_GL_FUNC(TexParameteri)
+    MOCK_GL_FUNC(TexStorage2D)
+    MOCK_GL_FUNC(TexSubImage2D)
+    MOCK_GL_FUNC(Uniform1i)
+    MOCK_GL_FUNC(Uniform1iv)
+    MOCK_GL_FUNC(Uniform4f)
+    MOCK_GL_FUNC(Uniform4fv)
+    MOCK_GL_FUNC(Uniform4i)
+    MOCK_GL_FUNC(UniformBlockBinding)
+    MOCK_GL_FUNC(UniformMatrix4fv)
+    MOCK_GL_FUNC(UnmapBuffer)
+    MOCK_GL_FUNC(UseProgram)
+    MOCK_GL_FUNC(VertexAttribPointer)
+    MOCK_GL_FUNC(Viewport)
+#undef MOCK_GL_FUNC
+    return NULL;
+}
+
+// the functions the plugin library looks up from libGL directly rather than via eglGetProcAddress
+
+void glBindTexture(uint32_t target, unsigned int texture) {
+    _bolt_mock_glBindTexture(target, texture);
+}
+
+void glClear(uint32_t mask) {
+    _bolt_mock_glClear(mask);
+}
+
+void glClearColor(float r, float g, float b, float a) {
+    _bolt_mock_glClearColor(r, g, b, a);
+}
+
+void glDeleteTextures(unsigned int n, const unsigned int* textures) {
+    _bolt_mock_glDeleteTextures(n, textures);
+}
+
+void glDrawArrays(uint32_t mode, int first, unsigned int count) {
+    _bolt_mock_glDrawArrays(mode, first, count);
+}
+
+void glDrawElements(uint32_t mode, unsigned int count, uint32_t type, const void* indices_offset) {
+    _bolt_mock_glDrawElements(mode, count, type, indices_offset);
+}
+
+void glFlush() {
+    _bolt_mock_glFlush();
+}
+
+void glGenTextures(uint32_t n, unsigned int* textures) {
+    _bolt_mock_glGenTextures(n, textures);
+}
+
+uint32_t glGetError() {
+    return _bolt_mock_glGetError();
+}
+
+void glTexParameteri(uint32_t target, uint32_t pname, int param) {
+    _bolt_mock_glTexParameteri(target, pname, param);
+}
+
+void glTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, uint32_t type, const void* pixels) {
+    _bolt_mock_glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+void glViewport(int x, int y, unsigned int width, unsigned int height) {
+    _bolt_mock_glViewport(x, y, width, height);
+}
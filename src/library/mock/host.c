@@ -0,0 +1,91 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#undef _GNU_SOURCE
+
+#include "host.h"
+#include "../ipc.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static char runtime_dir[] = "/tmp/bolt-mock-XXXXXX";
+static char socket_path[sizeof(((struct sockaddr_un*)NULL)->sun_path)];
+static int listen_fd = -1;
+static int fd = -1;
+
+static void _bolt_mock_host_remove_dir() {
+    char path[sizeof(socket_path)];
+    unlink(socket_path);
+    snprintf(path, sizeof(path), "%s/bolt-launcher", runtime_dir);
+    rmdir(path);
+    rmdir(runtime_dir);
+}
+
+// not _bolt_ipc_send, since the plugin library has its own, and the two can't both be linked in
+static uint8_t _bolt_mock_host_send(const void* data, size_t len) {
+    while (len > 0) {
+        const ssize_t written = send(fd, data, len, 0);
+        if (written <= 0) return 1;
+        data = (const uint8_t*)data + written;
+        len -= written;
+    }
+    return 0;
+}
+
+uint8_t _bolt_mock_host_listen() {
+    if (!mkdtemp(runtime_dir)) {
+        printf("error: mkdtemp() error %i\n", errno);
+        return 1;
+    }
+    atexit(_bolt_mock_host_remove_dir);
+    setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/bolt-launcher", runtime_dir);
+    mkdir(addr.sun_path, 0700);
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/bolt-launcher/ipc-0", runtime_dir);
+    snprintf(socket_path, sizeof(socket_path), "%s", addr.sun_path);
+    listen_fd = socket(addr.sun_family, SOCK_STREAM, 0);
+    if (listen_fd == -1 || bind(listen_fd, (const struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(listen_fd, 1) == -1) {
+        printf("error: IPC listen error %i\n", errno);
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t _bolt_mock_host_accept(int timeout_ms) {
+    if (fd != -1) return 1;
+    if (listen_fd == -1) return 0;
+    struct pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+    if (poll(&pfd, 1, timeout_ms) != 1) return 0;
+    fd = accept(listen_fd, NULL, NULL);
+    return fd != -1;
+}
+
+uint8_t _bolt_mock_host_start_plugin(const char* id, const char* path, const char* main) {
+    // the library expects the path to have a trailing slash, which the launcher makes sure of
+    const size_t path_length = strlen(path);
+    const uint8_t add_slash = path_length == 0 || path[path_length - 1] != '/';
+    const struct BoltIPCMessageToClient message = {.message_type = IPC_MSG_STARTPLUGINS, .items = 1};
+    const uint32_t lengths[] = {strlen(id), path_length + add_slash, strlen(main)};
+    const struct BoltIPCPluginLimits limits = {0}; // the library's defaults
+    return _bolt_mock_host_send(&message, sizeof(message))
+        || _bolt_mock_host_send(lengths, sizeof(lengths))
+        || _bolt_mock_host_send(id, lengths[0])
+        || _bolt_mock_host_send(path, path_length)
+        || (add_slash && _bolt_mock_host_send("/", 1))
+        || _bolt_mock_host_send(main, lengths[2])
+        || _bolt_mock_host_send(&limits, sizeof(limits));
+}
+
+void _bolt_mock_host_close() {
+    if (fd != -1) close(fd);
+    if (listen_fd != -1) close(listen_fd);
+    fd = -1;
+    listen_fd = -1;
+}
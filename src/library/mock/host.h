@@ -0,0 +1,27 @@
+#ifndef _BOLT_LIBRARY_MOCK_HOST_H_
+#define _BOLT_LIBRARY_MOCK_HOST_H_
+
+#include <stdint.h>
+
+// A stand-in for the launcher's end of the IPC channel, for programs which run the plugin library
+// on the mock backend (see mock.h). These programs play the part of the game as well, so they
+// load the library into the same process instead of starting a separate one.
+
+/// Creates a temporary directory, points XDG_RUNTIME_DIR at it, and listens on the IPC socket in
+/// it. Must be called before the plugin library's main context is first made current, since that's
+/// when it connects. The directory is removed at exit. Returns zero on success or non-zero on failure.
+uint8_t _bolt_mock_host_listen();
+
+/// Accepts the plugin library's connection if it's made one, waiting for up to `timeout_ms`.
+/// Returns 1 if it's connected, whether now or by a previous call, otherwise 0.
+uint8_t _bolt_mock_host_accept(int timeout_ms);
+
+/// Tells the plugin library to start a plugin, the same way the launcher does. `path` is the
+/// plugin's directory, and `main` is the name of its main file within that directory. Must only be
+/// called once connected. Returns zero on success or non-zero on failure.
+uint8_t _bolt_mock_host_start_plugin(const char* id, const char* path, const char* main);
+
+/// Closes the connection and the listening socket.
+void _bolt_mock_host_close();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _BOLT_LIBRARY_MOCK_H_
+#define _BOLT_LIBRARY_MOCK_H_
+
+// The mock backend is a set of three stand-in libraries, named libEGL.so.1, libGL.so.1 and
+// libxcb.so.1, which implement only the entrypoints the plugin library hooks or calls. Putting
+// their directory at the front of LD_LIBRARY_PATH lets the plugin library be loaded and driven
+// on a machine with no display or GPU. They keep just enough state that everything the plugin
+// library reads back from GL (buffer contents, mappings, bindings, uniforms, framebuffer
+// attachments) is consistent with what it previously wrote. Nothing is ever drawn.
+
+/// Looks up a GL function by name, including "gl" prefix. This is exported by the mock libGL and
+/// used by the mock libEGL's eglGetProcAddress, which is why it's not named like a GL function:
+/// the plugin library exports its own glX and eglX symbols which would take precedence over ours.
+void* _bolt_mock_gl_get_proc_address(const char* name);
+
+#endif
@@ -0,0 +1,182 @@
+-- Plugin started by bolt-mock-test (see ../test.c). It checks every 2D batch, 3D render and
+-- minimap it receives against what bolt-mock-test draws each frame, and that each frame has at most
+-- one of each. It also uses surfaces every frame, including ones loaded from icon.png. Any mismatch
+-- prints a line starting "mock plugin failed", which ctest looks for, and then raises a Lua error.
+-- Once enough of everything has been checked, it prints the line ctest is looking for.
+
+local bolt = require("bolt")
+bolt.checkversion(1, 0)
+
+local eventsneeded = 10
+
+-- each index of the quad's element buffer {0, 1, 2, 2, 1, 3}, as seen by the plugin
+local corners = {1, 2, 3, 3, 2, 4}
+local cornerxy = {{100, 200}, {164, 200}, {100, 264}, {164, 264}}
+local corneruv = {{0, 0}, {1, 0}, {0, 1}, {1, 1}}
+local colour = {0.25, 0.5, 0.75, 1.0}
+
+-- the 3D triangle, which is drawn with a model matrix that moves it to (1000, 0, 2000)
+local trianglexyz = {{0, 0, 0}, {512, 0, 0}, {0, 0, 512}}
+local triangleuv = {{0, 0}, {1, 0}, {0, 1}}
+local trianglemeta = (2 * 65536) + 1
+
+-- size of icon.png
+local iconwidth = 8
+local iconheight = 4
+
+local function fail (message)
+  print("mock plugin failed: " .. message)
+  error(message, 0)
+end
+
+local function check (what, actual, expected)
+  if actual ~= expected then
+    fail(string.format("%s: expected %s, got %s", what, tostring(expected), tostring(actual)))
+  end
+end
+
+local checked = {batch2d = 0, render3d = 0, minimap = 0, surface = 0}
+local thisframe = {batch2d = 0, render3d = 0, minimap = 0}
+local frames = 0
+local finished = false
+
+bolt.setcallback2d(function (event)
+  thisframe.batch2d = thisframe.batch2d + 1
+  check("vertexcount", event:vertexcount(), 6)
+  check("verticesperimage", event:verticesperimage(), 6)
+  check("isminimap", event:isminimap(), false)
+  local w, h = event:targetsize()
+  check("target width", w, 1280)
+  check("target height", h, 720)
+  local tw, th = event:texturesize()
+  check("texture width", tw, 256)
+  check("texture height", th, 256)
+
+  local vertices = event:vertices()
+  for i, corner in ipairs(corners) do
+    local x, y = event:vertexxy(i)
+    check("vertex " .. i .. " x", x, cornerxy[corner][1])
+    check("vertex " .. i .. " y", y, cornerxy[corner][2])
+    local u, v = event:vertexuv(i)
+    check("vertex " .. i .. " u", u, corneruv[corner][1])
+    check("vertex " .. i .. " v", v, corneruv[corner][2])
+    local ax, ay = event:vertexatlasxy(i)
+    check("vertex " .. i .. " atlas x", ax, 64)
+    check("vertex " .. i .. " atlas y", ay, 128)
+    local aw, ah = event:vertexatlaswh(i)
+    check("vertex " .. i .. " atlas w", aw, 32)
+    check("vertex " .. i .. " atlas h", ah, 64)
+
+    -- vertices() should agree with the per-vertex functions
+    check("vertices() " .. i .. " x", vertices.xy[(i * 2) - 1], x)
+    check("vertices() " .. i .. " y", vertices.xy[i * 2], y)
+    check("vertices() " .. i .. " atlas x", vertices.atlasxy[(i * 2) - 1], ax)
+    check("vertices() " .. i .. " atlas w", vertices.atlaswh[(i * 2) - 1], aw)
+    check("vertices() " .. i .. " u", vertices.uv[(i * 2) - 1], u)
+    for c = 1, 4 do
+      check("vertices() " .. i .. " colour " .. c, vertices.colour[((i - 1) * 4) + c], colour[c])
+    end
+  end
+  checked.batch2d = checked.batch2d + 1
+end)
+
+bolt.setcallback3d(function (event)
+  thisframe.render3d = thisframe.render3d + 1
+  check("3d vertexcount", event:vertexcount(), 3)
+  local tw, th = event:texturesize()
+  check("3d texture width", tw, 1024)
+  check("3d texture height", th, 1024)
+  local wx, wy, wz = event:worldposition()
+  check("3d world x", wx, 1000)
+  check("3d world y", wy, 0)
+  check("3d world z", wz, 2000)
+
+  -- uv and colour come from vertexarrays(), whose arrays start at 0
+  local arrays = event:vertexarrays()
+  for i, xyz in ipairs(trianglexyz) do
+    local x, y, z = event:vertexxyz(i)
+    check("3d vertex " .. i .. " x", x, xyz[1])
+    check("3d vertex " .. i .. " y", y, xyz[2])
+    check("3d vertex " .. i .. " z", z, xyz[3])
+    local tx, ty, tz = event:toworldspace(x, y, z)
+    check("3d vertex " .. i .. " world x", tx, xyz[1] + 1000)
+    check("3d vertex " .. i .. " world z", tz, xyz[3] + 2000)
+    local meta = event:vertexmeta(i)
+    check("3d vertex " .. i .. " meta", meta, trianglemeta)
+    local ax, ay, aw, ah = event:atlasxywh(meta)
+    check("3d vertex " .. i .. " atlas x", ax, 64)
+    check("3d vertex " .. i .. " atlas y", ay, 32)
+    check("3d vertex " .. i .. " atlas w", aw, 128)
+    check("3d vertex " .. i .. " atlas h", ah, 128)
+    check("3d vertexarrays() " .. i .. " u", arrays.uv[(i - 1) * 2], triangleuv[i][1])
+    check("3d vertexarrays() " .. i .. " v", arrays.uv[((i - 1) * 2) + 1], triangleuv[i][2])
+    for c = 1, 4 do
+      check("3d vertexarrays() " .. i .. " colour " .. c, arrays.colour[((i - 1) * 4) + c - 1], colour[c])
+    end
+  end
+  checked.render3d = checked.render3d + 1
+end)
+
+bolt.setcallbackminimap(function (event)
+  thisframe.minimap = thisframe.minimap + 1
+  check("minimap angle", event:angle(), 0)
+  check("minimap scale", event:scale(), 1)
+  local x, y = event:position()
+  check("minimap x", x, 3200)
+  check("minimap y", y, 6400)
+  checked.minimap = checked.minimap + 1
+end)
+
+-- surfaces: one drawn to the screen every frame, which has the icon drawn onto it first. drawing
+-- them mustn't look like the game drawing anything, so the event counts above can't change.
+local screensurface = bolt.createsurface(64, 64)
+local icon, w, h = bolt.createsurfacefrompng("icon")
+check("icon width", w, iconwidth)
+check("icon height", h, iconheight)
+-- the second load of the same file comes from the image cache, and has to give the same size
+local _, cw, ch = bolt.createsurfacefrompng("icon")
+check("cached icon width", cw, iconwidth)
+check("cached icon height", ch, iconheight)
+local ok = pcall(bolt.createsurfacefrompng, "missing")
+check("loading a missing png fails", ok, false)
+
+local asyncicon = nil
+bolt.createsurfacefrompngasync("icon", function (surface, width, height)
+  if not surface then fail("createsurfacefrompngasync: " .. tostring(width)) end
+  check("async icon width", width, iconwidth)
+  check("async icon height", height, iconheight)
+  asyncicon = surface
+end)
+
+local function drawsurfaces ()
+  screensurface:clear(0.25, 0.5, 0.75, 1.0)
+  icon:drawtosurface(screensurface, 0, 0, iconwidth, iconheight, 8, 8, iconwidth * 2, iconheight * 2)
+  if asyncicon then
+    asyncicon:drawtosurface(screensurface, 0, 0, iconwidth, iconheight, 32, 8, iconwidth, iconheight)
+  end
+  -- a short-lived surface, so that surfaces are freed as well as created while the game runs
+  local temporary = bolt.createsurfacefromrgba(2, 2, string.rep("\255\0\0\255", 4))
+  temporary:drawtosurface(screensurface, 0, 0, 2, 2, 0, 0, 4, 4)
+  screensurface:drawtoscreen(0, 0, 64, 64, 16, 16, 64, 64)
+  if asyncicon then checked.surface = checked.surface + 1 end
+end
+
+bolt.setcallbackswapbuffers(function (event)
+  frames = frames + 1
+  -- in threaded mode, a frame's events are dropped if the plugin thread is still busy, so a frame
+  -- can have none. it can never have more than the one of each that was drawn, though.
+  for kind, count in pairs(thisframe) do
+    if count > 1 then
+      fail(string.format("frame %d: expected at most 1 %s, got %d", frames, kind, count))
+    end
+    thisframe[kind] = 0
+  end
+  drawsurfaces()
+  if finished then return end
+  for _, count in pairs(checked) do
+    if count < eventsneeded then return end
+  end
+  finished = true
+  print(string.format("mock plugin ok: checked %d batches, %d renders, %d minimaps and %d surface frames in %d frames",
+    checked.batch2d, checked.render3d, checked.minimap, checked.surface, frames))
+end)
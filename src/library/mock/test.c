@@ -0,0 +1,395 @@
+// Runs the plugin library against the mock backend, the way the game would: it should be started
+// with libbolt-plugin.so in LD_PRELOAD and the mock directory at the front of LD_LIBRARY_PATH. This
+// stands in for the launcher too, serving the IPC socket the plugin library connects to and telling
+// it to start the plugin in the given directory. Then every frame it draws a minimap, a 3D triangle
+// into the game view and a 2D quad onto the screen, which the plugin checks (see plugin/main.lua).
+// Nothing here can tell whether the plugin was happy, so the plugin prints a line when it's finished
+// and ctest looks for that.
+// Usage: bolt-mock-test plugin-dir/ [frames]
+
+#include "host.h"
+#include "../gl.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// these are hooked by the plugin library, and otherwise provided by the mock libEGL and libGL
+void* eglGetDisplay(void* native_display);
+unsigned int eglInitialize(void* display, void* major, void* minor);
+void* eglCreateContext(void* display, void* config, void* share_context, const void* attrib_list);
+unsigned int eglMakeCurrent(void* display, void* draw, void* read, void* context);
+unsigned int eglSwapBuffers(void* display, void* surface);
+unsigned int eglDestroyContext(void* display, void* context);
+unsigned int eglTerminate(void* display);
+void* eglGetProcAddress(const char* name);
+void glGenTextures(uint32_t n, unsigned int* textures);
+void glBindTexture(uint32_t target, unsigned int texture);
+void glDrawArrays(uint32_t mode, int first, unsigned int count);
+void glDrawElements(uint32_t mode, unsigned int count, uint32_t type, const void* indices_offset);
+void glTexSubImage2D(uint32_t target, int level, int xoffset, int yoffset, unsigned int width, unsigned int height, uint32_t format, uint32_t type, const void* pixels);
+void glViewport(int x, int y, unsigned int width, unsigned int height);
+
+// size of the screen the 2D batch is drawn to, and of the texture it's drawn from
+#define SCREEN_WIDTH 1280
+#define SCREEN_HEIGHT 720
+#define ATLAS_SIZE 256
+
+// the 3D triangle's textures, and the size of the section of the screen the game view is drawn to
+#define ATLAS_3D_SIZE 1024
+#define SETTINGS_ATLAS_SIZE 64
+#define GAME_VIEW_WIDTH 1024
+#define GAME_VIEW_HEIGHT 640
+
+// the size the library expects the game's big minimap texture to be, and of the small one that's
+// drawn from it
+#define MINIMAP_BIG_SIZE 2048
+#define MINIMAP_SMALL_SIZE 256
+
+// the shaders are never compiled, but the library recognises what a program is for by its attribute
+// and uniform names, and the mock libGL looks uniforms up by searching the source
+static const char* source_2d = "uniform sampler2D uDiffuseMap; uniform mat4 uProjectionMatrix;";
+static const char* source_3d = "uniform sampler2D uTextureAtlas; uniform sampler2D uTextureAtlasSettings; uniform vec4 uAtlasMeta;"
+    "uniform mat4 uModelMatrix; uniform float uVertexScale; uniform ViewTransforms { vec3 uCameraPosition; mat4 uViewProjMatrix; };";
+static const char* source_minimap = "uniform mat4 uModelMatrix; uniform vec2 uGridSize;"
+    "uniform ViewTransforms { vec3 uCameraPosition; mat4 uViewProjMatrix; };";
+static const char* source_post = "uniform sampler2D sSceneHDRTex;";
+
+// one vertex of the 2D batch. the game passes colours as ABGR, which the library swaps back to RGBA.
+struct Vertex2D {
+    float xy[2];
+    float abgr[4];
+    float uv[2];
+    float atlas_min[2];
+    float atlas_extents[2];
+};
+
+// one vertex of a 2D draw from the big minimap texture, whose positions are integers
+struct VertexMinimap {
+    int16_t xy[2];
+    float abgr[4];
+    float uv[2];
+    float atlas_min[2];
+    float atlas_extents[2];
+};
+
+// one vertex of the 3D triangle
+struct Vertex3D {
+    float uv[2];
+    float abgr[4];
+    int16_t xyz_bone[4];
+    int16_t material_xy_tile_xz[4];
+};
+
+// a 64x64 quad at (100, 200), from the 32x64 region at (64, 128) in the atlas. the extents are
+// negative because the game's are. any change to these has to be made in plugin/main.lua too.
+static const struct Vertex2D vertices_2d[] = {
+    {{100.0f, 200.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {0.0f, 0.0f}, {0.25f, 0.5f}, {-0.125f, -0.25f}},
+    {{164.0f, 200.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {1.0f, 0.0f}, {0.25f, 0.5f}, {-0.125f, -0.25f}},
+    {{100.0f, 264.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {0.0f, 1.0f}, {0.25f, 0.5f}, {-0.125f, -0.25f}},
+    {{164.0f, 264.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {1.0f, 1.0f}, {0.25f, 0.5f}, {-0.125f, -0.25f}},
+};
+
+// the whole small minimap texture, from the unrotated 256x256 square in the middle of the big one.
+// that makes the minimap's scale 1 and its position the camera's.
+static const struct VertexMinimap vertices_minimap[] = {
+    {{0, 0}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.4375f, 0.4375f}, {0.0f, 0.0f}, {1.0f, 1.0f}},
+    {{MINIMAP_SMALL_SIZE, 0}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.5625f, 0.4375f}, {0.0f, 0.0f}, {1.0f, 1.0f}},
+    {{0, MINIMAP_SMALL_SIZE}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.4375f, 0.5625f}, {0.0f, 0.0f}, {1.0f, 1.0f}},
+    {{MINIMAP_SMALL_SIZE, MINIMAP_SMALL_SIZE}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.5625f, 0.5625f}, {0.0f, 0.0f}, {1.0f, 1.0f}},
+};
+
+// a triangle on the ground, using material slot (1, 2) of the settings atlas
+static const struct Vertex3D vertices_3d[] = {
+    {{0.0f, 0.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {0, 0, 0, 0}, {1, 2, 0, 0}},
+    {{1.0f, 0.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {512, 0, 0, 0}, {1, 2, 0, 0}},
+    {{0.0f, 1.0f}, {1.0f, 0.75f, 0.5f, 0.25f}, {0, 0, 512, 0}, {1, 2, 0, 0}},
+};
+
+static const uint16_t indices_quad[] = {0, 1, 2, 2, 1, 3};
+static const uint16_t indices_triangle[] = {0, 1, 2};
+
+// the ViewTransforms block: the mock lays each member out as if it were a mat4
+static const float view_transforms[32] = {
+    3200.0f, 0.0f, 6400.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+};
+static const float model_matrix[16] = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f,
+    1000.0f, 0.0f, 2000.0f, 1.0f,
+};
+
+static struct GLProcFunctions gl;
+
+// everything that's drawn each frame, and what it draws to
+static struct {
+    unsigned int program;
+    unsigned int vao;
+    unsigned int framebuffer;
+} draw_2d, draw_3d, draw_minimap, draw_minimap_2d;
+static unsigned int atlas_2d, atlas_3d, settings_atlas, minimap_big, minimap_small;
+
+static void load_functions() {
+#define PROC(NAME) gl.NAME = eglGetProcAddress("gl" #NAME);
+    PROC(ActiveTexture)
+    PROC(AttachShader)
+    PROC(BindAttribLocation)
+    PROC(BindBuffer)
+    PROC(BindBufferBase)
+    PROC(BindFramebuffer)
+    PROC(BindVertexArray)
+    PROC(BlitFramebuffer)
+    PROC(BufferData)
+    PROC(CompileShader)
+    PROC(CreateProgram)
+    PROC(CreateShader)
+    PROC(EnableVertexAttribArray)
+    PROC(FramebufferTexture2D)
+    PROC(GenBuffers)
+    PROC(GenFramebuffers)
+    PROC(GenVertexArrays)
+    PROC(GetUniformLocation)
+    PROC(LinkProgram)
+    PROC(ShaderSource)
+    PROC(TexStorage2D)
+    PROC(Uniform1i)
+    PROC(Uniform4f)
+    PROC(UniformMatrix4fv)
+    PROC(UseProgram)
+    PROC(VertexAttribPointer)
+#undef PROC
+}
+
+// creates and links a program from one source, with the given attributes bound in order
+static unsigned int create_program(const char* source, const char** attributes, unsigned int attribute_count) {
+    const unsigned int shaders[] = {gl.CreateShader(GL_VERTEX_SHADER), gl.CreateShader(GL_FRAGMENT_SHADER)};
+    const unsigned int program = gl.CreateProgram();
+    for (size_t i = 0; i < 2; i += 1) {
+        gl.ShaderSource(shaders[i], 1, &source, NULL);
+        gl.CompileShader(shaders[i]);
+        gl.AttachShader(program, shaders[i]);
+    }
+    for (unsigned int i = 0; i < attribute_count; i += 1) gl.BindAttribLocation(program, i, attributes[i]);
+    gl.LinkProgram(program);
+    return program;
+}
+
+static unsigned int create_texture(unsigned int width, unsigned int height) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    gl.TexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    return texture;
+}
+
+static unsigned int create_framebuffer(unsigned int texture) {
+    unsigned int framebuffer;
+    gl.GenFramebuffers(1, &framebuffer);
+    gl.BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    return framebuffer;
+}
+
+// creates a VAO with its own vertex and element buffers, leaving it and the vertex buffer bound
+static unsigned int create_vao(const void* vertices, uintptr_t vertices_size, const uint16_t* indices, uintptr_t indices_size) {
+    unsigned int vao;
+    unsigned int buffers[2];
+    gl.GenVertexArrays(1, &vao);
+    gl.BindVertexArray(vao);
+    gl.GenBuffers(2, buffers);
+    gl.BindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    gl.BufferData(GL_ARRAY_BUFFER, vertices_size, vertices, GL_STATIC_DRAW);
+    gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    gl.BufferData(GL_ELEMENT_ARRAY_BUFFER, indices_size, indices, GL_STATIC_DRAW);
+    return vao;
+}
+
+#define ATTRIB(INDEX, SIZE, TYPE, VERTEX, FIELD) \
+    gl.VertexAttribPointer(INDEX, SIZE, TYPE, 0, sizeof(struct VERTEX), (const void*)offsetof(struct VERTEX, FIELD)); \
+    gl.EnableVertexAttribArray(INDEX);
+
+static void setup_2d() {
+    const char* attributes[] = {"aVertexPosition2D", "aVertexColour", "aTextureUV", "aTextureUVAtlasMin", "aTextureUVAtlasExtents"};
+    draw_2d.program = create_program(source_2d, attributes, 5);
+    gl.UseProgram(draw_2d.program);
+    gl.Uniform1i(gl.GetUniformLocation(draw_2d.program, "uDiffuseMap"), 0);
+    draw_minimap_2d.program = draw_2d.program;
+
+    atlas_2d = create_texture(ATLAS_SIZE, ATLAS_SIZE);
+    draw_2d.framebuffer = 0;
+    draw_2d.vao = create_vao(vertices_2d, sizeof(vertices_2d), indices_quad, sizeof(indices_quad));
+    ATTRIB(0, 2, GL_FLOAT, Vertex2D, xy)
+    ATTRIB(1, 4, GL_FLOAT, Vertex2D, abgr)
+    ATTRIB(2, 2, GL_FLOAT, Vertex2D, uv)
+    ATTRIB(3, 2, GL_FLOAT, Vertex2D, atlas_min)
+    ATTRIB(4, 2, GL_FLOAT, Vertex2D, atlas_extents)
+}
+
+static void setup_minimap() {
+    draw_minimap.program = create_program(source_minimap, NULL, 0);
+    minimap_big = create_texture(MINIMAP_BIG_SIZE, MINIMAP_BIG_SIZE);
+    minimap_small = create_texture(MINIMAP_SMALL_SIZE, MINIMAP_SMALL_SIZE);
+    draw_minimap.framebuffer = create_framebuffer(minimap_big);
+    draw_minimap_2d.framebuffer = create_framebuffer(minimap_small);
+    draw_minimap_2d.vao = create_vao(vertices_minimap, sizeof(vertices_minimap), indices_quad, sizeof(indices_quad));
+    ATTRIB(0, 2, GL_SHORT, VertexMinimap, xy)
+    ATTRIB(1, 4, GL_FLOAT, VertexMinimap, abgr)
+    ATTRIB(2, 2, GL_FLOAT, VertexMinimap, uv)
+    ATTRIB(3, 2, GL_FLOAT, VertexMinimap, atlas_min)
+    ATTRIB(4, 2, GL_FLOAT, VertexMinimap, atlas_extents)
+}
+
+static void setup_3d() {
+    const char* attributes[] = {"aTextureUV", "aVertexColour", "aVertexPosition_BoneLabel", "aMaterialSettingsSlotXY_TilePositionXZ"};
+    draw_3d.program = create_program(source_3d, attributes, 4);
+    gl.UseProgram(draw_3d.program);
+    gl.Uniform1i(gl.GetUniformLocation(draw_3d.program, "uTextureAtlas"), 1);
+    gl.Uniform1i(gl.GetUniformLocation(draw_3d.program, "uTextureAtlasSettings"), 2);
+    gl.Uniform4f(gl.GetUniformLocation(draw_3d.program, "uAtlasMeta"), 0.0f, 4.0f, 0.0f, 0.0f);
+    gl.UniformMatrix4fv(gl.GetUniformLocation(draw_3d.program, "uModelMatrix"), 1, 0, model_matrix);
+
+    // material slot (1, 2) covers the 3x3 pixels at (3, 8) in the settings atlas. with an atlas
+    // scale of 4, this puts the material at (64, 32) in the atlas, 128 pixels square.
+    uint8_t settings[3 * 3 * 4] = {0};
+    settings[0] = 16;
+    settings[1] = 8;
+    settings[8] = 32;
+    atlas_3d = create_texture(ATLAS_3D_SIZE, ATLAS_3D_SIZE);
+    settings_atlas = create_texture(SETTINGS_ATLAS_SIZE, SETTINGS_ATLAS_SIZE);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 3, 8, 3, 3, GL_RGBA, GL_UNSIGNED_BYTE, settings);
+
+    unsigned int view_buffer;
+    gl.GenBuffers(1, &view_buffer);
+    gl.BindBufferBase(GL_UNIFORM_BUFFER, 0, view_buffer);
+    gl.BufferData(GL_UNIFORM_BUFFER, sizeof(view_transforms), view_transforms, GL_STATIC_DRAW);
+
+    draw_3d.vao = create_vao(vertices_3d, sizeof(vertices_3d), indices_triangle, sizeof(indices_triangle));
+    ATTRIB(0, 2, GL_FLOAT, Vertex3D, uv)
+    ATTRIB(1, 4, GL_FLOAT, Vertex3D, abgr)
+    ATTRIB(2, 4, GL_SHORT, Vertex3D, xyz_bone)
+    ATTRIB(3, 4, GL_SHORT, Vertex3D, material_xy_tile_xz)
+}
+
+#undef ATTRIB
+
+// goes through the same steps as the game does when the game view is resized, so that the library
+// finds out which texture the 3D scene is drawn to: the game view's framebuffer is blitted to the
+// screen, a post-processing pass draws the HDR scene texture into it, and the 3D scene is blitted
+// into the HDR scene texture.
+static void setup_game_view() {
+    const unsigned int scene_tex = create_texture(GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT);
+    const unsigned int hdr_tex = create_texture(GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT);
+    const unsigned int view_tex = create_texture(GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT);
+    draw_3d.framebuffer = create_framebuffer(scene_tex);
+    const unsigned int hdr_framebuffer = create_framebuffer(hdr_tex);
+    const unsigned int view_framebuffer = create_framebuffer(view_tex);
+
+    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, view_framebuffer);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    gl.BlitFramebuffer(0, 0, GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT, 0, 0, GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    const unsigned int post_program = create_program(source_post, NULL, 0);
+    gl.UseProgram(post_program);
+    gl.Uniform1i(gl.GetUniformLocation(post_program, "sSceneHDRTex"), 0);
+    gl.ActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdr_tex);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, view_framebuffer);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, draw_3d.framebuffer);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, hdr_framebuffer);
+    gl.BlitFramebuffer(0, 0, GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT, 0, 0, GAME_VIEW_WIDTH, GAME_VIEW_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+static void set_projection(unsigned int program, float width, float height) {
+    const float projection[16] = {
+        2.0f / width, 0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f / height, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        -1.0f, -1.0f, 0.0f, 1.0f,
+    };
+    gl.UniformMatrix4fv(gl.GetUniformLocation(program, "uProjectionMatrix"), 1, 0, projection);
+}
+
+static void draw_frame() {
+    // the minimap: the world map is drawn to the big texture, then part of it to the small one
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_minimap.framebuffer);
+    gl.UseProgram(draw_minimap.program);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_minimap_2d.framebuffer);
+    gl.UseProgram(draw_minimap_2d.program);
+    set_projection(draw_minimap_2d.program, MINIMAP_SMALL_SIZE, MINIMAP_SMALL_SIZE);
+    gl.ActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, minimap_big);
+    gl.BindVertexArray(draw_minimap_2d.vao);
+    glDrawElements(GL_TRIANGLES, sizeof(indices_quad) / sizeof(*indices_quad), GL_UNSIGNED_SHORT, NULL);
+
+    // the 3D scene
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_3d.framebuffer);
+    gl.UseProgram(draw_3d.program);
+    gl.ActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, atlas_3d);
+    gl.ActiveTexture(GL_TEXTURE0 + 2);
+    glBindTexture(GL_TEXTURE_2D, settings_atlas);
+    gl.BindVertexArray(draw_3d.vao);
+    glDrawElements(GL_TRIANGLES, sizeof(indices_triangle) / sizeof(*indices_triangle), GL_UNSIGNED_SHORT, NULL);
+
+    // the interface
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_2d.framebuffer);
+    gl.UseProgram(draw_2d.program);
+    set_projection(draw_2d.program, SCREEN_WIDTH, SCREEN_HEIGHT);
+    gl.ActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas_2d);
+    gl.BindVertexArray(draw_2d.vao);
+    glDrawElements(GL_TRIANGLES, sizeof(indices_quad) / sizeof(*indices_quad), GL_UNSIGNED_SHORT, NULL);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s plugin-dir/ [frames]\n", argv[0]);
+        return 1;
+    }
+    const int frames = (argc > 2) ? atoi(argv[2]) : 120;
+    if (_bolt_mock_host_listen()) return 1;
+
+    // like the game: the first context is only used for loading, and the plugin library starts up
+    // when the second one is first made current
+    void* display = eglGetDisplay(NULL);
+    eglInitialize(display, NULL, NULL);
+    void* loader_context = eglCreateContext(display, NULL, NULL, NULL);
+    void* main_context = eglCreateContext(display, NULL, NULL, NULL);
+    eglMakeCurrent(display, NULL, NULL, main_context);
+    if (!_bolt_mock_host_accept(5000)) {
+        printf("error: plugin library didn't connect to IPC, is it in LD_PRELOAD?\n");
+        return 1;
+    }
+    if (_bolt_mock_host_start_plugin("mock-test", argv[1], "main.lua")) {
+        printf("error: IPC send failed\n");
+        return 1;
+    }
+
+    load_functions();
+    setup_2d();
+    setup_minimap();
+    setup_3d();
+    setup_game_view();
+    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    const struct timespec frame_sleep = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (int i = 0; i < frames; i += 1) {
+        draw_frame();
+        eglSwapBuffers(display, NULL);
+        // gives plugin threads a chance to keep up, if BOLT_PLUGIN_THREADED is set
+        nanosleep(&frame_sleep, NULL);
+    }
+
+    // destroying the last context stops the plugins and frees everything the library made
+    eglDestroyContext(display, main_context);
+    eglDestroyContext(display, loader_context);
+    eglTerminate(display);
+    _bolt_mock_host_close();
+    printf("mock test finished %i frames\n", frames);
+    return 0;
+}
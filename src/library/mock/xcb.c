@@ -0,0 +1,39 @@
+#include "../so/x.h"
+
+#include <stdlib.h>
+
+// size reported for every window, since there's no real window to ask
+#define MOCK_WINDOW_WIDTH 1280
+#define MOCK_WINDOW_HEIGHT 720
+
+// there's never any input, so event polling always finds nothing. wait_for_event returning NULL
+// would normally mean the connection was lost, so anything calling that should expect to exit.
+
+xcb_generic_event_t* xcb_poll_for_event(xcb_connection_t* c) {
+    return NULL;
+}
+
+xcb_generic_event_t* xcb_poll_for_queued_event(xcb_connection_t* c) {
+    return NULL;
+}
+
+xcb_generic_event_t* xcb_wait_for_event(xcb_connection_t* c) {
+    return NULL;
+}
+
+xcb_get_geometry_cookie_t xcb_get_geometry(xcb_connection_t* c, xcb_drawable_t drawable) {
+    static unsigned int sequence = 0;
+    xcb_get_geometry_cookie_t cookie = {.sequence = __atomic_add_fetch(&sequence, 1, __ATOMIC_RELAXED)};
+    return cookie;
+}
+
+xcb_get_geometry_reply_t* xcb_get_geometry_reply(xcb_connection_t* c, xcb_get_geometry_cookie_t cookie, xcb_generic_error_t** e) {
+    // like the real thing, the caller frees the reply with free()
+    xcb_get_geometry_reply_t* reply = calloc(1, sizeof(*reply));
+    reply->response_type = 1;
+    reply->sequence = (uint16_t)cookie.sequence;
+    reply->width = MOCK_WINDOW_WIDTH;
+    reply->height = MOCK_WINDOW_HEIGHT;
+    if (e) *e = NULL;
+    return reply;
+}
@@ -2,6 +2,9 @@
 
 #include "plugin_api.h"
 #include "../ipc.h"
+#include "../imagecache/imagecache.h"
+#include "../thread/thread.h"
+#include "../trace/trace.h"
 #include "../../../modules/hashmap/hashmap.h"
 #include "../../../modules/spng/spng/spng.h"
 
@@ -17,6 +20,21 @@
 LARGE_INTEGER performance_frequency;
 #endif
 
+#if defined(_MSC_VER)
+#define thread_local __declspec(thread)
+#else
+#define thread_local _Thread_local
+#endif
+
+// relaxed atomic access to a size_t, for counters which one thread writes and others only poll
+#if defined(_MSC_VER)
+static size_t load_relaxed(const size_t* p) { return *(const volatile size_t*)p; }
+static void store_relaxed(size_t* p, size_t v) { *(volatile size_t*)p = v; }
+#else
+static size_t load_relaxed(const size_t* p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static void store_relaxed(size_t* p, size_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+#endif
+
 #define API_VERSION_MAJOR 1
 #define API_VERSION_MINOR 0
 
@@ -38,13 +56,26 @@ LARGE_INTEGER performance_frequency;
 #define MOUSEBUTTON_META_REGISTRYNAME "mousebuttonmeta"
 #define SCROLL_META_REGISTRYNAME "scrollmeta"
 #define WINDOW_META_REGISTRYNAME "windowmeta"
-#define SWAPBUFFERS_CB_REGISTRYNAME "swapbufferscb"
-#define BATCH2D_CB_REGISTRYNAME "batch2dcb"
-#define RENDER3D_CB_REGISTRYNAME "render3dcb"
-#define MINIMAP_CB_REGISTRYNAME "minimapcb"
-#define MOUSEMOTION_CB_REGISTRYNAME "mousemotioncb"
-#define MOUSEBUTTON_CB_REGISTRYNAME "mousebuttoncb"
-#define SCROLL_CB_REGISTRYNAME "scrollcb"
+#define FFI_REGISTRYNAME "ffi"
+
+// C declarations given to the FFI library of any plugin that uses vertex array views. These must
+// match Vertex2DArrays and Vertex3DArrays in plugin.h, except that the pointers are const.
+#define FFI_CDEFS \
+    "struct BoltVertex2DArrays { const int32_t* xy; const int32_t* atlasxy; const int32_t* atlaswh; const double* uv; const double* colour; };" \
+    "struct BoltVertex3DArrays { const int32_t* xyz; const uint32_t* meta; const double* uv; const double* colour; };"
+
+// types of userdata object passed to event callbacks, used as keys in the plugin's event object pool
+enum {
+    EVENT_OBJECT_SWAPBUFFERS,
+    EVENT_OBJECT_BATCH2D,
+    EVENT_OBJECT_RENDER3D,
+    EVENT_OBJECT_MINIMAP,
+    EVENT_OBJECT_RESIZE,
+    EVENT_OBJECT_MOUSEMOTION,
+    EVENT_OBJECT_MOUSEBUTTON,
+    EVENT_OBJECT_SCROLL,
+    EVENT_OBJECT_ENUM_SIZE, // last member of enum
+};
 
 enum {
     WINDOW_ONRESIZE,
@@ -90,17 +121,309 @@ struct Plugin {
     char* path;
     uint32_t id_length;
     uint32_t path_length;
+    struct PluginWorker* worker;
+
+    // references (from luaL_ref) to objects in this plugin's registry which are needed every time
+    // an event is sent to it, so that they can be fetched with lua_rawgeti instead of by name.
+    // any of these may be LUA_NOREF.
+    int callback_refs[PLUGIN_EVENT_ENUM_SIZE];
+    int event_meta_refs[EVENT_OBJECT_ENUM_SIZE];
+    int event_pool_ref;
+    int expired_event_meta_ref;
+
+    // time budget accounting (see _bolt_plugin_check_budget). all in microseconds.
+    struct BoltIPCPluginLimits limits; // none of these are 0 once the plugin has been added
+    uint64_t frame_number; // the worker's frame_number when this plugin last received an event
+    uint64_t frame_time; // total time spent in callbacks during that frame
+    uint64_t call_deadline; // time at which the current callback will be aborted, or 0 if none is running
+    uint32_t violations; // number of recent frames in a row where frame_time went over budget
+    uint32_t throttle_frames; // number of upcoming frames in which render events won't be sent
+
+    // profiling data since the last IPC_MSG_PLUGINPROFILE, indexed by PluginEventType, with window
+    // events at PLUGIN_EVENT_ENUM_SIZE
+    struct BoltIPCPluginProfile profile[IPC_PROFILE_CALLBACK_TYPES];
+};
+
+// threaded mode (see _bolt_plugin_init in plugin.h). each frame's events are written into a
+// SnapshotFrame as a series of records, each one being a SnapshotHeader followed by a payload, both
+// padded to a multiple of 8 bytes. records contain offsets instead of pointers, since the buffer can
+// be moved by realloc while the frame is being captured. input event types must come after all the
+// render event types in this enum, so that they can be kept when a frame's render events are dropped.
+enum SnapshotType {
+    SNAPSHOT_BATCH2D,
+    SNAPSHOT_RENDER3D,
+    SNAPSHOT_MINIMAP,
+    SNAPSHOT_MOUSEMOTION,
+    SNAPSHOT_MOUSEBUTTON,
+    SNAPSHOT_SCROLL,
+    SNAPSHOT_WINDOW_RESIZE,
+};
+
+struct SnapshotHeader {
+    uint32_t type;
+    uint32_t size; // of the whole record, including this header
+};
+
+struct SnapshotFrame {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+};
+
+enum SurfaceCommandType {
+    SURFACE_COMMAND_INIT,
+    SURFACE_COMMAND_DESTROY,
+    SURFACE_COMMAND_CLEAR,
+    SURFACE_COMMAND_DRAWTOSCREEN,
+    SURFACE_COMMAND_DRAWTOSURFACE,
+};
+
+// something a plugin did to a surface on the worker thread, which has to be carried out on the
+// render thread instead because it needs the GL context. for INIT, `target` is the SurfaceFunctions
+// struct to initialise, and the worker waits for it to be done before carrying on.
+struct SurfaceCommand {
+    enum SurfaceCommandType type;
+    struct SurfaceFunctions functions;
+    void* target;
+    double rgba[4];
+    int rect[8];
+    unsigned int width;
+    unsigned int height;
+    const void* data;
+    Signal* done; // INIT only, set once it's been carried out
+};
+
+struct SurfaceCommandList {
+    struct SurfaceCommand* commands;
+    size_t count;
+    size_t capacity;
+};
+
+// the plugins which currently have a callback set for one type of event, in the order they set it.
+// a plugin can set or unset its callback while an event of that type is being sent out, which
+// would break iteration of the list, so while `dispatch_depth` is non-zero, removed entries are
+// just set to NULL and then cleared out after the dispatch finishes.
+// the list is only ever changed by the thread of the worker it belongs to, but `live_count` is also
+// read by the render thread, so it's always accessed with load_relaxed and store_relaxed.
+struct SubscriberList {
+    struct Plugin** plugins;
+    size_t count;
+    size_t capacity;
+    size_t live_count;
+    uint32_t dispatch_depth;
+    uint8_t has_gaps;
+};
+
+// upper limit on the number of workers in threaded mode, regardless of how many CPUs there are
+#define PLUGIN_MAX_WORKERS 8
+
+// a thread which plugins run on. every plugin is pinned to one worker, which is the only thread that
+// ever uses its lua_State, so each worker has its own subscriber lists and scratch buffers. threaded
+// mode has a fixed-size pool of these, which all send the same frame to their own plugins at the
+// same time. worker 0 also takes frames from the render thread, hands them out to the rest of the
+// pool, and handles IPC messages once they've all finished. in non-threaded mode, every plugin
+// belongs to `main_worker`, which is the render thread.
+struct PluginWorker {
+    Thread thread;
+    Signal start_signal; // set when there's a frame for this worker, or when it should exit
+    Signal done_signal; // set by this worker when it's finished with a frame
+    Signal surface_init_signal; // set by the render thread after creating a surface for this worker
+    uint8_t stop;
+    size_t plugin_count;
+    uint64_t frame_number; // incremented after every SwapBuffers event sent by this worker
+    struct SubscriberList subscribers[PLUGIN_EVENT_ENUM_SIZE];
+    struct SurfaceCommandList surface_commands; // from the frame this worker is handling
+
+    // growable buffer holding the decoded vertex arrays for the most recent call to a `vertexarrays`
+    // function. only one event is ever being handled at a time per worker, so one buffer is enough.
+    uint8_t* vertex_arrays_buffer;
+    size_t vertex_arrays_buffer_size;
+
+    // same as above, for texture data read in threaded mode
+    uint8_t* texture_read_buffer;
+    size_t texture_read_buffer_size;
+};
+
+static struct PluginWorker main_worker;
+static struct PluginWorker* workers = NULL;
+static size_t worker_count = 0;
+static thread_local struct PluginWorker* current_worker = NULL; // NULL except on worker threads
+static struct SnapshotFrame* pool_frame; // the frame being handled by the whole pool, set by worker 0
+
+static uint8_t threaded = 0;
+static Signal render_signal; // set by workers when they need a surface created, and when worker 0 exits
+static RWLock frame_lock; // applies to the frame pointers and worker_busy, worker_stop and worker_exited
+static uint8_t worker_busy;
+static uint8_t worker_stop;
+static uint8_t worker_exited;
+static struct SnapshotFrame snapshot_frames[2];
+static struct SnapshotFrame* capture_frame; // written by the render thread
+static struct SnapshotFrame* dispatch_frame; // read by the workers while worker_busy is set
+static RWLock surface_commands_lock; // applies to pending_surface_commands
+static struct SurfaceCommandList pending_surface_commands; // waiting to be run by the render thread
+static struct SurfaceCommandList running_surface_commands; // being run by the render thread
+static RWLock plugins_lock; // applies to the `plugins` map, which any worker may remove from
+
+// a PNG file being loaded for createsurfacefrompngasync. jobs are loaded one at a time, in the order
+// they were queued, by `png_thread`, which then moves them to `png_done_jobs`. each one is finished
+// by the worker its plugin is pinned to, at that worker's next SwapBuffers. `plugin` is set to NULL
+// if the plugin is stopped before then, and the job is just freed instead.
+struct PngJob {
+    struct Plugin* plugin;
+    int surface_ref; // registry references in the plugin's lua_State
+    int callback_ref;
+    char* path;
+    struct CachedImage* image; // NULL if loading failed, in which case `error` says why
+    char error[1024];
+    struct PngJob* next;
 };
 
+static Thread png_thread;
+static Signal png_signal; // set when a job is queued, and when png_thread should exit
+static RWLock png_lock; // applies to everything below
+static uint8_t png_thread_started;
+static uint8_t png_thread_stop;
+static struct PngJob* png_queue; // waiting to be loaded. the first one is the one being loaded
+static struct PngJob* png_done_jobs; // waiting to be finished by a worker
+
+// decoded PNG files, shared between all plugins, so that loading the same image again (e.g. after a
+// plugin is restarted) doesn't need to decode it again. the size limit can be set in megabytes with
+// BOLT_IMAGE_CACHE_MB. only the decoded data is shared, not textures, since a plugin can draw onto
+// its surfaces. the references held by PngJobs are released by _bolt_plugin_free_png_job.
+static struct ImageCache image_cache;
+
 static void _bolt_plugin_window_onresize(struct EmbeddedWindow*, struct ResizeEvent*);
 static void _bolt_plugin_window_onmousemotion(struct EmbeddedWindow*, struct MouseMotionEvent*);
 static void _bolt_plugin_window_onmousebutton(struct EmbeddedWindow*, struct MouseButtonEvent*);
 static void _bolt_plugin_window_onscroll(struct EmbeddedWindow*, struct MouseScrollEvent*);
-static void _bolt_plugin_handle_mousemotion(struct MouseMotionEvent*);
-static void _bolt_plugin_handle_mousebutton(struct MouseButtonEvent*);
-static void _bolt_plugin_handle_scroll(struct MouseScrollEvent*);
+static void _bolt_plugin_dispatch_mousemotion(struct MouseMotionEvent*);
+static void _bolt_plugin_dispatch_mousebutton(struct MouseButtonEvent*);
+static void _bolt_plugin_dispatch_scroll(struct MouseScrollEvent*);
+static void _bolt_plugin_send_input(enum SnapshotType, struct EmbeddedWindow*, struct MouseEvent*, uint8_t);
+static void _bolt_plugin_send_resize(struct EmbeddedWindow*, struct ResizeEvent*);
+static void _bolt_plugin_start_workers();
+static void _bolt_plugin_stop_workers();
+static void _bolt_plugin_free_worker(struct PluginWorker*);
+static void _bolt_plugin_send_profiles();
+static void _bolt_plugin_submit_frame();
+static void _bolt_plugin_run_surface_commands();
+static void _bolt_plugin_surface_init(struct SurfaceFunctions*, unsigned int, unsigned int, const void*);
+static void _bolt_plugin_surface_destroy(void*);
+static void _bolt_plugin_surface_clear(const struct SurfaceFunctions*, double, double, double, double);
+static void _bolt_plugin_surface_draw_to_screen(const struct SurfaceFunctions*, int, int, int, int, int, int, int, int);
+static void _bolt_plugin_surface_draw_to_surface(const struct SurfaceFunctions*, void*, int, int, int, int, int, int, int, int);
+static struct CachedImage* _bolt_plugin_load_png(const char*, char*, size_t);
+static void _bolt_plugin_finish_png_jobs();
+static void _bolt_plugin_close_png_thread();
+
+// returns the worker whose plugins are run on this thread
+static struct PluginWorker* _bolt_plugin_current_worker() {
+    return current_worker ? current_worker : &main_worker;
+}
+
+static void _bolt_plugin_compact_subscribers(struct SubscriberList* list) {
+    size_t out = 0;
+    for (size_t i = 0; i < list->count; i += 1) {
+        if (list->plugins[i]) list->plugins[out++] = list->plugins[i];
+    }
+    list->count = out;
+    list->has_gaps = 0;
+}
+
+static void _bolt_plugin_subscribe(enum PluginEventType event, struct Plugin* plugin) {
+    struct SubscriberList* list = &plugin->worker->subscribers[event];
+    for (size_t i = 0; i < list->count; i += 1) {
+        if (list->plugins[i] == plugin) return;
+    }
+    if (list->count == list->capacity) {
+        const size_t new_capacity = list->capacity ? list->capacity * 2 : 4;
+        struct Plugin** new_plugins = realloc(list->plugins, new_capacity * sizeof(struct Plugin*));
+        if (!new_plugins) return;
+        list->plugins = new_plugins;
+        list->capacity = new_capacity;
+    }
+    list->plugins[list->count] = plugin;
+    list->count += 1;
+    store_relaxed(&list->live_count, list->live_count + 1);
+}
+
+static void _bolt_plugin_unsubscribe(enum PluginEventType event, const struct Plugin* plugin) {
+    struct SubscriberList* list = &plugin->worker->subscribers[event];
+    for (size_t i = 0; i < list->count; i += 1) {
+        if (list->plugins[i] != plugin) continue;
+        list->plugins[i] = NULL;
+        store_relaxed(&list->live_count, list->live_count - 1);
+        if (list->dispatch_depth) list->has_gaps = 1;
+        else _bolt_plugin_compact_subscribers(list);
+        return;
+    }
+}
+
+uint8_t _bolt_plugin_has_subscribers(enum PluginEventType event) {
+    if (load_relaxed(&main_worker.subscribers[event].live_count)) return 1;
+    for (size_t i = 0; i < worker_count; i += 1) {
+        if (load_relaxed(&workers[i].subscribers[event].live_count)) return 1;
+    }
+    return 0;
+}
+
+// pushes a userdata object of `size` bytes to be passed to an event callback, with the metatable
+// called `meta`. each plugin keeps one of these per event type in its event pool and reuses it for
+// every event of that type, so that dispatching events doesn't create garbage for the GC. the byte
+// after the object is set while it's in use, and if a callback somehow causes another event of the
+// same type to be sent to the same plugin, the nested event just gets a new object.
+static void* _bolt_acquire_event_object(struct Plugin* plugin, int type, size_t size, const char* meta) {
+    lua_State* state = plugin->state;
+    lua_rawgeti(state, LUA_REGISTRYINDEX, plugin->event_pool_ref); /*stack: pool*/
+    lua_rawgeti(state, -1, type); /*stack: pool, object or nil*/
+    uint8_t* object = lua_touserdata(state, -1);
+    if (!object || object[size]) {
+        const uint8_t pool_empty = !object;
+        lua_pop(state, 1); /*stack: pool*/
+        object = lua_newuserdata(state, size + 1); /*stack: pool, object*/
+        if (pool_empty) {
+            lua_pushvalue(state, -1); /*stack: pool, object, object*/
+            lua_rawseti(state, -3, type); /*stack: pool, object*/
+        }
+    }
+    lua_remove(state, -2); /*stack: object*/
+    object[size] = 1;
+    if (plugin->event_meta_refs[type] == LUA_NOREF) {
+        lua_getfield(state, LUA_REGISTRYINDEX, meta);
+        plugin->event_meta_refs[type] = luaL_ref(state, LUA_REGISTRYINDEX);
+    }
+    lua_rawgeti(state, LUA_REGISTRYINDEX, plugin->event_meta_refs[type]); /*stack: object, metatable*/
+    lua_setmetatable(state, -2); /*stack: object*/
+    return object;
+}
+
+// marks the event object at the top of the stack as no longer in use, and swaps its metatable for
+// one which raises an error if it's used, in case the callback kept a reference to it
+static void _bolt_release_event_object(struct Plugin* plugin, size_t size) {
+    uint8_t* object = lua_touserdata(plugin->state, -1);
+    object[size] = 0;
+    lua_rawgeti(plugin->state, LUA_REGISTRYINDEX, plugin->expired_event_meta_ref);
+    lua_setmetatable(plugin->state, -2);
+}
+
+static int api_expiredevent_index(lua_State* state) {
+    PUSHSTRING(state, "event objects can't be used after the callback they were passed to has returned");
+    return lua_error(state);
+}
 
 void _bolt_plugin_free(struct Plugin* const* plugin) {
+    for (size_t i = 0; i < PLUGIN_EVENT_ENUM_SIZE; i += 1) {
+        _bolt_plugin_unsubscribe(i, *plugin);
+    }
+    _bolt_rwlock_lock_write(&png_lock);
+    for (struct PngJob* job = png_queue; job; job = job->next) {
+        if (job->plugin == *plugin) job->plugin = NULL;
+    }
+    for (struct PngJob* job = png_done_jobs; job; job = job->next) {
+        if (job->plugin == *plugin) job->plugin = NULL;
+    }
+    _bolt_rwlock_unlock_write(&png_lock);
+    (*plugin)->worker->plugin_count -= 1;
     lua_close((*plugin)->state);
     free((*plugin)->id);
     free(*plugin);
@@ -128,45 +451,156 @@ static uint64_t _bolt_plugin_map_hash(const void* item, uint64_t seed0, uint64_t
 
 static struct hashmap* plugins;
 
-// macro for defining callback functions "_bolt_plugin_handle_*" and "api_setcallback*"
+// default time limits for plugins, in microseconds. a plugin which spends longer than its frame budget
+// in its callbacks during one frame won't be sent any render events for the next few frames, and is
+// stopped if that happens max_violations frames in a row. separately, any single callback which runs
+// for longer than its call limit is aborted with an error, which also stops the plugin. each plugin
+// can set its own limits in its bolt.json, and these defaults can be changed with the environment
+// variables read in _bolt_plugin_init.
+#define PLUGIN_FRAME_BUDGET 4000
+#define PLUGIN_CALL_LIMIT 250000
+#define PLUGIN_MAX_VIOLATIONS 8
+
+// how often the count hook checks the call limit. note that LuaJIT doesn't run hooks from inside
+// compiled traces, so a plugin stuck in a tight compiled loop can still overrun the limit.
+#define PLUGIN_HOOK_INSTRUCTIONS 10000
+
+// limits for plugins which don't set their own, see above
+static struct BoltIPCPluginLimits default_limits = {
+    .frame_budget_us = PLUGIN_FRAME_BUDGET, .call_limit_us = PLUGIN_CALL_LIMIT,
+    .max_violations = PLUGIN_MAX_VIOLATIONS, .hook_instructions = PLUGIN_HOOK_INSTRUCTIONS,
+};
+
+// how often each plugin's profiling data is sent to the host, in microseconds
+#define PLUGIN_PROFILE_INTERVAL 1000000
+static uint64_t last_profile_time = 0;
+
+// returns the value of a monotonic clock in microseconds, or 0 on failure
+static uint64_t _bolt_plugin_time() {
+#if defined(_WIN32)
+    LARGE_INTEGER ticks;
+    if (!QueryPerformanceCounter(&ticks)) return 0;
+    return (ticks.QuadPart * 1000000) / performance_frequency.QuadPart;
+#else
+    struct timespec s;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &s);
+    return (s.tv_sec * 1000000) + (s.tv_nsec / 1000);
+#endif
+}
+
+static void _bolt_plugin_budget_hook(lua_State* state, lua_Debug* ar) {
+    lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME);
+    const struct Plugin* plugin = lua_touserdata(state, -1);
+    lua_pop(state, 1);
+    if (plugin && plugin->call_deadline && _bolt_plugin_time() > plugin->call_deadline) {
+        luaL_error(state, "callback exceeded the time limit of %u ms", (unsigned int)(plugin->limits.call_limit_us / 1000));
+    }
+}
+
+// returns the number of bytes currently in use by a lua_State
+static int64_t _bolt_plugin_memory(lua_State* state) {
+    return ((int64_t)lua_gc(state, LUA_GCCOUNT, 0) * 1024) + lua_gc(state, LUA_GCCOUNTB, 0);
+}
+
+// same as lua_pcall(plugin->state, nargs, 0, 0), but counts the time taken towards the plugin's
+// budget for this frame and its profile for `event`, and sets the deadline checked by
+// _bolt_plugin_budget_hook. `event` is PLUGIN_EVENT_ENUM_SIZE for window events.
+static int _bolt_plugin_pcall(struct Plugin* plugin, int nargs, enum PluginEventType event) {
+    const int64_t memory = _bolt_plugin_memory(plugin->state);
+    const uint64_t start = _bolt_plugin_time();
+    plugin->call_deadline = start + plugin->limits.call_limit_us;
+    const int ret = lua_pcall(plugin->state, nargs, 0, 0);
+    plugin->call_deadline = 0;
+    const uint64_t time = _bolt_plugin_time() - start;
+    plugin->frame_time += time;
+
+    struct BoltIPCPluginProfile* profile = &plugin->profile[event];
+    profile->count += 1;
+    profile->total_us += time;
+    if (time > profile->max_us) profile->max_us = time;
+    profile->memory_delta += _bolt_plugin_memory(plugin->state) - memory;
+    return ret;
+}
+
+// called before sending any event to a plugin. if this is the first event the plugin has received
+// since a frame ended, this checks how much time it used in the last frame it was active in, and
+// throttles or stops it if necessary. returns 1 if the event shouldn't be sent to this plugin,
+// which is always the case if it's been stopped. `event` is PLUGIN_EVENT_ENUM_SIZE for window
+// events, which never stop the plugin since the caller may still be using the window afterwards.
+static uint8_t _bolt_plugin_check_budget(struct Plugin* plugin, enum PluginEventType event) {
+    const uint64_t frame_number = plugin->worker->frame_number;
+    if (plugin->frame_number != frame_number) {
+        const uint64_t frames_passed = frame_number - plugin->frame_number;
+        if (plugin->throttle_frames) {
+            plugin->throttle_frames = frames_passed < plugin->throttle_frames ? plugin->throttle_frames - frames_passed : 0;
+        } else if (plugin->frame_time > plugin->limits.frame_budget_us) {
+            plugin->violations += 1;
+            plugin->throttle_frames = plugin->violations;
+        } else {
+            plugin->violations = 0;
+        }
+        plugin->frame_number = frame_number;
+        plugin->frame_time = 0;
+
+        if (plugin->violations >= plugin->limits.max_violations && event != PLUGIN_EVENT_ENUM_SIZE) {
+            printf("plugin stopped: exceeded time budget of %u us per frame %u times in a row\n", (unsigned int)plugin->limits.frame_budget_us, (unsigned int)plugin->limits.max_violations);
+            _bolt_plugin_stop(plugin->id, plugin->id_length);
+            return 1;
+        }
+    }
+    if (!plugin->throttle_frames) return 0;
+    return event == PLUGIN_EVENT_BATCH2D || event == PLUGIN_EVENT_RENDER3D || event == PLUGIN_EVENT_MINIMAP;
+}
+
+// macro for defining callback functions "_bolt_plugin_dispatch_*" and "api_setcallback*"
 // e.g. DEFINE_CALLBACK(swapbuffers, SWAPBUFFERS, SwapBuffersEvent)
 #define DEFINE_CALLBACK(APINAME, REGNAME, STRUCTNAME) \
-void _bolt_plugin_handle_##APINAME(struct STRUCTNAME* e) { \
-    size_t iter = 0; \
-    void* item; \
-    while (hashmap_iter(plugins, &iter, &item)) { \
-        struct Plugin* plugin = *(struct Plugin* const*)item; \
-        void* newud = lua_newuserdata(plugin->state, sizeof(struct STRUCTNAME)); /*stack: userdata*/ \
+static void _bolt_plugin_dispatch_##APINAME(struct STRUCTNAME* e) { \
+    const uint64_t trace_start = _bolt_trace_begin(); \
+    struct SubscriberList* list = &_bolt_plugin_current_worker()->subscribers[PLUGIN_EVENT_##REGNAME]; \
+    list->dispatch_depth += 1; \
+    for (size_t i = 0; i < list->count; i += 1) { \
+        struct Plugin* plugin = list->plugins[i]; \
+        if (!plugin) continue; \
+        if (_bolt_plugin_check_budget(plugin, PLUGIN_EVENT_##REGNAME)) continue; \
+        void* newud = _bolt_acquire_event_object(plugin, EVENT_OBJECT_##REGNAME, sizeof(struct STRUCTNAME), REGNAME##_META_REGISTRYNAME); /*stack: userdata*/ \
         memcpy(newud, e, sizeof(struct STRUCTNAME)); \
-        lua_getfield(plugin->state, LUA_REGISTRYINDEX, REGNAME##_META_REGISTRYNAME); /*stack: userdata, metatable*/ \
-        lua_setmetatable(plugin->state, -2); /*stack: userdata*/ \
-        PUSHSTRING(plugin->state, REGNAME##_CB_REGISTRYNAME); /*stack: userdata, enumname*/ \
-        lua_gettable(plugin->state, LUA_REGISTRYINDEX); /*stack: userdata, callback*/ \
+        lua_rawgeti(plugin->state, LUA_REGISTRYINDEX, plugin->callback_refs[PLUGIN_EVENT_##REGNAME]); /*stack: userdata, callback*/ \
         if (!lua_isfunction(plugin->state, -1)) { \
-            lua_pop(plugin->state, 2); \
+            lua_pop(plugin->state, 1); \
+            _bolt_release_event_object(plugin, sizeof(struct STRUCTNAME)); \
+            lua_pop(plugin->state, 1); \
             continue; \
         } \
         lua_pushvalue(plugin->state, -2); /*stack: userdata, callback, userdata*/ \
-        if (lua_pcall(plugin->state, 1, 0, 0)) { /*stack: userdata, ?error*/ \
+        if (_bolt_plugin_pcall(plugin, 1, PLUGIN_EVENT_##REGNAME)) { /*stack: userdata, ?error*/ \
             const char* e = lua_tolstring(plugin->state, -1, 0); \
             printf("plugin callback " #APINAME " error: %s\n", e); \
             lua_pop(plugin->state, 2); /*stack: (empty)*/ \
             _bolt_plugin_stop(plugin->id, plugin->id_length); \
-            break; \
         } else { \
+            _bolt_release_event_object(plugin, sizeof(struct STRUCTNAME)); \
             lua_pop(plugin->state, 1); /*stack: (empty)*/ \
         } \
     } \
+    list->dispatch_depth -= 1; \
+    if (!list->dispatch_depth && list->has_gaps) _bolt_plugin_compact_subscribers(list); \
+    _bolt_trace_end("plugin dispatch " #APINAME, trace_start); \
 } \
 static int api_setcallback##APINAME(lua_State* state) { \
     _bolt_check_argc(state, 1, "setcallback" #APINAME); \
-    PUSHSTRING(state, REGNAME##_CB_REGISTRYNAME); \
+    lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME); \
+    struct Plugin* plugin = lua_touserdata(state, -1); \
+    lua_pop(state, 1); \
+    luaL_unref(state, LUA_REGISTRYINDEX, plugin->callback_refs[PLUGIN_EVENT_##REGNAME]); \
     if (lua_isfunction(state, 1)) { \
         lua_pushvalue(state, 1); \
+        plugin->callback_refs[PLUGIN_EVENT_##REGNAME] = luaL_ref(state, LUA_REGISTRYINDEX); \
+        _bolt_plugin_subscribe(PLUGIN_EVENT_##REGNAME, plugin); \
     } else { \
-        lua_pushnil(state); \
+        plugin->callback_refs[PLUGIN_EVENT_##REGNAME] = LUA_NOREF; \
+        _bolt_plugin_unsubscribe(PLUGIN_EVENT_##REGNAME, plugin); \
     } \
-    lua_settable(state, LUA_REGISTRYINDEX); \
     return 0; \
 }
 
@@ -191,25 +625,28 @@ static int api_window_on##APINAME(lua_State* state) { \
 } \
 void _bolt_plugin_window_on##APINAME(struct EmbeddedWindow* window, struct EVNAME* event) { \
     lua_State* state = window->plugin; \
+    lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME); /*stack: plugin*/ \
+    struct Plugin* plugin = lua_touserdata(state, -1); \
+    lua_pop(state, 1); /*stack: (empty)*/ \
+    if (_bolt_plugin_check_budget(plugin, PLUGIN_EVENT_ENUM_SIZE)) return; \
     lua_getfield(state, LUA_REGISTRYINDEX, WINDOWS_REGISTRYNAME); /*stack: window table*/ \
     lua_pushinteger(state, window->id); /*stack: window table, window id*/ \
     lua_gettable(state, -2); /*stack: window table, event table*/ \
     lua_pushinteger(state, WINDOW_ON##REGNAME); /*stack: window table, event table, event id*/ \
     lua_gettable(state, -2); /*stack: window table, event table, function or nil*/ \
     if (lua_isfunction(state, -1)) { \
-        void* newud = lua_newuserdata(state, sizeof(struct EVNAME)); /*stack: window table, event table, function, event*/ \
+        void* newud = _bolt_acquire_event_object(plugin, EVENT_OBJECT_##REGNAME, sizeof(struct EVNAME), REGNAME##_META_REGISTRYNAME); /*stack: window table, event table, function, event*/ \
         memcpy(newud, event, sizeof(struct EVNAME)); \
-        lua_getfield(state, LUA_REGISTRYINDEX, REGNAME##_META_REGISTRYNAME); /*stack: window table, event table, function, event, event metatable*/ \
-        lua_setmetatable(state, -2); /*stack: window table, event table, function, event*/ \
-        if (lua_pcall(state, 1, 0, 0)) { /*stack: window table, event table, ?error*/ \
+        lua_pushvalue(state, -1); /*stack: window table, event table, function, event, event*/ \
+        lua_insert(state, -3); /*stack: window table, event table, event, function, event*/ \
+        if (_bolt_plugin_pcall(plugin, 1, PLUGIN_EVENT_ENUM_SIZE)) { /*stack: window table, event table, event, ?error*/ \
             const char* e = lua_tolstring(state, -1, 0); \
             printf("plugin window on" #APINAME " error: %s\n", e); \
-            lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME); /*stack: window table, event table, error, plugin*/ \
-            const struct Plugin* plugin = lua_touserdata(state, -1); \
             lua_pop(state, 4); /*stack: (empty)*/ \
             _bolt_plugin_stop(plugin->id, plugin->id_length); \
         } else { \
-            lua_pop(state, 2); /*stack: (empty)*/ \
+            _bolt_release_event_object(plugin, sizeof(struct EVNAME)); \
+            lua_pop(state, 3); /*stack: (empty)*/ \
         } \
     } else { \
         lua_pop(state, 3); \
@@ -218,7 +655,7 @@ void _bolt_plugin_window_on##APINAME(struct EmbeddedWindow* window, struct EVNAM
 
 static int surface_gc(lua_State* state) {
     const struct SurfaceFunctions* functions = lua_touserdata(state, 1);
-    managed_functions.surface_destroy(functions->userdata);
+    _bolt_plugin_surface_destroy(functions->userdata);
     return 0;
 }
 
@@ -238,11 +675,12 @@ static int window_gc(lua_State* state) {
     lua_settable(state, -3);
     lua_pop(state, 1);
 
-    managed_functions.surface_destroy(window->surface_functions.userdata);
+    _bolt_plugin_surface_destroy(window->surface_functions.userdata);
     return 0;
 }
 
 void _bolt_plugin_on_startup() {
+    _bolt_trace_init();
     windows.map = hashmap_new(sizeof(struct EmbeddedWindow*), 8, 0, 0, _bolt_window_map_hash, _bolt_window_map_compare, NULL, NULL);
     _bolt_rwlock_init(&windows.lock);
     memset(&windows.input, 0, sizeof(windows.input));
@@ -251,6 +689,15 @@ void _bolt_plugin_on_startup() {
 #endif
 }
 
+// replaces one of default_limits with the value of an environment variable, if it's set to a number
+// other than 0
+static void _bolt_plugin_limit_from_env(const char* name, uint32_t* limit) {
+    const char* env = getenv(name);
+    if (!env || !*env) return;
+    const unsigned long value = strtoul(env, NULL, 10);
+    if (value && value <= UINT32_MAX) *limit = (uint32_t)value;
+}
+
 void _bolt_plugin_init(const struct PluginManagedFunctions* functions) {
     _bolt_plugin_ipc_init(&fd);
 
@@ -266,12 +713,26 @@ void _bolt_plugin_init(const struct PluginManagedFunctions* functions) {
     _bolt_rwlock_lock_write(&windows.lock);
     next_window_id = 1;
     plugins = hashmap_new(sizeof(struct Plugin*), 8, 0, 0, _bolt_plugin_map_hash, _bolt_plugin_map_compare, NULL, NULL);
+    _bolt_rwlock_init(&plugins_lock);
+    _bolt_rwlock_init(&png_lock);
+    _bolt_signal_init(&png_signal);
+    size_t image_cache_size = IMAGECACHE_DEFAULT_MAX_BYTES;
+    const char* image_cache_env = getenv("BOLT_IMAGE_CACHE_MB");
+    if (image_cache_env && *image_cache_env) image_cache_size = strtoul(image_cache_env, NULL, 10) * 1024 * 1024;
+    _bolt_imagecache_init(&image_cache, image_cache_size);
+    _bolt_plugin_limit_from_env("BOLT_PLUGIN_FRAME_BUDGET_US", &default_limits.frame_budget_us);
+    _bolt_plugin_limit_from_env("BOLT_PLUGIN_CALL_LIMIT_US", &default_limits.call_limit_us);
+    _bolt_plugin_limit_from_env("BOLT_PLUGIN_MAX_VIOLATIONS", &default_limits.max_violations);
+    _bolt_plugin_limit_from_env("BOLT_PLUGIN_HOOK_INSTRUCTIONS", &default_limits.hook_instructions);
     inited = 1;
     _bolt_rwlock_unlock_write(&windows.lock);
+
+    const char* threaded_env = getenv("BOLT_PLUGIN_THREADED");
+    if (threaded_env && *threaded_env && strcmp(threaded_env, "0")) _bolt_plugin_start_workers();
 }
 
 static int _bolt_api_init(lua_State* state) {
-    lua_createtable(state, 0, 13);
+    lua_createtable(state, 0, 14);
     API_ADD(apiversion)
     API_ADD(checkversion)
     API_ADD(time)
@@ -284,6 +745,7 @@ static int _bolt_api_init(lua_State* state) {
     API_ADD(createsurface)
     API_ADD(createsurfacefromrgba)
     API_ADD(createsurfacefrompng)
+    API_ADD(createsurfacefrompngasync)
     API_ADD(createwindow)
     return 1;
 }
@@ -293,9 +755,17 @@ uint8_t _bolt_plugin_is_inited() {
 }
 
 void _bolt_plugin_process_windows(uint32_t window_width, uint32_t window_height) {
-    struct SwapBuffersEvent event;
-    _bolt_plugin_handle_swapbuffers(&event);
-    _bolt_plugin_handle_messages();
+    const uint64_t trace_start = _bolt_trace_begin();
+    if (threaded) {
+        // carry out anything the workers did to surfaces while they were handling the previous
+        // frame. the workers send out SwapBuffers events and handle IPC messages themselves.
+        _bolt_plugin_run_surface_commands();
+    } else {
+        struct SwapBuffersEvent event;
+        _bolt_plugin_handle_swapbuffers(&event);
+        _bolt_plugin_handle_messages();
+        _bolt_plugin_send_profiles();
+    }
     struct WindowInfo* windows = _bolt_plugin_windowinfo();
 
     _bolt_rwlock_lock_write(&windows->input_lock);
@@ -304,30 +774,12 @@ void _bolt_plugin_process_windows(uint32_t window_width, uint32_t window_height)
     _bolt_rwlock_unlock_write(&windows->input_lock);
 
     
-    if (inputs.mouse_motion) {
-        struct MouseMotionEvent event = {.details = &inputs.mouse_motion_event};
-        _bolt_plugin_handle_mousemotion(&event);
-    }
-    if (inputs.mouse_left) {
-        struct MouseButtonEvent event = {.details = &inputs.mouse_left_event, .button = MBLeft};
-        _bolt_plugin_handle_mousebutton(&event);
-    }
-    if (inputs.mouse_right) {
-        struct MouseButtonEvent event = {.details = &inputs.mouse_right_event, .button = MBRight};
-        _bolt_plugin_handle_mousebutton(&event);
-    }
-    if (inputs.mouse_middle) {
-        struct MouseButtonEvent event = {.details = &inputs.mouse_middle_event, .button = MBMiddle};
-        _bolt_plugin_handle_mousebutton(&event);
-    }
-    if (inputs.mouse_scroll_up) {
-        struct MouseScrollEvent event = {.details = &inputs.mouse_scroll_up_event, .direction = 1};
-        _bolt_plugin_handle_scroll(&event);
-    }
-    if (inputs.mouse_scroll_down) {
-        struct MouseScrollEvent event = {.details = &inputs.mouse_scroll_up_event, .direction = 0};
-        _bolt_plugin_handle_scroll(&event);
-    }
+    if (inputs.mouse_motion) _bolt_plugin_send_input(SNAPSHOT_MOUSEMOTION, NULL, &inputs.mouse_motion_event, 0);
+    if (inputs.mouse_left) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, NULL, &inputs.mouse_left_event, MBLeft);
+    if (inputs.mouse_right) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, NULL, &inputs.mouse_right_event, MBRight);
+    if (inputs.mouse_middle) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, NULL, &inputs.mouse_middle_event, MBMiddle);
+    if (inputs.mouse_scroll_up) _bolt_plugin_send_input(SNAPSHOT_SCROLL, NULL, &inputs.mouse_scroll_up_event, 1);
+    if (inputs.mouse_scroll_down) _bolt_plugin_send_input(SNAPSHOT_SCROLL, NULL, &inputs.mouse_scroll_up_event, 0);
 
     _bolt_rwlock_lock_read(&windows->lock);
     size_t iter = 0;
@@ -368,40 +820,28 @@ void _bolt_plugin_process_windows(uint32_t window_width, uint32_t window_height)
             struct PluginSurfaceUserdata* ud = window->surface_functions.userdata;
             managed_functions.surface_resize_and_clear(ud, metadata.width, metadata.height);
             struct ResizeEvent event = {.width = metadata.width, .height = metadata.height};
-            _bolt_plugin_window_onresize(window, &event);
+            _bolt_plugin_send_resize(window, &event);
         }
 
-        if (inputs.mouse_motion) {
-            struct MouseMotionEvent event = {.details = &inputs.mouse_motion_event};
-            _bolt_plugin_window_onmousemotion(window, &event);
-        }
-        if (inputs.mouse_left) {
-            struct MouseButtonEvent event = {.details = &inputs.mouse_left_event, .button = MBLeft};
-            _bolt_plugin_window_onmousebutton(window, &event);
-        }
-        if (inputs.mouse_right) {
-            struct MouseButtonEvent event = {.details = &inputs.mouse_right_event, .button = MBRight};
-            _bolt_plugin_window_onmousebutton(window, &event);
-        }
-        if (inputs.mouse_middle) {
-            struct MouseButtonEvent event = {.details = &inputs.mouse_middle_event, .button = MBMiddle};
-            _bolt_plugin_window_onmousebutton(window, &event);
-        }
-        if (inputs.mouse_scroll_up) {
-            struct MouseScrollEvent event = {.details = &inputs.mouse_scroll_up_event, .direction = 1};
-            _bolt_plugin_window_onscroll(window, &event);
-        }
-        if (inputs.mouse_scroll_down) {
-            struct MouseScrollEvent event = {.details = &inputs.mouse_scroll_down_event, .direction = 0};
-            _bolt_plugin_window_onscroll(window, &event);
-        }
+        if (inputs.mouse_motion) _bolt_plugin_send_input(SNAPSHOT_MOUSEMOTION, window, &inputs.mouse_motion_event, 0);
+        if (inputs.mouse_left) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, window, &inputs.mouse_left_event, MBLeft);
+        if (inputs.mouse_right) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, window, &inputs.mouse_right_event, MBRight);
+        if (inputs.mouse_middle) _bolt_plugin_send_input(SNAPSHOT_MOUSEBUTTON, window, &inputs.mouse_middle_event, MBMiddle);
+        if (inputs.mouse_scroll_up) _bolt_plugin_send_input(SNAPSHOT_SCROLL, window, &inputs.mouse_scroll_up_event, 1);
+        if (inputs.mouse_scroll_down) _bolt_plugin_send_input(SNAPSHOT_SCROLL, window, &inputs.mouse_scroll_down_event, 0);
 
         window->surface_functions.draw_to_screen(window->surface_functions.userdata, 0, 0, metadata.width, metadata.height, metadata.x, metadata.y, metadata.width, metadata.height);
     }
     _bolt_rwlock_unlock_read(&windows->lock);
+
+    if (threaded) _bolt_plugin_submit_frame();
+    _bolt_trace_end("plugin process windows", trace_start);
 }
 
 void _bolt_plugin_close() {
+    if (threaded) _bolt_plugin_stop_workers();
+    _bolt_plugin_close_png_thread();
+    _bolt_imagecache_destroy(&image_cache);
     _bolt_plugin_ipc_close(fd);
     size_t iter = 0;
     void* item;
@@ -409,8 +849,18 @@ void _bolt_plugin_close() {
         struct Plugin** plugin = item;
         _bolt_plugin_free(plugin);
     }
+    _bolt_plugin_free_worker(&main_worker);
+    for (size_t i = 0; i < worker_count; i += 1) {
+        _bolt_plugin_free_worker(&workers[i]);
+    }
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
     _bolt_rwlock_lock_write(&windows.lock);
     hashmap_free(plugins);
+    _bolt_rwlock_destroy(&plugins_lock);
+    _bolt_rwlock_destroy(&png_lock);
+    _bolt_signal_destroy(&png_signal);
     inited = 0;
     _bolt_rwlock_unlock_write(&windows.lock);
 }
@@ -420,6 +870,7 @@ struct WindowInfo* _bolt_plugin_windowinfo() {
 }
 
 void _bolt_plugin_handle_messages() {
+    const uint64_t trace_start = _bolt_trace_begin();
     struct BoltIPCMessageToHost message;
     while (_bolt_ipc_poll(fd)) {
         if (_bolt_ipc_receive(fd, &message, sizeof(message)) != 0) break;
@@ -443,6 +894,7 @@ void _bolt_plugin_handle_messages() {
                     memcpy(full_path, plugin->path, plugin->path_length);
                     _bolt_ipc_receive(fd, full_path + plugin->path_length, main_length);
                     full_path[plugin->path_length + main_length] = '\0';
+                    _bolt_ipc_receive(fd, &plugin->limits, sizeof(plugin->limits));
                     if (_bolt_plugin_add(full_path, plugin)) {
                         lua_pop(plugin->state, 1);
                     } else {
@@ -451,14 +903,77 @@ void _bolt_plugin_handle_messages() {
                 }
                 break;
             }
+            case IPC_MSG_DUMPTRACE: {
+                char path[1024];
+                _bolt_plugin_trace_path(path, sizeof(path));
+                if (_bolt_trace_dump(path)) {
+                    printf("failed to write trace to %s (is BOLT_TRACE set?)\n", path);
+                } else {
+                    printf("wrote trace to %s\n", path);
+                }
+                break;
+            }
             default:
                 printf("unknown message type %u\n", message.message_type);
                 break;
         }
     }
+    _bolt_trace_end("plugin handle messages", trace_start);
+}
+
+// sends each plugin's profiling data to the host and resets it, if it's been at least
+// PLUGIN_PROFILE_INTERVAL since that was last done. this has to be called from the same place as
+// _bolt_plugin_handle_messages, since it reads the profiles of plugins on every worker.
+static void _bolt_plugin_send_profiles() {
+    const uint64_t now = _bolt_plugin_time();
+    if (now - last_profile_time < PLUGIN_PROFILE_INTERVAL) return;
+    last_profile_time = now;
+
+    _bolt_rwlock_lock_read(&plugins_lock);
+    const size_t count = hashmap_count(plugins);
+    if (count) {
+        struct BoltIPCMessageToHost message = {.message_type = IPC_MSG_PLUGINPROFILE, .items = count};
+        _bolt_ipc_send(fd, &message, sizeof(message));
+        size_t iter = 0;
+        void* item;
+        while (hashmap_iter(plugins, &iter, &item)) {
+            struct Plugin* plugin = *(struct Plugin**)item;
+            _bolt_ipc_send(fd, &plugin->id_length, sizeof(plugin->id_length));
+            _bolt_ipc_send(fd, plugin->id, plugin->id_length);
+            _bolt_ipc_send(fd, plugin->profile, sizeof(plugin->profile));
+            memset(plugin->profile, 0, sizeof(plugin->profile));
+        }
+    }
+    _bolt_rwlock_unlock_read(&plugins_lock);
 }
 
 uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
+    // pin this plugin to whichever worker currently has the fewest plugins. this only happens while
+    // handling IPC messages, when no other worker is running, so plugin_count is safe to read.
+    plugin->worker = &main_worker;
+    for (size_t i = 0; i < worker_count; i += 1) {
+        if (plugin->worker == &main_worker || workers[i].plugin_count < plugin->worker->plugin_count) {
+            plugin->worker = &workers[i];
+        }
+    }
+    plugin->worker->plugin_count += 1;
+
+    for (size_t i = 0; i < PLUGIN_EVENT_ENUM_SIZE; i += 1) plugin->callback_refs[i] = LUA_NOREF;
+    for (size_t i = 0; i < EVENT_OBJECT_ENUM_SIZE; i += 1) plugin->event_meta_refs[i] = LUA_NOREF;
+    plugin->event_pool_ref = LUA_NOREF;
+    plugin->expired_event_meta_ref = LUA_NOREF;
+    if (!plugin->limits.frame_budget_us) plugin->limits.frame_budget_us = default_limits.frame_budget_us;
+    if (!plugin->limits.call_limit_us) plugin->limits.call_limit_us = default_limits.call_limit_us;
+    if (!plugin->limits.max_violations) plugin->limits.max_violations = default_limits.max_violations;
+    if (!plugin->limits.hook_instructions) plugin->limits.hook_instructions = default_limits.hook_instructions;
+    if (plugin->limits.hook_instructions > INT32_MAX) plugin->limits.hook_instructions = INT32_MAX;
+    plugin->frame_number = plugin->worker->frame_number;
+    plugin->frame_time = 0;
+    plugin->call_deadline = 0;
+    plugin->violations = 0;
+    plugin->throttle_frames = 0;
+    memset(plugin->profile, 0, sizeof(plugin->profile));
+
     // load the user-provided string as a lua function, putting that function on the stack
     if (luaL_loadfile(plugin->state, path)) {
         const char* e = lua_tolstring(plugin->state, -1, 0);
@@ -468,21 +983,26 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
     }
 
     // put this into our list of plugins (important to do this before lua_pcall)
-    struct Plugin* const* old_plugin = hashmap_set(plugins, &plugin);
-    if (hashmap_oom(plugins)) {
+    _bolt_rwlock_lock_write(&plugins_lock);
+    struct Plugin* const* old_plugin_ptr = hashmap_set(plugins, &plugin);
+    struct Plugin* old_plugin = old_plugin_ptr ? *old_plugin_ptr : NULL;
+    const bool oom = hashmap_oom(plugins);
+    _bolt_rwlock_unlock_write(&plugins_lock);
+    if (oom) {
         printf("plugin load error: out of memory\n");
         _bolt_plugin_free(&plugin);
         return 0;
     }
     if (old_plugin) {
         // a plugin with this id was already running and we just overwrote it, so make sure not to leak the memory
-        _bolt_plugin_free(old_plugin);
+        _bolt_plugin_free(&old_plugin);
     }
 
     // add the struct pointer to the registry
     PUSHSTRING(plugin->state, PLUGIN_REGISTRYNAME);
     lua_pushlightuserdata(plugin->state, plugin);
     lua_settable(plugin->state, LUA_REGISTRYINDEX);
+    lua_sethook(plugin->state, _bolt_plugin_budget_hook, LUA_MASKCOUNT, (int)plugin->limits.hook_instructions);
 
     // Open just the specific libraries plugins are allowed to have
     lua_pushcfunction(plugin->state, luaopen_base);
@@ -525,6 +1045,17 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
     lua_newtable(plugin->state);
     lua_settable(plugin->state, LUA_REGISTRYINDEX);
 
+    // create the event object pool (empty, objects are created the first time they're needed)
+    lua_newtable(plugin->state);
+    plugin->event_pool_ref = luaL_ref(plugin->state, LUA_REGISTRYINDEX);
+
+    // create the metatable given to event objects after their callback returns
+    lua_newtable(plugin->state);
+    PUSHSTRING(plugin->state, "__index");
+    lua_pushcfunction(plugin->state, api_expiredevent_index);
+    lua_settable(plugin->state, -3);
+    plugin->expired_event_meta_ref = luaL_ref(plugin->state, LUA_REGISTRYINDEX);
+
     // create the metatable for all RenderBatch2D objects
     PUSHSTRING(plugin->state, BATCH2D_META_REGISTRYNAME);
     lua_newtable(plugin->state);
@@ -539,6 +1070,8 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
     API_ADD_SUB(plugin->state, vertexatlaswh, batch2d)
     API_ADD_SUB(plugin->state, vertexuv, batch2d)
     API_ADD_SUB(plugin->state, vertexcolour, batch2d)
+    API_ADD_SUB(plugin->state, vertices, batch2d)
+    API_ADD_SUB(plugin->state, vertexarrays, batch2d)
     API_ADD_SUB(plugin->state, textureid, batch2d)
     API_ADD_SUB(plugin->state, texturesize, batch2d)
     API_ADD_SUB(plugin->state, texturecompare, batch2d)
@@ -558,6 +1091,7 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
     API_ADD_SUB(plugin->state, atlasxywh, render3d)
     API_ADD_SUB(plugin->state, vertexuv, render3d)
     API_ADD_SUB(plugin->state, vertexcolour, render3d)
+    API_ADD_SUB(plugin->state, vertexarrays, render3d)
     API_ADD_SUB(plugin->state, textureid, render3d)
     API_ADD_SUB(plugin->state, texturesize, render3d)
     API_ADD_SUB(plugin->state, texturecompare, render3d)
@@ -682,7 +1216,9 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
         const char* e = lua_tolstring(plugin->state, -1, 0);
         printf("plugin startup error: %s\n", e);
         lua_pop(plugin->state, 1);
+        _bolt_rwlock_lock_write(&plugins_lock);
         hashmap_delete(plugins, &plugin);
+        _bolt_rwlock_unlock_write(&plugins_lock);
         return 0;
     } else {
         return 1;
@@ -692,8 +1228,11 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin) {
 void _bolt_plugin_stop(char* id, uint32_t id_length) {
     struct Plugin p = {.id = id, .id_length = id_length};
     struct Plugin* pp = &p;
-    struct Plugin* const* plugin = hashmap_delete(plugins, &pp);
-    _bolt_plugin_free(plugin);
+    _bolt_rwlock_lock_write(&plugins_lock);
+    struct Plugin* const* deleted = hashmap_delete(plugins, &pp);
+    struct Plugin* plugin = deleted ? *deleted : NULL;
+    _bolt_rwlock_unlock_write(&plugins_lock);
+    if (plugin) _bolt_plugin_free(&plugin);
 }
 
 // Calls `error()` if arg count is incorrect
@@ -718,6 +1257,960 @@ DEFINE_WINDOWEVENT(mousemotion, MOUSEMOTION, MouseMotionEvent)
 DEFINE_WINDOWEVENT(mousebutton, MOUSEBUTTON, MouseButtonEvent)
 DEFINE_WINDOWEVENT(scroll, SCROLL, MouseScrollEvent)
 
+void _bolt_plugin_handle_swapbuffers(struct SwapBuffersEvent* event) {
+    _bolt_plugin_finish_png_jobs();
+    _bolt_plugin_dispatch_swapbuffers(event);
+    _bolt_plugin_current_worker()->frame_number += 1;
+}
+
+// functions for threaded mode (see _bolt_plugin_init). the render thread captures events into
+// `capture_frame` using the _bolt_snapshot_* functions, and hands it to the worker thread at the end
+// of each frame if the worker has finished with the previous one. on the worker, the snapshot-backed
+// events are given the same vtable interface as live ones, so the rest of the API works unchanged.
+
+#define SNAPSHOT_ALIGN(N) (((N) + 7) & ~(size_t)7)
+#define SNAPSHOT_HEADER_SIZE SNAPSHOT_ALIGN(sizeof(struct SnapshotHeader))
+#define SNAPSHOT_PAYLOAD(FRAME, OFFSET) ((void*)((FRAME)->data + (OFFSET) + SNAPSHOT_HEADER_SIZE))
+
+// a frame will stop capturing render events once it reaches this size
+#define SNAPSHOT_FRAME_MAX (64 * 1024 * 1024)
+
+// textures are only captured by ID. reading a texture's contents on the worker goes through
+// managed_functions, so it gets the texture as it is at the time of reading, not at capture time.
+struct SnapshotTexture {
+    size_t id;
+    size_t size[2];
+};
+
+// followed by a Vertex2DArrays' worth of data, laid out the same way as batch2d_vertexarrays
+struct Snapshot2D {
+    uint32_t screen_width;
+    uint32_t screen_height;
+    uint32_t index_count;
+    uint32_t vertices_per_icon;
+    uint8_t is_minimap;
+    struct SnapshotTexture texture;
+};
+#define SNAPSHOT_2D_VERTEX_SIZE ((6 * sizeof(double)) + (6 * sizeof(int32_t)))
+
+// followed by a Vertex3DArrays' worth of data, then a copy of the matrix userdata, then a
+// SnapshotMeta for every distinct meta-ID used by the vertices, since atlas_xywh can't be called
+// after the event has ended.
+struct Snapshot3D {
+    uint32_t vertex_count;
+    uint32_t meta_count;
+    struct SnapshotTexture texture;
+    struct Render3DMatrixFunctions matrix_functions;
+};
+#define SNAPSHOT_3D_VERTEX_SIZE ((6 * sizeof(double)) + (4 * sizeof(int32_t)))
+
+struct SnapshotMeta {
+    uint32_t meta;
+    int32_t xywh[4];
+};
+
+struct SnapshotInput {
+    uint64_t window_id; // 0 if this isn't for a window
+    struct MouseEvent details;
+    uint8_t extra; // button or scroll direction
+};
+
+struct SnapshotResize {
+    uint64_t window_id;
+    struct ResizeEvent event;
+};
+
+// a snapshot event's vertex arrays plus the number of vertices in them, used as vertex userdata
+struct Snapshot2DView {
+    struct Vertex2DArrays arrays;
+    size_t count;
+};
+struct Snapshot3DView {
+    struct Vertex3DArrays arrays;
+    size_t count;
+    const struct SnapshotMeta* metas;
+    size_t meta_count;
+};
+
+// appends a record with space for `payload_size` bytes to the capture frame and returns its offset,
+// or SIZE_MAX if it doesn't fit
+static size_t _bolt_snapshot_begin(enum SnapshotType type, size_t payload_size) {
+    struct SnapshotFrame* frame = capture_frame;
+    const size_t size = SNAPSHOT_HEADER_SIZE + SNAPSHOT_ALIGN(payload_size);
+    if (size > SNAPSHOT_FRAME_MAX - frame->size) return SIZE_MAX;
+    if (frame->size + size > frame->capacity) {
+        size_t new_capacity = frame->capacity ? frame->capacity : 65536;
+        while (new_capacity < frame->size + size) new_capacity *= 2;
+        uint8_t* new_data = realloc(frame->data, new_capacity);
+        if (!new_data) return SIZE_MAX;
+        frame->data = new_data;
+        frame->capacity = new_capacity;
+    }
+    const size_t offset = frame->size;
+    struct SnapshotHeader* header = (struct SnapshotHeader*)(frame->data + offset);
+    header->type = type;
+    header->size = (uint32_t)size;
+    frame->size += size;
+    return offset;
+}
+
+// removes all the render events from a frame, keeping only the input events
+static void _bolt_snapshot_drop_render_events(struct SnapshotFrame* frame) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < frame->size) {
+        const struct SnapshotHeader* header = (const struct SnapshotHeader*)(frame->data + in);
+        const size_t size = header->size;
+        if (header->type >= SNAPSHOT_MOUSEMOTION) {
+            if (out != in) memmove(frame->data + out, frame->data + in, size);
+            out += size;
+        }
+        in += size;
+    }
+    frame->size = out;
+}
+
+static void _bolt_snapshot_texture(const struct TextureFunctions* functions, struct SnapshotTexture* out) {
+    out->id = functions->id(functions->userdata);
+    functions->size(functions->userdata, out->size);
+}
+
+static void _bolt_snapshot_2d_layout(struct Snapshot2D* snapshot, struct Vertex2DArrays* arrays) {
+    const size_t count = snapshot->index_count;
+    arrays->uv = (double*)((uint8_t*)snapshot + SNAPSHOT_ALIGN(sizeof(struct Snapshot2D)));
+    arrays->colour = arrays->uv + (count * 2);
+    arrays->xy = (int32_t*)(arrays->colour + (count * 4));
+    arrays->atlas_xy = arrays->xy + (count * 2);
+    arrays->atlas_wh = arrays->atlas_xy + (count * 2);
+}
+
+static void _bolt_snapshot_3d_layout(struct Snapshot3D* snapshot, struct Vertex3DArrays* arrays, void** matrix, struct SnapshotMeta** metas) {
+    const size_t count = snapshot->vertex_count;
+    arrays->uv = (double*)((uint8_t*)snapshot + SNAPSHOT_ALIGN(sizeof(struct Snapshot3D)));
+    arrays->colour = arrays->uv + (count * 2);
+    arrays->xyz = (int32_t*)(arrays->colour + (count * 4));
+    arrays->atlas_meta = (uint32_t*)(arrays->xyz + (count * 3));
+    *matrix = arrays->atlas_meta + count;
+    *metas = (struct SnapshotMeta*)((uint8_t*)*matrix + SNAPSHOT_ALIGN(snapshot->matrix_functions.userdata_size));
+}
+
+static void _bolt_snapshot_2d(const struct RenderBatch2D* batch) {
+    const size_t count = batch->index_count;
+    const size_t offset = _bolt_snapshot_begin(SNAPSHOT_BATCH2D, SNAPSHOT_ALIGN(sizeof(struct Snapshot2D)) + (count * SNAPSHOT_2D_VERTEX_SIZE));
+    if (offset == SIZE_MAX) return;
+    struct Snapshot2D* snapshot = SNAPSHOT_PAYLOAD(capture_frame, offset);
+    snapshot->screen_width = batch->screen_width;
+    snapshot->screen_height = batch->screen_height;
+    snapshot->index_count = batch->index_count;
+    snapshot->vertices_per_icon = batch->vertices_per_icon;
+    snapshot->is_minimap = batch->is_minimap;
+    _bolt_snapshot_texture(&batch->texture_functions, &snapshot->texture);
+    struct Vertex2DArrays arrays;
+    _bolt_snapshot_2d_layout(snapshot, &arrays);
+    batch->vertex_functions.decode(count, batch->vertex_functions.userdata, &arrays);
+}
+
+static void _bolt_snapshot_3d(const struct Render3D* render) {
+    const size_t count = render->vertex_count;
+    const size_t fixed_size = SNAPSHOT_ALIGN(sizeof(struct Snapshot3D)) + (count * SNAPSHOT_3D_VERTEX_SIZE) + SNAPSHOT_ALIGN(render->matrix_functions.userdata_size);
+
+    // reserve enough space for every vertex to have a different meta-ID, then give back what
+    // wasn't used afterwards. this works because nothing else is captured in the meantime.
+    const size_t offset = _bolt_snapshot_begin(SNAPSHOT_RENDER3D, fixed_size + (count * sizeof(struct SnapshotMeta)));
+    if (offset == SIZE_MAX) return;
+    struct Snapshot3D* snapshot = SNAPSHOT_PAYLOAD(capture_frame, offset);
+    snapshot->vertex_count = count;
+    snapshot->meta_count = 0;
+    snapshot->matrix_functions = render->matrix_functions;
+    _bolt_snapshot_texture(&render->texture_functions, &snapshot->texture);
+    struct Vertex3DArrays arrays;
+    void* matrix;
+    struct SnapshotMeta* metas;
+    _bolt_snapshot_3d_layout(snapshot, &arrays, &matrix, &metas);
+    render->vertex_functions.decode(count, render->vertex_functions.userdata, &arrays);
+    memcpy(matrix, render->matrix_functions.userdata, render->matrix_functions.userdata_size);
+
+    size_t last = 0;
+    for (size_t i = 0; i < count; i += 1) {
+        const uint32_t meta = arrays.atlas_meta[i];
+        // consecutive vertices usually have the same meta-ID, so check the last one first
+        if (snapshot->meta_count && metas[last].meta == meta) continue;
+        for (last = 0; last < snapshot->meta_count && metas[last].meta != meta; last += 1);
+        if (last < snapshot->meta_count) continue;
+        metas[last].meta = meta;
+        render->vertex_functions.atlas_xywh(meta, render->vertex_functions.userdata, metas[last].xywh);
+        snapshot->meta_count += 1;
+    }
+
+    struct SnapshotHeader* header = (struct SnapshotHeader*)(capture_frame->data + offset);
+    header->size = (uint32_t)(SNAPSHOT_HEADER_SIZE + SNAPSHOT_ALIGN(fixed_size + (snapshot->meta_count * sizeof(struct SnapshotMeta))));
+    capture_frame->size = offset + header->size;
+}
+
+static void _bolt_snapshot_minimap(const struct RenderMinimapEvent* render) {
+    const size_t offset = _bolt_snapshot_begin(SNAPSHOT_MINIMAP, sizeof(struct RenderMinimapEvent));
+    if (offset == SIZE_MAX) return;
+    memcpy(SNAPSHOT_PAYLOAD(capture_frame, offset), render, sizeof(struct RenderMinimapEvent));
+}
+
+// macro for defining the per-vertex functions of snapshot events, which copy `N` values of the
+// given type from one of the arrays in the view, or zeroes if the index is out of range
+// e.g. DEFINE_SNAPSHOT_VERTEX(vertex2d_xy, Snapshot2DView, xy, int32_t, 2)
+#define DEFINE_SNAPSHOT_VERTEX(NAME, VIEW, ARRAY, TYPE, N) \
+static void _bolt_snapshot_##NAME(size_t index, void* userdata, TYPE* out) { \
+    const struct VIEW* view = userdata; \
+    if (index >= view->count) memset(out, 0, (N) * sizeof(TYPE)); \
+    else memcpy(out, view->arrays.ARRAY + (index * (N)), (N) * sizeof(TYPE)); \
+}
+
+DEFINE_SNAPSHOT_VERTEX(vertex2d_xy, Snapshot2DView, xy, int32_t, 2)
+DEFINE_SNAPSHOT_VERTEX(vertex2d_atlas_xy, Snapshot2DView, atlas_xy, int32_t, 2)
+DEFINE_SNAPSHOT_VERTEX(vertex2d_atlas_wh, Snapshot2DView, atlas_wh, int32_t, 2)
+DEFINE_SNAPSHOT_VERTEX(vertex2d_uv, Snapshot2DView, uv, double, 2)
+DEFINE_SNAPSHOT_VERTEX(vertex2d_colour, Snapshot2DView, colour, double, 4)
+DEFINE_SNAPSHOT_VERTEX(vertex3d_xyz, Snapshot3DView, xyz, int32_t, 3)
+DEFINE_SNAPSHOT_VERTEX(vertex3d_uv, Snapshot3DView, uv, double, 2)
+DEFINE_SNAPSHOT_VERTEX(vertex3d_colour, Snapshot3DView, colour, double, 4)
+
+static void _bolt_snapshot_vertex2d_decode(size_t count, void* userdata, struct Vertex2DArrays* out) {
+    const struct Snapshot2DView* view = userdata;
+    if (count > view->count) count = view->count;
+    memcpy(out->xy, view->arrays.xy, count * 2 * sizeof(int32_t));
+    memcpy(out->atlas_xy, view->arrays.atlas_xy, count * 2 * sizeof(int32_t));
+    memcpy(out->atlas_wh, view->arrays.atlas_wh, count * 2 * sizeof(int32_t));
+    memcpy(out->uv, view->arrays.uv, count * 2 * sizeof(double));
+    memcpy(out->colour, view->arrays.colour, count * 4 * sizeof(double));
+}
+
+static size_t _bolt_snapshot_vertex3d_atlas_meta(size_t index, void* userdata) {
+    const struct Snapshot3DView* view = userdata;
+    return index < view->count ? view->arrays.atlas_meta[index] : 0;
+}
+
+static void _bolt_snapshot_vertex3d_atlas_xywh(size_t meta, void* userdata, int32_t* out) {
+    const struct Snapshot3DView* view = userdata;
+    for (size_t i = 0; i < view->meta_count; i += 1) {
+        if (view->metas[i].meta == meta) {
+            memcpy(out, view->metas[i].xywh, sizeof(view->metas[i].xywh));
+            return;
+        }
+    }
+    memset(out, 0, 4 * sizeof(int32_t));
+}
+
+static void _bolt_snapshot_vertex3d_decode(size_t count, void* userdata, struct Vertex3DArrays* out) {
+    const struct Snapshot3DView* view = userdata;
+    if (count > view->count) count = view->count;
+    memcpy(out->xyz, view->arrays.xyz, count * 3 * sizeof(int32_t));
+    memcpy(out->atlas_meta, view->arrays.atlas_meta, count * sizeof(uint32_t));
+    memcpy(out->uv, view->arrays.uv, count * 2 * sizeof(double));
+    memcpy(out->colour, view->arrays.colour, count * 4 * sizeof(double));
+}
+
+static size_t _bolt_snapshot_texture_id(void* userdata) {
+    const struct SnapshotTexture* texture = userdata;
+    return texture->id;
+}
+
+static void _bolt_snapshot_texture_size(void* userdata, size_t* out) {
+    const struct SnapshotTexture* texture = userdata;
+    out[0] = texture->size[0];
+    out[1] = texture->size[1];
+}
+
+static uint8_t _bolt_snapshot_texture_compare(void* userdata, size_t x, size_t y, size_t len, const unsigned char* data) {
+    const struct SnapshotTexture* texture = userdata;
+    return managed_functions.texture_compare(texture->id, x, y, len, data);
+}
+
+static uint8_t* _bolt_snapshot_texture_data(void* userdata, size_t x, size_t y, size_t len) {
+    const struct SnapshotTexture* texture = userdata;
+    struct PluginWorker* worker = _bolt_plugin_current_worker();
+    if (len > worker->texture_read_buffer_size) {
+        free(worker->texture_read_buffer);
+        worker->texture_read_buffer = malloc(len);
+        worker->texture_read_buffer_size = len;
+    }
+    managed_functions.texture_read(texture->id, x, y, len, worker->texture_read_buffer);
+    return worker->texture_read_buffer;
+}
+
+static void _bolt_snapshot_texture_functions(struct SnapshotTexture* texture, struct TextureFunctions* out) {
+    out->userdata = texture;
+    out->id = _bolt_snapshot_texture_id;
+    out->size = _bolt_snapshot_texture_size;
+    out->compare = _bolt_snapshot_texture_compare;
+    out->data = _bolt_snapshot_texture_data;
+}
+
+static void _bolt_snapshot_dispatch_2d(struct Snapshot2D* snapshot) {
+    struct Snapshot2DView view;
+    _bolt_snapshot_2d_layout(snapshot, &view.arrays);
+    view.count = snapshot->index_count;
+    struct RenderBatch2D batch;
+    batch.screen_width = snapshot->screen_width;
+    batch.screen_height = snapshot->screen_height;
+    batch.index_count = snapshot->index_count;
+    batch.vertices_per_icon = snapshot->vertices_per_icon;
+    batch.is_minimap = snapshot->is_minimap;
+    batch.vertex_functions.userdata = &view;
+    batch.vertex_functions.xy = _bolt_snapshot_vertex2d_xy;
+    batch.vertex_functions.atlas_xy = _bolt_snapshot_vertex2d_atlas_xy;
+    batch.vertex_functions.atlas_wh = _bolt_snapshot_vertex2d_atlas_wh;
+    batch.vertex_functions.uv = _bolt_snapshot_vertex2d_uv;
+    batch.vertex_functions.colour = _bolt_snapshot_vertex2d_colour;
+    batch.vertex_functions.decode = _bolt_snapshot_vertex2d_decode;
+    _bolt_snapshot_texture_functions(&snapshot->texture, &batch.texture_functions);
+    _bolt_plugin_dispatch_2d(&batch);
+}
+
+static void _bolt_snapshot_dispatch_3d(struct Snapshot3D* snapshot) {
+    struct Snapshot3DView view;
+    void* matrix;
+    struct SnapshotMeta* metas;
+    _bolt_snapshot_3d_layout(snapshot, &view.arrays, &matrix, &metas);
+    view.count = snapshot->vertex_count;
+    view.metas = metas;
+    view.meta_count = snapshot->meta_count;
+    struct Render3D render;
+    render.vertex_count = snapshot->vertex_count;
+    render.vertex_functions.userdata = &view;
+    render.vertex_functions.xyz = _bolt_snapshot_vertex3d_xyz;
+    render.vertex_functions.atlas_meta = _bolt_snapshot_vertex3d_atlas_meta;
+    render.vertex_functions.atlas_xywh = _bolt_snapshot_vertex3d_atlas_xywh;
+    render.vertex_functions.uv = _bolt_snapshot_vertex3d_uv;
+    render.vertex_functions.colour = _bolt_snapshot_vertex3d_colour;
+    render.vertex_functions.decode = _bolt_snapshot_vertex3d_decode;
+    _bolt_snapshot_texture_functions(&snapshot->texture, &render.texture_functions);
+    render.matrix_functions = snapshot->matrix_functions;
+    render.matrix_functions.userdata = matrix;
+    _bolt_plugin_dispatch_3d(&render);
+}
+
+// looks up a window by its ID, returning NULL if it's been destroyed or if it belongs to a plugin
+// on a different worker. only the owning worker can destroy a window, so the check has to be done
+// under the lock, but after that the window is safe to use.
+static struct EmbeddedWindow* _bolt_plugin_find_window(uint64_t id) {
+    const uint64_t* id_ptr = &id;
+    _bolt_rwlock_lock_read(&windows.lock);
+    struct EmbeddedWindow* const* window = hashmap_get(windows.map, &id_ptr);
+    struct EmbeddedWindow* ret = (window && (*window)->worker == _bolt_plugin_current_worker()) ? *window : NULL;
+    _bolt_rwlock_unlock_read(&windows.lock);
+    return ret;
+}
+
+// sends out every event in a frame to this worker's plugins, in the order they were captured
+static void _bolt_snapshot_dispatch(struct SnapshotFrame* frame) {
+    const uint64_t trace_start = _bolt_trace_begin();
+    size_t offset = 0;
+    while (offset < frame->size) {
+        const struct SnapshotHeader* header = (const struct SnapshotHeader*)(frame->data + offset);
+        void* payload = SNAPSHOT_PAYLOAD(frame, offset);
+        switch (header->type) {
+            case SNAPSHOT_BATCH2D:
+                _bolt_snapshot_dispatch_2d(payload);
+                break;
+            case SNAPSHOT_RENDER3D:
+                _bolt_snapshot_dispatch_3d(payload);
+                break;
+            case SNAPSHOT_MINIMAP:
+                _bolt_plugin_dispatch_minimap(payload);
+                break;
+            case SNAPSHOT_MOUSEMOTION:
+            case SNAPSHOT_MOUSEBUTTON:
+            case SNAPSHOT_SCROLL: {
+                struct SnapshotInput* input = payload;
+                struct EmbeddedWindow* window = input->window_id ? _bolt_plugin_find_window(input->window_id) : NULL;
+                if (input->window_id && !window) break;
+                _bolt_plugin_send_input(header->type, window, &input->details, input->extra);
+                break;
+            }
+            case SNAPSHOT_WINDOW_RESIZE: {
+                struct SnapshotResize* resize = payload;
+                struct EmbeddedWindow* window = _bolt_plugin_find_window(resize->window_id);
+                if (window) _bolt_plugin_window_onresize(window, &resize->event);
+                break;
+            }
+        }
+        offset += header->size;
+    }
+    _bolt_trace_end("plugin snapshot dispatch", trace_start);
+}
+
+void _bolt_plugin_handle_2d(struct RenderBatch2D* batch) {
+    if (threaded) _bolt_snapshot_2d(batch);
+    else _bolt_plugin_dispatch_2d(batch);
+}
+
+void _bolt_plugin_handle_3d(struct Render3D* render) {
+    if (threaded) _bolt_snapshot_3d(render);
+    else _bolt_plugin_dispatch_3d(render);
+}
+
+void _bolt_plugin_handle_minimap(struct RenderMinimapEvent* render) {
+    if (threaded) _bolt_snapshot_minimap(render);
+    else _bolt_plugin_dispatch_minimap(render);
+}
+
+// sends a mouse event to plugins, or if this is the render thread in threaded mode, adds it to the
+// frame to be sent by the workers. `window` is NULL for events which aren't for a particular window.
+static void _bolt_plugin_send_input(enum SnapshotType type, struct EmbeddedWindow* window, struct MouseEvent* details, uint8_t extra) {
+    if (threaded && !current_worker) {
+        const size_t offset = _bolt_snapshot_begin(type, sizeof(struct SnapshotInput));
+        if (offset == SIZE_MAX) return;
+        struct SnapshotInput* input = SNAPSHOT_PAYLOAD(capture_frame, offset);
+        input->window_id = window ? window->id : 0;
+        input->details = *details;
+        input->extra = extra;
+        return;
+    }
+    switch (type) {
+        case SNAPSHOT_MOUSEMOTION: {
+            struct MouseMotionEvent event = {.details = details};
+            if (window) _bolt_plugin_window_onmousemotion(window, &event);
+            else _bolt_plugin_dispatch_mousemotion(&event);
+            break;
+        }
+        case SNAPSHOT_MOUSEBUTTON: {
+            struct MouseButtonEvent event = {.details = details, .button = extra};
+            if (window) _bolt_plugin_window_onmousebutton(window, &event);
+            else _bolt_plugin_dispatch_mousebutton(&event);
+            break;
+        }
+        case SNAPSHOT_SCROLL: {
+            struct MouseScrollEvent event = {.details = details, .direction = extra};
+            if (window) _bolt_plugin_window_onscroll(window, &event);
+            else _bolt_plugin_dispatch_scroll(&event);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// same as above, for window resize events
+static void _bolt_plugin_send_resize(struct EmbeddedWindow* window, struct ResizeEvent* event) {
+    if (threaded && !current_worker) {
+        const size_t offset = _bolt_snapshot_begin(SNAPSHOT_WINDOW_RESIZE, sizeof(struct SnapshotResize));
+        if (offset == SIZE_MAX) return;
+        struct SnapshotResize* resize = SNAPSHOT_PAYLOAD(capture_frame, offset);
+        resize->window_id = window->id;
+        resize->event = *event;
+        return;
+    }
+    _bolt_plugin_window_onresize(window, event);
+}
+
+// adds a command to the end of a list, returning NULL if out of memory
+static struct SurfaceCommand* _bolt_surface_command_push(struct SurfaceCommandList* list) {
+    if (list->count == list->capacity) {
+        const size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        struct SurfaceCommand* new_commands = realloc(list->commands, new_capacity * sizeof(struct SurfaceCommand));
+        if (!new_commands) return NULL;
+        list->commands = new_commands;
+        list->capacity = new_capacity;
+    }
+    struct SurfaceCommand* command = &list->commands[list->count];
+    list->count += 1;
+    return command;
+}
+
+// hands a worker's commands for the frame it just finished over to the render thread, all at once,
+// so that the render thread never draws half of what a plugin drew in a frame
+static void _bolt_plugin_publish_surface_commands(struct PluginWorker* worker) {
+    _bolt_rwlock_lock_write(&surface_commands_lock);
+    for (size_t i = 0; i < worker->surface_commands.count; i += 1) {
+        struct SurfaceCommand* command = _bolt_surface_command_push(&pending_surface_commands);
+        if (!command) break;
+        *command = worker->surface_commands.commands[i];
+    }
+    _bolt_rwlock_unlock_write(&surface_commands_lock);
+    worker->surface_commands.count = 0;
+}
+
+static void _bolt_plugin_run_surface_commands() {
+    _bolt_rwlock_lock_write(&surface_commands_lock);
+    const struct SurfaceCommandList list = pending_surface_commands;
+    pending_surface_commands = running_surface_commands;
+    running_surface_commands = list;
+    _bolt_rwlock_unlock_write(&surface_commands_lock);
+
+    for (size_t i = 0; i < running_surface_commands.count; i += 1) {
+        const struct SurfaceCommand* c = &running_surface_commands.commands[i];
+        const struct SurfaceFunctions* f = &c->functions;
+        switch (c->type) {
+            case SURFACE_COMMAND_INIT:
+                managed_functions.surface_init(c->target, c->width, c->height, c->data);
+                _bolt_signal_set(c->done);
+                break;
+            case SURFACE_COMMAND_DESTROY:
+                managed_functions.surface_destroy(f->userdata);
+                break;
+            case SURFACE_COMMAND_CLEAR:
+                f->clear(f->userdata, c->rgba[0], c->rgba[1], c->rgba[2], c->rgba[3]);
+                break;
+            case SURFACE_COMMAND_DRAWTOSCREEN:
+                f->draw_to_screen(f->userdata, c->rect[0], c->rect[1], c->rect[2], c->rect[3], c->rect[4], c->rect[5], c->rect[6], c->rect[7]);
+                break;
+            case SURFACE_COMMAND_DRAWTOSURFACE:
+                f->draw_to_surface(f->userdata, c->target, c->rect[0], c->rect[1], c->rect[2], c->rect[3], c->rect[4], c->rect[5], c->rect[6], c->rect[7]);
+                break;
+        }
+    }
+    running_surface_commands.count = 0;
+}
+
+// the functions below are used by the plugin API instead of calling SurfaceFunctions or
+// managed_functions directly. on a worker thread they queue up a command for the render thread.
+
+static void _bolt_plugin_surface_init(struct SurfaceFunctions* out, unsigned int width, unsigned int height, const void* data) {
+    if (!current_worker) {
+        managed_functions.surface_init(out, width, height, data);
+        return;
+    }
+    // this one has to be waited for, since the plugin is going to use the surface straight away
+    _bolt_rwlock_lock_write(&surface_commands_lock);
+    struct SurfaceCommand* command = _bolt_surface_command_push(&pending_surface_commands);
+    if (command) {
+        command->type = SURFACE_COMMAND_INIT;
+        command->target = out;
+        command->width = width;
+        command->height = height;
+        command->data = data;
+        command->done = &current_worker->surface_init_signal;
+    }
+    _bolt_rwlock_unlock_write(&surface_commands_lock);
+    if (!command) {
+        printf("error: out of memory creating plugin surface\n");
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    _bolt_signal_set(&render_signal);
+    _bolt_signal_wait(&current_worker->surface_init_signal);
+}
+
+static void _bolt_plugin_surface_destroy(void* userdata) {
+    if (!userdata) return;
+    if (!current_worker) {
+        managed_functions.surface_destroy(userdata);
+        return;
+    }
+    struct SurfaceCommand* command = _bolt_surface_command_push(&current_worker->surface_commands);
+    if (!command) return;
+    command->type = SURFACE_COMMAND_DESTROY;
+    command->functions.userdata = userdata;
+}
+
+static void _bolt_plugin_surface_clear(const struct SurfaceFunctions* functions, double r, double g, double b, double a) {
+    if (!functions->userdata) return;
+    if (!current_worker) {
+        functions->clear(functions->userdata, r, g, b, a);
+        return;
+    }
+    struct SurfaceCommand* command = _bolt_surface_command_push(&current_worker->surface_commands);
+    if (!command) return;
+    command->type = SURFACE_COMMAND_CLEAR;
+    command->functions = *functions;
+    command->rgba[0] = r;
+    command->rgba[1] = g;
+    command->rgba[2] = b;
+    command->rgba[3] = a;
+}
+
+static void _bolt_plugin_surface_draw_to_screen(const struct SurfaceFunctions* functions, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh) {
+    if (!functions->userdata) return;
+    if (!current_worker) {
+        functions->draw_to_screen(functions->userdata, sx, sy, sw, sh, dx, dy, dw, dh);
+        return;
+    }
+    struct SurfaceCommand* command = _bolt_surface_command_push(&current_worker->surface_commands);
+    if (!command) return;
+    const int rect[8] = {sx, sy, sw, sh, dx, dy, dw, dh};
+    command->type = SURFACE_COMMAND_DRAWTOSCREEN;
+    command->functions = *functions;
+    memcpy(command->rect, rect, sizeof(rect));
+}
+
+static void _bolt_plugin_surface_draw_to_surface(const struct SurfaceFunctions* functions, void* target, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh) {
+    if (!functions->userdata || !target) return;
+    if (!current_worker) {
+        functions->draw_to_surface(functions->userdata, target, sx, sy, sw, sh, dx, dy, dw, dh);
+        return;
+    }
+    struct SurfaceCommand* command = _bolt_surface_command_push(&current_worker->surface_commands);
+    if (!command) return;
+    const int rect[8] = {sx, sy, sw, sh, dx, dy, dw, dh};
+    command->type = SURFACE_COMMAND_DRAWTOSURFACE;
+    command->functions = *functions;
+    command->target = target;
+    memcpy(command->rect, rect, sizeof(rect));
+}
+
+// reads the PNG file at `path`, and returns a reference to its decoded data in image_cache, which
+// the caller must release. it's only decoded if it's not already in the cache. on failure, returns
+// NULL and writes a message into `error`. this doesn't use lua, so it's safe to call from any thread.
+static struct CachedImage* _bolt_plugin_load_png(const char* path, char* error, size_t error_size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        snprintf(error, error_size, "error opening file '%s'", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    const long png_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void* png = png_size > 0 ? malloc(png_size) : NULL;
+    if (!png || fread(png, 1, png_size, f) < png_size) {
+        fclose(f);
+        free(png);
+        snprintf(error, error_size, "error reading file '%s'", path);
+        return NULL;
+    }
+    fclose(f);
+
+    const uint64_t hash = _bolt_imagecache_hash(png, png_size);
+    struct CachedImage* image = _bolt_imagecache_acquire(&image_cache, hash, png, png_size);
+    if (image) {
+        free(png);
+        return image;
+    }
+
+#define CALL_SPNG(FUNC, ...) err = FUNC(__VA_ARGS__); if(err){snprintf(error,error_size,"error decoding file '%s': " #FUNC " returned %i",path,err);spng_ctx_free(spng);free(png);free(rgba);return NULL;}
+    void* rgba = NULL;
+    size_t rgba_size;
+    int err;
+    spng_ctx* spng = spng_ctx_new(0);
+    CALL_SPNG(spng_set_png_buffer, spng, png, png_size);
+    struct spng_ihdr ihdr;
+    CALL_SPNG(spng_get_ihdr, spng, &ihdr)
+    CALL_SPNG(spng_decoded_image_size, spng, SPNG_FMT_RGBA8, &rgba_size)
+    rgba = malloc(rgba_size);
+    CALL_SPNG(spng_decode_image, spng, rgba, rgba_size, SPNG_FMT_RGBA8, 0)
+    spng_ctx_free(spng);
+#undef CALL_SPNG
+
+    // the cache keeps the file, to compare against next time
+    image = _bolt_imagecache_insert(&image_cache, hash, png, png_size, ihdr.width, ihdr.height, rgba, rgba_size);
+    if (!image) snprintf(error, error_size, "out of memory loading file '%s'", path);
+    return image;
+}
+
+// writes the full path of the PNG file which a plugin refers to by `path` into `out`, which must be
+// big enough for plugin->path_length + path_length + sizeof(".png") bytes
+static void _bolt_plugin_png_path(const struct Plugin* plugin, const char* path, size_t path_length, char* out) {
+    const char extension[] = ".png";
+    memcpy(out, plugin->path, plugin->path_length);
+    memcpy(out + plugin->path_length, path, path_length + 1);
+    for (char* c = out + plugin->path_length; *c; c += 1) {
+        if (*c == '.') *c = '/';
+    }
+    memcpy(out + plugin->path_length + path_length, extension, sizeof(extension));
+}
+
+static void _bolt_plugin_free_png_job(struct PngJob* job) {
+    _bolt_imagecache_release(&image_cache, job->image);
+    free(job->path);
+    free(job);
+}
+
+// the main function for png_thread. a job stays at the front of png_queue while it's being loaded,
+// so that _bolt_plugin_free can still find it there.
+static void _bolt_plugin_png_thread_main(void* arg) {
+    while (1) {
+        _bolt_rwlock_lock_read(&png_lock);
+        struct PngJob* job = png_queue;
+        const uint8_t stop = png_thread_stop;
+        _bolt_rwlock_unlock_read(&png_lock);
+        if (stop) break;
+        if (!job) {
+            _bolt_signal_wait(&png_signal);
+            continue;
+        }
+
+        const uint64_t trace_start = _bolt_trace_begin();
+        job->image = _bolt_plugin_load_png(job->path, job->error, sizeof(job->error));
+        _bolt_trace_end("plugin load png", trace_start);
+
+        _bolt_rwlock_lock_write(&png_lock);
+        png_queue = job->next;
+        job->next = NULL;
+        struct PngJob** link = &png_done_jobs;
+        while (*link) link = &(*link)->next;
+        *link = job;
+        _bolt_rwlock_unlock_write(&png_lock);
+    }
+}
+
+// turns any loaded PNGs belonging to this worker's plugins into surfaces, and calls the callbacks
+// that were passed to createsurfacefrompngasync for them
+static void _bolt_plugin_finish_png_jobs() {
+    const struct PluginWorker* worker = _bolt_plugin_current_worker();
+    while (1) {
+        // one job at a time, since a callback might stop its plugin, which changes the list
+        _bolt_rwlock_lock_write(&png_lock);
+        struct PngJob** link = &png_done_jobs;
+        while (*link && (*link)->plugin && (*link)->plugin->worker != worker) link = &(*link)->next;
+        struct PngJob* job = *link;
+        if (job) *link = job->next;
+        _bolt_rwlock_unlock_write(&png_lock);
+        if (!job) break;
+
+        // a plugin can only be stopped by its own worker, or while the pool is idle, so `plugin`
+        // can't be freed by anything else from here on
+        struct Plugin* plugin = job->plugin;
+        if (plugin && !_bolt_plugin_check_budget(plugin, PLUGIN_EVENT_SWAPBUFFERS)) {
+            lua_State* state = plugin->state;
+            lua_rawgeti(state, LUA_REGISTRYINDEX, job->callback_ref); /*stack: callback*/
+            lua_rawgeti(state, LUA_REGISTRYINDEX, job->surface_ref); /*stack: callback, surface*/
+            luaL_unref(state, LUA_REGISTRYINDEX, job->callback_ref);
+            luaL_unref(state, LUA_REGISTRYINDEX, job->surface_ref);
+            int nargs;
+            if (job->image) {
+                struct SurfaceFunctions* functions = lua_touserdata(state, -1);
+                _bolt_plugin_surface_init(functions, job->image->width, job->image->height, job->image->rgba);
+                lua_pushinteger(state, job->image->width);
+                lua_pushinteger(state, job->image->height); /*stack: callback, surface, width, height*/
+                nargs = 3;
+            } else {
+                char error_buffer[1100];
+                lua_pop(state, 1);
+                lua_pushnil(state);
+                SNPUSHSTRING(state, error_buffer, "createsurfacefrompngasync: %s", job->error); /*stack: callback, nil, error*/
+                nargs = 2;
+            }
+            if (_bolt_plugin_pcall(plugin, nargs, PLUGIN_EVENT_SWAPBUFFERS)) { /*stack: ?error*/
+                const char* e = lua_tolstring(state, -1, 0);
+                printf("plugin callback createsurfacefrompngasync error: %s\n", e);
+                lua_pop(state, 1); /*stack: (empty)*/
+                _bolt_plugin_stop(plugin->id, plugin->id_length);
+            }
+        }
+        _bolt_plugin_free_png_job(job);
+    }
+}
+
+// stops png_thread, if it was started, and frees all the jobs without calling their callbacks
+static void _bolt_plugin_close_png_thread() {
+    _bolt_rwlock_lock_write(&png_lock);
+    const uint8_t started = png_thread_started;
+    png_thread_stop = 1;
+    _bolt_rwlock_unlock_write(&png_lock);
+    if (started) {
+        _bolt_signal_set(&png_signal);
+        _bolt_thread_join(&png_thread);
+    }
+
+    struct PngJob* lists[] = {png_queue, png_done_jobs};
+    for (size_t i = 0; i < sizeof(lists) / sizeof(*lists); i += 1) {
+        struct PngJob* job = lists[i];
+        while (job) {
+            struct PngJob* next = job->next;
+            _bolt_plugin_free_png_job(job);
+            job = next;
+        }
+    }
+    png_queue = NULL;
+    png_done_jobs = NULL;
+    png_thread_started = 0;
+    png_thread_stop = 0;
+}
+
+// the main function for every worker in the pool other than worker 0
+static void _bolt_plugin_pool_worker_main(void* arg) {
+    struct PluginWorker* worker = arg;
+    current_worker = worker;
+    while (1) {
+        _bolt_signal_wait(&worker->start_signal);
+        if (worker->stop) break;
+        _bolt_snapshot_dispatch(pool_frame);
+        struct SwapBuffersEvent event;
+        _bolt_plugin_handle_swapbuffers(&event);
+        _bolt_signal_set(&worker->done_signal);
+    }
+}
+
+// tells workers 1 to `count - 1` to exit, and waits for them to do so
+static void _bolt_plugin_join_pool(size_t count) {
+    for (size_t i = 1; i < count; i += 1) {
+        workers[i].stop = 1;
+        _bolt_signal_set(&workers[i].start_signal);
+        _bolt_thread_join(&workers[i].thread);
+    }
+}
+
+// the main function for worker 0, which hands each frame out to the rest of the pool. any surface
+// commands are passed on to the render thread in worker order, after every worker has finished, so
+// plugins' drawing is composited in the same order every frame.
+static void _bolt_plugin_worker_main(void* arg) {
+    struct PluginWorker* worker = arg;
+    current_worker = worker;
+    while (1) {
+        _bolt_signal_wait(&worker->start_signal);
+        _bolt_rwlock_lock_read(&frame_lock);
+        const uint8_t busy = worker_busy;
+        const uint8_t stop = worker_stop;
+        struct SnapshotFrame* frame = dispatch_frame;
+        _bolt_rwlock_unlock_read(&frame_lock);
+
+        if (busy) {
+            pool_frame = frame;
+            for (size_t i = 1; i < worker_count; i += 1) {
+                _bolt_signal_set(&workers[i].start_signal);
+            }
+            _bolt_snapshot_dispatch(frame);
+            struct SwapBuffersEvent event;
+            _bolt_plugin_handle_swapbuffers(&event);
+            for (size_t i = 1; i < worker_count; i += 1) {
+                _bolt_signal_wait(&workers[i].done_signal);
+            }
+
+            // the rest of the pool is idle now, so it's safe to start, replace or free any plugin here
+            _bolt_plugin_handle_messages();
+            _bolt_plugin_send_profiles();
+            for (size_t i = 0; i < worker_count; i += 1) {
+                _bolt_plugin_publish_surface_commands(&workers[i]);
+            }
+            _bolt_rwlock_lock_write(&frame_lock);
+            worker_busy = 0;
+            _bolt_rwlock_unlock_write(&frame_lock);
+        }
+        if (stop) break;
+    }
+    _bolt_plugin_join_pool(worker_count);
+    _bolt_rwlock_lock_write(&frame_lock);
+    worker_exited = 1;
+    _bolt_rwlock_unlock_write(&frame_lock);
+    _bolt_signal_set(&render_signal);
+}
+
+// called on the render thread at the end of each frame
+static void _bolt_plugin_submit_frame() {
+    _bolt_rwlock_lock_write(&frame_lock);
+    const uint8_t busy = worker_busy;
+    if (!busy) {
+        struct SnapshotFrame* frame = dispatch_frame;
+        dispatch_frame = capture_frame;
+        capture_frame = frame;
+        worker_busy = 1;
+    }
+    _bolt_rwlock_unlock_write(&frame_lock);
+    if (busy) {
+        // the workers are still going, so the render events in this frame will never be looked at.
+        // input events are kept and sent out with the next frame that the workers get.
+        _bolt_snapshot_drop_render_events(capture_frame);
+    } else {
+        capture_frame->size = 0;
+        _bolt_signal_set(&workers[0].start_signal);
+    }
+}
+
+static void _bolt_plugin_free_worker(struct PluginWorker* worker) {
+    for (size_t i = 0; i < PLUGIN_EVENT_ENUM_SIZE; i += 1) {
+        free(worker->subscribers[i].plugins);
+    }
+    free(worker->surface_commands.commands);
+    free(worker->vertex_arrays_buffer);
+    free(worker->texture_read_buffer);
+    memset(worker, 0, sizeof(*worker));
+}
+
+static void _bolt_plugin_start_workers() {
+    // one thread is left for the game to render on, unless overridden by BOLT_PLUGIN_WORKERS
+    size_t count = _bolt_thread_cpu_count() - 1;
+    const char* count_env = getenv("BOLT_PLUGIN_WORKERS");
+    if (count_env && *count_env) count = strtoul(count_env, NULL, 10);
+    if (count < 1) count = 1;
+    if (count > PLUGIN_MAX_WORKERS) count = PLUGIN_MAX_WORKERS;
+    workers = calloc(count, sizeof(struct PluginWorker));
+    if (!workers) {
+        printf("error: out of memory starting plugin threads, plugins will run on the render thread instead\n");
+        return;
+    }
+    for (size_t i = 0; i < count; i += 1) {
+        _bolt_signal_init(&workers[i].start_signal);
+        _bolt_signal_init(&workers[i].done_signal);
+        _bolt_signal_init(&workers[i].surface_init_signal);
+    }
+    _bolt_signal_init(&render_signal);
+    _bolt_rwlock_init(&frame_lock);
+    _bolt_rwlock_init(&surface_commands_lock);
+    worker_busy = 0;
+    worker_stop = 0;
+    worker_exited = 0;
+    capture_frame = &snapshot_frames[0];
+    dispatch_frame = &snapshot_frames[1];
+
+    // start the rest of the pool before worker 0, since worker 0 needs to know how many there are.
+    // if some of them fail to start, just carry on with fewer.
+    worker_count = count;
+    for (size_t i = 1; i < count; i += 1) {
+        if (_bolt_thread_start(&workers[i].thread, _bolt_plugin_pool_worker_main, &workers[i])) {
+            worker_count = i;
+            break;
+        }
+    }
+    if (_bolt_thread_start(&workers[0].thread, _bolt_plugin_worker_main, &workers[0])) {
+        printf("error: failed to start plugin thread, plugins will run on the render thread instead\n");
+        _bolt_plugin_join_pool(worker_count);
+        for (size_t i = 0; i < count; i += 1) {
+            _bolt_signal_destroy(&workers[i].start_signal);
+            _bolt_signal_destroy(&workers[i].done_signal);
+            _bolt_signal_destroy(&workers[i].surface_init_signal);
+        }
+        _bolt_signal_destroy(&render_signal);
+        _bolt_rwlock_destroy(&frame_lock);
+        _bolt_rwlock_destroy(&surface_commands_lock);
+        free(workers);
+        workers = NULL;
+        worker_count = 0;
+        return;
+    }
+    for (size_t i = worker_count; i < count; i += 1) {
+        _bolt_signal_destroy(&workers[i].start_signal);
+        _bolt_signal_destroy(&workers[i].done_signal);
+        _bolt_signal_destroy(&workers[i].surface_init_signal);
+    }
+    threaded = 1;
+}
+
+// stops all the worker threads. the PluginWorker structs are left alone, since plugins still refer
+// to them, and are freed by _bolt_plugin_close after the plugins.
+static void _bolt_plugin_stop_workers() {
+    _bolt_rwlock_lock_write(&frame_lock);
+    worker_stop = 1;
+    _bolt_rwlock_unlock_write(&frame_lock);
+    _bolt_signal_set(&workers[0].start_signal);
+
+    // workers may be waiting on the render thread to create a surface for them, so keep doing
+    // that until they're gone
+    while (1) {
+        _bolt_rwlock_lock_read(&frame_lock);
+        const uint8_t exited = worker_exited;
+        _bolt_rwlock_unlock_read(&frame_lock);
+        _bolt_plugin_run_surface_commands();
+        if (exited) break;
+        _bolt_signal_wait(&render_signal);
+    }
+    _bolt_thread_join(&workers[0].thread);
+    threaded = 0;
+
+    for (size_t i = 0; i < 2; i += 1) {
+        free(snapshot_frames[i].data);
+        memset(&snapshot_frames[i], 0, sizeof(snapshot_frames[i]));
+    }
+    free(pending_surface_commands.commands);
+    free(running_surface_commands.commands);
+    memset(&pending_surface_commands, 0, sizeof(pending_surface_commands));
+    memset(&running_surface_commands, 0, sizeof(running_surface_commands));
+    for (size_t i = 0; i < worker_count; i += 1) {
+        _bolt_signal_destroy(&workers[i].start_signal);
+        _bolt_signal_destroy(&workers[i].done_signal);
+        _bolt_signal_destroy(&workers[i].surface_init_signal);
+    }
+    _bolt_signal_destroy(&render_signal);
+    _bolt_rwlock_destroy(&frame_lock);
+    _bolt_rwlock_destroy(&surface_commands_lock);
+}
+
 static int api_apiversion(lua_State* state) {
     _bolt_check_argc(state, 0, "apiversion");
     lua_pushnumber(state, API_VERSION_MAJOR);
@@ -743,20 +2236,12 @@ static int api_checkversion(lua_State* state) {
 
 static int api_time(lua_State* state) {
     _bolt_check_argc(state, 0, "time");
-#if defined(_WIN32)
-    LARGE_INTEGER ticks;
-    if (QueryPerformanceCounter(&ticks)) {
-        const uint64_t microseconds = (ticks.QuadPart * 1000000) / performance_frequency.QuadPart;
+    const uint64_t microseconds = _bolt_plugin_time();
+    if (microseconds) {
         lua_pushinteger(state, microseconds);
     } else {
         lua_pushnil(state);
     }
-#else
-    struct timespec s;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &s);
-    const uint64_t microseconds = (s.tv_sec * 1000000) + (s.tv_nsec / 1000);
-    lua_pushinteger(state, microseconds);
-#endif
     return 1;
 }
 
@@ -786,7 +2271,7 @@ static int api_createsurface(lua_State* state) {
     const lua_Integer w = lua_tointeger(state, 1);
     const lua_Integer h = lua_tointeger(state, 2);
     struct SurfaceFunctions* functions = lua_newuserdata(state, sizeof(struct SurfaceFunctions));
-    managed_functions.surface_init(functions, w, h, NULL);
+    _bolt_plugin_surface_init(functions, w, h, NULL);
     lua_getfield(state, LUA_REGISTRYINDEX, SURFACE_META_REGISTRYNAME);
     lua_setmetatable(state, -2);
     return 1;
@@ -801,12 +2286,12 @@ static int api_createsurfacefromrgba(lua_State* state) {
     const void* rgba = lua_tolstring(state, 3, &length);
     struct SurfaceFunctions* functions = lua_newuserdata(state, sizeof(struct SurfaceFunctions));
     if (length >= req_length) {
-        managed_functions.surface_init(functions, w, h, rgba);
+        _bolt_plugin_surface_init(functions, w, h, rgba);
     } else {
         uint8_t* ud = lua_newuserdata(state, req_length);
         memcpy(ud, rgba, length);
         memset(ud + length, 0, req_length - length);
-        managed_functions.surface_init(functions, w, h, ud);
+        _bolt_plugin_surface_init(functions, w, h, ud);
         lua_pop(state, 1);
     }
     lua_getfield(state, LUA_REGISTRYINDEX, SURFACE_META_REGISTRYNAME);
@@ -816,59 +2301,91 @@ static int api_createsurfacefromrgba(lua_State* state) {
 
 static int api_createsurfacefrompng(lua_State* state) {
     _bolt_check_argc(state, 1, "createsurfacefrompng");
-    const char extension[] = ".png";
-    size_t rgba_size, path_length;
+    size_t path_length;
     const char* path = lua_tolstring(state, 1, &path_length);
     lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME);
     const struct Plugin* plugin = lua_touserdata(state, -1);
-    const size_t full_path_length = plugin->path_length + path_length + sizeof(extension);
-    char* full_path = lua_newuserdata(state, full_path_length);
-    memcpy(full_path, plugin->path, plugin->path_length);
-    memcpy(full_path + plugin->path_length, path, path_length + 1);
-    for (char* c = full_path + plugin->path_length; *c; c += 1) {
-        if (*c == '.') *c = '/';
+    char* full_path = lua_newuserdata(state, plugin->path_length + path_length + sizeof(".png"));
+    _bolt_plugin_png_path(plugin, path, path_length, full_path);
+    char error[1024];
+    struct CachedImage* image = _bolt_plugin_load_png(full_path, error, sizeof(error));
+    if (!image) {
+        char error_buffer[1100];
+        SNPUSHSTRING(state, error_buffer, "createsurfacefrompng: %s", error);
+        lua_error(state);
     }
-    memcpy(full_path + plugin->path_length + path_length, extension, sizeof(extension));
-    FILE* f = fopen(full_path, "rb");
-    if (!f) {
-        char error_buffer[65536];
-        SNPUSHSTRING(state, error_buffer, "createsurfacefrompng: error opening file '%s'", (char*)full_path);
+    lua_pop(state, 2);
+
+    lua_pushinteger(state, image->width);
+    lua_pushinteger(state, image->height);
+    struct SurfaceFunctions* functions = lua_newuserdata(state, sizeof(struct SurfaceFunctions));
+    _bolt_plugin_surface_init(functions, image->width, image->height, image->rgba);
+    lua_getfield(state, LUA_REGISTRYINDEX, SURFACE_META_REGISTRYNAME);
+    lua_setmetatable(state, -2);
+    _bolt_imagecache_release(&image_cache, image);
+    return 3;
+}
+
+static int api_createsurfacefrompngasync(lua_State* state) {
+    _bolt_check_argc(state, 2, "createsurfacefrompngasync");
+    if (!lua_isfunction(state, 2)) {
+        PUSHSTRING(state, "createsurfacefrompngasync: second argument must be a function");
         lua_error(state);
     }
-    fseek(f, 0, SEEK_END);
-    const long png_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    void* png = lua_newuserdata(state, png_size);
-    if (fread(png, 1, png_size, f) < png_size) {
-        char error_buffer[65536];
-        fclose(f);
-        SNPUSHSTRING(state, error_buffer, "createsurfacefrompng: error reading file '%s'", (char*)full_path);
+    size_t path_length;
+    const char* path = lua_tolstring(state, 1, &path_length);
+    lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME);
+    struct Plugin* plugin = lua_touserdata(state, -1);
+    lua_pop(state, 1);
+    struct PngJob* job = malloc(sizeof(struct PngJob));
+    char* full_path = malloc(plugin->path_length + path_length + sizeof(".png"));
+    if (!job || !full_path) {
+        free(job);
+        free(full_path);
+        PUSHSTRING(state, "createsurfacefrompngasync: out of memory");
         lua_error(state);
     }
-    fclose(f);
-
-#define CALL_SPNG(FUNC, ...) err = FUNC(__VA_ARGS__); if(err){char b[65536];free(rgba);SNPUSHSTRING(state,b,"createsurfacefrompng: error decoding file '%s': " #FUNC " returned %i",(char*)full_path,err);lua_error(state);}
-    void* rgba = NULL;
-    int err;
-    spng_ctx* spng = spng_ctx_new(0);
-    CALL_SPNG(spng_set_png_buffer, spng, png, png_size);
-    struct spng_ihdr ihdr;
-    CALL_SPNG(spng_get_ihdr, spng, &ihdr)
-    CALL_SPNG(spng_decoded_image_size, spng, SPNG_FMT_RGBA8, &rgba_size)
-    rgba = malloc(rgba_size);
-    CALL_SPNG(spng_decode_image, spng, rgba, rgba_size, SPNG_FMT_RGBA8, 0)
-    spng_ctx_free(spng);
-    lua_pop(state, 3);
-#undef CALL_SPNG
+    _bolt_plugin_png_path(plugin, path, path_length, full_path);
 
-    lua_pushinteger(state, ihdr.width);
-    lua_pushinteger(state, ihdr.height);
+    // the pending surface has no texture yet, which all the surface functions treat as a no-op
     struct SurfaceFunctions* functions = lua_newuserdata(state, sizeof(struct SurfaceFunctions));
-    managed_functions.surface_init(functions, ihdr.width, ihdr.height, rgba);
+    memset(functions, 0, sizeof(*functions));
     lua_getfield(state, LUA_REGISTRYINDEX, SURFACE_META_REGISTRYNAME);
     lua_setmetatable(state, -2);
-    free(rgba);
-    return 3;
+    lua_pushvalue(state, -1);
+    job->surface_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+    lua_pushvalue(state, 2);
+    job->callback_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+    job->plugin = plugin;
+    job->path = full_path;
+    job->image = NULL;
+    job->error[0] = '\0';
+    job->next = NULL;
+
+    _bolt_rwlock_lock_write(&png_lock);
+    if (!png_thread_started) {
+        png_thread_started = !_bolt_thread_start(&png_thread, _bolt_plugin_png_thread_main, NULL);
+    }
+    const uint8_t started = png_thread_started;
+    if (started) {
+        struct PngJob** link = &png_queue;
+        while (*link) link = &(*link)->next;
+        *link = job;
+    }
+    _bolt_rwlock_unlock_write(&png_lock);
+    if (!started) {
+        // no thread to load it on, so load it now and let the next SwapBuffers finish it as usual
+        printf("error: failed to start png thread, loading '%s' synchronously\n", full_path);
+        job->image = _bolt_plugin_load_png(job->path, job->error, sizeof(job->error));
+        _bolt_rwlock_lock_write(&png_lock);
+        struct PngJob** link = &png_done_jobs;
+        while (*link) link = &(*link)->next;
+        *link = job;
+        _bolt_rwlock_unlock_write(&png_lock);
+    } else {
+        _bolt_signal_set(&png_signal);
+    }
+    return 1;
 }
 
 static int api_createwindow(lua_State* state) {
@@ -876,8 +2393,15 @@ static int api_createwindow(lua_State* state) {
     
     // push a window onto the stack as the return value, then initialise it
     struct EmbeddedWindow* window = lua_newuserdata(state, sizeof(struct EmbeddedWindow));
+    lua_getfield(state, LUA_REGISTRYINDEX, PLUGIN_REGISTRYNAME);
+    const struct Plugin* plugin = lua_touserdata(state, -1);
+    lua_pop(state, 1);
+    _bolt_rwlock_lock_write(&windows.lock);
     window->id = next_window_id;
+    next_window_id += 1;
+    _bolt_rwlock_unlock_write(&windows.lock);
     window->plugin = state;
+    window->worker = plugin->worker;
     _bolt_rwlock_init(&window->lock);
     _bolt_rwlock_init(&window->input_lock);
     window->metadata.x = lua_tointeger(state, 1);
@@ -885,10 +2409,9 @@ static int api_createwindow(lua_State* state) {
     window->metadata.width = lua_tointeger(state, 3);
     window->metadata.height = lua_tointeger(state, 4);
     memset(&window->input, 0, sizeof(window->input));
-    managed_functions.surface_init(&window->surface_functions, window->metadata.width, window->metadata.height, NULL);
+    _bolt_plugin_surface_init(&window->surface_functions, window->metadata.width, window->metadata.height, NULL);
     lua_getfield(state, LUA_REGISTRYINDEX, WINDOW_META_REGISTRYNAME);
     lua_setmetatable(state, -2);
-    next_window_id += 1;
 
     // create an empty event table in the registry for this window
     lua_getfield(state, LUA_REGISTRYINDEX, WINDOWS_REGISTRYNAME);
@@ -990,6 +2513,111 @@ static int api_batch2d_vertexcolour(lua_State* state) {
     return 4;
 }
 
+// pushes a flat array of `count` integers onto the stack and sets it as field `name` of the table
+// just below it
+static void _bolt_push_int_array(lua_State* state, const char* name, const int32_t* values, size_t count) {
+    lua_createtable(state, count, 0);
+    for (size_t i = 0; i < count; i += 1) {
+        lua_pushinteger(state, values[i]);
+        lua_rawseti(state, -2, i + 1);
+    }
+    lua_setfield(state, -2, name);
+}
+
+// same as above but for floating-point numbers
+static void _bolt_push_number_array(lua_State* state, const char* name, const double* values, size_t count) {
+    lua_createtable(state, count, 0);
+    for (size_t i = 0; i < count; i += 1) {
+        lua_pushnumber(state, values[i]);
+        lua_rawseti(state, -2, i + 1);
+    }
+    lua_setfield(state, -2, name);
+}
+
+static int api_batch2d_vertices(lua_State* state) {
+    _bolt_check_argc(state, 1, "batch2d_vertices");
+    struct RenderBatch2D* batch = lua_touserdata(state, 1);
+    const size_t count = batch->index_count;
+
+    // one allocation for all five arrays, doubles first to keep them aligned. this is a userdata
+    // rather than the vertex arrays buffer so that it doesn't overwrite any arrays the plugin got from
+    // vertexarrays(). lua_newuserdata raises a Lua error if it's out of memory, and the GC frees it.
+    uint8_t* block = lua_newuserdata(state, count * ((6 * sizeof(double)) + (6 * sizeof(int32_t))));
+    struct Vertex2DArrays arrays;
+    arrays.uv = (double*)block;
+    arrays.colour = arrays.uv + (count * 2);
+    arrays.xy = (int32_t*)(arrays.colour + (count * 4));
+    arrays.atlas_xy = arrays.xy + (count * 2);
+    arrays.atlas_wh = arrays.atlas_xy + (count * 2);
+    batch->vertex_functions.decode(count, batch->vertex_functions.userdata, &arrays);
+
+    lua_createtable(state, 0, 5);
+    _bolt_push_int_array(state, "xy", arrays.xy, count * 2);
+    _bolt_push_int_array(state, "atlasxy", arrays.atlas_xy, count * 2);
+    _bolt_push_int_array(state, "atlaswh", arrays.atlas_wh, count * 2);
+    _bolt_push_number_array(state, "uv", arrays.uv, count * 2);
+    _bolt_push_number_array(state, "colour", arrays.colour, count * 4);
+    return 1;
+}
+
+// returns a buffer of at least the given size, which stays valid until the next call, or NULL if
+// out of memory. the previous buffer is kept if a bigger one can't be allocated.
+static uint8_t* _bolt_vertex_arrays_buffer(size_t size) {
+    struct PluginWorker* worker = _bolt_plugin_current_worker();
+    if (size > worker->vertex_arrays_buffer_size) {
+        uint8_t* buffer = malloc(size);
+        if (!buffer) return NULL;
+        free(worker->vertex_arrays_buffer);
+        worker->vertex_arrays_buffer = buffer;
+        worker->vertex_arrays_buffer_size = size;
+    }
+    return worker->vertex_arrays_buffer;
+}
+
+// pushes an FFI cdata object of the given pointer type, pointing to `ptr`. the ffi library is
+// loaded into the registry the first time a plugin does this, and never made visible to the
+// plugin itself, so plugins which don't use this pay nothing for it and can't use `ffi` directly.
+static void _bolt_push_ffi_pointer(lua_State* state, const char* ctype, const void* ptr) {
+    PUSHSTRING(state, FFI_REGISTRYNAME);
+    lua_gettable(state, LUA_REGISTRYINDEX);
+    if (lua_isnil(state, -1)) {
+        lua_pop(state, 1);
+        lua_pushcfunction(state, luaopen_ffi);
+        lua_call(state, 0, 1);
+        lua_getfield(state, -1, "cdef");
+        PUSHSTRING(state, FFI_CDEFS);
+        lua_call(state, 1, 0);
+        PUSHSTRING(state, FFI_REGISTRYNAME);
+        lua_pushvalue(state, -2);
+        lua_settable(state, LUA_REGISTRYINDEX);
+    }
+    lua_getfield(state, -1, "cast");
+    lua_pushstring(state, ctype);
+    lua_pushlightuserdata(state, (void*)ptr);
+    lua_call(state, 2, 1);
+    lua_remove(state, -2);
+}
+
+static int api_batch2d_vertexarrays(lua_State* state) {
+    _bolt_check_argc(state, 1, "batch2d_vertexarrays");
+    struct RenderBatch2D* batch = lua_touserdata(state, 1);
+    const size_t count = batch->index_count;
+    uint8_t* buffer = _bolt_vertex_arrays_buffer(sizeof(struct Vertex2DArrays) + (count * ((6 * sizeof(double)) + (6 * sizeof(int32_t)))));
+    if (!buffer) {
+        PUSHSTRING(state, "batch2d_vertexarrays: out of memory");
+        lua_error(state);
+    }
+    struct Vertex2DArrays* arrays = (struct Vertex2DArrays*)buffer;
+    arrays->uv = (double*)(buffer + sizeof(struct Vertex2DArrays));
+    arrays->colour = arrays->uv + (count * 2);
+    arrays->xy = (int32_t*)(arrays->colour + (count * 4));
+    arrays->atlas_xy = arrays->xy + (count * 2);
+    arrays->atlas_wh = arrays->atlas_xy + (count * 2);
+    batch->vertex_functions.decode(count, batch->vertex_functions.userdata, arrays);
+    _bolt_push_ffi_pointer(state, "const struct BoltVertex2DArrays*", arrays);
+    return 1;
+}
+
 static int api_batch2d_textureid(lua_State* state) {
     _bolt_check_argc(state, 1, "batch2d_textureid");
     struct RenderBatch2D* render = lua_touserdata(state, 1);
@@ -1026,7 +2654,8 @@ static int api_batch2d_texturedata(lua_State* state) {
     const size_t x = lua_tointeger(state, 2);
     const size_t y = lua_tointeger(state, 3);
     const size_t len = lua_tointeger(state, 4);
-    const uint8_t* ret = render->texture_functions.data(render->texture_functions.userdata, x, y);
+    const uint8_t* ret = render->texture_functions.data(render->texture_functions.userdata, x, y, len);
+    if (!ret) return luaL_error(state, "batch2d_texturedata: out of memory");
     lua_pushlstring(state, (const char*)ret, len);
     return 1;
 }
@@ -1059,7 +2688,7 @@ static int api_surface_clear(lua_State* state) {
     switch (argc) {
         case 1: {
             const struct SurfaceFunctions* functions = lua_touserdata(state, 1);
-            functions->clear(functions->userdata, 0.0, 0.0, 0.0, 0.0);
+            _bolt_plugin_surface_clear(functions, 0.0, 0.0, 0.0, 0.0);
             break;
         }
         case 4: {
@@ -1067,7 +2696,7 @@ static int api_surface_clear(lua_State* state) {
             const double r = lua_tonumber(state, 2);
             const double g = lua_tonumber(state, 3);
             const double b = lua_tonumber(state, 4);
-            functions->clear(functions->userdata, r, g, b, 1.0);
+            _bolt_plugin_surface_clear(functions, r, g, b, 1.0);
             break;
         }
         case 5: {
@@ -1076,7 +2705,7 @@ static int api_surface_clear(lua_State* state) {
             const double g = lua_tonumber(state, 3);
             const double b = lua_tonumber(state, 4);
             const double a = lua_tonumber(state, 5);
-            functions->clear(functions->userdata, r, g, b, a);
+            _bolt_plugin_surface_clear(functions, r, g, b, a);
             break;
         }
         default: {
@@ -1098,7 +2727,7 @@ static int api_surface_drawtoscreen(lua_State* state) {
     const int dy = lua_tointeger(state, 7);
     const int dw = lua_tointeger(state, 8);
     const int dh = lua_tointeger(state, 9);
-    functions->draw_to_screen(functions->userdata, sx, sy, sw, sh, dx, dy, dw, dh);
+    _bolt_plugin_surface_draw_to_screen(functions, sx, sy, sw, sh, dx, dy, dw, dh);
     return 0;
 }
 
@@ -1114,7 +2743,7 @@ static int api_surface_drawtosurface(lua_State* state) {
     const int dy = lua_tointeger(state, 8);
     const int dw = lua_tointeger(state, 9);
     const int dh = lua_tointeger(state, 10);
-    functions->draw_to_surface(functions->userdata, target->userdata, sx, sy, sw, sh, dx, dy, dw, dh);
+    _bolt_plugin_surface_draw_to_surface(functions, target->userdata, sx, sy, sw, sh, dx, dy, dw, dh);
     return 0;
 }
 
@@ -1130,7 +2759,7 @@ static int api_surface_drawtowindow(lua_State* state) {
     const int dy = lua_tointeger(state, 8);
     const int dw = lua_tointeger(state, 9);
     const int dh = lua_tointeger(state, 10);
-    functions->draw_to_surface(functions->userdata, target->surface_functions.userdata, sx, sy, sw, sh, dx, dy, dw, dh);
+    _bolt_plugin_surface_draw_to_surface(functions, target->surface_functions.userdata, sx, sy, sw, sh, dx, dy, dw, dh);
     return 0;
 }
 
@@ -1140,7 +2769,7 @@ static int api_window_clear(lua_State* state) {
     switch (argc) {
         case 1: {
             const struct EmbeddedWindow* window = lua_touserdata(state, 1);
-            window->surface_functions.clear(window->surface_functions.userdata, 0.0, 0.0, 0.0, 0.0);
+            _bolt_plugin_surface_clear(&window->surface_functions, 0.0, 0.0, 0.0, 0.0);
             break;
         }
         case 4: {
@@ -1148,7 +2777,7 @@ static int api_window_clear(lua_State* state) {
             const double r = lua_tonumber(state, 2);
             const double g = lua_tonumber(state, 3);
             const double b = lua_tonumber(state, 4);
-            window->surface_functions.clear(window->surface_functions.userdata, r, g, b, 1.0);
+            _bolt_plugin_surface_clear(&window->surface_functions, r, g, b, 1.0);
             break;
         }
         case 5: {
@@ -1157,7 +2786,7 @@ static int api_window_clear(lua_State* state) {
             const double g = lua_tonumber(state, 3);
             const double b = lua_tonumber(state, 4);
             const double a = lua_tonumber(state, 5);
-            window->surface_functions.clear(window->surface_functions.userdata, r, g, b, a);
+            _bolt_plugin_surface_clear(&window->surface_functions, r, g, b, a);
             break;
         }
         default: {
@@ -1250,6 +2879,25 @@ static int api_render3d_vertexcolour(lua_State* state) {
     return 2;
 }
 
+static int api_render3d_vertexarrays(lua_State* state) {
+    _bolt_check_argc(state, 1, "render3d_vertexarrays");
+    const struct Render3D* render = lua_touserdata(state, 1);
+    const size_t count = render->vertex_count;
+    uint8_t* buffer = _bolt_vertex_arrays_buffer(sizeof(struct Vertex3DArrays) + (count * ((6 * sizeof(double)) + (3 * sizeof(int32_t)) + sizeof(uint32_t))));
+    if (!buffer) {
+        PUSHSTRING(state, "render3d_vertexarrays: out of memory");
+        lua_error(state);
+    }
+    struct Vertex3DArrays* arrays = (struct Vertex3DArrays*)buffer;
+    arrays->uv = (double*)(buffer + sizeof(struct Vertex3DArrays));
+    arrays->colour = arrays->uv + (count * 2);
+    arrays->xyz = (int32_t*)(arrays->colour + (count * 4));
+    arrays->atlas_meta = (uint32_t*)(arrays->xyz + (count * 3));
+    render->vertex_functions.decode(count, render->vertex_functions.userdata, arrays);
+    _bolt_push_ffi_pointer(state, "const struct BoltVertex3DArrays*", arrays);
+    return 1;
+}
+
 static int api_render3d_textureid(lua_State* state) {
     _bolt_check_argc(state, 1, "render3d_textureid");
     struct Render3D* render = lua_touserdata(state, 1);
@@ -1286,7 +2934,8 @@ static int api_render3d_texturedata(lua_State* state) {
     const size_t x = lua_tointeger(state, 2);
     const size_t y = lua_tointeger(state, 3);
     const size_t len = lua_tointeger(state, 4);
-    const uint8_t* ret = render->texture_functions.data(render->texture_functions.userdata, x, y);
+    const uint8_t* ret = render->texture_functions.data(render->texture_functions.userdata, x, y, len);
+    if (!ret) return luaL_error(state, "render3d_texturedata: out of memory");
     lua_pushlstring(state, (const char*)ret, len);
     return 1;
 }
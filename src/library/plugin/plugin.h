@@ -9,6 +9,7 @@
 struct RenderBatch2D;
 struct Plugin;
 struct lua_State;
+struct PluginWorker;
 
 enum PluginMouseButton {
     MBLeft = 1,
@@ -16,6 +17,18 @@ enum PluginMouseButton {
     MBMiddle = 3,
 };
 
+/// Types of event which plugins can set a callback for.
+enum PluginEventType {
+    PLUGIN_EVENT_SWAPBUFFERS,
+    PLUGIN_EVENT_BATCH2D,
+    PLUGIN_EVENT_RENDER3D,
+    PLUGIN_EVENT_MINIMAP,
+    PLUGIN_EVENT_MOUSEMOTION,
+    PLUGIN_EVENT_MOUSEBUTTON,
+    PLUGIN_EVENT_SCROLL,
+    PLUGIN_EVENT_ENUM_SIZE, // last member of enum
+};
+
 // having MouseEvent has the first member of structs allows for generalisation with pointers
 struct MouseEvent {
     int16_t x;
@@ -31,6 +44,26 @@ struct MouseEvent {
     uint8_t mb_middle;
 };
 
+/// Output of Vertex2DFunctions.decode. Each member is a contiguous array containing the same data
+/// as the equivalent per-vertex function, for every vertex in order, so for example the Y value of
+/// vertex N will be at `xy[(N * 2) + 1]`. The arrays are owned by whoever called decode.
+struct Vertex2DArrays {
+    int32_t* xy;       // 2 per vertex
+    int32_t* atlas_xy; // 2 per vertex
+    int32_t* atlas_wh; // 2 per vertex
+    double* uv;        // 2 per vertex
+    double* colour;    // 4 per vertex
+};
+
+/// Output of Vertex3DFunctions.decode, laid out the same way as Vertex2DArrays. Meta-IDs are
+/// truncated to 32 bits, which is enough to hold every meta-ID the game can currently produce.
+struct Vertex3DArrays {
+    int32_t* xyz;         // 3 per vertex
+    uint32_t* atlas_meta; // 1 per vertex
+    double* uv;           // 2 per vertex
+    double* colour;       // 4 per vertex
+};
+
 /// Struct containing "vtable" callback information for RenderBatch2D's list of vertices.
 /// Unless stated otherwise, functions will be called with three params: the index, the specified
 /// userdata, and an output pointer, which must be able to index the returned number of items.
@@ -53,6 +86,10 @@ struct Vertex2DFunctions {
 
     /// Returns the RGBA colour of this vertex, each one normalised from 0.0 to 1.0.
     void (*colour)(size_t index, void* userdata, double* out);
+
+    /// Decodes the first `count` vertices in one pass, filling every array in `out`. This gives
+    /// exactly the same results as calling each of the above functions for every vertex.
+    void (*decode)(size_t count, void* userdata, struct Vertex2DArrays* out);
 };
 
 /// Struct containing "vtable" callback information for Render3D's list of vertices.
@@ -79,6 +116,10 @@ struct Vertex3DFunctions {
 
     /// Returns the RGBA colour of this vertex, each one normalised from 0.0 to 1.0.
     void (*colour)(size_t index, void* userdata, double* out);
+
+    /// Decodes the first `count` vertices in one pass, filling every array in `out`. This gives
+    /// exactly the same results as calling each of the per-vertex functions for every vertex.
+    void (*decode)(size_t count, void* userdata, struct Vertex3DArrays* out);
 };
 
 /// Struct containing "vtable" callback information for textures.
@@ -102,7 +143,10 @@ struct TextureFunctions {
 
     /// Fetches a pointer to the texture's pixel data at coordinates x and y. Doesn't do any checks
     /// on whether x and y are in-bounds. Data is always RGBA and pixel rows are always contiguous.
-    uint8_t* (*data)(void* userdata, size_t x, size_t y);
+    /// `len` is the number of bytes the caller is going to read, so that they can be decoded first
+    /// if the texture was uploaded in a compressed format. Returns NULL if the texture's RGBA copy
+    /// couldn't be allocated.
+    uint8_t* (*data)(void* userdata, size_t x, size_t y, size_t len);
 };
 
 /// Struct containing "vtable" callback information for 3D renders' transformation matrices.
@@ -110,6 +154,10 @@ struct Render3DMatrixFunctions {
     /// Userdata which will be passed to the functions contained in this struct.
     void* userdata;
 
+    /// Size of the userdata in bytes. The userdata must not point to anything else, so that it can
+    /// be copied and used with these functions after the event has ended, from any thread.
+    size_t userdata_size;
+
     /// Converts an XYZ coordinate from model space to world space.
     void (*to_world_space)(int x, int y, int z, void* userdata, double* out);
 
@@ -143,6 +191,15 @@ struct PluginManagedFunctions {
     void (*surface_init)(struct SurfaceFunctions*, unsigned int, unsigned int, const void*);
     void (*surface_destroy)(void*);
     void (*surface_resize_and_clear)(void*, unsigned int, unsigned int);
+
+    /// Equivalent to TextureFunctions.compare, but looks the texture up by its ID. Unlike all the
+    /// other functions here, these two may be called from threads other than the render thread.
+    /// Returns false if the texture no longer exists.
+    uint8_t (*texture_compare)(size_t id, size_t x, size_t y, size_t len, const unsigned char* data);
+
+    /// Copies `len` bytes of the texture's RGBA data, starting at x,y, into `out`. Returns false and
+    /// zeroes `out` if the texture no longer exists or the range is out of bounds.
+    uint8_t (*texture_read)(size_t id, size_t x, size_t y, size_t len, uint8_t* out);
 };
 
 struct WindowPendingInput {
@@ -172,6 +229,7 @@ struct EmbeddedWindow {
     uint64_t id;
     struct SurfaceFunctions surface_functions;
     struct lua_State* plugin;
+    struct PluginWorker* worker; // the thread which `plugin` runs on
     RWLock lock; // applies to the metadata
     struct EmbeddedWindowMetadata metadata;
     RWLock input_lock; // applies to the pending inputs
@@ -224,6 +282,20 @@ void _bolt_plugin_on_startup();
 /// Init the plugin library. Call _bolt_plugin_close at the end of execution, and don't double-init.
 /// Must be provided with a fully-populated PluginManagedFunctions struct for backend-specific functions
 /// from plugin code. The contents are copied so they do not need to remain in scope after this function ends.
+///
+/// If the environment variable BOLT_PLUGIN_THREADED is set to anything other than "0", plugins will
+/// be run on a pool of worker threads instead of the render thread. Each plugin is pinned to one
+/// worker, and the workers send the same frame to their own plugins concurrently. The pool has one
+/// thread fewer than the number of CPUs, up to 8, or BOLT_PLUGIN_WORKERS threads if that's set. In
+/// that mode, render events are captured into a snapshot of each frame which the workers send out
+/// to plugins while the next frame is being rendered, and anything plugins do to surfaces is carried
+/// out on the render thread during _bolt_plugin_process_windows, once every worker has finished. If
+/// the workers are still busy when a frame ends, that frame's render events are dropped, but its
+/// mouse and window events are kept for the next frame.
+///
+/// The time limits for plugins which don't set their own in their bolt.json can be changed with
+/// BOLT_PLUGIN_FRAME_BUDGET_US, BOLT_PLUGIN_CALL_LIMIT_US, BOLT_PLUGIN_MAX_VIOLATIONS and
+/// BOLT_PLUGIN_HOOK_INSTRUCTIONS (see PLUGIN_FRAME_BUDGET in plugin.c).
 void _bolt_plugin_init(const struct PluginManagedFunctions*);
 
 /// Returns true if the plugin library is initialised (i.e. init has been called more recently than
@@ -244,6 +316,10 @@ void _bolt_plugin_ipc_init(int*);
 /// Closes the IPC channel. (OS-specific)
 void _bolt_plugin_ipc_close(int);
 
+/// Writes the path of the file which the trace buffer should be dumped to into `out`, which is
+/// `len` bytes long. The path is unique to this process. (OS-specific)
+void _bolt_plugin_trace_path(char* out, size_t len);
+
 /// Gets a reference to the global WindowInfo struct
 struct WindowInfo* _bolt_plugin_windowinfo();
 
@@ -260,16 +336,20 @@ uint8_t _bolt_plugin_add(const char* path, struct Plugin* plugin);
 /// Stops a plugin via its unique ID, as passed to `_bolt_plugin_add`.
 void _bolt_plugin_stop(char* id, uint32_t id_length);
 
+/// Returns true if at least one running plugin has a callback set for this type of event. If not,
+/// there's no need to build the event at all, since calling the handler for it would do nothing.
+uint8_t _bolt_plugin_has_subscribers(enum PluginEventType);
+
 /// Sends a SwapBuffers event to all plugins.
 void _bolt_plugin_handle_swapbuffers(struct SwapBuffersEvent*);
 
-/// Sends a RenderBatch2D to all plugins.
+/// Sends a RenderBatch2D to all plugins, or in threaded mode, captures it to be sent by the worker.
 void _bolt_plugin_handle_2d(struct RenderBatch2D*);
 
-/// Sends a Render3D to all plugins.
+/// Sends a Render3D to all plugins, or in threaded mode, captures it to be sent by the worker.
 void _bolt_plugin_handle_3d(struct Render3D*);
 
-/// Sends a RenderMinimap to all plugins.
+/// Sends a RenderMinimap to all plugins, or in threaded mode, captures it to be sent by the worker.
 void _bolt_plugin_handle_minimap(struct RenderMinimapEvent*);
 
 #endif
@@ -122,9 +122,22 @@ static int api_createsurfacefromrgba(lua_State*);
 ///
 /// As with `createsurface`, the width and height of your PNG file should be integral powers of 2.
 ///
-/// Loading PNG files is slow, so use this function sparingly.
+/// Loading PNG files is slow, so use this function sparingly, or use `createsurfacefrompngasync`
+/// instead.
 static int api_createsurfacefrompng(lua_State*);
 
+/// [-2, +1, e]
+/// Same as `createsurfacefrompng`, except that the file is loaded on a background thread so that
+/// the game doesn't freeze while it's being read and decoded. Takes a path, interpreted the same way
+/// as in `createsurfacefrompng`, and a callback function.
+///
+/// Returns a surface object straight away, which stays empty until loading has finished. Until
+/// then, drawing to or from it does nothing. Once the file has been loaded, at the start of a
+/// later frame, the surface is created and the callback is called with the surface, width and
+/// height as arguments, before that frame's swapbuffers callback. If the file can't be loaded, the
+/// callback is called with nil and an error message instead, and the surface stays empty forever.
+static int api_createsurfacefrompngasync(lua_State*);
+
 /// [-4, +1, -]
 /// Creates an embedded window with the given initial values for x, y, width, height. The x and y
 /// relate to the top-left corner of the window. An embedded window's top, left, bottom and right
@@ -292,6 +305,31 @@ static int api_batch2d_vertexuv(lua_State*);
 /// Also aliased as "vertexcolor" to keep the Americans happy.
 static int api_batch2d_vertexcolour(lua_State*);
 
+/// [-1, +1, -]
+/// Decodes every vertex in the batch at once and returns a table containing the results. This is
+/// much faster than calling the vertex functions above for each vertex individually, so it should
+/// be preferred if a plugin is going to look at most or all of the vertices in a batch.
+///
+/// The table has the fields `xy`, `atlasxy`, `atlaswh`, `uv` and `colour`, each one being a flat
+/// array containing the values that would be returned by the equivalent function above, for each
+/// vertex in order. For example, the X and Y of vertex N are `t.xy[(N * 2) - 1]` and
+/// `t.xy[N * 2]`, and its red, green, blue and alpha are `t.colour[(N * 4) - 3]` through
+/// `t.colour[N * 4]`.
+static int api_batch2d_vertices(lua_State*);
+
+/// [-1, +1, -]
+/// Decodes every vertex in the batch at once and returns a LuaJIT FFI pointer to a struct with the
+/// fields `xy`, `atlasxy`, `atlaswh`, `uv` and `colour`. Each field is a pointer to an array of
+/// the same values that `vertices()` would return, except that they're indexed from 0 rather than
+/// 1, so the X and Y of vertex N (with N starting at 1) are `v.xy[(N - 1) * 2]` and
+/// `v.xy[((N - 1) * 2) + 1]`. Unlike `vertices()`, this doesn't create any Lua tables, so loops
+/// over the arrays can be JIT-compiled and run at close to native speed.
+///
+/// The arrays become invalid as soon as the callback ends, or as soon as any other
+/// `vertexarrays()` function is called, whichever happens first. There is no bounds checking, so
+/// don't index past `vertexcount()`.
+static int api_batch2d_vertexarrays(lua_State*);
+
 /// [-1, +1, -]
 /// Returns the unique ID of the texture associated with this render. There will always be one (and
 /// only one) texture associated with a 2D render batch. These textures are "atlased", meaning they
@@ -464,6 +502,18 @@ static int api_render3d_vertexuv(lua_State*);
 /// Also aliased as "vertexcolor" to keep the Americans happy.
 static int api_render3d_vertexcolour(lua_State*);
 
+/// [-1, +1, -]
+/// Decodes every vertex in the model at once and returns a LuaJIT FFI pointer to a struct with the
+/// fields `xyz`, `meta`, `uv` and `colour`. Each field is a pointer to an array of values that
+/// would be returned by the equivalent function above for each vertex in order, with 3 values per
+/// vertex for `xyz`, one for `meta`, 2 for `uv` and 4 for `colour`. The arrays are indexed from 0,
+/// so the meta-ID of vertex N (with N starting at 1) is `v.meta[N - 1]`.
+///
+/// The same lifetime rules apply as for `batch2d_vertexarrays()`: the arrays become invalid when
+/// the callback ends or when any other `vertexarrays()` function is called, and there is no bounds
+/// checking.
+static int api_render3d_vertexarrays(lua_State*);
+
 /// [-1, +1, -]
 /// Returns the unique ID of the texture associated with this render. There will always be one (and
 /// only one) texture associated with a 3D model render. These textures are "atlased", meaning they
@@ -26,3 +26,9 @@ void _bolt_plugin_ipc_close(int fd) {
     close(fd);
     errno = olderr;
 }
+
+void _bolt_plugin_trace_path(char* out, size_t len) {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    const char* prefix = (runtime_dir && *runtime_dir) ? runtime_dir : "/tmp";
+    snprintf(out, len, "%s/bolt-launcher/trace-%i.json", prefix, (int)getpid());
+}
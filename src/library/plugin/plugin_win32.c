@@ -1,5 +1,8 @@
 #include "plugin.h"
 
+#include <stdio.h>
+#include <windows.h>
+
 void _bolt_plugin_ipc_init(int* fd) {
     // TODO
 }
@@ -7,3 +10,9 @@ void _bolt_plugin_ipc_init(int* fd) {
 void _bolt_plugin_ipc_close(int fd) {
     // TODO
 }
+
+void _bolt_plugin_trace_path(char* out, size_t len) {
+    char temp_dir[MAX_PATH + 1];
+    if (!GetTempPathA(sizeof(temp_dir), temp_dir)) temp_dir[0] = '\0';
+    snprintf(out, len, "%sbolt-trace-%lu.json", temp_dir, (unsigned long)GetCurrentProcessId());
+}
@@ -10,7 +10,9 @@
 
 #include "x.h"
 #include "../gl.h"
+#include "../capture/capture.h"
 #include "../plugin/plugin.h"
+#include "../trace/trace.h"
 #include "../../../modules/hashmap/hashmap.h"
 
 // comment or uncomment this to enable verbose logging of hooks in this file
@@ -268,6 +270,7 @@ static int _bolt_dl_iterate_callback(struct dl_phdr_info* info, size_t size, voi
 
 static void _bolt_init_functions() {
     _bolt_plugin_on_startup();
+    _bolt_capture_init();
     pthread_mutex_init(&egl_lock, NULL);
     dl_iterate_phdr(_bolt_dl_iterate_callback, NULL);
     inited = 1;
@@ -338,7 +341,9 @@ void* eglGetProcAddress(const char* name) {
 unsigned int eglSwapBuffers(void* display, void* surface) {
     LOG("eglSwapBuffers\n");
     _bolt_gl_onSwapBuffers(main_window_width, main_window_height);
+    const uint64_t trace_start = _bolt_trace_begin();
     unsigned int ret = real_eglSwapBuffers(display, surface);
+    _bolt_trace_end("eglSwapBuffers", trace_start);
     LOG("eglSwapBuffers end (returned %u)\n", ret);
     return ret;
 }
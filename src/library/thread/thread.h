@@ -0,0 +1,41 @@
+#ifndef _BOLT_LIBRARY_THREAD_H_
+#define _BOLT_LIBRARY_THREAD_H_
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef HANDLE Thread;
+typedef struct {
+    SRWLOCK lock;
+    CONDITION_VARIABLE cond;
+    uint8_t set;
+} Signal;
+#else
+#include <pthread.h>
+typedef pthread_t Thread;
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t set;
+} Signal;
+#endif
+
+/// Starts a new thread which calls `func` with `arg`. Returns 0 on success or 1 on failure.
+uint8_t _bolt_thread_start(Thread*, void (*func)(void*), void* arg);
+
+/// Waits for a thread to exit.
+void _bolt_thread_join(Thread*);
+
+/// Returns the number of logical CPUs available to this process, or 1 if it can't be found.
+uint32_t _bolt_thread_cpu_count();
+
+/// A Signal is a flag which one thread can wait on until another thread sets it. It resets itself
+/// when a waiting thread wakes up, so setting it several times before anything waits on it will
+/// only wake one wait.
+void _bolt_signal_init(Signal*);
+void _bolt_signal_set(Signal*);
+void _bolt_signal_wait(Signal*);
+void _bolt_signal_destroy(Signal*);
+
+#endif
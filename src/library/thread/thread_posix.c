@@ -0,0 +1,62 @@
+#include "thread.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+struct ThreadStart {
+    void (*func)(void*);
+    void* arg;
+};
+
+static void* _bolt_thread_main(void* arg) {
+    struct ThreadStart start = *(struct ThreadStart*)arg;
+    free(arg);
+    start.func(start.arg);
+    return NULL;
+}
+
+uint8_t _bolt_thread_start(Thread* thread, void (*func)(void*), void* arg) {
+    struct ThreadStart* start = malloc(sizeof(struct ThreadStart));
+    if (!start) return 1;
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, _bolt_thread_main, start)) {
+        free(start);
+        return 1;
+    }
+    return 0;
+}
+
+void _bolt_thread_join(Thread* thread) {
+    pthread_join(*thread, NULL);
+}
+
+uint32_t _bolt_thread_cpu_count() {
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
+void _bolt_signal_init(Signal* signal) {
+    pthread_mutex_init(&signal->mutex, NULL);
+    pthread_cond_init(&signal->cond, NULL);
+    signal->set = 0;
+}
+
+void _bolt_signal_set(Signal* signal) {
+    pthread_mutex_lock(&signal->mutex);
+    signal->set = 1;
+    pthread_cond_signal(&signal->cond);
+    pthread_mutex_unlock(&signal->mutex);
+}
+
+void _bolt_signal_wait(Signal* signal) {
+    pthread_mutex_lock(&signal->mutex);
+    while (!signal->set) pthread_cond_wait(&signal->cond, &signal->mutex);
+    signal->set = 0;
+    pthread_mutex_unlock(&signal->mutex);
+}
+
+void _bolt_signal_destroy(Signal* signal) {
+    pthread_cond_destroy(&signal->cond);
+    pthread_mutex_destroy(&signal->mutex);
+}
@@ -0,0 +1,61 @@
+#include "thread.h"
+
+#include <stdlib.h>
+
+struct ThreadStart {
+    void (*func)(void*);
+    void* arg;
+};
+
+static DWORD WINAPI _bolt_thread_main(LPVOID arg) {
+    struct ThreadStart start = *(struct ThreadStart*)arg;
+    free(arg);
+    start.func(start.arg);
+    return 0;
+}
+
+uint8_t _bolt_thread_start(Thread* thread, void (*func)(void*), void* arg) {
+    struct ThreadStart* start = malloc(sizeof(struct ThreadStart));
+    if (!start) return 1;
+    start->func = func;
+    start->arg = arg;
+    *thread = CreateThread(NULL, 0, _bolt_thread_main, start, 0, NULL);
+    if (!*thread) {
+        free(start);
+        return 1;
+    }
+    return 0;
+}
+
+void _bolt_thread_join(Thread* thread) {
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+}
+
+uint32_t _bolt_thread_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+void _bolt_signal_init(Signal* signal) {
+    InitializeSRWLock(&signal->lock);
+    InitializeConditionVariable(&signal->cond);
+    signal->set = 0;
+}
+
+void _bolt_signal_set(Signal* signal) {
+    AcquireSRWLockExclusive(&signal->lock);
+    signal->set = 1;
+    WakeConditionVariable(&signal->cond);
+    ReleaseSRWLockExclusive(&signal->lock);
+}
+
+void _bolt_signal_wait(Signal* signal) {
+    AcquireSRWLockExclusive(&signal->lock);
+    while (!signal->set) SleepConditionVariableSRW(&signal->cond, &signal->lock, INFINITE, 0);
+    signal->set = 0;
+    ReleaseSRWLockExclusive(&signal->lock);
+}
+
+void _bolt_signal_destroy(Signal* signal) {}
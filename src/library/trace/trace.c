@@ -0,0 +1,117 @@
+#include "trace.h"
+
+#include "../rwlock/rwlock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define thread_local __declspec(thread)
+#else
+#include <unistd.h>
+#define thread_local _Thread_local
+#endif
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint32_t duration;
+    uint32_t thread;
+};
+
+uint8_t _bolt_trace_enabled = 0;
+
+// the buffer is written to by whichever thread the traced code runs on, so all access to it, and
+// to next_thread_id, goes through `lock`. `count` is the total number of events ever recorded, so
+// the next one goes at index `count % TRACE_CAPACITY`.
+static RWLock lock;
+static struct TraceEvent* events = NULL;
+static uint64_t count = 0;
+static uint32_t next_thread_id = 1;
+static thread_local uint32_t thread_id = 0;
+
+#if defined(_WIN32)
+static LARGE_INTEGER frequency;
+#endif
+
+void _bolt_trace_init() {
+    const char* env = getenv("BOLT_TRACE");
+    if (!env || !*env || !strcmp(env, "0")) return;
+    events = malloc(TRACE_CAPACITY * sizeof(struct TraceEvent));
+    if (!events) {
+        printf("error: out of memory allocating trace buffer, tracing will be disabled\n");
+        return;
+    }
+#if defined(_WIN32)
+    QueryPerformanceFrequency(&frequency);
+#endif
+    _bolt_rwlock_init(&lock);
+    _bolt_trace_enabled = 1;
+}
+
+uint64_t _bolt_trace_now() {
+#if defined(_WIN32)
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return (ticks.QuadPart * 1000000) / frequency.QuadPart;
+#else
+    struct timespec s;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &s);
+    return (s.tv_sec * 1000000) + (s.tv_nsec / 1000);
+#endif
+}
+
+void _bolt_trace_record(const char* name, uint64_t start) {
+    const uint64_t end = _bolt_trace_now();
+    _bolt_rwlock_lock_write(&lock);
+    if (!thread_id) {
+        thread_id = next_thread_id;
+        next_thread_id += 1;
+    }
+    struct TraceEvent* event = &events[count % TRACE_CAPACITY];
+    event->name = name;
+    event->start = start;
+    event->duration = (uint32_t)(end - start);
+    event->thread = thread_id;
+    count += 1;
+    _bolt_rwlock_unlock_write(&lock);
+}
+
+uint8_t _bolt_trace_dump(const char* path) {
+    if (!_bolt_trace_enabled) return 1;
+
+    // copy the events out first, so that traced code isn't held up while the file is being written
+    struct TraceEvent* copy = malloc(TRACE_CAPACITY * sizeof(struct TraceEvent));
+    if (!copy) return 1;
+    _bolt_rwlock_lock_write(&lock);
+    const size_t event_count = count < TRACE_CAPACITY ? count : TRACE_CAPACITY;
+    const size_t first = count < TRACE_CAPACITY ? 0 : (count % TRACE_CAPACITY);
+    for (size_t i = 0; i < event_count; i += 1) {
+        copy[i] = events[(first + i) % TRACE_CAPACITY];
+    }
+    _bolt_rwlock_unlock_write(&lock);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        free(copy);
+        return 1;
+    }
+#if defined(_WIN32)
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = getpid();
+#endif
+    fputs("{\"traceEvents\":[", file);
+    for (size_t i = 0; i < event_count; i += 1) {
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%lu,\"pid\":%lu,\"tid\":%lu}",
+            i ? "," : "", copy[i].name, (unsigned long long)copy[i].start, (unsigned long)copy[i].duration, pid, (unsigned long)copy[i].thread);
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    const uint8_t failed = ferror(file) != 0;
+    fclose(file);
+    free(copy);
+    return failed;
+}
@@ -0,0 +1,39 @@
+#ifndef _BOLT_LIBRARY_TRACE_H_
+#define _BOLT_LIBRARY_TRACE_H_
+
+#include <stdint.h>
+
+/// Number of events kept in the trace buffer. Once it's full, the oldest events are overwritten.
+#define TRACE_CAPACITY 65536
+
+/// Non-zero if tracing is enabled. This is set by _bolt_trace_init and never changes afterwards.
+extern uint8_t _bolt_trace_enabled;
+
+/// Enables tracing if the environment variable BOLT_TRACE is set to anything other than "0". This
+/// must be called once, before any other trace function. While tracing is disabled, the only cost
+/// of a traced section is one branch in _bolt_trace_begin and one in _bolt_trace_end.
+void _bolt_trace_init();
+
+/// Returns the value of a monotonic clock in microseconds.
+uint64_t _bolt_trace_now();
+
+/// Records an event called `name` which started at `start` and ends now. `name` is stored by pointer,
+/// so it must be a string literal or otherwise valid for as long as the library is loaded.
+void _bolt_trace_record(const char* name, uint64_t start);
+
+/// Returns the start time to pass to _bolt_trace_end for a section of code, or 0 if tracing is disabled.
+static inline uint64_t _bolt_trace_begin() {
+    return _bolt_trace_enabled ? _bolt_trace_now() : 0;
+}
+
+/// Records the end of a section of code started by _bolt_trace_begin. Does nothing if `start` is 0.
+static inline void _bolt_trace_end(const char* name, uint64_t start) {
+    if (start) _bolt_trace_record(name, start);
+}
+
+/// Writes every event in the buffer to `path` in the Chrome trace event JSON format, which can be
+/// opened by chrome://tracing or Perfetto. The buffer isn't cleared. Returns 0 on success or 1 on
+/// failure, including if tracing is disabled.
+uint8_t _bolt_trace_dump(const char* path);
+
+#endif